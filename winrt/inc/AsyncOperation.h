@@ -252,6 +252,40 @@ public:
     }
 
 
+    // Creates an operation that runs nothing by itself. Whatever owns it does the
+    // work however it likes, then reports the outcome by calling Complete or Fail.
+    AsyncOperation()
+    {
+    }
+
+
+    // Returns false once the operation has been cancelled, so the owner can skip
+    // any work it has not yet started.
+    bool ShouldContinue()
+    {
+        return ContinueAsyncOperation();
+    }
+
+
+    // Finishes an operation created by the default constructor. If it has been
+    // cancelled, these just notify listeners.
+    void Complete(Microsoft::WRL::ComPtr<T> const& result)
+    {
+        m_result = result;
+
+        if (!TryTransitionToCompleted())
+            m_result = nullptr;
+
+        FireCompletion();
+    }
+
+    void Fail(HRESULT hr)
+    {
+        (void)TryTransitionToError(hr);
+        FireCompletion();
+    }
+
+
     // Gets the result of the async operation.
     virtual HRESULT STDMETHODCALLTYPE GetResults(T_abi* results)
     {
@@ -118,7 +118,7 @@ void CanvasImageBrush::SetImage(ICanvasImage* image)
     else
     {
         // Use an image brush.
-        auto d2dImage = As<ICanvasImageInternal>(image)->GetD2DImage(m_device.EnsureNotClosed().Get(), nullptr, GetImageFlags::MinimalRealization);
+        auto d2dImage = As<ICanvasImageInternal>(image)->GetD2DImage(m_device.EnsureNotClosed().Get(), nullptr, GetImageFlags::MinimalRealization | GetImageFlags::RetainRealization);
 
         if (m_d2dImageBrush)
         {
@@ -457,8 +457,8 @@ void CanvasImageBrush::RealizeSourceEffect(ID2D1DeviceContext* deviceContext, Ge
     // Look up the corresponding Win2D wrapper instance.
     auto& sourceEffect = m_currentImageCache.GetOrCreateWrapper(m_device.EnsureNotClosed().Get(), d2dImage.Get());
 
-    // Make sure the effect is properly realized.
-    auto realizedEffect = As<ICanvasImageInternal>(sourceEffect)->GetD2DImage(m_device.EnsureNotClosed().Get(), deviceContext, flags, dpi);
+    // Make sure the effect is properly realized. The brush holds on to it, so it must not be recycled.
+    auto realizedEffect = As<ICanvasImageInternal>(sourceEffect)->GetD2DImage(m_device.EnsureNotClosed().Get(), deviceContext, flags | GetImageFlags::RetainRealization, dpi);
 
     // If realization changed the D2D effect instance, update ourselves to use the new version.
     if (m_currentImageCache.UpdateResource(realizedEffect.Get()))
@@ -0,0 +1,142 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "GradientStopCollectionCache.h"
+#include "utils/HashUtilities.h"
+
+using namespace ABI::Microsoft::Graphics::Canvas;
+
+
+//
+// GradientStopCollectionKey implementation
+//
+
+
+static_assert(sizeof(D2D1_GRADIENT_STOP) == sizeof(float) * 5, "D2D1_GRADIENT_STOP should have no padding");
+
+
+size_t GradientStopCollectionKey::GetHash() const
+{
+    size_t hash = HashBytes(HashSeed, Stops.data(), Stops.size() * sizeof(D2D1_GRADIENT_STOP));
+    hash = HashValue(hash, PreInterpolationSpace);
+    hash = HashValue(hash, PostInterpolationSpace);
+    hash = HashValue(hash, BufferPrecision);
+    hash = HashValue(hash, ExtendMode);
+    hash = HashValue(hash, InterpolationMode);
+
+    return hash;
+}
+
+
+bool GradientStopCollectionKey::operator==(GradientStopCollectionKey const& other) const
+{
+    if (PreInterpolationSpace != other.PreInterpolationSpace ||
+        PostInterpolationSpace != other.PostInterpolationSpace ||
+        BufferPrecision != other.BufferPrecision ||
+        ExtendMode != other.ExtendMode ||
+        InterpolationMode != other.InterpolationMode)
+    {
+        return false;
+    }
+
+    if (Stops.size() != other.Stops.size())
+        return false;
+
+    return Stops.empty() || memcmp(Stops.data(), other.Stops.data(), Stops.size() * sizeof(D2D1_GRADIENT_STOP)) == 0;
+}
+
+
+//
+// GradientStopCollectionCache implementation
+//
+
+
+GradientStopCollectionCache::GradientStopCollectionCache()
+    : m_hitCount(0)
+    , m_missCount(0)
+{
+}
+
+
+void GradientStopCollectionCache::Clear()
+{
+    Lock lock(m_mutex);
+
+    m_entries.Clear();
+}
+
+
+size_t GradientStopCollectionCache::GetEntryCount()
+{
+    Lock lock(m_mutex);
+    return m_entries.Size();
+}
+
+
+uint64_t GradientStopCollectionCache::GetHitCount()
+{
+    Lock lock(m_mutex);
+    return m_hitCount;
+}
+
+
+uint64_t GradientStopCollectionCache::GetMissCount()
+{
+    Lock lock(m_mutex);
+    return m_missCount;
+}
+
+
+ComPtr<ID2D1GradientStopCollection1> GradientStopCollectionCache::Find(GradientStopCollectionKey const& key, size_t hash)
+{
+    Lock lock(m_mutex);
+
+    auto entry = FindEntry(lock, key, hash);
+
+    if (entry == m_entries.end())
+    {
+        ++m_missCount;
+        return nullptr;
+    }
+
+    ++m_hitCount;
+
+    // Move it to the front, since it has just been used
+    m_entries.MoveToFront(entry);
+
+    return entry->Value.StopCollection;
+}
+
+
+ComPtr<ID2D1GradientStopCollection1> GradientStopCollectionCache::Add(
+    GradientStopCollectionKey&& key,
+    size_t hash,
+    ComPtr<ID2D1GradientStopCollection1>&& stopCollection)
+{
+    Lock lock(m_mutex);
+
+    // Another thread may have added the same collection while ours was being
+    // created
+    auto existing = FindEntry(lock, key, hash);
+    if (existing != m_entries.end())
+        return existing->Value.StopCollection;
+
+    m_entries.AddToFront(hash, Entry{ std::move(key), stopCollection });
+    m_entries.TrimToCount(MaxEntries);
+
+    return std::move(stopCollection);
+}
+
+
+GradientStopCollectionCache::EntryList::iterator GradientStopCollectionCache::FindEntry(
+    Lock const& lock,
+    GradientStopCollectionKey const& key,
+    size_t hash)
+{
+    MustOwnLock(lock);
+
+    return m_entries.Find(hash, [&](Entry const& entry) { return entry.Key == key; });
+}
@@ -0,0 +1,102 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+#include "utils/LruList.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Everything that goes into creating a gradient stop collection.  Stops
+    // are compared bit for bit, so eg. 0 and -0 are considered different.
+    // That only ever costs a cache miss.
+    //
+    struct GradientStopCollectionKey
+    {
+        std::vector<D2D1_GRADIENT_STOP> Stops;
+        D2D1_COLOR_SPACE PreInterpolationSpace;
+        D2D1_COLOR_SPACE PostInterpolationSpace;
+        D2D1_BUFFER_PRECISION BufferPrecision;
+        D2D1_EXTEND_MODE ExtendMode;
+        D2D1_COLOR_INTERPOLATION_MODE InterpolationMode;
+
+        size_t GetHash() const;
+
+        bool operator==(GradientStopCollectionKey const& other) const;
+    };
+
+
+    //
+    // Each CanvasDevice owns one of these, so that gradient brushes created
+    // with the same stops and settings share a single stop collection.  Stop
+    // collections are immutable, so sharing them is safe.
+    //
+    // The cache holds up to MaxEntries collections, discarding the least
+    // recently used.  It is cleared when the device is trimmed, lost or
+    // closed.
+    //
+    class GradientStopCollectionCache
+    {
+        struct Entry
+        {
+            GradientStopCollectionKey Key;
+            ComPtr<ID2D1GradientStopCollection1> StopCollection;
+        };
+
+        typedef LruList<Entry> EntryList;
+
+        std::mutex m_mutex;
+
+        // Indexed by key hash; different keys may share a hash
+        EntryList m_entries;
+
+        uint64_t m_hitCount;
+        uint64_t m_missCount;
+
+    public:
+        static uint32_t const MaxEntries = 64;
+
+        GradientStopCollectionCache();
+
+        GradientStopCollectionCache(GradientStopCollectionCache const&) = delete;
+        GradientStopCollectionCache& operator=(GradientStopCollectionCache const&) = delete;
+
+        //
+        // Returns the cached collection for key, or calls create (which is
+        // passed the key) to make one.  create is called without holding the
+        // lock, so if two threads race to create the same collection the
+        // second one to finish gets the first one's result.
+        //
+        template<typename FN>
+        ComPtr<ID2D1GradientStopCollection1> GetOrCreate(GradientStopCollectionKey&& key, FN&& create)
+        {
+            auto hash = key.GetHash();
+
+            if (auto stopCollection = Find(key, hash))
+                return stopCollection;
+
+            auto stopCollection = create(key);
+
+            return Add(std::move(key), hash, std::move(stopCollection));
+        }
+
+        void Clear();
+
+        size_t GetEntryCount();
+        uint64_t GetHitCount();
+        uint64_t GetMissCount();
+
+    private:
+        ComPtr<ID2D1GradientStopCollection1> Find(GradientStopCollectionKey const& key, size_t hash);
+
+        ComPtr<ID2D1GradientStopCollection1> Add(
+            GradientStopCollectionKey&& key,
+            size_t hash,
+            ComPtr<ID2D1GradientStopCollection1>&& stopCollection);
+
+        EntryList::iterator FindEntry(Lock const& lock, GradientStopCollectionKey const& key, size_t hash);
+    };
+}}}}
@@ -633,6 +633,36 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             });
     }
 
+    IFACEMETHODIMP CanvasDevice::get_EffectCacheStatistics(CanvasEffectCacheStatistics* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                GetResource();  // this ensures that Close() hasn't been called
+
+                value->EntryCount = static_cast<int32_t>(m_realizedEffectCache.GetEntryCount());
+                value->HitCount = static_cast<int64_t>(m_realizedEffectCache.GetHitCount());
+                value->MissCount = static_cast<int64_t>(m_realizedEffectCache.GetMissCount());
+            });
+    }
+
+    IFACEMETHODIMP CanvasDevice::get_GradientStopCacheStatistics(CanvasGradientStopCacheStatistics* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                GetResource();  // this ensures that Close() hasn't been called
+
+                value->EntryCount = static_cast<int32_t>(m_gradientStopCollectionCache.GetEntryCount());
+                value->HitCount = static_cast<int64_t>(m_gradientStopCollectionCache.GetHitCount());
+                value->MissCount = static_cast<int64_t>(m_gradientStopCollectionCache.GetMissCount());
+            });
+    }
+
     IFACEMETHODIMP CanvasDevice::add_DeviceLost(
         DeviceLostHandlerType* value, 
         EventRegistrationToken* token)
@@ -694,6 +724,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                     ThrowHR(E_INVALIDARG, Strings::DeviceExpectedToBeLost);
                 }
 
+                // Nothing created on the lost device can be used again
+                m_gradientStopCollectionCache.Clear();
+                m_realizedEffectCache.Clear();
+                ClearHistogramEffects();
+                ClearDrawImageEffects();
+
                 ThrowIfFailed(m_deviceLostEventList.InvokeAll(this, nullptr));
             });
     }
@@ -718,13 +754,18 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             [&]
             {
                 m_deviceContextPool.Close();
+                m_gradientStopCollectionCache.Clear();
+                m_realizedEffectCache.Clear();
+#if WINVER > _WIN32_WINNT_WINBLUE
+                m_spriteBufferPool.Trim();
+#endif
                 ThrowIfFailed(this->ResourceWrapper::Close()); // 'this->' is workaround for VS2013 calling with bad 'this' pointer
 
                 m_dxgiDevice.Close();
                 m_primaryOutput.Reset();
                 m_sharedState.reset();
-                m_histogramEffect.Reset();
-                m_atlasEffect.Reset();
+                ClearHistogramEffects();
+                ClearDrawImageEffects();
         });
     }
 
@@ -1020,6 +1061,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
                 d2dDevice->ClearResources();
 
+                m_gradientStopCollectionCache.Clear();
+                m_realizedEffectCache.Clear();
+                ClearHistogramEffects();
+                ClearDrawImageEffects();
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+                m_spriteBufferPool.Trim();
+#endif
+
                 dxgiDevice->Trim();
             });
     }
@@ -1043,20 +1093,32 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         D2D1_EXTEND_MODE extendMode,
         D2D1_COLOR_INTERPOLATION_MODE interpolationMode)
     {
-        auto deviceContext = GetResourceCreationDeviceContext();
-
-        ComPtr<ID2D1GradientStopCollection1> gradientStopCollection;
-        ThrowIfFailed(deviceContext->CreateGradientStopCollection(
-            stops.data(),
-            static_cast<uint32_t>(stops.size()),
+        GradientStopCollectionKey cacheKey{
+            std::move(stops),
             preInterpolationSpace,
             postInterpolationSpace,
             bufferPrecision,
             extendMode,
-            interpolationMode,
-            &gradientStopCollection));
+            interpolationMode };
+
+        return m_gradientStopCollectionCache.GetOrCreate(std::move(cacheKey),
+            [&] (GradientStopCollectionKey const& key)
+            {
+                auto deviceContext = GetResourceCreationDeviceContext();
 
-        return gradientStopCollection;
+                ComPtr<ID2D1GradientStopCollection1> gradientStopCollection;
+                ThrowIfFailed(deviceContext->CreateGradientStopCollection(
+                    key.Stops.data(),
+                    static_cast<uint32_t>(key.Stops.size()),
+                    key.PreInterpolationSpace,
+                    key.PostInterpolationSpace,
+                    key.BufferPrecision,
+                    key.ExtendMode,
+                    key.InterpolationMode,
+                    &gradientStopCollection));
+
+                return gradientStopCollection;
+            });
     }
 
     ComPtr<ID2D1LinearGradientBrush> CanvasDevice::CreateLinearGradientBrush(
@@ -1329,27 +1391,135 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
     CanvasDevice::HistogramAndAtlasEffects CanvasDevice::LeaseHistogramEffect(ID2D1DeviceContext* d2dContext)
     {
-        ComPtr<ID2D1Effect> histogram = InterlockedExchangeComPtr(m_histogramEffect, nullptr);
+        HistogramAndAtlasEffects effects;
 
-        if (!histogram)
         {
-            ThrowIfFailed(d2dContext->CreateEffect(CLSID_D2D1Histogram, &histogram));
+            std::unique_lock<std::mutex> lock(m_histogramEffectsMutex);
+
+            if (!m_histogramEffects.empty())
+            {
+                effects = std::move(m_histogramEffects.back());
+                m_histogramEffects.pop_back();
+            }
         }
 
-        ComPtr<ID2D1Effect> atlas = InterlockedExchangeComPtr(m_atlasEffect, nullptr);
+        if (!effects.HistogramEffect)
+        {
+            ThrowIfFailed(d2dContext->CreateEffect(CLSID_D2D1Histogram, &effects.HistogramEffect));
+        }
 
-        if (!atlas)
+        if (!effects.AtlasEffect)
         {
-            ThrowIfFailed(d2dContext->CreateEffect(CLSID_D2D1Atlas, &atlas));
+            ThrowIfFailed(d2dContext->CreateEffect(CLSID_D2D1Atlas, &effects.AtlasEffect));
         }
 
-        return HistogramAndAtlasEffects{ histogram, atlas };
+        return effects;
     }
 
     void CanvasDevice::ReleaseHistogramEffect(HistogramAndAtlasEffects&& effects)
     {
-        InterlockedExchangeComPtr(m_histogramEffect, std::move(effects.HistogramEffect));
-        InterlockedExchangeComPtr(m_atlasEffect, std::move(effects.AtlasEffect));
+        HistogramAndAtlasEffects released(std::move(effects));
+
+        std::unique_lock<std::mutex> lock(m_histogramEffectsMutex);
+
+        // If the pool is already full the effects are simply destroyed.
+        if (m_histogramEffects.size() < MaxPooledHistogramEffects)
+        {
+            m_histogramEffects.push_back(std::move(released));
+        }
+    }
+
+    ComPtr<ID2D1Effect> CanvasDevice::LeaseExtraHistogramEffect(ID2D1DeviceContext* d2dContext)
+    {
+        ComPtr<ID2D1Effect> effect;
+
+        {
+            std::unique_lock<std::mutex> lock(m_histogramEffectsMutex);
+
+            if (!m_extraHistogramEffects.empty())
+            {
+                effect = std::move(m_extraHistogramEffects.back());
+                m_extraHistogramEffects.pop_back();
+            }
+        }
+
+        if (!effect)
+        {
+            ThrowIfFailed(d2dContext->CreateEffect(CLSID_D2D1Histogram, &effect));
+        }
+
+        return effect;
+    }
+
+    void CanvasDevice::ReleaseExtraHistogramEffect(ComPtr<ID2D1Effect>&& effect)
+    {
+        ComPtr<ID2D1Effect> released(std::move(effect));
+
+        std::unique_lock<std::mutex> lock(m_histogramEffectsMutex);
+
+        if (m_extraHistogramEffects.size() < MaxPooledHistogramEffects)
+        {
+            m_extraHistogramEffects.push_back(std::move(released));
+        }
+    }
+
+    void CanvasDevice::ClearHistogramEffects()
+    {
+        std::vector<HistogramAndAtlasEffects> effects;
+        std::vector<ComPtr<ID2D1Effect>> extraEffects;
+
+        {
+            std::unique_lock<std::mutex> lock(m_histogramEffectsMutex);
+            std::swap(effects, m_histogramEffects);
+            std::swap(extraEffects, m_extraHistogramEffects);
+        }
+    }
+
+    ComPtr<ID2D1Effect> CanvasDevice::LeaseDrawImageEffect(ID2D1DeviceContext* d2dContext, IID const& effectId)
+    {
+        ComPtr<ID2D1Effect> effect;
+
+        if (auto slot = GetDrawImageEffectSlot(effectId))
+            effect = InterlockedExchangeComPtr(*slot, nullptr);
+
+        if (!effect)
+        {
+            ThrowIfFailed(d2dContext->CreateEffect(effectId, &effect));
+        }
+
+        return effect;
+    }
+
+    void CanvasDevice::ReleaseDrawImageEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect)
+    {
+        if (auto slot = GetDrawImageEffectSlot(effectId))
+            InterlockedExchangeComPtr(*slot, std::move(effect));
+        else
+            effect.Reset();
+    }
+
+    ComPtr<ID2D1Effect>* CanvasDevice::GetDrawImageEffectSlot(IID const& effectId)
+    {
+        if (effectId == CLSID_D2D1ColorMatrix)
+            return &m_drawImageColorMatrixEffect;
+        else if (effectId == CLSID_D2D1Border)
+            return &m_drawImageBorderEffect;
+        else if (effectId == CLSID_D2D1DpiCompensation)
+            return &m_drawImageDpiCompensationEffect;
+        else
+            return nullptr;
+    }
+
+    void CanvasDevice::ClearDrawImageEffects()
+    {
+        InterlockedExchangeComPtr(m_drawImageColorMatrixEffect, nullptr);
+        InterlockedExchangeComPtr(m_drawImageBorderEffect, nullptr);
+        InterlockedExchangeComPtr(m_drawImageDpiCompensationEffect, nullptr);
+    }
+
+    Effects::RealizedEffectCache& CanvasDevice::GetRealizedEffectCache()
+    {
+        return m_realizedEffectCache;
     }
 
 #if WINVER > _WIN32_WINNT_WINBLUE
@@ -1425,6 +1595,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         return false;
     }
 
+    SpriteBufferPool& CanvasDevice::GetSpriteBufferPool()
+    {
+        return m_spriteBufferPool;
+    }
+
     ComPtr<ID2D1SvgDocument> CanvasDevice::CreateSvgDocument(IStream* inputXmlStream)
     {
         auto lease = GetResourceCreationDeviceContext();
@@ -1448,6 +1623,51 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         return d2dSvgDocument;
     }
 
+    //
+    // GpuFence implemented with a D3D event query, issued on the immediate
+    // context that D2D submits its work to.
+    //
+    class D3DEventQueryFence : public GpuFence
+    {
+        ComPtr<ID2D1Device1> m_d2dDevice;
+        ComPtr<ID3D11DeviceContext> m_immediateContext;
+        ComPtr<ID3D11Query> m_query;
+
+    public:
+        D3DEventQueryFence(ID2D1Device1* d2dDevice, ID3D11Device* d3dDevice)
+            : m_d2dDevice(d2dDevice)
+        {
+            D3D11_QUERY_DESC queryDesc{ D3D11_QUERY_EVENT, 0 };
+            ThrowIfFailed(d3dDevice->CreateQuery(&queryDesc, &m_query));
+
+            d3dDevice->GetImmediateContext(&m_immediateContext);
+
+            D2DResourceLock lock(m_d2dDevice.Get());
+            m_immediateContext->End(m_query.Get());
+        }
+
+        virtual bool IsComplete() override
+        {
+            D2DResourceLock lock(m_d2dDevice.Get());
+
+            // Deliberately not passing D3D11_ASYNC_GETDATA_DONOTFLUSH, so
+            // that polling also gets the preceding work submitted to the GPU.
+            BOOL isComplete = FALSE;
+            HRESULT hr = m_immediateContext->GetData(m_query.Get(), &isComplete, sizeof(isComplete), 0);
+            ThrowIfFailed(hr);
+
+            return hr == S_OK && isComplete;
+        }
+    };
+
+    std::unique_ptr<GpuFence> CanvasDevice::InsertGpuFence()
+    {
+        auto& d2dDevice = GetResource();
+        auto& dxgiDevice = m_dxgiDevice.EnsureNotClosed();
+
+        return std::make_unique<D3DEventQueryFence>(d2dDevice.Get(), As<ID3D11Device>(dxgiDevice).Get());
+    }
+
 #endif
 
     HRESULT CanvasDevice::GetDeviceRemovedErrorCode()
@@ -5,6 +5,9 @@
 #pragma once
 
 #include "DeviceContextPool.h"
+#include "SpriteBufferPool.h"
+#include "brushes/GradientStopCollectionCache.h"
+#include "effects/RealizedEffectCache.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
@@ -62,6 +65,22 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     };
 
 
+#if WINVER > _WIN32_WINNT_WINBLUE
+    //
+    // Marks a point in the device's stream of GPU work.  IsComplete polls,
+    // without blocking, whether everything submitted before the fence was
+    // inserted has finished executing.
+    //
+    class GpuFence
+    {
+    public:
+        virtual ~GpuFence() = default;
+
+        virtual bool IsComplete() = 0;
+    };
+#endif
+
+
     //
     // This internal interface is exposed by the CanvasDevice runtime class and
     // allows for internal access to non-WinRT methods.
@@ -165,12 +184,29 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         virtual HistogramAndAtlasEffects LeaseHistogramEffect(ID2D1DeviceContext* d2dContext) = 0;
         virtual void ReleaseHistogramEffect(HistogramAndAtlasEffects&& effects) = 0;
 
+        // Extra histogram effects, without an atlas, for histograms of further
+        // channels that share the atlas of a HistogramAndAtlasEffects pair.
+        virtual ComPtr<ID2D1Effect> LeaseExtraHistogramEffect(ID2D1DeviceContext* d2dContext) = 0;
+        virtual void ReleaseExtraHistogramEffect(ComPtr<ID2D1Effect>&& effect) = 0;
+
+        // Helper effects (ColorMatrix, Border and DpiCompensation) that
+        // DrawImage inserts to emulate opacity and DrawBitmap source rectangle
+        // behavior.  Callers must clear the effect's input before releasing it.
+        virtual ComPtr<ID2D1Effect> LeaseDrawImageEffect(ID2D1DeviceContext* d2dContext, IID const& effectId) = 0;
+        virtual void ReleaseDrawImageEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect) = 0;
+
+        virtual Effects::RealizedEffectCache& GetRealizedEffectCache() = 0;
+
 #if WINVER > _WIN32_WINNT_WINBLUE
         virtual ComPtr<ID2D1GradientMesh> CreateGradientMesh(D2D1_GRADIENT_MESH_PATCH const* patches, uint32_t patchCount) = 0;
 
         virtual bool IsSpriteBatchQuirkRequired() = 0;
 
+        virtual SpriteBufferPool& GetSpriteBufferPool() = 0;
+
         virtual ComPtr<ID2D1SvgDocument> CreateSvgDocument(IStream* inputXmlStream) = 0;
+
+        virtual std::unique_ptr<GpuFence> InsertGpuFence() = 0;
 #endif
     };
 
@@ -208,8 +244,19 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
         DeviceContextPool m_deviceContextPool;
 
-        ComPtr<ID2D1Effect> m_histogramEffect;
-        ComPtr<ID2D1Effect> m_atlasEffect;
+        GradientStopCollectionCache m_gradientStopCollectionCache;
+
+        Effects::RealizedEffectCache m_realizedEffectCache;
+
+        // Idle histogram and atlas effect pairs, so that concurrent
+        // ComputeHistogram calls can each reuse one.
+        std::mutex m_histogramEffectsMutex;
+        std::vector<HistogramAndAtlasEffects> m_histogramEffects;
+        std::vector<ComPtr<ID2D1Effect>> m_extraHistogramEffects;
+
+        ComPtr<ID2D1Effect> m_drawImageColorMatrixEffect;
+        ComPtr<ID2D1Effect> m_drawImageBorderEffect;
+        ComPtr<ID2D1Effect> m_drawImageDpiCompensationEffect;
 
 #if WINVER > _WIN32_WINNT_WINBLUE
         std::mutex m_quirkMutex;
@@ -222,9 +269,14 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         };
 
         SpriteBatchQuirk m_spriteBatchQuirk;
+
+        SpriteBufferPool m_spriteBufferPool;
 #endif
 
     public:
+        // How many idle histogram effect pairs, and extra histogram effects, are kept for reuse.
+        static size_t const MaxPooledHistogramEffects = 4;
+
         static ComPtr<CanvasDevice> CreateNew(bool forceSoftwareRenderer);
         static ComPtr<CanvasDevice> CreateNew(IDirect3DDevice* direct3DDevice);
 
@@ -251,6 +303,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         IFACEMETHOD(get_LowPriority)(boolean* value) override;
         IFACEMETHOD(put_LowPriority)(boolean value) override;
 
+        IFACEMETHOD(get_EffectCacheStatistics)(CanvasEffectCacheStatistics* value) override;
+        IFACEMETHOD(get_GradientStopCacheStatistics)(CanvasGradientStopCacheStatistics* value) override;
+
         IFACEMETHOD(add_DeviceLost)(DeviceLostHandlerType* value, EventRegistrationToken* token) override;
 
         IFACEMETHOD(remove_DeviceLost)(EventRegistrationToken token) override;
@@ -364,12 +419,24 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         virtual HistogramAndAtlasEffects LeaseHistogramEffect(ID2D1DeviceContext* d2dContext) override;
         virtual void ReleaseHistogramEffect(HistogramAndAtlasEffects&& effects) override;
 
+        virtual ComPtr<ID2D1Effect> LeaseExtraHistogramEffect(ID2D1DeviceContext* d2dContext) override;
+        virtual void ReleaseExtraHistogramEffect(ComPtr<ID2D1Effect>&& effect) override;
+
+        virtual ComPtr<ID2D1Effect> LeaseDrawImageEffect(ID2D1DeviceContext* d2dContext, IID const& effectId) override;
+        virtual void ReleaseDrawImageEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect) override;
+
+        virtual Effects::RealizedEffectCache& GetRealizedEffectCache() override;
+
 #if WINVER > _WIN32_WINNT_WINBLUE
         virtual ComPtr<ID2D1GradientMesh> CreateGradientMesh(D2D1_GRADIENT_MESH_PATCH const* patches, uint32_t patchCount) override;
 
         virtual bool IsSpriteBatchQuirkRequired() override;
 
+        virtual SpriteBufferPool& GetSpriteBufferPool() override;
+
         virtual ComPtr<ID2D1SvgDocument> CreateSvgDocument(IStream* inputXmlStream) override;
+
+        virtual std::unique_ptr<GpuFence> InsertGpuFence() override;
 #endif
 
         //
@@ -407,6 +474,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
         bool DetectIfSpriteBatchQuirkIsRequired();
 
+        void ClearHistogramEffects();
+
+        ComPtr<ID2D1Effect>* GetDrawImageEffectSlot(IID const& effectId);
+        void ClearDrawImageEffects();
+
         ComPtr<ID2D1Bitmap1> CreateBitmapFromWicBitmap(ID2D1DeviceContext* deviceContext, IWICBitmapSource* wicBitmapSource, float dpi, CanvasAlphaMode alpha);
         ComPtr<ID2D1Bitmap1> CreateBitmapFromDdsFrame(ID2D1DeviceContext* deviceContext, IWICBitmapSource* wicBitmapSource, IWICDdsFrameDecode* ddsFrame, float dpi, CanvasAlphaMode alpha);
     };
@@ -436,6 +436,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         ComPtr<ID2D1Image> m_opacityEffectOutput;
         ComPtr<ID2D1Image> m_borderEffectOutput;
 
+        // Helper effects are leased from the device, so that steady state
+        // drawing does not create any new effects, and handed back when the
+        // worker is destroyed.
+        ComPtr<ID2D1Effect> m_opacityEffect;
+        ComPtr<ID2D1Effect> m_borderEffect;
+        ComPtr<ID2D1Effect> m_dpiCompensationEffect;
+
+        enum class EffectPooling { NotChecked, Allowed, NotAllowed };
+        EffectPooling m_effectPooling;
+
     public:
         DrawImageWorker(ICanvasDevice* canvasDevice, ID2D1DeviceContext1* deviceContext, Vector2* offset, Rect* destinationRect, Rect* sourceRect, float opacity, CanvasImageInterpolation interpolation)
             : m_canvasDevice(canvasDevice)
@@ -445,6 +455,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             , m_sourceRect(sourceRect)
             , m_opacity(opacity)
             , m_interpolation(interpolation)
+            , m_effectPooling(EffectPooling::NotChecked)
         {
             assert(m_offset || m_destinationRect);
 
@@ -452,6 +463,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 m_d2dSourceRect = ToD2DRect(*sourceRect);
         }
 
+        ~DrawImageWorker()
+        {
+            m_opacityEffectOutput.Reset();
+            m_borderEffectOutput.Reset();
+
+            ReleaseEffect(CLSID_D2D1ColorMatrix, m_opacityEffect);
+            ReleaseEffect(CLSID_D2D1Border, m_borderEffect);
+            ReleaseEffect(CLSID_D2D1DpiCompensation, m_dpiCompensationEffect);
+        }
+
         void DrawBitmap(ICanvasBitmap* bitmap, Numerics::Matrix4x4* perspective)
         {
             DrawBitmap(As<ICanvasBitmapInternal>(bitmap).Get(), perspective);
@@ -551,9 +572,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             if (m_opacity >= 1.0f)
                 return d2dImage;
 
-            ComPtr<ID2D1Effect> opacityEffect;
-
-            ThrowIfFailed(m_deviceContext->CreateEffect(CLSID_D2D1ColorMatrix, &opacityEffect));
+            m_opacityEffect = LeaseEffect(CLSID_D2D1ColorMatrix);
 
             if (auto bitmap = MaybeAs<ID2D1Bitmap>(d2dImage))
             {
@@ -562,11 +581,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 // the bitmap's DPI before passing it to the color matrix effect
                 // (since effects by default ignore a bitmap's DPI).
                 //
-                ThrowIfFailed(D2D1::SetDpiCompensatedEffectInput(m_deviceContext, opacityEffect.Get(), 0, bitmap.Get()));
+                SetDpiCompensatedEffectInput(m_opacityEffect.Get(), bitmap.Get());
             }
             else
             {
-                opacityEffect->SetInput(0, d2dImage);
+                m_opacityEffect->SetInput(0, d2dImage);
             }
 
             D2D1_MATRIX_5X4_F opacityMatrix = D2D1::Matrix5x4F(
@@ -576,9 +595,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 0, 0, 0, m_opacity,
                 0, 0, 0, 0);
 
-            opacityEffect->SetValue(D2D1_COLORMATRIX_PROP_COLOR_MATRIX, opacityMatrix);
+            m_opacityEffect->SetValue(D2D1_COLORMATRIX_PROP_COLOR_MATRIX, opacityMatrix);
             
-            opacityEffect->GetOutput(&m_opacityEffectOutput);
+            m_opacityEffect->GetOutput(&m_opacityEffectOutput);
             return m_opacityEffectOutput.Get();
         }
 
@@ -704,14 +723,72 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             // image, but it is non trivial to detect that for different filter modes, and this
             // is a slow path in any case so we keep it simple and always add the border.
 
-            ComPtr<ID2D1Effect> borderEffect;
-            ThrowIfFailed(m_deviceContext->CreateEffect(CLSID_D2D1Border, &borderEffect));
-            ThrowIfFailed(D2D1::SetDpiCompensatedEffectInput(m_deviceContext, borderEffect.Get(), 0, d2dBitmap.Get()));
+            m_borderEffect = LeaseEffect(CLSID_D2D1Border);
+            SetDpiCompensatedEffectInput(m_borderEffect.Get(), d2dBitmap.Get());
 
-            borderEffect->GetOutput(&m_borderEffectOutput);
+            m_borderEffect->GetOutput(&m_borderEffectOutput);
             return m_borderEffectOutput.Get();
         }
 
+        // Equivalent to D2D1::SetDpiCompensatedEffectInput, except that the
+        // DpiCompensation effect is leased rather than created each time.
+        void SetDpiCompensatedEffectInput(ID2D1Effect* effect, ID2D1Bitmap* bitmap)
+        {
+            // At most one bitmap per draw ever needs compensating.
+            assert(!m_dpiCompensationEffect);
+
+            m_dpiCompensationEffect = LeaseEffect(CLSID_D2D1DpiCompensation);
+
+            D2D1_POINT_2F bitmapDpi;
+            bitmap->GetDpi(&bitmapDpi.x, &bitmapDpi.y);
+
+            m_dpiCompensationEffect->SetInput(0, bitmap);
+
+            ThrowIfFailed(m_dpiCompensationEffect->SetValue(D2D1_DPICOMPENSATION_PROP_INPUT_DPI, bitmapDpi));
+            ThrowIfFailed(m_dpiCompensationEffect->SetValue(D2D1_DPICOMPENSATION_PROP_INTERPOLATION_MODE, D2D1_DPICOMPENSATION_INTERPOLATION_MODE_LINEAR));
+            ThrowIfFailed(m_dpiCompensationEffect->SetValue(D2D1_DPICOMPENSATION_PROP_BORDER_MODE, D2D1_BORDER_MODE_HARD));
+
+            effect->SetInputEffect(0, m_dpiCompensationEffect.Get());
+        }
+
+        ComPtr<ID2D1Effect> LeaseEffect(IID const& effectId)
+        {
+            if (CanPoolEffects())
+                return As<ICanvasDeviceInternal>(m_canvasDevice)->LeaseDrawImageEffect(m_deviceContext, effectId);
+
+            ComPtr<ID2D1Effect> effect;
+            ThrowIfFailed(m_deviceContext->CreateEffect(effectId, &effect));
+            return effect;
+        }
+
+        void ReleaseEffect(IID const& effectId, ComPtr<ID2D1Effect>& effect)
+        {
+            if (!effect)
+                return;
+
+            // Pooled effects must not keep the image that was drawn alive.
+            effect->SetInput(0, nullptr);
+
+            if (m_effectPooling == EffectPooling::Allowed)
+                As<ICanvasDeviceInternal>(m_canvasDevice)->ReleaseDrawImageEffect(effectId, std::move(effect));
+            else
+                effect.Reset();
+        }
+
+        // Command lists record effects by reference rather than taking a
+        // snapshot, so effects drawn into one can never be reused.  This
+        // includes printing, which also draws to a command list.
+        bool CanPoolEffects()
+        {
+            if (m_effectPooling == EffectPooling::NotChecked)
+            {
+                m_effectPooling = TargetIsCommandList(m_deviceContext) ? EffectPooling::NotAllowed
+                                                                       : EffectPooling::Allowed;
+            }
+
+            return m_effectPooling == EffectPooling::Allowed;
+        }
+
         D2D1_RECT_F* GetD2DSourceRect()
         {
             if (m_sourceRect)
@@ -4129,6 +4206,18 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     {
         return ExceptionBoundary([&]
         {
+            // Validate sort mode
+            switch (sortMode)
+            {
+            case CanvasSpriteSortMode::None:
+            case CanvasSpriteSortMode::Bitmap:
+            case CanvasSpriteSortMode::Layer:
+                break;
+
+            default:
+                ThrowHR(E_INVALIDARG);
+            }
+
             // Validate interpolation mode
             switch (interpolation)
             {
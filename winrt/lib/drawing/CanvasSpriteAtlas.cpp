@@ -0,0 +1,476 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "CanvasSpriteAtlas.h"
+
+//
+// CanvasSpriteAtlasFactory implementation
+//
+
+IFACEMETHODIMP CanvasSpriteAtlasFactory::Create(
+    ICanvasResourceCreator* resourceCreator,
+    int32_t widthInPixels,
+    int32_t heightInPixels,
+    ICanvasSpriteAtlas** spriteAtlas)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(resourceCreator);
+        CheckAndClearOutPointer(spriteAtlas);
+
+        if (widthInPixels <= 0 || heightInPixels <= 0)
+            ThrowHR(E_INVALIDARG);
+
+        ComPtr<ICanvasDevice> device;
+        ThrowIfFailed(resourceCreator->get_Device(&device));
+
+        auto newSpriteAtlas = Make<CanvasSpriteAtlas>(
+            device.Get(),
+            static_cast<uint32_t>(widthInPixels),
+            static_cast<uint32_t>(heightInPixels));
+        CheckMakeResult(newSpriteAtlas);
+
+        ThrowIfFailed(newSpriteAtlas.CopyTo(spriteAtlas));
+    });
+}
+
+
+//
+// CanvasSpriteAtlas implementation
+//
+
+CanvasSpriteAtlas::CanvasSpriteAtlas(
+    ICanvasDevice* device,
+    uint32_t widthInPixels,
+    uint32_t heightInPixels,
+    uint32_t padding)
+    : m_device(device)
+    , m_padding(padding)
+    , m_packer(widthInPixels, heightInPixels)
+    , m_useCounter(0)
+{
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::TryAdd(
+    ICanvasBitmap* bitmap,
+    boolean* added)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        CheckInPointer(added);
+        auto& device = m_device.EnsureNotClosed();
+
+        ComPtr<ICanvasDevice> bitmapDevice;
+        ThrowIfFailed(As<ICanvasResourceCreator>(bitmap)->get_Device(&bitmapDevice));
+
+        if (!IsSameInstance(bitmapDevice.Get(), device.Get()))
+            ThrowHR(E_INVALIDARG, Strings::SpriteAtlasWrongDevice);
+
+        *added = false;
+
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap>(bitmap);
+
+        Lock lock(m_mutex);
+
+        auto it = m_entries.find(d2dBitmap.Get());
+        if (it != m_entries.end())
+        {
+            it->second.LastUsed = ++m_useCounter;
+            *added = true;
+            return;
+        }
+
+        //
+        // CopyFromBitmap requires both bitmaps to have the same format, and
+        // bitmaps that would never fit can't be added.
+        //
+
+        auto pixelFormat = d2dBitmap->GetPixelFormat();
+        if (pixelFormat.format != DXGI_FORMAT_B8G8R8A8_UNORM || pixelFormat.alphaMode != D2D1_ALPHA_MODE_PREMULTIPLIED)
+            return;
+
+        auto size = d2dBitmap->GetPixelSize();
+        if (size.width + m_padding * 2 > m_packer.GetWidth() ||
+            size.height + m_padding * 2 > m_packer.GetHeight())
+            return;
+
+        Entry entry{ d2dBitmap, size, D2D1_POINT_2U{}, ++m_useCounter, false };
+
+        if (TryPlace(m_packer, size, &entry.Offset))
+        {
+            ThrowIfFailed(EnsureAtlasBitmap(lock)->CopyFromBitmap(&entry.Offset, d2dBitmap.Get(), nullptr));
+            entry.IsInAtlas = true;
+            m_entries.emplace(d2dBitmap.Get(), std::move(entry));
+        }
+        else
+        {
+            // The new entry is the most recently used, so it will be the last
+            // to be evicted.  We've already checked that it fits on its own.
+            m_entries.emplace(d2dBitmap.Get(), std::move(entry));
+
+            auto removeEntry = MakeScopeWarden([&] { m_entries.erase(d2dBitmap.Get()); });
+            Relayout(lock);
+            removeEntry.Dismiss();
+        }
+
+        *added = true;
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::Contains(
+    ICanvasBitmap* bitmap,
+    boolean* value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        CheckInPointer(value);
+        m_device.EnsureNotClosed();
+
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap>(bitmap);
+
+        Lock lock(m_mutex);
+        *value = m_entries.find(d2dBitmap.Get()) != m_entries.end();
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::Remove(
+    ICanvasBitmap* bitmap)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        m_device.EnsureNotClosed();
+
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap>(bitmap);
+
+        // The space used by the bitmap isn't reclaimed until the atlas is
+        // repacked.
+        Lock lock(m_mutex);
+        m_entries.erase(d2dBitmap.Get());
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::Repack()
+{
+    return ExceptionBoundary([&]
+    {
+        m_device.EnsureNotClosed();
+
+        Lock lock(m_mutex);
+        Relayout(lock);
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::Clear()
+{
+    return ExceptionBoundary([&]
+    {
+        m_device.EnsureNotClosed();
+
+        Lock lock(m_mutex);
+        m_entries.clear();
+        m_packer.Reset();
+        m_atlasBitmap.Reset();
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::get_Count(
+    int32_t* value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(value);
+        m_device.EnsureNotClosed();
+
+        Lock lock(m_mutex);
+        *value = static_cast<int32_t>(m_entries.size());
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::get_Occupancy(
+    float* value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(value);
+        m_device.EnsureNotClosed();
+
+        Lock lock(m_mutex);
+        *value = m_packer.GetOccupancy();
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::get_Bitmap(
+    ICanvasBitmap** value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckAndClearOutPointer(value);
+        auto& device = m_device.EnsureNotClosed();
+
+        Lock lock(m_mutex);
+        auto& atlasBitmap = EnsureAtlasBitmap(lock);
+
+        auto canvasBitmap = ResourceManager::GetOrCreate<ICanvasBitmap>(device.Get(), atlasBitmap.Get());
+        ThrowIfFailed(canvasBitmap.CopyTo(value));
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::Close()
+{
+    Lock lock(m_mutex);
+
+    m_entries.clear();
+    m_atlasBitmap.Reset();
+    m_device.Close();
+
+    return S_OK;
+}
+
+
+IFACEMETHODIMP CanvasSpriteAtlas::get_Device(
+    ICanvasDevice** value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckAndClearOutPointer(value);
+
+        auto& device = m_device.EnsureNotClosed();
+        ThrowIfFailed(device.CopyTo(value));
+    });
+}
+
+
+bool CanvasSpriteAtlas::TryGetPlacement(
+    ID2D1Bitmap* bitmap,
+    ComPtr<ID2D1Bitmap>* atlasBitmap,
+    D2D1_POINT_2U* offset)
+{
+    Lock lock(m_mutex);
+
+    if (!m_atlasBitmap)
+        return false;
+
+    auto it = m_entries.find(bitmap);
+    if (it == m_entries.end())
+        return false;
+
+    it->second.LastUsed = ++m_useCounter;
+
+    *atlasBitmap = m_atlasBitmap;
+    *offset = it->second.Offset;
+    return true;
+}
+
+
+ComPtr<ID2D1Bitmap1> const& CanvasSpriteAtlas::EnsureAtlasBitmap(Lock const& lock)
+{
+    MustOwnLock(lock);
+
+    if (!m_atlasBitmap)
+        m_atlasBitmap = CreateAtlasBitmap();
+
+    return m_atlasBitmap;
+}
+
+
+//
+// New render target bitmaps have undefined contents, so the atlas is cleared
+// to transparent.  Otherwise sprites that filter across their edges would
+// pick up whatever happened to be in the padding.
+//
+ComPtr<ID2D1Bitmap1> CanvasSpriteAtlas::CreateAtlasBitmap()
+{
+    auto deviceInternal = As<ICanvasDeviceInternal>(m_device.EnsureNotClosed());
+
+    // At the default DPI, DIPs and pixels are the same
+    auto atlasBitmap = deviceInternal->CreateRenderTargetBitmap(
+        static_cast<float>(m_packer.GetWidth()),
+        static_cast<float>(m_packer.GetHeight()),
+        DEFAULT_DPI,
+        PIXEL_FORMAT(B8G8R8A8UIntNormalized),
+        CanvasAlphaMode::Premultiplied);
+
+    auto deviceContext = deviceInternal->GetResourceCreationDeviceContext();
+
+    deviceContext->SetTarget(atlasBitmap.Get());
+    auto clearTarget = MakeScopeWarden([&] { deviceContext->SetTarget(nullptr); });
+
+    deviceContext->BeginDraw();
+    deviceContext->Clear(D2D1::ColorF(0, 0));
+    ThrowIfFailed(deviceContext->EndDraw());
+
+    return atlasBitmap;
+}
+
+
+bool CanvasSpriteAtlas::TryPlace(SkylinePacker& packer, D2D1_SIZE_U size, D2D1_POINT_2U* offset) const
+{
+    D2D1_POINT_2U position;
+    if (!packer.TryInsert(size.width + m_padding * 2, size.height + m_padding * 2, &position))
+        return false;
+
+    *offset = D2D1_POINT_2U{ position.x + m_padding, position.y + m_padding };
+    return true;
+}
+
+
+//
+// Packs all the entries again from scratch, evicting the least recently used
+// ones until the rest fit.
+//
+// The entries are copied into a new atlas bitmap, rather than being moved
+// around within the current one, since drawing that has already been issued
+// using the current atlas may not have been executed yet.  They are copied
+// from the current atlas, not from the bitmaps they were added from, so that
+// later changes to those bitmaps are still not picked up.
+//
+// The new layout and bitmap are built before anything is changed, so if
+// creating or filling in the bitmap fails the atlas is left as it was.
+//
+void CanvasSpriteAtlas::Relayout(Lock const& lock)
+{
+    MustOwnLock(lock);
+
+    std::vector<Entry*> byLastUsed;
+    byLastUsed.reserve(m_entries.size());
+
+    for (auto& pair : m_entries)
+        byLastUsed.push_back(&pair.second);
+
+    std::sort(byLastUsed.begin(), byLastUsed.end(),
+        [] (Entry const* a, Entry const* b)
+        {
+            return a->LastUsed > b->LastUsed;
+        });
+
+    // Packing taller bitmaps first leaves a flatter skyline.  Indices are
+    // into byLastUsed, so keeping the first N entries just skips the rest.
+    std::vector<size_t> packOrder(byLastUsed.size());
+    for (size_t i = 0; i < packOrder.size(); ++i)
+        packOrder[i] = i;
+
+    std::stable_sort(packOrder.begin(), packOrder.end(),
+        [&] (size_t a, size_t b)
+        {
+            auto const& sizeA = byLastUsed[a]->Size;
+            auto const& sizeB = byLastUsed[b]->Size;
+
+            if (sizeA.height != sizeB.height)
+                return sizeA.height > sizeB.height;
+
+            return sizeA.width > sizeB.width;
+        });
+
+    // Indexed in the same order as byLastUsed
+    std::vector<D2D1_POINT_2U> offsets(byLastUsed.size());
+    SkylinePacker packer(m_packer);
+
+    auto tryPack = [&] (size_t count)
+    {
+        packer.Reset();
+
+        for (auto i : packOrder)
+        {
+            if (i < count && !TryPlace(packer, byLastUsed[i]->Size, &offsets[i]))
+                return false;
+        }
+
+        return true;
+    };
+
+    auto keepCount = byLastUsed.size();
+
+    if (!tryPack(keepCount))
+    {
+        //
+        // Binary search for how many of the most recently used entries fit.
+        // Each entry fits on its own, so we'll always end up keeping at least
+        // one.
+        //
+
+        size_t fits = 1;
+        size_t doesNotFit = keepCount;
+
+        while (doesNotFit - fits > 1)
+        {
+            auto count = fits + (doesNotFit - fits) / 2;
+
+            if (tryPack(count))
+                fits = count;
+            else
+                doesNotFit = count;
+        }
+
+        keepCount = fits;
+
+        // The last attempt may have been one that failed, so pack the
+        // entries we're keeping again.
+        if (!tryPack(keepCount))
+            ThrowHR(E_UNEXPECTED);
+    }
+
+    ComPtr<ID2D1Bitmap1> atlasBitmap;
+
+    if (keepCount > 0)
+    {
+        atlasBitmap = CreateAtlasBitmap();
+
+        for (size_t i = 0; i < keepCount; ++i)
+        {
+            auto entry = byLastUsed[i];
+
+            if (entry->IsInAtlas)
+            {
+                D2D1_RECT_U sourceRect{
+                    entry->Offset.x,
+                    entry->Offset.y,
+                    entry->Offset.x + entry->Size.width,
+                    entry->Offset.y + entry->Size.height };
+
+                ThrowIfFailed(atlasBitmap->CopyFromBitmap(&offsets[i], m_atlasBitmap.Get(), &sourceRect));
+            }
+            else
+            {
+                ThrowIfFailed(atlasBitmap->CopyFromBitmap(&offsets[i], entry->Source.Get(), nullptr));
+            }
+        }
+    }
+
+    //
+    // Nothing below here can fail, so swap in the new layout
+    //
+
+    for (size_t i = 0; i < keepCount; ++i)
+    {
+        byLastUsed[i]->Offset = offsets[i];
+        byLastUsed[i]->IsInAtlas = true;
+    }
+
+    for (auto i = keepCount; i < byLastUsed.size(); ++i)
+        m_entries.erase(byLastUsed[i]->Source.Get());
+
+    m_packer = std::move(packer);
+    m_atlasBitmap = std::move(atlasBitmap);
+}
+
+
+ActivatableClassWithFactory(CanvasSpriteAtlas, CanvasSpriteAtlasFactory);
+
+#endif
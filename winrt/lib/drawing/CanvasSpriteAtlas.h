@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "SkylinePacker.h"
+#include "utils/LockUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Used by CanvasSpriteBatch to redirect sprites to the atlas.
+    //
+    class __declspec(uuid("8D0C5B7E-4A12-4F3D-B6E9-2C7A1F5D9E38"))
+    ICanvasSpriteAtlasInternal : public IUnknown
+    {
+    public:
+        // Returns false if the bitmap isn't in the atlas.  Otherwise the atlas
+        // bitmap and the offset, in pixels, of the bitmap within it are
+        // returned.
+        virtual bool TryGetPlacement(
+            ID2D1Bitmap* bitmap,
+            ComPtr<ID2D1Bitmap>* atlasBitmap,
+            D2D1_POINT_2U* offset) = 0;
+    };
+
+
+    class CanvasSpriteAtlasFactory
+        : public AgileActivationFactory<ICanvasSpriteAtlasFactory>
+        , private LifespanTracker<CanvasSpriteAtlasFactory>
+    {
+        InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasSpriteAtlas, BaseTrust);
+
+    public:
+        IFACEMETHODIMP Create(
+            ICanvasResourceCreator* resourceCreator,
+            int32_t widthInPixels,
+            int32_t heightInPixels,
+            ICanvasSpriteAtlas** spriteAtlas) override;
+    };
+
+
+    //
+    // Packs small bitmaps into a single, larger, bitmap so that a sprite batch
+    // can draw sprites that use any of them with a single DrawSpriteBatch call.
+    //
+    // Bitmaps are copied into the atlas when they're added, so later changes
+    // to the original bitmap are not picked up.  When the atlas is full, the
+    // least recently used bitmaps are evicted to make room.
+    //
+    class CanvasSpriteAtlas
+        : public RuntimeClass<
+            ICanvasSpriteAtlas,
+            IClosable,
+            ICanvasResourceCreator,
+            CloakedIid<ICanvasSpriteAtlasInternal>>
+        , private LifespanTracker<CanvasSpriteAtlas>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_CanvasSpriteAtlas, BaseTrust);
+
+        struct Entry
+        {
+            ComPtr<ID2D1Bitmap> Source;
+            D2D1_SIZE_U Size;
+            D2D1_POINT_2U Offset;
+            uint64_t LastUsed;
+
+            // False until the bitmap has been copied into the atlas.  After
+            // that, relayouts copy it from the atlas rather than from Source.
+            bool IsInAtlas;
+        };
+
+        std::mutex m_mutex;
+
+        ClosablePtr<ICanvasDevice> m_device;
+        uint32_t const m_padding;
+        SkylinePacker m_packer;
+        ComPtr<ID2D1Bitmap1> m_atlasBitmap;
+        std::unordered_map<ID2D1Bitmap*, Entry> m_entries;
+        uint64_t m_useCounter;
+
+    public:
+        // The number of pixels left empty around each bitmap, so that
+        // filtering at the edge of one sprite doesn't pick up its neighbors.
+        static uint32_t const DefaultPadding = 1;
+
+        CanvasSpriteAtlas(
+            ICanvasDevice* device,
+            uint32_t widthInPixels,
+            uint32_t heightInPixels,
+            uint32_t padding = DefaultPadding);
+
+        //
+        // ICanvasSpriteAtlas
+        //
+
+        IFACEMETHODIMP TryAdd(
+            ICanvasBitmap* bitmap,
+            boolean* added) override;
+
+        IFACEMETHODIMP Contains(
+            ICanvasBitmap* bitmap,
+            boolean* value) override;
+
+        IFACEMETHODIMP Remove(
+            ICanvasBitmap* bitmap) override;
+
+        IFACEMETHODIMP Repack() override;
+
+        IFACEMETHODIMP Clear() override;
+
+        IFACEMETHODIMP get_Count(
+            int32_t* value) override;
+
+        IFACEMETHODIMP get_Occupancy(
+            float* value) override;
+
+        IFACEMETHODIMP get_Bitmap(
+            ICanvasBitmap** value) override;
+
+        //
+        // IClosable
+        //
+
+        IFACEMETHODIMP Close() override;
+
+        //
+        // ICanvasResourceCreator
+        //
+
+        IFACEMETHODIMP get_Device(
+            ICanvasDevice** value) override;
+
+        //
+        // ICanvasSpriteAtlasInternal
+        //
+
+        virtual bool TryGetPlacement(
+            ID2D1Bitmap* bitmap,
+            ComPtr<ID2D1Bitmap>* atlasBitmap,
+            D2D1_POINT_2U* offset) override;
+
+    private:
+        ComPtr<ID2D1Bitmap1> const& EnsureAtlasBitmap(Lock const& lock);
+        ComPtr<ID2D1Bitmap1> CreateAtlasBitmap();
+        bool TryPlace(SkylinePacker& packer, D2D1_SIZE_U size, D2D1_POINT_2U* offset) const;
+        void Relayout(Lock const& lock);
+    };
+}}}}
+
+#endif
@@ -9,6 +9,8 @@
 #include <WindowsNumerics.h>
 
 #include "CanvasSpriteBatch.h"
+#include "SpriteCuller.h"
+#include "SpriteSorter.h"
 
 using namespace ::Windows::Foundation::Numerics;
 
@@ -77,13 +79,8 @@ static D2D1_RECT_U MakeSourceRect(ComPtr<ID2D1Bitmap> const& d2dBitmap, CanvasSp
 }
 
 
-static D2D1_RECT_U MakeSourceRect(CanvasSpriteFlip flip, D2D1_UNIT_MODE unitMode, ICanvasBitmap* bitmap, Rect sourceRect)
+static D2D1_RECT_U MakeSourceRect(CanvasSpriteFlip flip, float dpi, Rect sourceRect)
 {
-    float dpi = 96.0f;
-
-    if (unitMode == D2D1_UNIT_MODE_DIPS)
-        ThrowIfFailed(As<ICanvasResourceCreatorWithDpi>(bitmap)->get_Dpi(&dpi));
-    
     auto sourceLeft   = DipsToPixels(sourceRect.X,      dpi, CanvasDpiRounding::Round);
     auto sourceTop    = DipsToPixels(sourceRect.Y,      dpi, CanvasDpiRounding::Round);
     auto sourceWidth  = DipsToPixels(sourceRect.Width,  dpi, CanvasDpiRounding::Round);
@@ -101,6 +98,17 @@ static D2D1_RECT_U MakeSourceRect(CanvasSpriteFlip flip, D2D1_UNIT_MODE unitMode
 }
 
 
+static D2D1_RECT_U MakeSourceRect(CanvasSpriteFlip flip, D2D1_UNIT_MODE unitMode, ICanvasBitmap* bitmap, Rect sourceRect)
+{
+    float dpi = 96.0f;
+
+    if (unitMode == D2D1_UNIT_MODE_DIPS)
+        ThrowIfFailed(As<ICanvasResourceCreatorWithDpi>(bitmap)->get_Dpi(&dpi));
+
+    return MakeSourceRect(flip, dpi, sourceRect);
+}
+
+
 static float3x2 MakeTransform(Vector2 const& origin, float rotation, Vector2 const& scale, Vector2 const& offset)
 {
     return
@@ -111,6 +119,14 @@ static float3x2 MakeTransform(Vector2 const& origin, float rotation, Vector2 con
 }
 
 
+static ComPtr<ICanvasDeviceInternal> GetDeviceInternal(ID2D1DeviceContext3* deviceContext)
+{
+    ComPtr<ID2D1Device> d2dDevice;
+    deviceContext->GetDevice(&d2dDevice);
+    return ResourceManager::GetOrCreate<ICanvasDeviceInternal>(d2dDevice.Get());
+}
+
+
 CanvasSpriteBatch::CanvasSpriteBatch(
     ComPtr<ID2D1DeviceContext3> const& deviceContext,
     CanvasSpriteSortMode sortMode,
@@ -121,9 +137,17 @@ CanvasSpriteBatch::CanvasSpriteBatch(
     , m_interpolationMode(interpolation)
     , m_spriteOptions(options)
     , m_unitMode(deviceContext->GetUnitMode())
+    , m_device(GetDeviceInternal(deviceContext.Get()))
+    , m_sprites(m_device->GetSpriteBufferPool().Lease(&m_sortScratch))
+    , m_isCullingEnabled(false)
+    , m_culledSpriteCount(0)
+    , m_submittedSpriteCount(0)
+    , m_layer(0)
+    , m_statistics{}
 {
     assert(m_sortMode == CanvasSpriteSortMode::None
-        || m_sortMode == CanvasSpriteSortMode::Bitmap);
+        || m_sortMode == CanvasSpriteSortMode::Bitmap
+        || m_sortMode == CanvasSpriteSortMode::Layer);
     
     assert(m_interpolationMode == D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR
         || m_interpolationMode == D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
@@ -187,6 +211,7 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawAtOffsetWithTint(
         auto d2dSourceRect = MakeSourceRect(d2dBitmap, CanvasSpriteFlip::None);
         
         m_sprites.emplace_back(
+            m_layer,
             std::move(d2dBitmap),
             d2dDestRect,
             d2dSourceRect,
@@ -219,6 +244,7 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawToRectWithTintAndFlip(
         auto d2dSourceRect = MakeSourceRect(d2dBitmap, flip);
         
         m_sprites.emplace_back(
+            m_layer,
             std::move(d2dBitmap),
             ToD2DRect(destRect),
             d2dSourceRect,
@@ -243,6 +269,7 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawWithTransformAndTintAndFlip(
         auto d2dSourceRect = MakeSourceRect(d2dBitmap, flip);
 
         m_sprites.emplace_back(
+            m_layer,
             std::move(d2dBitmap),
             d2dDestRect,
             d2dSourceRect,
@@ -272,6 +299,7 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawAtOffsetWithTintAndTransform(
         auto transform = MakeTransform(origin, rotation, scale, offset);
 
         m_sprites.emplace_back(
+            m_layer,
             std::move(d2dBitmap),
             d2dDestRect,
             d2dSourceRect,
@@ -334,6 +362,7 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawFromSpriteSheetAtOffsetWithTint(
         auto d2dSourceRect = MakeSourceRect(CanvasSpriteFlip::None, m_unitMode, bitmap, sourceRect);
         
         m_sprites.emplace_back(
+            m_layer,
             std::move(d2dBitmap),
             d2dDestRect,
             d2dSourceRect,
@@ -368,6 +397,7 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawFromSpriteSheetToRectWithTintAndFlip(
         auto d2dSourceRect = MakeSourceRect(flip, m_unitMode, bitmap, sourceRect);
         
         m_sprites.emplace_back(
+            m_layer,
             std::move(d2dBitmap),
             ToD2DRect(destRect),
             d2dSourceRect,
@@ -393,6 +423,7 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawFromSpriteSheetWithTransformAndTintAndFlip
         auto d2dSourceRect = MakeSourceRect(flip, m_unitMode, bitmap, sourceRect);
         
         m_sprites.emplace_back(
+            m_layer,
             std::move(d2dBitmap),
             d2dDestRect,
             d2dSourceRect,
@@ -423,6 +454,7 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawFromSpriteSheetAtOffsetWithTintAndTransfor
         auto transform = MakeTransform(origin, rotation, scale, offset);
 
         m_sprites.emplace_back(
+            m_layer,
             std::move(d2dBitmap),
             d2dDestRect,
             d2dSourceRect,
@@ -432,10 +464,242 @@ IFACEMETHODIMP CanvasSpriteBatch::DrawFromSpriteSheetAtOffsetWithTintAndTransfor
 }
 
 
+//
+// The per-sprite arrays passed to the bulk Draw methods can either contain one
+// element for every sprite, or a single element that applies to all of them.
+// Optional arrays may also be empty, in which case the default is used.
+//
+static void ValidateSpriteArray(uint32_t spriteCount, uint32_t count, void const* elements, bool isOptional)
+{
+    if (count == 0)
+    {
+        if (!isOptional)
+            ThrowHR(E_INVALIDARG, Strings::SpriteBatchArrayLengthMismatch);
+        return;
+    }
+
+    CheckInPointer(elements);
+
+    if (count != 1 && count != spriteCount)
+        ThrowHR(E_INVALIDARG, Strings::SpriteBatchArrayLengthMismatch);
+}
+
+
 template<typename T>
+static T GetSpriteArrayElement(uint32_t count, T const* elements, uint32_t index, T const& defaultValue)
+{
+    switch (count)
+    {
+    case 0:  return defaultValue;
+    case 1:  return elements[0];
+    default: return elements[index];
+    }
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::DrawAtOffsets(
+    ICanvasBitmap* bitmap,
+    uint32_t offsetCount,
+    Vector2* offsets,
+    uint32_t tintCount,
+    Vector4* tints,
+    uint32_t flipCount,
+    CanvasSpriteFlip* flips)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        EnsureNotClosed();
+
+        if (offsetCount == 0)
+            return;
+
+        CheckInPointer(offsets);
+
+        AddSprites(bitmap, offsetCount, offsets, nullptr, 0, nullptr, tintCount, tints, flipCount, flips);
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::DrawWithTransforms(
+    ICanvasBitmap* bitmap,
+    uint32_t transformCount,
+    Matrix3x2* transforms,
+    uint32_t tintCount,
+    Vector4* tints,
+    uint32_t flipCount,
+    CanvasSpriteFlip* flips)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        EnsureNotClosed();
+
+        if (transformCount == 0)
+            return;
+
+        CheckInPointer(transforms);
+
+        AddSprites(bitmap, transformCount, nullptr, transforms, 0, nullptr, tintCount, tints, flipCount, flips);
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::DrawFromSpriteSheetAtOffsets(
+    ICanvasBitmap* bitmap,
+    uint32_t offsetCount,
+    Vector2* offsets,
+    uint32_t sourceRectCount,
+    Rect* sourceRects,
+    uint32_t tintCount,
+    Vector4* tints,
+    uint32_t flipCount,
+    CanvasSpriteFlip* flips)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        EnsureNotClosed();
+
+        if (offsetCount == 0)
+            return;
+
+        CheckInPointer(offsets);
+        ValidateSpriteArray(offsetCount, sourceRectCount, sourceRects, false);
+
+        AddSprites(bitmap, offsetCount, offsets, nullptr, sourceRectCount, sourceRects, tintCount, tints, flipCount, flips);
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::DrawFromSpriteSheetWithTransforms(
+    ICanvasBitmap* bitmap,
+    uint32_t transformCount,
+    Matrix3x2* transforms,
+    uint32_t sourceRectCount,
+    Rect* sourceRects,
+    uint32_t tintCount,
+    Vector4* tints,
+    uint32_t flipCount,
+    CanvasSpriteFlip* flips)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        EnsureNotClosed();
+
+        if (transformCount == 0)
+            return;
+
+        CheckInPointer(transforms);
+        ValidateSpriteArray(transformCount, sourceRectCount, sourceRects, false);
+
+        AddSprites(bitmap, transformCount, nullptr, transforms, sourceRectCount, sourceRects, tintCount, tints, flipCount, flips);
+    });
+}
+
+
+void CanvasSpriteBatch::AddSprites(
+    ICanvasBitmap* bitmap,
+    uint32_t spriteCount,
+    Vector2 const* offsets,
+    Matrix3x2 const* transforms,
+    uint32_t sourceRectCount,
+    Rect const* sourceRects,
+    uint32_t tintCount,
+    Vector4 const* tints,
+    uint32_t flipCount,
+    CanvasSpriteFlip const* flips)
+{
+    assert(spriteCount > 0);
+    assert((offsets == nullptr) != (transforms == nullptr));
+
+    ValidateSpriteArray(spriteCount, tintCount, tints, true);
+    ValidateSpriteArray(spriteCount, flipCount, flips, true);
+
+    // Checking the flips up front means that nothing below can fail once we
+    // start adding sprites, so either all of them are added or none are.
+    for (uint32_t i = 0; i < flipCount; ++i)
+    {
+        if (flips[i] < CanvasSpriteFlip::None || flips[i] > CanvasSpriteFlip::Both)
+            ThrowHR(E_INVALIDARG);
+    }
+
+    //
+    // Everything that depends only on the bitmap is looked up once, rather
+    // than once per sprite.
+    //
+
+    auto d2dBitmap = GetWrappedResource<ID2D1Bitmap>(bitmap);
+    auto sizeInDips = d2dBitmap->GetSize();
+    auto sizeInPixels = d2dBitmap->GetPixelSize();
+
+    float dpi = DEFAULT_DPI;
+    if (sourceRects && m_unitMode == D2D1_UNIT_MODE_DIPS)
+        ThrowIfFailed(As<ICanvasResourceCreatorWithDpi>(bitmap)->get_Dpi(&dpi));
+
+    // Make room for the whole array at once, but never less than the
+    // vector's own geometric growth would, so that many small arrays don't
+    // each reallocate and copy every sprite added so far.
+    auto requiredCapacity = m_sprites.size() + spriteCount;
+
+    if (requiredCapacity > m_sprites.capacity())
+        m_sprites.reserve(std::max(requiredCapacity, m_sprites.capacity() * 2));
+
+    for (uint32_t i = 0; i < spriteCount; ++i)
+    {
+        auto tint = GetSpriteArrayElement(tintCount, tints, i, DEFAULT_TINT);
+        auto flip = GetSpriteArrayElement(flipCount, flips, i, CanvasSpriteFlip::None);
+
+        D2D1_RECT_F d2dDestRect;
+        D2D1_RECT_U d2dSourceRect;
+
+        if (sourceRects)
+        {
+            auto sourceRect = GetSpriteArrayElement(sourceRectCount, sourceRects, i, Rect{});
+            d2dDestRect = MakeDestRect(sourceRect);
+            d2dSourceRect = MakeSourceRect(flip, dpi, sourceRect);
+        }
+        else
+        {
+            d2dDestRect = D2D1_RECT_F{ 0, 0, sizeInDips.width, sizeInDips.height };
+            d2dSourceRect = MakeSourceRect(flip, 0, 0, sizeInPixels.width, sizeInPixels.height);
+        }
+
+        if (offsets)
+        {
+            auto& offset = offsets[i];
+
+            d2dDestRect.left   += offset.X;
+            d2dDestRect.top    += offset.Y;
+            d2dDestRect.right  += offset.X;
+            d2dDestRect.bottom += offset.Y;
+
+            m_sprites.emplace_back(
+                m_layer,
+                ComPtr<ID2D1Bitmap>(d2dBitmap),
+                d2dDestRect,
+                d2dSourceRect,
+                tint);
+        }
+        else
+        {
+            m_sprites.emplace_back(
+                m_layer,
+                ComPtr<ID2D1Bitmap>(d2dBitmap),
+                d2dDestRect,
+                d2dSourceRect,
+                tint,
+                transforms[i]);
+        }
+    }
+}
+
+
+template<typename T, typename A>
 class BatchFinder
 {
-    std::vector<T> const& m_sprites;
+    std::vector<T, A> const& m_sprites;
     uint32_t const m_maxSpritesPerBatch;
 
     uint32_t m_startIndex;
@@ -443,7 +707,7 @@ class BatchFinder
     ID2D1Bitmap* m_bitmap;
 
 public:
-    BatchFinder(std::vector<T> const& sprites, uint32_t maxSpritesPerBatch) noexcept
+    BatchFinder(std::vector<T, A> const& sprites, uint32_t maxSpritesPerBatch) noexcept
         : m_sprites(sprites)
         , m_maxSpritesPerBatch(maxSpritesPerBatch)
         , m_startIndex(0)
@@ -485,6 +749,13 @@ public:
         return m_endIndex - m_startIndex;
     }
 
+    // True if the previous batch was cut short by maxSpritesPerBatch, so this
+    // one carries on with the same bitmap.
+    bool CurrentContinuesPreviousBatch() const noexcept
+    {
+        return m_startIndex != 0 && m_sprites[m_startIndex - 1].Bitmap.Get() == m_bitmap;
+    }
+
     ID2D1Bitmap* CurrentBitmap() const noexcept
     {
         return m_bitmap;
@@ -504,6 +775,151 @@ private:
     }
 };
 
+//
+// Issues the DrawSpriteBatch calls for sprites that have already been added
+// to spriteBatch - one call for each run of sprites that share a bitmap.  The
+// calls made are counted in statistics.
+//
+template<typename T, typename A>
+static void DrawSpriteRuns(
+    ICanvasDeviceInternal* device,
+    ID2D1DeviceContext3* deviceContext,
+    ID2D1SpriteBatch* spriteBatch,
+    std::vector<T, A> const& sprites,
+    D2D1_UNIT_MODE unitMode,
+    D2D1_BITMAP_INTERPOLATION_MODE interpolationMode,
+    D2D1_SPRITE_OPTIONS spriteOptions,
+    CanvasSpriteBatchStatistics* statistics)
+{
+    //
+    // Get the device context into the right state
+    //
+    
+    auto originalAntialiasMode = deviceContext->GetAntialiasMode();
+
+    if (originalAntialiasMode == D2D1_ANTIALIAS_MODE_PER_PRIMITIVE)
+        deviceContext->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+
+    auto originalUnitMode = deviceContext->GetUnitMode();
+    if (originalUnitMode != unitMode)
+        deviceContext->SetUnitMode(unitMode);
+
+    //
+    // Draw the sprites - one DrawSpriteBatch call for each bitmap
+    //
+
+    // Figure out if we need to quirk the batch size to workaround an issue
+    // with older Qualcomm drivers.
+    bool quirked = device->IsSpriteBatchQuirkRequired();
+    uint32_t maxSpritesPerBatch = quirked ? 256 : std::numeric_limits<uint32_t>::max();
+    
+    for (BatchFinder<T, A> batchFinder(sprites, maxSpritesPerBatch); !batchFinder.Done(); batchFinder.FindNext())
+    {
+        deviceContext->DrawSpriteBatch(
+            spriteBatch,
+            batchFinder.CurrentStartIndex(),
+            batchFinder.CurrentSpriteCount(),
+            batchFinder.CurrentBitmap(),
+            interpolationMode,
+            spriteOptions);
+
+        ++statistics->DrawCallCount;
+
+        if (batchFinder.CurrentContinuesPreviousBatch())
+            ++statistics->QuirkDrawCallCount;
+
+        if (quirked)
+        {
+            // Direct2D will helpfully batch up our DrawSpriteBatch calls - when
+            // we're manually unbatching them to avoid limits of the maximum sprites per batch!
+            // An explicit Flush here prevents that from happening.
+            deviceContext->Flush();
+            ++statistics->FlushCount;
+        }
+    }
+
+    //
+    // Restore the state we may have changed
+    //
+
+    if (originalUnitMode != unitMode)
+        deviceContext->SetUnitMode(originalUnitMode);
+
+    if (originalAntialiasMode == D2D1_ANTIALIAS_MODE_PER_PRIMITIVE)
+        deviceContext->SetAntialiasMode(originalAntialiasMode);
+}
+
+
+//
+// Close is timed with the performance counter, and the results reported as
+// TimeSpans (100ns units).
+//
+static int64_t GetPerformanceCounter()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+
+static TimeSpan GetTimeSince(int64_t startCounter)
+{
+    static int64_t const frequency = []
+    {
+        LARGE_INTEGER value;
+        QueryPerformanceFrequency(&value);
+        return value.QuadPart;
+    }();
+
+    static int64_t const ticksPerSecond = 10000000;
+
+    auto elapsed = GetPerformanceCounter() - startCounter;
+
+    TimeSpan timeSpan;
+    timeSpan.Duration = elapsed * ticksPerSecond / frequency;
+    return timeSpan;
+}
+
+
+//
+// Works out the rectangle of the target that sprites can be drawn to, and the
+// transform that maps sprites into the same space (target pixels).  Returns
+// false if the target has no bounds - eg. if it's a command list - in which
+// case nothing can be culled.
+//
+// D2D doesn't let us query the current clip, so only the target bounds are
+// used.
+//
+static bool TryGetCullingParameters(
+    ID2D1DeviceContext3* deviceContext,
+    D2D1_UNIT_MODE unitMode,
+    D2D1_MATRIX_3X2_F* transform,
+    D2D1_RECT_F* visibleRect)
+{
+    ComPtr<ID2D1Image> target;
+    deviceContext->GetTarget(&target);
+
+    auto targetBitmap = MaybeAs<ID2D1Bitmap>(target);
+    if (!targetBitmap)
+        return false;
+
+    auto sizeInPixels = targetBitmap->GetPixelSize();
+    *visibleRect = D2D1_RECT_F{ 0, 0, static_cast<float>(sizeInPixels.width), static_cast<float>(sizeInPixels.height) };
+
+    deviceContext->GetTransform(transform);
+
+    if (unitMode == D2D1_UNIT_MODE_DIPS)
+    {
+        float dpiX, dpiY;
+        deviceContext->GetDpi(&dpiX, &dpiY);
+
+        *transform = *transform * D2D1::Matrix3x2F::Scale(dpiX / DEFAULT_DPI, dpiY / DEFAULT_DPI);
+    }
+
+    return true;
+}
+
+
 IFACEMETHODIMP CanvasSpriteBatch::Close()
 {
     return ExceptionBoundary([&]
@@ -512,22 +928,84 @@ IFACEMETHODIMP CanvasSpriteBatch::Close()
         if (!deviceContext)
             return;
 
+        auto atlas = std::move(m_atlas);
+
+        EventWrite_CanvasSpriteBatch_Close_Start(static_cast<uint32_t>(m_sprites.size()));
+        auto closeEnd = MakeScopeWarden([&]
+            {
+                EventWrite_CanvasSpriteBatch_Close_Stop(
+                    m_submittedSpriteCount,
+                    m_culledSpriteCount,
+                    m_statistics.DrawCallCount,
+                    m_statistics.QuirkDrawCallCount,
+                    m_statistics.FlushCount,
+                    m_statistics.SortTime.Duration,
+                    m_statistics.AddSpritesTime.Duration,
+                    m_statistics.DrawTime.Duration);
+            });
+
+        //
+        // Give our working memory back to the device, however we leave here
+        //
+
+        // Culling shrinks m_sprites, but the next batch will still need room
+        // for everything that was drawn into this one.
+        auto const spriteCount = m_sprites.size();
+
+        auto device = std::move(m_device);
+        auto returnSprites = MakeScopeWarden([&] { device->GetSpriteBufferPool().Return(std::move(m_sprites), std::move(m_sortScratch), spriteCount); });
+
         if (m_sprites.empty()) // early out if there's nothing to draw
             return;
 
+        //
+        // Drop the sprites that are entirely outside the target
+        //
+
+        if (m_isCullingEnabled)
+        {
+            D2D1_MATRIX_3X2_F transform;
+            D2D1_RECT_F visibleRect;
+
+            if (TryGetCullingParameters(deviceContext.Get(), m_unitMode, &transform, &visibleRect))
+                m_culledSpriteCount = SpriteCuller::Cull(m_sprites, transform, visibleRect);
+        }
+
+        m_submittedSpriteCount = static_cast<uint32_t>(m_sprites.size());
+
+        if (m_sprites.empty())
+            return;
+
+        //
+        // Redirect sprites whose bitmaps have been packed into the atlas, so
+        // that they can be drawn together
+        //
+
+        if (atlas)
+            RemapSpritesToAtlas(atlas.Get());
+
         //
         // Sort the sprites
         //
         
-        if (m_sortMode == CanvasSpriteSortMode::Bitmap)
+        auto sortStart = GetPerformanceCounter();
+
+        switch (m_sortMode)
         {
-            std::stable_sort(m_sprites.begin(), m_sprites.end(),
-                [] (auto const& a, auto const& b)
-                {
-                    return a.Bitmap.Get() < b.Bitmap.Get();
-                });
+        case CanvasSpriteSortMode::Bitmap:
+            SpriteSorter::SortByBitmap(m_sprites, m_sortScratch);
+            break;
+
+        case CanvasSpriteSortMode::Layer:
+            SpriteSorter::SortByLayerAndBitmap(m_sprites, m_sortScratch);
+            break;
+
+        default:
+            break;
         }
 
+        m_statistics.SortTime = GetTimeSince(sortStart);
+
         //
         // Build up a D2D sprite batch from our sprites
         //
@@ -540,6 +1018,8 @@ IFACEMETHODIMP CanvasSpriteBatch::Close()
         auto firstSprite = &m_sprites.front();
         auto stride = static_cast<uint32_t>(sizeof(Sprite));
 
+        auto addSpritesStart = GetPerformanceCounter();
+
         ThrowIfFailed(spriteBatch->AddSprites(
             static_cast<uint32_t>(m_sprites.size()),
             &firstSprite->DestinationRect,
@@ -551,110 +1031,192 @@ IFACEMETHODIMP CanvasSpriteBatch::Close()
             stride,
             stride));
 
-        //
-        // Get the device context into the right state
-        //
-        
-        auto originalAntialiasMode = deviceContext->GetAntialiasMode();
-
-        if (originalAntialiasMode == D2D1_ANTIALIAS_MODE_PER_PRIMITIVE)
-            deviceContext->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
-
-        auto originalUnitMode = deviceContext->GetUnitMode();
-        if (originalUnitMode != m_unitMode)
-            deviceContext->SetUnitMode(m_unitMode);
-
-        //
-        // Draw the sprites - one DrawSpriteBatch call for each bitmap
-        //
+        m_statistics.AddSpritesTime = GetTimeSince(addSpritesStart);
 
-        // Figure out if we need to quirk the batch size to workaround an issue
-        // with older Qualcomm drivers.
-        ComPtr<ID2D1Device> d2dDevice;
-        deviceContext->GetDevice(&d2dDevice);
-        auto device = ResourceManager::GetOrCreate<ICanvasDeviceInternal>(d2dDevice.Get());
-        bool quirked = device->IsSpriteBatchQuirkRequired();
-        uint32_t maxSpritesPerBatch = quirked ? 256 : std::numeric_limits<uint32_t>::max();
-        
-        for (BatchFinder<Sprite> batchFinder(m_sprites, maxSpritesPerBatch); !batchFinder.Done(); batchFinder.FindNext())
-        {
-            deviceContext->DrawSpriteBatch(
-                spriteBatch.Get(),
-                batchFinder.CurrentStartIndex(),
-                batchFinder.CurrentSpriteCount(),
-                batchFinder.CurrentBitmap(),
-                m_interpolationMode,
-                m_spriteOptions);
-
-            if (quirked)
-            {
-                // Direct2D will helpfully batch up our DrawSpriteBatch calls - when
-                // we're manually unbatching them to avoid limits of the maximum sprites per batch!
-                // An explicit Flush here prevents that from happening.
-                deviceContext->Flush();
-            }
-        }
+        auto drawStart = GetPerformanceCounter();
 
-        //
-        // Restore the state we may have changed
-        //
+        DrawSpriteRuns(
+            device.Get(),
+            deviceContext.Get(),
+            spriteBatch.Get(),
+            m_sprites,
+            m_unitMode,
+            m_interpolationMode,
+            m_spriteOptions,
+            &m_statistics);
 
-        if (originalUnitMode != m_unitMode)
-            deviceContext->SetUnitMode(originalUnitMode);
+        m_statistics.DrawTime = GetTimeSince(drawStart);
+    });
+}
 
-        if (originalAntialiasMode == D2D1_ANTIALIAS_MODE_PER_PRIMITIVE)
-            deviceContext->SetAntialiasMode(originalAntialiasMode);
 
-        //
-        // Release our working memory
-        //
+IFACEMETHODIMP CanvasSpriteBatch::get_Atlas(
+    ICanvasSpriteAtlas** value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckAndClearOutPointer(value);
+        EnsureNotClosed();
 
-        m_sprites.clear();
-        m_sprites.shrink_to_fit();
+        ThrowIfFailed(m_atlas.CopyTo(value));
     });
 }
 
 
-IFACEMETHODIMP CanvasSpriteBatch::get_Device(
-    ICanvasDevice** value)
+IFACEMETHODIMP CanvasSpriteBatch::put_Atlas(
+    ICanvasSpriteAtlas* value)
 {
     return ExceptionBoundary([&]
     {
-        CheckAndClearOutPointer(value);
+        EnsureNotClosed();
 
-        ComPtr<ID2D1Device> d2dDevice;
-        m_deviceContext.EnsureNotClosed()->GetDevice(&d2dDevice);
+        if (value)
+        {
+            ComPtr<ICanvasDevice> atlasDevice;
+            ThrowIfFailed(As<ICanvasResourceCreator>(value)->get_Device(&atlasDevice));
 
-        auto device = ResourceManager::GetOrCreate<ICanvasDevice>(d2dDevice.Get());
+            auto atlasD2DDevice = As<ICanvasDeviceInternal>(atlasDevice)->GetD2DDevice();
 
-        ThrowIfFailed(device.CopyTo(value));
+            if (!IsSameInstance(atlasD2DDevice.Get(), m_device->GetD2DDevice().Get()))
+                ThrowHR(E_INVALIDARG, Strings::SpriteBatchAtlasWrongDevice);
+        }
+
+        m_atlas = value;
     });
 }
 
 
-IFACEMETHODIMP CanvasSpriteBatch::get_Dpi( 
-    float* dpi)
+IFACEMETHODIMP CanvasSpriteBatch::get_IsCullingEnabled(
+    boolean* value)
 {
     return ExceptionBoundary([&]
     {
-        CheckInPointer(dpi);
+        CheckInPointer(value);
+        EnsureNotClosed();
 
-        *dpi = GetDpi(m_deviceContext.EnsureNotClosed());
+        *value = m_isCullingEnabled;
     });
 }
 
 
-IFACEMETHODIMP CanvasSpriteBatch::ConvertPixelsToDips( 
-    int32_t pixels,
-    float* dips)
+IFACEMETHODIMP CanvasSpriteBatch::put_IsCullingEnabled(
+    boolean value)
 {
     return ExceptionBoundary([&]
     {
-        CheckInPointer(dips);
-        
-        *dips = PixelsToDips(pixels, GetDpi(m_deviceContext.EnsureNotClosed()));
-    });      
-}
+        EnsureNotClosed();
+
+        m_isCullingEnabled = !!value;
+    });
+}
+
+
+//
+// The sprite counts and statistics are only known once the sprite batch has
+// been closed, so unlike the other properties these can be read after Close.
+//
+
+IFACEMETHODIMP CanvasSpriteBatch::get_CulledSpriteCount(
+    int32_t* value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(value);
+
+        *value = static_cast<int32_t>(m_culledSpriteCount);
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::get_SubmittedSpriteCount(
+    int32_t* value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(value);
+
+        *value = static_cast<int32_t>(m_submittedSpriteCount);
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::get_Statistics(
+    CanvasSpriteBatchStatistics* value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(value);
+
+        *value = m_statistics;
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::get_Layer(
+    int32_t* value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(value);
+        EnsureNotClosed();
+
+        *value = m_layer;
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::put_Layer(
+    int32_t value)
+{
+    return ExceptionBoundary([&]
+    {
+        EnsureNotClosed();
+
+        m_layer = value;
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::get_Device(
+    ICanvasDevice** value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckAndClearOutPointer(value);
+
+        ComPtr<ID2D1Device> d2dDevice;
+        m_deviceContext.EnsureNotClosed()->GetDevice(&d2dDevice);
+
+        auto device = ResourceManager::GetOrCreate<ICanvasDevice>(d2dDevice.Get());
+
+        ThrowIfFailed(device.CopyTo(value));
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::get_Dpi( 
+    float* dpi)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(dpi);
+
+        *dpi = GetDpi(m_deviceContext.EnsureNotClosed());
+    });
+}
+
+
+IFACEMETHODIMP CanvasSpriteBatch::ConvertPixelsToDips( 
+    int32_t pixels,
+    float* dips)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(dips);
+        
+        *dips = PixelsToDips(pixels, GetDpi(m_deviceContext.EnsureNotClosed()));
+    });      
+}
 
 
 IFACEMETHODIMP CanvasSpriteBatch::ConvertDipsToPixels( 
@@ -677,4 +1239,579 @@ void CanvasSpriteBatch::EnsureNotClosed()
 }
 
 
+void CanvasSpriteBatch::RemapSpritesToAtlas(ICanvasSpriteAtlas* atlas)
+{
+    auto atlasInternal = As<ICanvasSpriteAtlasInternal>(atlas);
+
+    // Sprites tend to come in runs that share a bitmap, so the atlas is only
+    // asked about each run once.
+    ID2D1Bitmap* runBitmap = nullptr;
+    bool runIsInAtlas = false;
+    ComPtr<ID2D1Bitmap> atlasBitmap;
+    D2D1_POINT_2U offset{};
+
+    for (auto& sprite : m_sprites)
+    {
+        if (sprite.Bitmap.Get() != runBitmap)
+        {
+            runBitmap = sprite.Bitmap.Get();
+            runIsInAtlas = atlasInternal->TryGetPlacement(runBitmap, &atlasBitmap, &offset);
+        }
+
+        if (!runIsInAtlas)
+            continue;
+
+        sprite.Bitmap = atlasBitmap;
+
+        // Flipped sprites have their source rectangle edges swapped, which
+        // doesn't affect how they're offset.
+        sprite.SourceRect.left += offset.x;
+        sprite.SourceRect.right += offset.x;
+        sprite.SourceRect.top += offset.y;
+        sprite.SourceRect.bottom += offset.y;
+    }
+}
+
+
+//
+// CanvasRetainedSpriteBatchFactory implementation
+//
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatchFactory::Create(
+    ICanvasResourceCreator* resourceCreator,
+    ICanvasRetainedSpriteBatch** retainedSpriteBatch)
+{
+    return CreateWithInterpolationAndOptions(
+        resourceCreator,
+        CanvasImageInterpolation::Linear,
+        CanvasSpriteOptions::None,
+        retainedSpriteBatch);
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatchFactory::CreateWithInterpolationAndOptions(
+    ICanvasResourceCreator* resourceCreator,
+    CanvasImageInterpolation interpolation,
+    CanvasSpriteOptions options,
+    ICanvasRetainedSpriteBatch** retainedSpriteBatch)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(resourceCreator);
+        CheckAndClearOutPointer(retainedSpriteBatch);
+
+        // Same validation as CanvasDrawingSession.CreateSpriteBatch
+        switch (interpolation)
+        {
+        case CanvasImageInterpolation::NearestNeighbor:
+        case CanvasImageInterpolation::Linear:
+            break;
+
+        default:
+            ThrowHR(E_INVALIDARG, Strings::SpriteBatchInvalidInterpolation);
+        }
+
+        auto const validOptions = CanvasSpriteOptions::ClampToSourceRect;
+        if ((static_cast<uint32_t>(options) & ~static_cast<uint32_t>(validOptions)) != 0)
+            ThrowHR(E_INVALIDARG);
+
+        ComPtr<ICanvasDevice> device;
+        ThrowIfFailed(resourceCreator->get_Device(&device));
+
+        {
+            auto lease = As<ICanvasDeviceInternal>(device)->GetResourceCreationDeviceContext();
+            if (!MaybeAs<ID2D1DeviceContext3>(lease.Get()))
+                ThrowHR(E_NOTIMPL, Strings::SpriteBatchNotAvailable);
+        }
+
+        auto newRetainedSpriteBatch = Make<CanvasRetainedSpriteBatch>(
+            device.Get(),
+            static_cast<D2D1_BITMAP_INTERPOLATION_MODE>(interpolation),
+            static_cast<D2D1_SPRITE_OPTIONS>(options));
+        CheckMakeResult(newRetainedSpriteBatch);
+
+        ThrowIfFailed(newRetainedSpriteBatch.CopyTo(retainedSpriteBatch));
+    });
+}
+
+
+//
+// CanvasRetainedSpriteBatch implementation
+//
+
+
+CanvasRetainedSpriteBatch::CanvasRetainedSpriteBatch(
+    ICanvasDevice* device,
+    D2D1_BITMAP_INTERPOLATION_MODE interpolation,
+    D2D1_SPRITE_OPTIONS options)
+    : m_device(device)
+    , m_interpolationMode(interpolation)
+    , m_spriteOptions(options)
+    , m_uploadedCount(0)
+    , m_needsRebuild(false)
+{
+    assert(m_interpolationMode == D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR
+        || m_interpolationMode == D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
+
+    assert(m_spriteOptions == D2D1_SPRITE_OPTIONS_NONE
+        || m_spriteOptions == D2D1_SPRITE_OPTIONS_CLAMP_TO_SOURCE_RECTANGLE);
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::Add(
+    ICanvasBitmap* bitmap,
+    Matrix3x2 transform,
+    Vector4 tint,
+    CanvasSpriteFlip flip,
+    uint32_t* spriteHandle)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        CheckInPointer(spriteHandle);
+        ValidateBitmapDevice(bitmap);
+
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap>(bitmap);
+        auto d2dDestRect = MakeDestRect(d2dBitmap);
+        auto d2dSourceRect = MakeSourceRect(d2dBitmap, flip);
+
+        *spriteHandle = AddSprite(
+            std::move(d2dBitmap),
+            d2dDestRect,
+            d2dSourceRect,
+            tint,
+            transform);
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::AddFromSpriteSheet(
+    ICanvasBitmap* bitmap,
+    Matrix3x2 transform,
+    Rect sourceRect,
+    Vector4 tint,
+    CanvasSpriteFlip flip,
+    uint32_t* spriteHandle)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(bitmap);
+        CheckInPointer(spriteHandle);
+        ValidateBitmapDevice(bitmap);
+
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap>(bitmap);
+        auto d2dDestRect = MakeDestRect(sourceRect);
+        auto d2dSourceRect = MakeSourceRect(flip, D2D1_UNIT_MODE_DIPS, bitmap, sourceRect);
+
+        *spriteHandle = AddSprite(
+            std::move(d2dBitmap),
+            d2dDestRect,
+            d2dSourceRect,
+            tint,
+            transform);
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::SetTransform(
+    uint32_t spriteHandle,
+    Matrix3x2 transform)
+{
+    return ExceptionBoundary([&]
+    {
+        m_device.EnsureNotClosed();
+
+        auto slot = GetSlot(spriteHandle);
+        m_sprites[slot].Transform = *ReinterpretAs<D2D1_MATRIX_3X2_F const*>(&transform);
+        MarkDirty(slot);
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::SetTint(
+    uint32_t spriteHandle,
+    Vector4 tint)
+{
+    return ExceptionBoundary([&]
+    {
+        m_device.EnsureNotClosed();
+
+        auto slot = GetSlot(spriteHandle);
+        m_sprites[slot].Color = *ReinterpretAs<D2D1_COLOR_F const*>(&tint);
+        MarkDirty(slot);
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::SetSourceRect(
+    uint32_t spriteHandle,
+    Rect sourceRect,
+    CanvasSpriteFlip flip)
+{
+    return ExceptionBoundary([&]
+    {
+        m_device.EnsureNotClosed();
+
+        auto slot = GetSlot(spriteHandle);
+        auto& sprite = m_sprites[slot];
+
+        float dpiX, dpiY;
+        sprite.Bitmap->GetDpi(&dpiX, &dpiY);
+
+        sprite.DestinationRect = MakeDestRect(sourceRect);
+        sprite.SourceRect = MakeSourceRect(flip, dpiX, sourceRect);
+        MarkDirty(slot);
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::Remove(
+    uint32_t spriteHandle)
+{
+    return ExceptionBoundary([&]
+    {
+        m_device.EnsureNotClosed();
+
+        auto slot = GetSlot(spriteHandle);
+
+        m_handleToSlot[spriteHandle] = InvalidIndex;
+        m_freeHandles.push_back(spriteHandle);
+
+        if (slot == m_sprites.size() - 1)
+        {
+            // Nothing after this sprite needs to keep its index, so the slot
+            // can go away completely.  D2D may still hold a stale copy of it
+            // but we never draw past the end of m_sprites.
+            m_sprites.pop_back();
+            return;
+        }
+
+        auto& sprite = m_sprites[slot];
+
+        // The free slot stays in the D2D batch, so it takes on the bitmap of a
+        // neighbor to avoid splitting a run of sprites that would otherwise be
+        // drawn with a single DrawSpriteBatch call.
+        sprite.Bitmap = (slot > 0) ? m_sprites[slot - 1].Bitmap : m_sprites[slot + 1].Bitmap;
+        sprite.DestinationRect = D2D1_RECT_F{};
+        sprite.Color = D2D1_COLOR_F{};
+        sprite.Handle = InvalidIndex;
+
+        MarkDirty(slot);
+        m_freeSlots.push_back(slot);
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::Clear()
+{
+    return ExceptionBoundary([&]
+    {
+        m_device.EnsureNotClosed();
+
+        m_sprites.clear();
+        m_freeSlots.clear();
+        m_handleToSlot.clear();
+        m_freeHandles.clear();
+        m_dirtySlots.clear();
+
+        // The D2D batch is cleared on the next Draw, so everything added
+        // from now on is new to it.
+        m_uploadedCount = 0;
+        m_needsRebuild = true;
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::get_Count(
+    uint32_t* value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(value);
+        m_device.EnsureNotClosed();
+
+        *value = static_cast<uint32_t>(m_sprites.size() - m_freeSlots.size());
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::Draw(
+    ICanvasDrawingSession* drawingSession)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckInPointer(drawingSession);
+        auto deviceInternal = As<ICanvasDeviceInternal>(m_device.EnsureNotClosed());
+
+        auto deviceContext = MaybeAs<ID2D1DeviceContext3>(GetWrappedResource<ID2D1DeviceContext1>(drawingSession));
+        if (!deviceContext)
+            ThrowHR(E_NOTIMPL, Strings::SpriteBatchNotAvailable);
+
+        ComPtr<ID2D1Device> d2dDevice;
+        deviceContext->GetDevice(&d2dDevice);
+        if (!IsSameInstance(d2dDevice.Get(), deviceInternal->GetD2DDevice().Get()))
+            ThrowHR(E_INVALIDARG, Strings::RetainedSpriteBatchWrongDevice);
+
+        // Once at least half the slots are free it is cheaper to upload the
+        // whole batch again than to keep drawing the holes.
+        if (m_freeSlots.size() * 2 > m_sprites.size())
+            Compact();
+
+        if (m_sprites.empty())
+            return;
+
+        Upload(deviceContext.Get());
+
+        // Retained batches don't report statistics
+        CanvasSpriteBatchStatistics statistics{};
+
+        DrawSpriteRuns(
+            deviceInternal.Get(),
+            deviceContext.Get(),
+            m_d2dSpriteBatch.Get(),
+            m_sprites,
+            D2D1_UNIT_MODE_DIPS,
+            m_interpolationMode,
+            m_spriteOptions,
+            &statistics);
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::Close()
+{
+    return ExceptionBoundary([&]
+    {
+        m_d2dSpriteBatch.Reset();
+        m_uploadedCount = 0;
+
+        m_sprites.clear();
+        m_sprites.shrink_to_fit();
+        m_freeSlots.clear();
+        m_handleToSlot.clear();
+        m_freeHandles.clear();
+        m_dirtySlots.clear();
+
+        m_device.Close();
+    });
+}
+
+
+IFACEMETHODIMP CanvasRetainedSpriteBatch::get_Device(
+    ICanvasDevice** value)
+{
+    return ExceptionBoundary([&]
+    {
+        CheckAndClearOutPointer(value);
+
+        ThrowIfFailed(m_device.EnsureNotClosed().CopyTo(value));
+    });
+}
+
+
+void CanvasRetainedSpriteBatch::ValidateBitmapDevice(ICanvasBitmap* bitmap)
+{
+    auto& device = m_device.EnsureNotClosed();
+
+    ComPtr<ICanvasDevice> bitmapDevice;
+    ThrowIfFailed(As<ICanvasResourceCreator>(bitmap)->get_Device(&bitmapDevice));
+
+    if (!IsSameInstance(bitmapDevice.Get(), device.Get()))
+        ThrowHR(E_INVALIDARG, Strings::RetainedSpriteBatchBitmapWrongDevice);
+}
+
+
+uint32_t CanvasRetainedSpriteBatch::AddSprite(
+    ComPtr<ID2D1Bitmap>&& bitmap,
+    D2D1_RECT_F const& destinationRect,
+    D2D1_RECT_U const& sourceRect,
+    Vector4 const& tint,
+    Matrix3x2 const& transform)
+{
+    uint32_t spriteHandle;
+
+    if (m_freeHandles.empty())
+    {
+        spriteHandle = static_cast<uint32_t>(m_handleToSlot.size());
+        m_handleToSlot.push_back(InvalidIndex);
+    }
+    else
+    {
+        spriteHandle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+
+    uint32_t slot;
+
+    if (m_freeSlots.empty())
+    {
+        slot = static_cast<uint32_t>(m_sprites.size());
+        m_sprites.push_back(Sprite{});
+    }
+    else
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+
+    auto& sprite = m_sprites[slot];
+    sprite.Bitmap = std::move(bitmap);
+    sprite.DestinationRect = destinationRect;
+    sprite.SourceRect = sourceRect;
+    sprite.Color = *ReinterpretAs<D2D1_COLOR_F const*>(&tint);
+    sprite.Transform = *ReinterpretAs<D2D1_MATRIX_3X2_F const*>(&transform);
+    sprite.Handle = spriteHandle;
+
+    m_handleToSlot[spriteHandle] = slot;
+    MarkDirty(slot);
+
+    return spriteHandle;
+}
+
+
+uint32_t CanvasRetainedSpriteBatch::GetSlot(uint32_t spriteHandle)
+{
+    if (spriteHandle >= m_handleToSlot.size() || m_handleToSlot[spriteHandle] == InvalidIndex)
+        ThrowHR(E_INVALIDARG);
+
+    return m_handleToSlot[spriteHandle];
+}
+
+
+void CanvasRetainedSpriteBatch::MarkDirty(uint32_t slot)
+{
+    // Slots that haven't been uploaded yet are picked up by the AddSprites
+    // call in Upload, so there's no need to track them.
+    if (slot >= m_uploadedCount)
+        return;
+
+    auto& sprite = m_sprites[slot];
+
+    if (!sprite.IsDirty)
+    {
+        sprite.IsDirty = true;
+        m_dirtySlots.push_back(slot);
+    }
+}
+
+
+void CanvasRetainedSpriteBatch::Compact()
+{
+    m_sprites.erase(
+        std::remove_if(m_sprites.begin(), m_sprites.end(),
+            [] (Sprite const& sprite) { return sprite.Handle == InvalidIndex; }),
+        m_sprites.end());
+
+    for (uint32_t slot = 0; slot < m_sprites.size(); ++slot)
+    {
+        m_sprites[slot].IsDirty = false;
+        m_handleToSlot[m_sprites[slot].Handle] = slot;
+    }
+
+    m_freeSlots.clear();
+    m_dirtySlots.clear();
+
+    m_uploadedCount = 0;
+    m_needsRebuild = true;
+}
+
+
+void CanvasRetainedSpriteBatch::Upload(ID2D1DeviceContext3* deviceContext)
+{
+    auto const stride = static_cast<uint32_t>(sizeof(Sprite));
+
+    if (!m_d2dSpriteBatch)
+    {
+        ThrowIfFailed(deviceContext->CreateSpriteBatch(&m_d2dSpriteBatch));
+        m_uploadedCount = 0;
+        m_needsRebuild = false;
+    }
+    else if (m_needsRebuild)
+    {
+        m_d2dSpriteBatch->Clear();
+        m_uploadedCount = 0;
+        m_needsRebuild = false;
+    }
+
+    //
+    // Send modified sprites, one SetSprites call per contiguous range of slots
+    //
+
+    if (!m_dirtySlots.empty())
+    {
+        std::sort(m_dirtySlots.begin(), m_dirtySlots.end());
+
+        // Sprites may have been removed from the end since they were marked
+        // dirty.
+        auto const spriteCount = static_cast<uint32_t>(m_sprites.size());
+        auto const slotLimit = std::min(spriteCount, m_uploadedCount);
+
+        size_t i = 0;
+        while (i < m_dirtySlots.size())
+        {
+            auto startSlot = m_dirtySlots[i];
+            auto endSlot = startSlot + 1;
+
+            for (++i; i < m_dirtySlots.size() && m_dirtySlots[i] <= endSlot; ++i)
+                endSlot = std::max(endSlot, m_dirtySlots[i] + 1);
+
+            // Slots past slotLimit are sent by AddSprites below, but must
+            // still be marked clean so later changes to them are tracked.
+            for (auto slot = startSlot; slot < std::min(endSlot, spriteCount); ++slot)
+                m_sprites[slot].IsDirty = false;
+
+            endSlot = std::min(endSlot, slotLimit);
+            if (startSlot >= endSlot)
+                continue;
+
+            auto firstSprite = &m_sprites[startSlot];
+
+            ThrowIfFailed(m_d2dSpriteBatch->SetSprites(
+                startSlot,
+                endSlot - startSlot,
+                &firstSprite->DestinationRect,
+                &firstSprite->SourceRect,
+                &firstSprite->Color,
+                &firstSprite->Transform,
+                stride,
+                stride,
+                stride,
+                stride));
+        }
+
+        m_dirtySlots.clear();
+    }
+
+    //
+    // Append any sprites that D2D doesn't know about yet
+    //
+
+    assert(m_sprites.size() < std::numeric_limits<uint32_t>::max());
+    auto spriteCount = static_cast<uint32_t>(m_sprites.size());
+
+    if (spriteCount > m_uploadedCount)
+    {
+        auto firstSprite = &m_sprites[m_uploadedCount];
+
+        ThrowIfFailed(m_d2dSpriteBatch->AddSprites(
+            spriteCount - m_uploadedCount,
+            &firstSprite->DestinationRect,
+            &firstSprite->SourceRect,
+            &firstSprite->Color,
+            &firstSprite->Transform,
+            stride,
+            stride,
+            stride,
+            stride));
+
+        m_uploadedCount = spriteCount;
+    }
+}
+
+
+ActivatableClassWithFactory(CanvasRetainedSpriteBatch, CanvasRetainedSpriteBatchFactory);
+
+
+
 #endif
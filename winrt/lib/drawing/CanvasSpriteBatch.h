@@ -6,6 +6,8 @@
 
 #if WINVER > _WIN32_WINNT_WINBLUE
 
+#include "CanvasSpriteAtlas.h"
+
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
     class CanvasSpriteBatchStatics
@@ -30,39 +32,26 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         D2D1_SPRITE_OPTIONS m_spriteOptions;
         D2D1_UNIT_MODE m_unitMode;
         
-        struct Sprite
-        {
-            ComPtr<ID2D1Bitmap> Bitmap;
-            D2D1_RECT_F DestinationRect;
-            D2D1_RECT_U SourceRect;
-            D2D1_COLOR_F Color;
-            D2D1_MATRIX_3X2_F Transform;
+        typedef SpriteBatchSprite Sprite;
 
-            Sprite(
-                ComPtr<ID2D1Bitmap>&& bitmap,
-                D2D1_RECT_F const& destinationRect,
-                D2D1_RECT_U const& sourceRect,
-                Vector4 const& tint,
-                Matrix3x2 const& transform)
-                : Bitmap(std::move(bitmap))
-                , DestinationRect(destinationRect)
-                , SourceRect(sourceRect)
-                , Color(*ReinterpretAs<D2D1_COLOR_F const*>(&tint))
-                , Transform(*ReinterpretAs<D2D1_MATRIX_3X2_F const*>(&transform))
-            {
-            }
-
-            Sprite(
-                ComPtr<ID2D1Bitmap>&& bitmap,
-                D2D1_RECT_F const& destinationRect,
-                D2D1_RECT_U const& sourceRect,
-                Vector4 const& tint)
-                : Sprite(std::move(bitmap), destinationRect, sourceRect, tint, Identity3x2())
-            {
-            }
-        };
+        // Leased from the device's SpriteBufferPool, and returned on Close.
+        // m_sortScratch must come before m_sprites, since leasing the
+        // sprites fills it in.
+        ComPtr<ICanvasDeviceInternal> m_device;
+        PooledSpriteSortScratch m_sortScratch;
+        SpriteBuffer m_sprites;
 
-        std::vector<Sprite> m_sprites;
+        ComPtr<ICanvasSpriteAtlas> m_atlas;
+
+        bool m_isCullingEnabled;
+        uint32_t m_culledSpriteCount;
+        uint32_t m_submittedSpriteCount;
+
+        // Given to each sprite as it is added
+        int32_t m_layer;
+
+        // Filled in by Close
+        CanvasSpriteBatchStatistics m_statistics;
 
     public:
         static Vector4 const DEFAULT_TINT;
@@ -184,6 +173,73 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             Vector2 scale,
             CanvasSpriteFlip flip) override;
 
+        IFACEMETHODIMP DrawAtOffsets(
+            ICanvasBitmap* bitmap,
+            uint32_t offsetCount,
+            Vector2* offsets,
+            uint32_t tintCount,
+            Vector4* tints,
+            uint32_t flipCount,
+            CanvasSpriteFlip* flips) override;
+
+        IFACEMETHODIMP DrawWithTransforms(
+            ICanvasBitmap* bitmap,
+            uint32_t transformCount,
+            Matrix3x2* transforms,
+            uint32_t tintCount,
+            Vector4* tints,
+            uint32_t flipCount,
+            CanvasSpriteFlip* flips) override;
+
+        IFACEMETHODIMP DrawFromSpriteSheetAtOffsets(
+            ICanvasBitmap* bitmap,
+            uint32_t offsetCount,
+            Vector2* offsets,
+            uint32_t sourceRectCount,
+            Rect* sourceRects,
+            uint32_t tintCount,
+            Vector4* tints,
+            uint32_t flipCount,
+            CanvasSpriteFlip* flips) override;
+
+        IFACEMETHODIMP DrawFromSpriteSheetWithTransforms(
+            ICanvasBitmap* bitmap,
+            uint32_t transformCount,
+            Matrix3x2* transforms,
+            uint32_t sourceRectCount,
+            Rect* sourceRects,
+            uint32_t tintCount,
+            Vector4* tints,
+            uint32_t flipCount,
+            CanvasSpriteFlip* flips) override;
+
+        IFACEMETHODIMP get_Atlas(
+            ICanvasSpriteAtlas** value) override;
+
+        IFACEMETHODIMP put_Atlas(
+            ICanvasSpriteAtlas* value) override;
+
+        IFACEMETHODIMP get_IsCullingEnabled(
+            boolean* value) override;
+
+        IFACEMETHODIMP put_IsCullingEnabled(
+            boolean value) override;
+
+        IFACEMETHODIMP get_CulledSpriteCount(
+            int32_t* value) override;
+
+        IFACEMETHODIMP get_SubmittedSpriteCount(
+            int32_t* value) override;
+
+        IFACEMETHODIMP get_Layer(
+            int32_t* value) override;
+
+        IFACEMETHODIMP put_Layer(
+            int32_t value) override;
+
+        IFACEMETHODIMP get_Statistics(
+            CanvasSpriteBatchStatistics* value) override;
+
         //
         // IClosable
         //
@@ -216,6 +272,170 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
     private:
         void EnsureNotClosed();
+        void RemapSpritesToAtlas(ICanvasSpriteAtlas* atlas);
+
+        // Exactly one of offsets and transforms is non-null, and contains
+        // spriteCount elements.  A null sourceRects means that each sprite
+        // uses the whole bitmap.
+        void AddSprites(
+            ICanvasBitmap* bitmap,
+            uint32_t spriteCount,
+            Vector2 const* offsets,
+            Matrix3x2 const* transforms,
+            uint32_t sourceRectCount,
+            Rect const* sourceRects,
+            uint32_t tintCount,
+            Vector4 const* tints,
+            uint32_t flipCount,
+            CanvasSpriteFlip const* flips);
+    };
+
+
+    class CanvasRetainedSpriteBatchFactory
+        : public AgileActivationFactory<ICanvasRetainedSpriteBatchFactory>
+        , private LifespanTracker<CanvasRetainedSpriteBatchFactory>
+    {
+        InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasRetainedSpriteBatch, BaseTrust);
+
+    public:
+        IFACEMETHOD(Create)(
+            ICanvasResourceCreator* resourceCreator,
+            ICanvasRetainedSpriteBatch** retainedSpriteBatch) override;
+
+        IFACEMETHOD(CreateWithInterpolationAndOptions)(
+            ICanvasResourceCreator* resourceCreator,
+            CanvasImageInterpolation interpolation,
+            CanvasSpriteOptions options,
+            ICanvasRetainedSpriteBatch** retainedSpriteBatch) override;
+    };
+
+
+    //
+    // A sprite batch that keeps its sprites, and the D2D sprite batch they
+    // are uploaded to, alive between frames.  Each sprite is identified by a
+    // handle.  Only sprites that have been added or modified since the last
+    // Draw are sent to D2D, using SetSprites for the ranges that changed.
+    //
+    class CanvasRetainedSpriteBatch
+        : public RuntimeClass<ICanvasRetainedSpriteBatch, IClosable, ICanvasResourceCreator>
+        , private LifespanTracker<CanvasRetainedSpriteBatch>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_CanvasRetainedSpriteBatch, BaseTrust);
+
+        static uint32_t const InvalidIndex = 0xFFFFFFFF;
+
+        ClosablePtr<ICanvasDevice> m_device;
+        D2D1_BITMAP_INTERPOLATION_MODE m_interpolationMode;
+        D2D1_SPRITE_OPTIONS m_spriteOptions;
+
+        // The first five fields match the layout CanvasSpriteBatch uses, so
+        // that the array can be passed straight to AddSprites / SetSprites
+        // with a stride.
+        struct Sprite
+        {
+            ComPtr<ID2D1Bitmap> Bitmap;
+            D2D1_RECT_F DestinationRect;
+            D2D1_RECT_U SourceRect;
+            D2D1_COLOR_F Color;
+            D2D1_MATRIX_3X2_F Transform;
+            uint32_t Handle;
+            bool IsDirty;
+        };
+
+        // Sprites are stored in slots.  Removed sprites leave a free slot
+        // behind (so that the indices of the other sprites in the D2D batch
+        // don't change) which is reused by the next Add.  Free slots have a
+        // Handle of InvalidIndex.
+        std::vector<Sprite> m_sprites;
+        std::vector<uint32_t> m_freeSlots;
+
+        // Maps handles to slots; InvalidIndex marks a free handle.
+        std::vector<uint32_t> m_handleToSlot;
+        std::vector<uint32_t> m_freeHandles;
+
+        // Slots below m_uploadedCount that have changed since the last Draw.
+        std::vector<uint32_t> m_dirtySlots;
+
+        ComPtr<ID2D1SpriteBatch> m_d2dSpriteBatch;
+        uint32_t m_uploadedCount;
+        bool m_needsRebuild;
+
+    public:
+        CanvasRetainedSpriteBatch(
+            ICanvasDevice* device,
+            D2D1_BITMAP_INTERPOLATION_MODE interpolation,
+            D2D1_SPRITE_OPTIONS options);
+
+        //
+        // ICanvasRetainedSpriteBatch
+        //
+
+        IFACEMETHODIMP Add(
+            ICanvasBitmap* bitmap,
+            Matrix3x2 transform,
+            Vector4 tint,
+            CanvasSpriteFlip flip,
+            uint32_t* spriteHandle) override;
+
+        IFACEMETHODIMP AddFromSpriteSheet(
+            ICanvasBitmap* bitmap,
+            Matrix3x2 transform,
+            Rect sourceRect,
+            Vector4 tint,
+            CanvasSpriteFlip flip,
+            uint32_t* spriteHandle) override;
+
+        IFACEMETHODIMP SetTransform(
+            uint32_t spriteHandle,
+            Matrix3x2 transform) override;
+
+        IFACEMETHODIMP SetTint(
+            uint32_t spriteHandle,
+            Vector4 tint) override;
+
+        IFACEMETHODIMP SetSourceRect(
+            uint32_t spriteHandle,
+            Rect sourceRect,
+            CanvasSpriteFlip flip) override;
+
+        IFACEMETHODIMP Remove(
+            uint32_t spriteHandle) override;
+
+        IFACEMETHODIMP Clear() override;
+
+        IFACEMETHODIMP get_Count(
+            uint32_t* value) override;
+
+        IFACEMETHODIMP Draw(
+            ICanvasDrawingSession* drawingSession) override;
+
+        //
+        // IClosable
+        //
+
+        IFACEMETHODIMP Close() override;
+
+        //
+        // ICanvasResourceCreator
+        //
+
+        IFACEMETHODIMP get_Device(
+            ICanvasDevice** value) override;
+
+    private:
+        void ValidateBitmapDevice(ICanvasBitmap* bitmap);
+
+        uint32_t AddSprite(
+            ComPtr<ID2D1Bitmap>&& bitmap,
+            D2D1_RECT_F const& destinationRect,
+            D2D1_RECT_U const& sourceRect,
+            Vector4 const& tint,
+            Matrix3x2 const& transform);
+
+        uint32_t GetSlot(uint32_t spriteHandle);
+        void MarkDirty(uint32_t slot);
+        void Compact();
+        void Upload(ID2D1DeviceContext3* deviceContext);
     };
 
 } } } }
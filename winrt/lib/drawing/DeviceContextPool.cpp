@@ -12,33 +12,88 @@
 //
 
 
+//
+// When a leased device context is returned it is added back to the pool,
+// unless the pool has reached its maximum size, in which the context is
+// destroyed.  This is to give the pool a chance to shrink back down to a
+// reasonable size if there is ever any large scale concurrency going on.
+//
+// Max pool size is picked from number of CPUs - reasoning being that you
+// should expect to be able to have that many threads running and reusing
+// contexts without recreating them.  We have the same number of slots.
+//
 DeviceContextPool::DeviceContextPool(ID2D1Device1* d2dDevice)
     : m_d2dDevice(d2dDevice)
+    , m_isClosed(false)
+    , m_maxPoolSize(std::max(std::thread::hardware_concurrency(), 1U))
+    , m_pooledCount(0)
+    , m_slots(new Slot[m_maxPoolSize])
+    , m_entries(MakeAligned<StackEntry>(m_maxPoolSize))
+    , m_stack(MakeAligned<SLIST_HEADER>(1))
+    , m_freeEntries(MakeAligned<SLIST_HEADER>(1))
 {
+    for (uint32_t i = 0; i < m_maxPoolSize; ++i)
+        m_slots[i].DeviceContext = nullptr;
+
+    InitializeSListHead(m_stack.get());
+    InitializeSListHead(m_freeEntries.get());
+
+    for (uint32_t i = 0; i < m_maxPoolSize; ++i)
+    {
+        auto entry = m_entries.get() + i;
+        entry->DeviceContext = nullptr;
+        InterlockedPushEntrySList(m_freeEntries.get(), &entry->Entry);
+    }
 }
 
 
-DeviceContextLease DeviceContextPool::TakeLease()
+DeviceContextPool::~DeviceContextPool()
 {
-    Lock lock(m_mutex);
+    ReleasePooledDeviceContexts();
+}
 
-    if (!m_d2dDevice)
+
+DeviceContextLease DeviceContextPool::TakeLease()
+{
+    if (m_isClosed)
         ThrowHR(RO_E_CLOSED);
-    
-    if (m_deviceContexts.empty())
+
+    //
+    // Reuse a pooled context if there is one, preferring the one this thread
+    // used last.  Contexts sitting in other threads' slots are only taken
+    // when the alternative is to create a new one.
+    //
+
+    auto pooledDeviceContext = GetCurrentThreadSlot().DeviceContext.exchange(nullptr);
+
+    if (!pooledDeviceContext)
+        pooledDeviceContext = TakeFromStack();
+
+    if (!pooledDeviceContext)
+        pooledDeviceContext = TakeFromAnySlot();
+
+    ComPtr<ID2D1DeviceContext1> deviceContext;
+
+    if (pooledDeviceContext)
     {
-        ComPtr<ID2D1DeviceContext1> deviceContext;
-        ThrowIfFailed(m_d2dDevice->CreateDeviceContext(
-            D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
-            &deviceContext));
+        --m_pooledCount;
+        deviceContext.Attach(pooledDeviceContext);
         return DeviceContextLease(this, std::move(deviceContext));
     }
-    else
-    {
-        DeviceContextLease newLease(this, std::move(m_deviceContexts.back()));
-        m_deviceContexts.pop_back();
-        return newLease;
-    }
+
+    //
+    // Otherwise make a new one
+    //
+
+    Lock lock(m_mutex);
+
+    if (!m_d2dDevice)
+        ThrowHR(RO_E_CLOSED);
+
+    ThrowIfFailed(m_d2dDevice->CreateDeviceContext(
+        D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
+        &deviceContext));
+    return DeviceContextLease(this, std::move(deviceContext));
 }
 
 
@@ -46,29 +101,38 @@ void DeviceContextPool::ReturnLease(ComPtr<ID2D1DeviceContext1>&& deviceContext)
 {
     if (!deviceContext)
         return;
-        
-    Lock lock(m_mutex);
 
     //
     // If the pool has been closed we just discard the context
     //
-    if (!m_d2dDevice)
+    if (m_isClosed)
         return;
 
+    // The context is destroyed if the pool is full
+    if (m_pooledCount++ >= m_maxPoolSize)
+    {
+        --m_pooledCount;
+        return;
+    }
+
+    auto pooledDeviceContext = deviceContext.Detach();
+
+    ID2D1DeviceContext1* empty = nullptr;
+    if (!GetCurrentThreadSlot().DeviceContext.compare_exchange_strong(empty, pooledDeviceContext))
+    {
+        if (!TryPushToStack(pooledDeviceContext))
+        {
+            --m_pooledCount;
+            pooledDeviceContext->Release();
+        }
+    }
+
     //
-    // When a leased device context is returned it is added back to the pool,
-    // unless the pool has reached its maximum size, in which the context is
-    // destroyed.  This is to give the pool a chance to shrink back down to a
-    // reasonable size if there is ever any large scale concurrency going on.
-    //
-    // Max pool size is picked from number of CPUs - reasoning being that you
-    // should expect to be able to have that many threads running and reusing
-    // contexts without recreating them.
+    // If Close ran while we were adding the context to the pool then it may
+    // not have seen it, so we need to release it ourselves.
     //
-    static auto maxPoolSize = std::max(std::thread::hardware_concurrency(), 1U);
-
-    if (m_deviceContexts.size() < maxPoolSize)
-        m_deviceContexts.emplace_back(std::move(deviceContext));
+    if (m_isClosed)
+        ReleasePooledDeviceContexts();
 }
 
 
@@ -76,6 +140,83 @@ void DeviceContextPool::Close()
 {
     Lock lock(m_mutex);
 
-    m_deviceContexts.clear();
+    m_isClosed = true;
     m_d2dDevice = nullptr;
+
+    lock.unlock();
+
+    ReleasePooledDeviceContexts();
+}
+
+
+DeviceContextPool::Slot& DeviceContextPool::GetCurrentThreadSlot()
+{
+    static std::atomic<uint32_t> nextThreadIndex;
+    static thread_local uint32_t const threadIndex = nextThreadIndex++;
+
+    return m_slots[threadIndex % m_maxPoolSize];
+}
+
+
+ID2D1DeviceContext1* DeviceContextPool::TakeFromStack()
+{
+    auto entry = reinterpret_cast<StackEntry*>(InterlockedPopEntrySList(m_stack.get()));
+    if (!entry)
+        return nullptr;
+
+    auto deviceContext = entry->DeviceContext;
+    entry->DeviceContext = nullptr;
+
+    InterlockedPushEntrySList(m_freeEntries.get(), &entry->Entry);
+
+    return deviceContext;
+}
+
+
+ID2D1DeviceContext1* DeviceContextPool::TakeFromAnySlot()
+{
+    for (uint32_t i = 0; i < m_maxPoolSize; ++i)
+    {
+        if (auto deviceContext = m_slots[i].DeviceContext.exchange(nullptr))
+            return deviceContext;
+    }
+
+    return nullptr;
+}
+
+
+bool DeviceContextPool::TryPushToStack(ID2D1DeviceContext1* deviceContext)
+{
+    auto entry = reinterpret_cast<StackEntry*>(InterlockedPopEntrySList(m_freeEntries.get()));
+
+    // m_pooledCount should stop this from happening, but it costs nothing to
+    // be safe.
+    if (!entry)
+        return false;
+
+    entry->DeviceContext = deviceContext;
+    InterlockedPushEntrySList(m_stack.get(), &entry->Entry);
+
+    return true;
+}
+
+
+//
+// Every context is removed from the pool with an atomic exchange or pop, so
+// this is safe to run at the same time as TakeLease, ReturnLease or even
+// itself.  Each context is released exactly once.
+//
+void DeviceContextPool::ReleasePooledDeviceContexts()
+{
+    while (auto deviceContext = TakeFromAnySlot())
+    {
+        --m_pooledCount;
+        deviceContext->Release();
+    }
+
+    while (auto deviceContext = TakeFromStack())
+    {
+        --m_pooledCount;
+        deviceContext->Release();
+    }
 }
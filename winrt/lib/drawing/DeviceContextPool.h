@@ -13,13 +13,65 @@ class DeviceContextLease;
 
 class DeviceContextPool
 {
-    ID2D1Device1* m_d2dDevice;
+    //
+    // Device contexts are returned to, and taken from, a slot belonging to
+    // the current thread first.  A thread that leases one context at a time
+    // only ever touches its own slot.  When that slot is empty (or full) we
+    // fall back to a lock-free stack that all threads share.  The mutex is
+    // only taken when a new context has to be created, and by Close.
+    //
+    // Threads are assigned slots round robin, so if there are more threads
+    // than slots some of them share.  Each slot is padded out to a cache line
+    // so that threads using neighboring slots don't contend.
+    //
+    // Slots and stack entries own a reference to their context.
+    //
+    struct Slot
+    {
+        std::atomic<ID2D1DeviceContext1*> DeviceContext;
+        uint8_t Padding[64 - sizeof(std::atomic<ID2D1DeviceContext1*>)];
+    };
+
+    struct DECLSPEC_ALIGN(MEMORY_ALLOCATION_ALIGNMENT) StackEntry
+    {
+        SLIST_ENTRY Entry;
+        ID2D1DeviceContext1* DeviceContext;
+    };
+
+    struct AlignedFree
+    {
+        void operator()(void* p) const { _aligned_free(p); }
+    };
+
+    // SLIST_HEADERs and SLIST_ENTRYs must be aligned to MEMORY_ALLOCATION_ALIGNMENT
+    template<typename T>
+    static std::unique_ptr<T, AlignedFree> MakeAligned(size_t count)
+    {
+        auto p = static_cast<T*>(_aligned_malloc(sizeof(T) * count, MEMORY_ALLOCATION_ALIGNMENT));
+        if (!p)
+            ThrowHR(E_OUTOFMEMORY);
+        return std::unique_ptr<T, AlignedFree>(p);
+    }
 
     std::mutex m_mutex;
-    std::vector<ComPtr<ID2D1DeviceContext1>> m_deviceContexts;
+    ID2D1Device1* m_d2dDevice;  // only accessed while holding m_mutex
+    std::atomic<bool> m_isClosed;
+
+    // The total number of contexts held by the slots and the stack
+    uint32_t const m_maxPoolSize;
+    std::atomic<uint32_t> m_pooledCount;
+
+    std::unique_ptr<Slot[]> m_slots;
+
+    // Each entry is either on m_stack, holding a context, or on m_freeEntries.
+    // There are m_maxPoolSize of them, so we never run out.
+    std::unique_ptr<StackEntry, AlignedFree> m_entries;
+    std::unique_ptr<SLIST_HEADER, AlignedFree> m_stack;
+    std::unique_ptr<SLIST_HEADER, AlignedFree> m_freeEntries;
     
 public:
     DeviceContextPool(ID2D1Device1* d2dDevice);
+    ~DeviceContextPool();
 
     DeviceContextPool(DeviceContextPool const&) = delete;
     DeviceContextPool& operator=(DeviceContextPool const&) = delete;
@@ -31,6 +83,12 @@ public:
 private:
     void ReturnLease(ComPtr<ID2D1DeviceContext1>&& deviceContext);
 
+    Slot& GetCurrentThreadSlot();
+    ID2D1DeviceContext1* TakeFromStack();
+    ID2D1DeviceContext1* TakeFromAnySlot();
+    bool TryPushToStack(ID2D1DeviceContext1* deviceContext);
+    void ReleasePooledDeviceContexts();
+
     friend class DeviceContextLease;
 };
 
@@ -0,0 +1,160 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "SkylinePacker.h"
+
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height)
+    : m_width(width)
+    , m_height(height)
+    , m_usedArea(0)
+{
+    Reset();
+}
+
+
+void SkylinePacker::Reset()
+{
+    m_skyline.clear();
+    m_skyline.push_back(Segment{ 0, 0, m_width });
+    m_usedArea = 0;
+}
+
+
+float SkylinePacker::GetOccupancy() const
+{
+    auto totalArea = static_cast<uint64_t>(m_width) * m_height;
+    if (totalArea == 0)
+        return 0;
+
+    return static_cast<float>(static_cast<double>(m_usedArea) / totalArea);
+}
+
+
+bool SkylinePacker::TryInsert(uint32_t width, uint32_t height, D2D1_POINT_2U* position)
+{
+    if (width == 0 || height == 0 || width > m_width || height > m_height)
+        return false;
+
+    //
+    // Find the position where the top of the rectangle is lowest.  Ties are
+    // broken by picking the narrowest segment, which leaves wider gaps free
+    // for later rectangles.
+    //
+
+    size_t bestIndex = m_skyline.size();
+    uint32_t bestTop = std::numeric_limits<uint32_t>::max();
+    uint32_t bestSegmentWidth = std::numeric_limits<uint32_t>::max();
+    uint32_t bestY = 0;
+
+    for (size_t i = 0; i < m_skyline.size(); ++i)
+    {
+        uint32_t y;
+        if (!TryFit(i, width, height, &y))
+            continue;
+
+        auto top = y + height;
+        auto segmentWidth = m_skyline[i].Width;
+
+        if (top < bestTop || (top == bestTop && segmentWidth < bestSegmentWidth))
+        {
+            bestIndex = i;
+            bestTop = top;
+            bestSegmentWidth = segmentWidth;
+            bestY = y;
+        }
+    }
+
+    if (bestIndex == m_skyline.size())
+        return false;
+
+    *position = D2D1_POINT_2U{ m_skyline[bestIndex].X, bestY };
+
+    AddSegment(bestIndex, *position, width, height);
+
+    m_usedArea += static_cast<uint64_t>(width) * height;
+
+    return true;
+}
+
+
+// Works out how high a rectangle placed at the left edge of the given segment
+// would have to sit, given all the segments it spans.
+bool SkylinePacker::TryFit(size_t segmentIndex, uint32_t width, uint32_t height, uint32_t* y) const
+{
+    auto x = m_skyline[segmentIndex].X;
+    if (x + width > m_width)
+        return false;
+
+    uint32_t maxY = 0;
+    uint32_t remainingWidth = width;
+
+    for (auto i = segmentIndex; remainingWidth > 0; ++i)
+    {
+        assert(i < m_skyline.size());
+
+        auto const& segment = m_skyline[i];
+
+        maxY = std::max(maxY, segment.Y);
+        if (maxY + height > m_height)
+            return false;
+
+        remainingWidth -= std::min(remainingWidth, segment.Width);
+    }
+
+    *y = maxY;
+    return true;
+}
+
+
+void SkylinePacker::AddSegment(size_t segmentIndex, D2D1_POINT_2U const& position, uint32_t width, uint32_t height)
+{
+    m_skyline.insert(m_skyline.begin() + segmentIndex, Segment{ position.x, position.y + height, width });
+
+    //
+    // Shrink or remove the segments that are now underneath the new one.
+    //
+
+    auto right = position.x + width;
+
+    for (auto i = segmentIndex + 1; i < m_skyline.size(); )
+    {
+        auto& segment = m_skyline[i];
+
+        if (segment.X >= right)
+            break;
+
+        auto segmentRight = segment.X + segment.Width;
+
+        if (segmentRight <= right)
+        {
+            m_skyline.erase(m_skyline.begin() + i);
+        }
+        else
+        {
+            segment.Width = segmentRight - right;
+            segment.X = right;
+            break;
+        }
+    }
+
+    //
+    // Merge neighboring segments that are at the same height.
+    //
+
+    for (size_t i = 0; i + 1 < m_skyline.size(); )
+    {
+        if (m_skyline[i].Y == m_skyline[i + 1].Y)
+        {
+            m_skyline[i].Width += m_skyline[i + 1].Width;
+            m_skyline.erase(m_skyline.begin() + i + 1);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
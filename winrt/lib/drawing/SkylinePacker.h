@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Packs rectangles into a fixed size area using the skyline bottom-left
+    // heuristic.  The top edge of the packed rectangles is tracked as a list
+    // of horizontal segments (the "skyline"), and each new rectangle is placed
+    // where its top edge ends up lowest.
+    //
+    // Individual rectangles can't be freed; reclaiming space requires a Reset
+    // and repacking everything that should be kept.
+    //
+    class SkylinePacker
+    {
+        struct Segment
+        {
+            uint32_t X;
+            uint32_t Y;
+            uint32_t Width;
+        };
+
+        uint32_t m_width;
+        uint32_t m_height;
+        uint64_t m_usedArea;
+        std::vector<Segment> m_skyline;
+
+    public:
+        SkylinePacker(uint32_t width, uint32_t height);
+
+        bool TryInsert(uint32_t width, uint32_t height, D2D1_POINT_2U* position);
+
+        void Reset();
+
+        uint32_t GetWidth() const { return m_width; }
+        uint32_t GetHeight() const { return m_height; }
+        uint64_t GetUsedArea() const { return m_usedArea; }
+
+        // The fraction of the area covered by packed rectangles.
+        float GetOccupancy() const;
+
+    private:
+        bool TryFit(size_t segmentIndex, uint32_t width, uint32_t height, uint32_t* y) const;
+        void AddSegment(size_t segmentIndex, D2D1_POINT_2U const& position, uint32_t width, uint32_t height);
+    };
+}}}}
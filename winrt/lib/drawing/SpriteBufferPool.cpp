@@ -0,0 +1,178 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "SpriteBufferPool.h"
+
+using namespace ABI::Microsoft::Graphics::Canvas;
+
+
+SpriteBufferPool::SpriteBufferPool()
+    : m_returnCount(0)
+    , m_returnsInWindow(0)
+    , m_currentWindowPeak(0)
+    , m_previousWindowPeak(0)
+    , m_leaseCount(0)
+    , m_reuseCount(0)
+{
+    m_freeBuffers.reserve(MaxFreeBuffers);
+}
+
+
+SpriteBuffer SpriteBufferPool::Lease()
+{
+    PooledSpriteSortScratch sortScratch;
+    return Lease(&sortScratch);
+}
+
+
+SpriteBuffer SpriteBufferPool::Lease(PooledSpriteSortScratch* sortScratch)
+{
+    assert(sortScratch);
+
+    Lock lock(m_mutex);
+
+    ++m_leaseCount;
+
+    auto highWaterMark = GetHighWaterMark(lock);
+
+    SpriteBuffer buffer;
+
+    if (!m_freeBuffers.empty())
+    {
+        auto& freeBuffer = m_freeBuffers.back();
+
+        //
+        // A buffer left over from a burst of large batches would otherwise
+        // keep its memory for as long as the app keeps drawing, so once the
+        // high-water mark has come down it is freed rather than reused.
+        //
+
+        if (freeBuffer.Buffer.capacity() <= highWaterMark * OversizeFactor)
+        {
+            buffer = std::move(freeBuffer.Buffer);
+            *sortScratch = std::move(freeBuffer.SortScratch);
+            ++m_reuseCount;
+        }
+
+        m_freeBuffers.pop_back();
+    }
+
+    // reserve() doesn't do anything if the buffer is already big enough
+    buffer.reserve(highWaterMark);
+
+    return buffer;
+}
+
+
+void SpriteBufferPool::Return(SpriteBuffer&& buffer, size_t peakSpriteCount)
+{
+    Return(std::move(buffer), PooledSpriteSortScratch(), peakSpriteCount);
+}
+
+
+void SpriteBufferPool::Return(SpriteBuffer&& returnedBuffer, PooledSpriteSortScratch&& returnedSortScratch, size_t peakSpriteCount)
+{
+    // Take ownership of the buffer and scratch so that, whatever happens,
+    // the caller is left with nothing.
+    SpriteBuffer buffer(std::move(returnedBuffer));
+    PooledSpriteSortScratch sortScratch(std::move(returnedSortScratch));
+
+    auto size = std::max(buffer.size(), peakSpriteCount);
+
+    // Release the bitmaps before taking the lock
+    buffer.clear();
+
+    sortScratch.Entries.clear();
+    sortScratch.RadixBuffer.clear();
+    sortScratch.Bitmaps.clear();
+
+    Lock lock(m_mutex);
+
+    ++m_returnCount;
+
+    m_currentWindowPeak = std::max(m_currentWindowPeak, size);
+
+    if (++m_returnsInWindow == HighWaterMarkWindow)
+    {
+        m_previousWindowPeak = m_currentWindowPeak;
+        m_currentWindowPeak = 0;
+        m_returnsInWindow = 0;
+    }
+
+    TrimIdleBuffers(lock);
+
+    // Buffers that never allocated anything aren't worth keeping
+    if (buffer.capacity() == 0)
+        return;
+
+    if (m_freeBuffers.size() >= MaxFreeBuffers)
+        return;
+
+    m_freeBuffers.push_back(FreeBuffer{ std::move(buffer), std::move(sortScratch), m_returnCount });
+}
+
+
+void SpriteBufferPool::Trim()
+{
+    Lock lock(m_mutex);
+
+    m_freeBuffers.clear();
+}
+
+
+size_t SpriteBufferPool::GetHighWaterMark()
+{
+    Lock lock(m_mutex);
+    return GetHighWaterMark(lock);
+}
+
+
+size_t SpriteBufferPool::GetFreeBufferCount()
+{
+    Lock lock(m_mutex);
+    return m_freeBuffers.size();
+}
+
+
+uint64_t SpriteBufferPool::GetLeaseCount()
+{
+    Lock lock(m_mutex);
+    return m_leaseCount;
+}
+
+
+uint64_t SpriteBufferPool::GetReuseCount()
+{
+    Lock lock(m_mutex);
+    return m_reuseCount;
+}
+
+
+size_t SpriteBufferPool::GetHighWaterMark(Lock const& lock)
+{
+    MustOwnLock(lock);
+
+    return std::max(m_currentWindowPeak, m_previousWindowPeak);
+}
+
+
+void SpriteBufferPool::TrimIdleBuffers(Lock const& lock)
+{
+    MustOwnLock(lock);
+
+    // The least recently returned buffers are at the front
+    auto firstToKeep = std::find_if(m_freeBuffers.begin(), m_freeBuffers.end(),
+        [&] (FreeBuffer const& freeBuffer)
+        {
+            return m_returnCount - freeBuffer.ReturnedAt <= IdleReturnLimit;
+        });
+
+    m_freeBuffers.erase(m_freeBuffers.begin(), firstToKeep);
+}
+
+#endif
@@ -0,0 +1,202 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "utils/LockUtilities.h"
+#include "SpriteSorter.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // The sprites that CanvasSpriteBatch collects before handing them to D2D.
+    // Layer is only used for sorting; the D2D arrays are read with a stride.
+    //
+    struct SpriteBatchSprite
+    {
+        ComPtr<ID2D1Bitmap> Bitmap;
+        D2D1_RECT_F DestinationRect;
+        D2D1_RECT_U SourceRect;
+        D2D1_COLOR_F Color;
+        D2D1_MATRIX_3X2_F Transform;
+        int32_t Layer;
+
+        SpriteBatchSprite(
+            int32_t layer,
+            ComPtr<ID2D1Bitmap>&& bitmap,
+            D2D1_RECT_F const& destinationRect,
+            D2D1_RECT_U const& sourceRect,
+            Numerics::Vector4 const& tint,
+            Numerics::Matrix3x2 const& transform)
+            : Bitmap(std::move(bitmap))
+            , DestinationRect(destinationRect)
+            , SourceRect(sourceRect)
+            , Color(*ReinterpretAs<D2D1_COLOR_F const*>(&tint))
+            , Transform(*ReinterpretAs<D2D1_MATRIX_3X2_F const*>(&transform))
+            , Layer(layer)
+        {
+        }
+
+        SpriteBatchSprite(
+            int32_t layer,
+            ComPtr<ID2D1Bitmap>&& bitmap,
+            D2D1_RECT_F const& destinationRect,
+            D2D1_RECT_U const& sourceRect,
+            Numerics::Vector4 const& tint)
+            : SpriteBatchSprite(layer, std::move(bitmap), destinationRect, sourceRect, tint, Identity3x2())
+        {
+        }
+    };
+
+
+    //
+    // A std::allocator that counts how many times it has been asked for
+    // memory, so that tests can check that the sprite path doesn't allocate
+    // once it has warmed up.  The count is per type, and shared by all
+    // instances.
+    //
+    template<typename T>
+    class CountingAllocator
+    {
+        static std::atomic<uint64_t> s_allocationCount;
+
+    public:
+        typedef T value_type;
+
+        CountingAllocator() = default;
+
+        template<typename U>
+        CountingAllocator(CountingAllocator<U> const&)
+        {
+        }
+
+        T* allocate(size_t count)
+        {
+            ++s_allocationCount;
+            return std::allocator<T>().allocate(count);
+        }
+
+        void deallocate(T* p, size_t count)
+        {
+            std::allocator<T>().deallocate(p, count);
+        }
+
+        static uint64_t GetAllocationCount()
+        {
+            return s_allocationCount;
+        }
+    };
+
+    template<typename T>
+    std::atomic<uint64_t> CountingAllocator<T>::s_allocationCount;
+
+    template<typename T, typename U>
+    bool operator==(CountingAllocator<T> const&, CountingAllocator<U> const&)
+    {
+        return true;
+    }
+
+    template<typename T, typename U>
+    bool operator!=(CountingAllocator<T> const&, CountingAllocator<U> const&)
+    {
+        return false;
+    }
+
+
+    typedef std::vector<SpriteBatchSprite, CountingAllocator<SpriteBatchSprite>> SpriteBuffer;
+    typedef SpriteSortScratch<CountingAllocator> PooledSpriteSortScratch;
+
+
+    //
+    // Each CanvasDevice owns one of these.  Sprite batches lease a buffer when
+    // they are created and give it back when they're closed, so an app that
+    // creates a few batches every frame reuses the same memory rather than
+    // allocating and freeing it each time.
+    //
+    // New (or small) buffers are reserved up to the high-water mark - the
+    // largest number of sprites in any buffer returned over the last two
+    // windows of HighWaterMarkWindow returns.  This lets the pool shrink again
+    // after a burst of large batches.
+    //
+    // Time is measured in returns rather than frames, since the device has no
+    // idea what a frame is.  A buffer that sits unused in the pool for more
+    // than IdleReturnLimit returns is freed, as is a pooled buffer whose
+    // capacity is much larger than the current high-water mark.
+    //
+    // Each buffer carries the scratch space that SpriteSorter needs to sort
+    // it, so sorted batches don't allocate either.  The scratch is never
+    // larger than the buffer it came with, and is pooled and freed with it.
+    //
+    class SpriteBufferPool
+    {
+        struct FreeBuffer
+        {
+            SpriteBuffer Buffer;
+            PooledSpriteSortScratch SortScratch;
+            uint64_t ReturnedAt;
+        };
+
+        std::mutex m_mutex;
+
+        // Most recently returned at the back
+        std::vector<FreeBuffer> m_freeBuffers;
+
+        uint64_t m_returnCount;
+        uint32_t m_returnsInWindow;
+        size_t m_currentWindowPeak;
+        size_t m_previousWindowPeak;
+
+        uint64_t m_leaseCount;
+        uint64_t m_reuseCount;
+
+    public:
+        static uint32_t const MaxFreeBuffers = 16;
+        static uint32_t const HighWaterMarkWindow = 128;
+        static uint32_t const IdleReturnLimit = 256;
+        static uint32_t const OversizeFactor = 4;
+
+        SpriteBufferPool();
+
+        SpriteBufferPool(SpriteBufferPool const&) = delete;
+        SpriteBufferPool& operator=(SpriteBufferPool const&) = delete;
+
+        SpriteBuffer Lease();
+
+        // The buffer's sort scratch is moved into *sortScratch.
+        SpriteBuffer Lease(PooledSpriteSortScratch* sortScratch);
+
+        // peakSpriteCount is the most sprites the buffer has held, when that
+        // is more than it holds now (eg. because some were culled).  This is
+        // what the high-water mark tracks.
+        void Return(SpriteBuffer&& buffer, size_t peakSpriteCount = 0);
+        void Return(SpriteBuffer&& buffer, PooledSpriteSortScratch&& sortScratch, size_t peakSpriteCount = 0);
+
+        // Frees all of the buffers that aren't currently leased.  The
+        // high-water mark is kept, so later leases are still sized well.
+        void Trim();
+
+        size_t GetHighWaterMark();
+        size_t GetFreeBufferCount();
+        uint64_t GetLeaseCount();
+        uint64_t GetReuseCount();
+
+        // The number of times any sprite buffer or sort scratch, pooled or
+        // not, has allocated memory.
+        static uint64_t GetAllocationCount()
+        {
+            return
+                CountingAllocator<SpriteBatchSprite>::GetAllocationCount() +
+                CountingAllocator<uint64_t>::GetAllocationCount() +
+                CountingAllocator<ID2D1Bitmap*>::GetAllocationCount();
+        }
+
+    private:
+        size_t GetHighWaterMark(Lock const& lock);
+        void TrimIdleBuffers(Lock const& lock);
+    };
+}}}}
+
+#endif
@@ -0,0 +1,106 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Removes sprites that can't be seen because, after transforming them,
+    // they lie entirely outside of a visible rectangle.  The order of the
+    // remaining sprites is preserved.
+    //
+    // The four corners of each sprite are transformed together using
+    // DirectXMath, so this compiles down to SSE2 or NEON depending on the
+    // target.  A sprite is only culled if all four corners are beyond the
+    // same edge of the visible rectangle, which is conservative for rotated
+    // sprites near a corner but never culls anything that would be drawn.
+    //
+    // T is expected to have DestinationRect and Transform members that are a
+    // D2D1_RECT_F and a D2D1_MATRIX_3X2_F.
+    //
+    class SpriteCuller
+    {
+    public:
+        // transform maps from the space that sprites are in after their own
+        // transform has been applied to the space that visibleRect is in.
+        // Returns the number of sprites that were removed.
+        template<typename T, typename A>
+        static uint32_t Cull(
+            std::vector<T, A>& sprites,
+            D2D1_MATRIX_3X2_F const& transform,
+            D2D1_RECT_F const& visibleRect)
+        {
+            using namespace DirectX;
+
+            static_assert(sizeof(D2D1_RECT_F) == sizeof(XMFLOAT4), "D2D1_RECT_F should be four floats");
+
+            Matrix const target(transform);
+
+            auto const visibleLeft   = XMVectorReplicate(visibleRect.left);
+            auto const visibleTop    = XMVectorReplicate(visibleRect.top);
+            auto const visibleRight  = XMVectorReplicate(visibleRect.right);
+            auto const visibleBottom = XMVectorReplicate(visibleRect.bottom);
+
+            auto newEnd = std::remove_if(sprites.begin(), sprites.end(),
+                [&] (T const& sprite)
+                {
+                    // (left, top, right, bottom) => the x and y coordinates
+                    // of the top-left, top-right, bottom-left and
+                    // bottom-right corners.
+                    auto rect = XMLoadFloat4(reinterpret_cast<XMFLOAT4 const*>(&sprite.DestinationRect));
+                    auto x = XMVectorSwizzle<0, 2, 0, 2>(rect);
+                    auto y = XMVectorSwizzle<1, 1, 3, 3>(rect);
+
+                    Matrix(sprite.Transform).TransformPoints(&x, &y);
+                    target.TransformPoints(&x, &y);
+
+                    return
+                        XMVector4LessOrEqual(x, visibleLeft) ||
+                        XMVector4LessOrEqual(y, visibleTop) ||
+                        XMVector4GreaterOrEqual(x, visibleRight) ||
+                        XMVector4GreaterOrEqual(y, visibleBottom);
+                });
+
+            auto culledCount = static_cast<uint32_t>(std::distance(newEnd, sprites.end()));
+            sprites.erase(newEnd, sprites.end());
+
+            return culledCount;
+        }
+
+    private:
+        // A 3x2 matrix with each element replicated across a vector, so that
+        // four points can be transformed at once.
+        struct Matrix
+        {
+            DirectX::XMVECTOR M11, M12, M21, M22, DX, DY;
+
+            explicit Matrix(D2D1_MATRIX_3X2_F const& m)
+            {
+                using namespace DirectX;
+
+                auto linear = XMLoadFloat4(reinterpret_cast<XMFLOAT4 const*>(&m._11));
+                auto translation = XMLoadFloat2(reinterpret_cast<XMFLOAT2 const*>(&m._31));
+
+                M11 = XMVectorSplatX(linear);
+                M12 = XMVectorSplatY(linear);
+                M21 = XMVectorSplatZ(linear);
+                M22 = XMVectorSplatW(linear);
+                DX  = XMVectorSplatX(translation);
+                DY  = XMVectorSplatY(translation);
+            }
+
+            void TransformPoints(DirectX::XMVECTOR* x, DirectX::XMVECTOR* y) const
+            {
+                using namespace DirectX;
+
+                auto newX = XMVectorMultiplyAdd(*x, M11, XMVectorMultiplyAdd(*y, M21, DX));
+                auto newY = XMVectorMultiplyAdd(*x, M12, XMVectorMultiplyAdd(*y, M22, DY));
+
+                *x = newX;
+                *y = newY;
+            }
+        };
+    };
+}}}}
@@ -0,0 +1,277 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Sorts sprites so that sprites using the same bitmap are adjacent, with
+    // bitmaps ordered by pointer value.  The sort is stable: sprites that share
+    // a bitmap stay in the order they were added.
+    //
+    // SortByLayerAndBitmap additionally groups sprites by layer, lowest layer
+    // first, and then by bitmap within each layer.  This keeps painter's order
+    // between layers while still batching as much as possible within them.
+    //
+    // Sprites are large and hold a reference to their bitmap, so rather than
+    // moving them around during the sort each distinct bitmap is given a small
+    // ordinal and an array of (ordinal, index) keys is LSD radix sorted.  The
+    // layer sort is another stable radix sort over the same keys.  The
+    // sprites are then permuted in place, so that the vector keeps its
+    // storage (which may have come from a SpriteBufferPool).
+    //
+    // T is expected to have a member called Bitmap that is a ComPtr, and, for
+    // SortByLayerAndBitmap, an int32_t member called Layer.
+    //
+    // The sort's working memory lives in a SpriteSortScratch.  Passing the
+    // same one to every sort lets its vectors keep their capacity, so once it
+    // has warmed up sorting doesn't allocate.
+    //
+    template<template<typename> class Allocator = std::allocator>
+    struct SpriteSortScratch
+    {
+        std::vector<uint64_t, Allocator<uint64_t>> Entries;
+        std::vector<uint64_t, Allocator<uint64_t>> RadixBuffer;
+        std::vector<ID2D1Bitmap*, Allocator<ID2D1Bitmap*>> Bitmaps;
+    };
+
+    class SpriteSorter
+    {
+        typedef uint64_t Entry;
+
+        static uint32_t const RadixBits = 8;
+        static uint32_t const RadixSize = 1 << RadixBits;
+        static uint32_t const KeyShift = 32;
+
+    public:
+        template<typename T, typename A>
+        static void SortByBitmap(std::vector<T, A>& sprites)
+        {
+            SpriteSortScratch<> scratch;
+            SortByBitmap(sprites, scratch);
+        }
+
+        template<typename T, typename A>
+        static void SortByLayerAndBitmap(std::vector<T, A>& sprites)
+        {
+            SpriteSortScratch<> scratch;
+            SortByLayerAndBitmap(sprites, scratch);
+        }
+
+        template<typename T, typename A, typename S>
+        static void SortByBitmap(std::vector<T, A>& sprites, S& scratch)
+        {
+            if (sprites.size() < 2)
+                return;
+
+            auto bitmapCount = MakeBitmapEntries(sprites, scratch);
+
+            if (bitmapCount == 1)
+                return;
+
+            RadixSort(scratch.Entries, scratch.RadixBuffer, bitmapCount - 1);
+
+            Permute(sprites, scratch.Entries);
+        }
+
+        template<typename T, typename A, typename S>
+        static void SortByLayerAndBitmap(std::vector<T, A>& sprites, S& scratch)
+        {
+            if (sprites.size() < 2)
+                return;
+
+            auto layers = std::minmax_element(sprites.begin(), sprites.end(),
+                [] (T const& a, T const& b)
+                {
+                    return a.Layer < b.Layer;
+                });
+
+            auto minLayer = layers.first->Layer;
+            auto maxLayer = layers.second->Layer;
+
+            if (minLayer == maxLayer)
+            {
+                SortByBitmap(sprites, scratch);
+                return;
+            }
+
+            //
+            // Sort by bitmap first, and then by layer.  Because each pass is
+            // stable the second leaves sprites in the same layer in bitmap
+            // order.
+            //
+
+            auto& entries = scratch.Entries;
+            auto bitmapCount = MakeBitmapEntries(sprites, scratch);
+
+            if (bitmapCount > 1)
+                RadixSort(entries, scratch.RadixBuffer, bitmapCount - 1);
+
+            for (auto& entry : entries)
+            {
+                auto index = GetIndex(entry);
+                entry = MakeEntry(GetLayerKey(sprites[index].Layer, minLayer), index);
+            }
+
+            RadixSort(entries, scratch.RadixBuffer, GetLayerKey(maxLayer, minLayer));
+
+            Permute(sprites, entries);
+        }
+
+    private:
+        //
+        // Fills in scratch.Entries with the original index of each sprite,
+        // keyed on an ordinal for its bitmap.  Ordinals are numbered in bitmap
+        // pointer order.  Returns the number of distinct bitmaps.
+        //
+        template<typename T, typename A, typename S>
+        static uint32_t MakeBitmapEntries(std::vector<T, A> const& sprites, S& scratch)
+        {
+            assert(sprites.size() < std::numeric_limits<uint32_t>::max());
+            auto const count = static_cast<uint32_t>(sprites.size());
+
+            //
+            // Sprites tend to come in runs that share a bitmap, so collect
+            // the bitmap of each run and then sort them, dropping duplicates.
+            // A bitmap's ordinal is then its position in this list.
+            //
+
+            auto& bitmaps = scratch.Bitmaps;
+            bitmaps.clear();
+
+            ID2D1Bitmap* previousBitmap = nullptr;
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                auto bitmap = sprites[i].Bitmap.Get();
+
+                if (i == 0 || bitmap != previousBitmap)
+                {
+                    bitmaps.push_back(bitmap);
+                    previousBitmap = bitmap;
+                }
+            }
+
+            std::sort(bitmaps.begin(), bitmaps.end());
+            bitmaps.erase(std::unique(bitmaps.begin(), bitmaps.end()), bitmaps.end());
+
+            //
+            // Look up the ordinal for each run.
+            //
+
+            auto& entries = scratch.Entries;
+            entries.resize(count);
+
+            uint32_t previousOrdinal = 0;
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                auto bitmap = sprites[i].Bitmap.Get();
+
+                if (i == 0 || bitmap != previousBitmap)
+                {
+                    auto position = std::lower_bound(bitmaps.begin(), bitmaps.end(), bitmap);
+                    previousOrdinal = static_cast<uint32_t>(position - bitmaps.begin());
+                    previousBitmap = bitmap;
+                }
+
+                entries[i] = MakeEntry(previousOrdinal, i);
+            }
+
+            return static_cast<uint32_t>(bitmaps.size());
+        }
+
+        //
+        // Moves the sprites into their sorted positions.  entries[i] says
+        // which sprite belongs at position i; following these round each
+        // cycle of the permutation needs only one temporary.  Positions that
+        // have been filled are marked by pointing them at themselves.
+        //
+        template<typename T, typename A, typename E>
+        static void Permute(std::vector<T, A>& sprites, E& entries)
+        {
+            auto const count = static_cast<uint32_t>(entries.size());
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (GetIndex(entries[i]) == i)
+                    continue;
+
+                T temporary(std::move(sprites[i]));
+                uint32_t destination = i;
+
+                for (;;)
+                {
+                    auto source = GetIndex(entries[destination]);
+                    entries[destination] = MakeEntry(0, destination);
+
+                    if (source == i)
+                    {
+                        sprites[destination] = std::move(temporary);
+                        break;
+                    }
+
+                    sprites[destination] = std::move(sprites[source]);
+                    destination = source;
+                }
+            }
+        }
+
+        // Maps layers onto unsigned keys that sort in the same order.
+        static uint32_t GetLayerKey(int32_t layer, int32_t minLayer)
+        {
+            return static_cast<uint32_t>(layer) - static_cast<uint32_t>(minLayer);
+        }
+
+        static Entry MakeEntry(uint32_t key, uint32_t index)
+        {
+            return (static_cast<Entry>(key) << KeyShift) | index;
+        }
+
+        static uint32_t GetKey(Entry entry)
+        {
+            return static_cast<uint32_t>(entry >> KeyShift);
+        }
+
+        static uint32_t GetIndex(Entry entry)
+        {
+            return static_cast<uint32_t>(entry);
+        }
+
+        // Leaves the sorted entries in entries, using buffer as the other
+        // half of each pass.
+        template<typename E>
+        static void RadixSort(E& entries, E& buffer, uint32_t maxKey)
+        {
+            buffer.resize(entries.size());
+
+            for (uint32_t shift = 0; shift < 32 && (maxKey >> shift) != 0; shift += RadixBits)
+            {
+                uint32_t offsets[RadixSize] = {};
+
+                for (auto entry : entries)
+                    ++offsets[Digit(entry, shift)];
+
+                uint32_t total = 0;
+                for (auto& offset : offsets)
+                {
+                    auto digitCount = offset;
+                    offset = total;
+                    total += digitCount;
+                }
+
+                for (auto entry : entries)
+                    buffer[offsets[Digit(entry, shift)]++] = entry;
+
+                entries.swap(buffer);
+            }
+        }
+
+        static uint32_t Digit(Entry entry, uint32_t shift)
+        {
+            return (GetKey(entry) >> shift) & (RadixSize - 1);
+        }
+    };
+}}}}
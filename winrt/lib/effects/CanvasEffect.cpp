@@ -17,6 +17,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         , m_sources(sourcesSize)
         , m_cacheOutput(false)
         , m_bufferPrecision(D2D1_BUFFER_PRECISION_UNKNOWN)
+        , m_isResourceExposed(effect != nullptr)
+        , m_generation(0)
+        , m_validatedGeneration(0)
+        , m_validatedImageCloseCount(0)
+        , m_isValidated(false)
+        , m_validatedFlags(GetImageFlags::None)
+        , m_validatedDpi(0)
+        , m_foldColorTransforms(false)
+        , m_isFolded(false)
+        , m_foldedMatrix()
     {
         // If this effect has a variable number of inputs, expose them as an IVector<>.
         if (!isSourcesSizeFixed)
@@ -41,6 +51,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     CanvasEffect::~CanvasEffect()
     {
+        RecycleResource();
+
         // The sources vector could outlive us if a customer is holding onto a separate reference
         // to it. But with us gone, its parent link would be a stale pointer, so we null that out.
         if (m_sourcesVector)
@@ -48,7 +60,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
-    bool CanvasEffect::TryCreateEffect(ICanvasDevice* device, IUnknown* resource, float dpi, ComPtr<IInspectable>* result)
+    ResourceManager::TryCreateResult CanvasEffect::TryCreateEffect(ICanvasDevice* device, IUnknown* resource, float dpi, ComPtr<IInspectable>* result)
     {
         UNREFERENCED_PARAMETER(dpi);
 
@@ -56,7 +68,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         auto d2dEffect = MaybeAs<ID2D1Effect>(resource);
 
         if (!d2dEffect)
-            return false;
+            return ResourceManager::TryCreateResult::WrongType;
 
         if (!device)
             ThrowHR(E_INVALIDARG, Strings::ResourceManagerNoDevice);
@@ -70,7 +82,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             {
                 // Found it! Create the Win2D wrapper class.
                 effectMaker->second(device, d2dEffect.Get(), result);
-                return true;
+                return ResourceManager::TryCreateResult::Created;
             }
         }
 
@@ -78,11 +90,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         if (IsEqualGUID(effectId, CLSID_PixelShaderEffect))
         {
             MakeEffect<PixelShaderEffect>(device, d2dEffect.Get(), result);
-            return true;
+            return ResourceManager::TryCreateResult::Created;
         }
 
         // Unrecognized effect CLSID.
-        return false;
+        return ResourceManager::TryCreateResult::NotCreated;
     }
 
 
@@ -134,6 +146,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 // Command lists are DPI independent, so we always
                 // need to insert DPI compensation when drawing to them.
                 flags |= GetImageFlags::AlwaysInsertDpiCompensation;
+
+                // They also record effects by reference, so whatever we draw into
+                // one must stay as it is for as long as the command list exists.
+                flags |= GetImageFlags::RetainRealization;
             }
             else
             {
@@ -150,6 +166,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             flags |= GetImageFlags::NeverInsertDpiCompensation;
         }
 
+        // Color transform folding applies to our whole source graph, so is passed down along with the other flags.
+        if (m_foldColorTransforms)
+        {
+            flags |= GetImageFlags::FoldColorTransforms;
+        }
+
         // Check if device is the same as previous device.
         ComPtr<ID2D1Device> d2dDevice = As<ICanvasDeviceInternal>(device)->GetD2DDevice();
 
@@ -160,6 +182,44 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             m_realizationDevice.Set(d2dDevice.Get(), device);
         }
 
+        if (realizedDpi)
+            *realizedDpi = 0;
+
+        bool isMinimalRealization = (flags & GetImageFlags::MinimalRealization) != GetImageFlags::None;
+
+        // Once our D2D effect is visible outside Win2D, anything it draws from is too. This
+        // includes sources added later, so the flag is passed down by every walk of the graph.
+        if (HasResource() && m_isResourceExposed)
+        {
+            flags |= GetImageFlags::RetainRealization;
+        }
+
+        bool retainRealization = (flags & GetImageFlags::RetainRealization) != GetImageFlags::None;
+
+        // Retaining the realization does not change what it looks like, so is not part of what we validate for.
+        auto validationFlags = flags & ~GetImageFlags::RetainRealization;
+
+        // If neither this effect nor anything below it has changed since we last validated
+        // for the same target, the D2D effect graph is already correct and we can skip the walk.
+        // The exception is the first time it is retained, when the walk must mark our sources too.
+        if (!isMinimalRealization && HasResource() && IsValidatedFor(validationFlags, targetDpi) &&
+            (!retainRealization || m_isResourceExposed))
+        {
+            return GetOutputImage();
+        }
+
+        bool wasValidated = m_isValidated;
+
+        if (!isMinimalRealization)
+        {
+            // Snapshot the generation before walking the graph, so changes that arrive
+            // while the walk is in progress will leave us marked as needing another pass.
+            // The same goes for images that are closed during the walk.
+            m_isValidated = false;
+            m_validatedGeneration = m_generation.load();
+            m_validatedImageCloseCount = GetCanvasImageCloseCount();
+        }
+
         if (!HasResource())
         {
             // Create resource if not created yet.
@@ -167,17 +227,53 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             {
                 return nullptr;
             }
+
+            if (retainRealization)
+            {
+                m_isResourceExposed = true;
+            }
         }
-        else if ((flags & GetImageFlags::MinimalRealization) == GetImageFlags::None)
+        else
         {
-            // Recurse through the effect graph to make sure child nodes are properly realized.
-            RefreshInputs(flags, targetDpi, deviceContext);
+            // Property sets write through while we are realized, so this normally finds nothing to do.
+            SetDirtyD2DProperties(GetResource().Get());
+
+            if (!isMinimalRealization)
+            {
+                // Recurse through the effect graph to make sure child nodes are properly realized.
+                RefreshInputs(flags, targetDpi, deviceContext);
+            }
+
+            if (retainRealization)
+            {
+                m_isResourceExposed = true;
+            }
         }
 
-        if (realizedDpi)
-            *realizedDpi = 0;
+        if (!isMinimalRealization)
+        {
+            if ((flags & GetImageFlags::FoldColorTransforms) != GetImageFlags::None)
+            {
+                UpdateFoldedColorTransform(lock, deviceContext);
+            }
+            else
+            {
+                ResetFoldedColorTransform();
+            }
 
-        return As<ID2D1Image>(GetResource());
+            // Validating for a different target (eg. a new DPI) may have changed our D2D
+            // inputs, which parents that last validated against the old target don't know about.
+            if (wasValidated && (validationFlags != m_validatedFlags || targetDpi != m_validatedDpi))
+            {
+                MarkParentsChanged();
+            }
+
+            m_isValidated = true;
+            m_validatedFlags = validationFlags;
+            m_validatedDpi = targetDpi;
+        }
+
+        return GetOutputImage();
     }
 
 
@@ -196,7 +292,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 if (!device)
                     ThrowHR(E_INVALIDARG, Strings::GetResourceNoDevice);
 
-                GetImageFlags flags = GetImageFlags::AllowNullEffectInputs;
+                // The caller can reach every effect in our graph from the one we return.
+                GetImageFlags flags = GetImageFlags::AllowNullEffectInputs | GetImageFlags::RetainRealization;
 
                 // If the caller did not specify target DPI, we always need to insert DPI compensation
                 // (same as when using effects with DPI independent contexts such as command lists).
@@ -205,9 +302,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                     flags |= GetImageFlags::AlwaysInsertDpiCompensation;
                 }
 
-                auto realizedEffect = GetD2DImage(device, nullptr, flags, dpi);
-                
-                ThrowIfFailed(realizedEffect.CopyTo(iid, resource));
+                GetD2DImage(device, nullptr, flags, dpi);
+
+                // The caller may modify the D2D effect directly, which we have no way to observe.
+                MarkChanged();
+
+                // Return our own D2D effect, even if GetD2DImage substituted a folded color transform.
+                ThrowIfFailed(GetResource().CopyTo(iid, resource));
             });
     }
 
@@ -218,8 +319,14 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     IFACEMETHODIMP CanvasEffect::Close()
     {
+        RecycleResource();
         ReleaseResource();
 
+        m_isValidated = false;
+        MarkChanged();
+
+        ResetFoldedColorTransform();
+
         m_realizationDevice.Reset();
         m_workaround6146411.Reset();
         m_sources.assign(m_sources.size(), SourceReference());
@@ -301,7 +408,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             [&]
             {
                 CheckInPointer(count);
-                *count = static_cast<UINT>(m_properties.size());
+                *count = m_properties.GetCount();
             });
     }
 
@@ -313,10 +420,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             {
                 CheckAndClearOutPointer(value);
         
-                if (index >= m_properties.size())
+                if (index >= m_properties.GetCount())
                     ThrowHR(E_BOUNDS);
 
-                ThrowIfFailed(GetProperty(index).CopyTo(value));
+                auto lock = Lock(m_mutex);
+
+                RefreshProperty(lock, index);
+
+                // Values are only boxed on demand, as this is the one place that needs them as IPropertyValue.
+                ThrowIfFailed(m_properties.Box(m_propertyValueFactory.Get(), index).CopyTo(value));
             });
     }
 
@@ -395,6 +507,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             {
                 auto lock = Lock(m_mutex);
 
+                bool changed = !!m_cacheOutput != !!value;
+
                 m_cacheOutput = value;
 
                 // If we are realized, set the new value through to the underlying D2D resource.
@@ -402,6 +516,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 {
                     ThrowIfFailed(d2dEffect->SetValue(D2D1_PROPERTY_CACHED, static_cast<BOOL>(m_cacheOutput)));
                 }
+
+                // Cached effects can't be folded, so a folded graph must be rebuilt.
+                if (changed)
+                    MarkChanged();
             });
     }
 
@@ -441,6 +559,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             {
                 auto lock = Lock(m_mutex);
 
+                auto previousBufferPrecision = m_bufferPrecision;
+
                 if (value)
                 {
                     // Convert non-null values from Win2D to D2D format.
@@ -460,6 +580,41 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 {
                     ThrowIfFailed(d2dEffect->SetValue(D2D1_PROPERTY_PRECISION, m_bufferPrecision));
                 }
+
+                // Effects with an explicit precision can't be folded, so a folded graph must be rebuilt.
+                if (m_bufferPrecision != previousBufferPrecision)
+                    MarkChanged();
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasEffect::get_FoldColorTransforms(boolean* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                auto lock = Lock(m_mutex);
+
+                *value = m_foldColorTransforms;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasEffect::put_FoldColorTransforms(boolean value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                auto lock = Lock(m_mutex);
+
+                if (m_foldColorTransforms != !!value)
+                {
+                    m_foldColorTransforms = !!value;
+
+                    MarkChanged();
+                }
             });
     }
 
@@ -742,6 +897,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
             m_sources[index] = source;
         }
+
+        MarkChanged();
     }
 
 
@@ -782,6 +939,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
             m_sources.insert(m_sources.begin() + index, source);
         }
+
+        MarkChanged();
     }
 
 
@@ -829,6 +988,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         // Common to both realized and unrealized paths.
         m_sources.erase(m_sources.begin() + index);
+
+        MarkChanged();
     }
 
 
@@ -852,6 +1013,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             // If not realized, use our local sources vector.
             m_sources.push_back(source);
         }
+
+        MarkChanged();
     }
 
 
@@ -864,6 +1027,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         Unrealize(0, true);
 
         m_sources.clear();
+
+        MarkChanged();
     }
 
 
@@ -1001,6 +1166,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
                 bool dpiChanged = ApplyDpiCompensation(i, realizedSource, realizedDpi, flags, targetDpi, deviceContext);
 
+                TrackSource(source.Get());
+
                 // If the source value has changed, update the D2D effect graph.
                 if (resourceChanged || dpiChanged)
                 {
@@ -1016,6 +1183,28 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         ComPtr<ID2D1Image> realizedSource;
         float realizedDpi = 0;
 
+        if (!RealizeSource(index, source, flags, targetDpi, deviceContext, &realizedSource, &realizedDpi))
+            return false;
+
+        // Update our local state vector.
+        if (m_sources.size() <= index)
+            m_sources.resize(index + 1);
+
+        m_sources[index].Set(realizedSource.Get(), source);
+
+        // Update the underlying D2D effect state.
+        ApplyDpiCompensation(index, realizedSource, realizedDpi, flags, targetDpi, deviceContext);
+
+        SetEffectInput(d2dEffect, index, realizedSource.Get());
+
+        return true;
+    }
+
+
+    // Gets the D2D image for one of our sources, realizing it if need be. Returns false (after
+    // unrealizing this effect) if the source cannot currently be used as a D2D effect input.
+    bool CanvasEffect::RealizeSource(unsigned int index, IGraphicsEffectSource* source, GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext, ComPtr<ID2D1Image>* realizedSource, float* realizedDpi)
+    {
         if (source)
         {
             // Make sure the specified source is an ICanvasImage.
@@ -1057,14 +1246,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             }
 
             // Get the underlying D2D interface. This call recurses through the effect graph.
-            realizedSource = internalSource->GetD2DImage(RealizationDevice(), deviceContext, flags, targetDpi, &realizedDpi);
+            *realizedSource = internalSource->GetD2DImage(RealizationDevice(), deviceContext, flags, targetDpi, realizedDpi);
 
-            if (!realizedSource)
+            if (!*realizedSource)
             {
                 Unrealize(index);
                 m_sources[index] = source;
                 return false;
             }
+
+            TrackSource(source);
         }
         else
         {
@@ -1073,17 +1264,6 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 ThrowFormattedMessage(E_INVALIDARG, Strings::EffectNullSource, index);
         }
 
-        // Update our local state vector.
-        if (m_sources.size() <= index)
-            m_sources.resize(index + 1);
-
-        m_sources[index].Set(realizedSource.Get(), source);
-
-        // Update the underlying D2D effect state.
-        ApplyDpiCompensation(index, realizedSource, realizedDpi, flags, targetDpi, deviceContext);
-
-        SetEffectInput(d2dEffect, index, realizedSource.Get());
-
         return true;
     }
 
@@ -1116,78 +1296,119 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
-    void CanvasEffect::SetProperty(unsigned int index, IPropertyValue* propertyValue)
+    // Called with m_mutex held, before reading a value from m_properties.
+    void CanvasEffect::RefreshProperty(Lock const& lock, unsigned int index)
     {
-        auto lock = Lock(m_mutex);
+        MustOwnLock(lock);
 
-        assert(index < m_properties.size());
+        assert(index < m_properties.GetCount());
 
+        // If we are realized, the D2D effect holds the latest value unless it has
+        // been changed locally since it was last pushed.
         auto& d2dEffect = MaybeGetResource();
 
-        if (d2dEffect)
+        if (d2dEffect && !m_properties.IsDirty(index))
         {
-            // If we are realized, set the property value through to the underlying D2D resource.
-            SetD2DProperty(d2dEffect.Get(), index, propertyValue);
+            GetD2DProperty(d2dEffect.Get(), index);
         }
-        else
+    }
+
+
+    // Called with m_mutex held, after storing a new value in m_properties.
+    void CanvasEffect::WriteThroughProperty(Lock const& lock, unsigned int index)
+    {
+        MustOwnLock(lock);
+
+        // If we are realized, set the value through to the D2D effect right away. Apps
+        // may be drawing it directly (see GetNativeResource), and this way any D2D
+        // error is reported by the set call. Only unrealized effects hold dirty values.
+        auto& d2dEffect = MaybeGetResource();
+
+        if (!d2dEffect)
+            return;
+
+        try
         {
-            // If we are not realized, directly store the property value.
-            m_properties[index] = propertyValue;
+            SetD2DProperty(d2dEffect.Get(), index);
         }
+        catch (...)
+        {
+            // D2D rejected the value, so go back to the one it still has.
+            GetD2DProperty(d2dEffect.Get(), index);
+            throw;
+        }
+
+        m_properties.ClearDirty(index);
     }
 
 
-    void CanvasEffect::SetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index, IPropertyValue* propertyValue)
+    void CanvasEffect::SetDirtyD2DProperties(ID2D1Effect* d2dEffect)
     {
-        PropertyType propertyType;
-        ThrowIfFailed(propertyValue->get_Type(&propertyType));
+        if (!m_properties.HasDirtyValues())
+            return;
 
-        switch (propertyType)
+        for (unsigned i = 0; i < m_properties.GetCount(); ++i)
         {
-        case PropertyType_Boolean:
+            if (m_properties.IsDirty(i))
+            {
+                SetD2DProperty(d2dEffect, i);
+                m_properties.ClearDirty(i);
+            }
+        }
+    }
+
+
+    void CanvasEffect::SetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index)
+    {
+        switch (m_properties.GetType(index))
+        {
+        case EffectPropertyStorage::ValueType::None:
+            // Never set, so leave the D2D default value in place.
+            break;
+
+        case EffectPropertyStorage::ValueType::Boolean:
             {
                 boolean value;
-                ThrowIfFailed(propertyValue->GetBoolean(&value));
+                m_properties.GetValue(index, &value);
                 ThrowIfFailed(d2dEffect->SetValue(index, static_cast<BOOL>(value)));
             }
             break;
 
-        case PropertyType_Int32:
+        case EffectPropertyStorage::ValueType::Int32:
             {
                 INT32 value;
-                ThrowIfFailed(propertyValue->GetInt32(&value));
+                m_properties.GetValue(index, &value);
                 ThrowIfFailed(d2dEffect->SetValue(index, value));
             }
             break;
 
-        case PropertyType_UInt32:
+        case EffectPropertyStorage::ValueType::UInt32:
             {
                 UINT32 value;
-                ThrowIfFailed(propertyValue->GetUInt32(&value));
+                m_properties.GetValue(index, &value);
                 ThrowIfFailed(d2dEffect->SetValue(index, value));
             }
             break;
 
-        case PropertyType_Single:
+        case EffectPropertyStorage::ValueType::Float:
             {
                 float value;
-                ThrowIfFailed(propertyValue->GetSingle(&value));
+                m_properties.GetValue(index, &value);
                 ThrowIfFailed(d2dEffect->SetValue(index, value));
             }
             break;
 
-        case PropertyType_SingleArray:
+        case EffectPropertyStorage::ValueType::FloatArray:
             {
-                ComArray<float> value;
-                ThrowIfFailed(propertyValue->GetSingleArray(value.GetAddressOfSize(), value.GetAddressOfData()));
-                ThrowIfFailed(d2dEffect->SetValue(index, reinterpret_cast<BYTE*>(value.GetData()), value.GetSize() * sizeof(float)));
+                uint32_t count;
+                auto value = m_properties.GetValues(index, &count);
+                ThrowIfFailed(d2dEffect->SetValue(index, reinterpret_cast<BYTE const*>(value), count * sizeof(float)));
             }
             break;
 
-        case PropertyType_InspectableArray:
+        case EffectPropertyStorage::ValueType::Inspectable:
             {
-                ComPtr<IInspectable> wrapper;
-                GetValueOfProperty(propertyValue, wrapper.GetAddressOf());
+                auto wrapper = m_properties.GetInspectable(index);
 
                 auto d2dResource = wrapper ? GetWrappedResource<IUnknown>(wrapper, m_realizationDevice.GetWrapper()) : nullptr;
 
@@ -1208,80 +1429,83 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
-    ComPtr<IPropertyValue> CanvasEffect::GetProperty(unsigned int index)
+    // Reads a property value from the D2D effect into m_properties.
+    void CanvasEffect::GetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index)
     {
-        auto lock = Lock(m_mutex);
-
-        assert(index < m_properties.size());
-
-        auto& d2dEffect = MaybeGetResource();
+        auto valueType = m_properties.GetType(index);
 
-        if (d2dEffect)
+        // If we don't yet know how this property is stored, choose based on the D2D type.
+        if (valueType == EffectPropertyStorage::ValueType::None)
         {
-            // If we are realized, read the property value from the underlying D2D resource.
-            return GetD2DProperty(d2dEffect.Get(), index);
-        }
-        else
-        {
-            // If we are not realized, directly return the property value.
-            return m_properties[index];
+            switch (d2dEffect->GetType(index))
+            {
+            case D2D1_PROPERTY_TYPE_BOOL:
+                valueType = EffectPropertyStorage::ValueType::Boolean;
+                break;
+
+            case D2D1_PROPERTY_TYPE_INT32:
+            case D2D1_PROPERTY_TYPE_UINT32:     // Not a mistake: unsigned DImage properties are exposed in WinRT as signed.
+                valueType = EffectPropertyStorage::ValueType::Int32;
+                break;
+
+            case D2D1_PROPERTY_TYPE_ENUM:
+                valueType = EffectPropertyStorage::ValueType::UInt32;
+                break;
+
+            case D2D1_PROPERTY_TYPE_FLOAT:
+                valueType = EffectPropertyStorage::ValueType::Float;
+                break;
+
+            case D2D1_PROPERTY_TYPE_VECTOR2:
+            case D2D1_PROPERTY_TYPE_VECTOR3:
+            case D2D1_PROPERTY_TYPE_VECTOR4:
+            case D2D1_PROPERTY_TYPE_MATRIX_3X2:
+            case D2D1_PROPERTY_TYPE_MATRIX_4X4:
+            case D2D1_PROPERTY_TYPE_MATRIX_5X4:
+            case D2D1_PROPERTY_TYPE_BLOB:
+                valueType = EffectPropertyStorage::ValueType::FloatArray;
+                break;
+
+            case D2D1_PROPERTY_TYPE_IUNKNOWN:
+            case D2D1_PROPERTY_TYPE_COLOR_CONTEXT:
+                valueType = EffectPropertyStorage::ValueType::Inspectable;
+                break;
+
+            default:
+                ThrowHR(E_NOTIMPL);
+            }
         }
-    }
-
 
-    ComPtr<IPropertyValue> CanvasEffect::GetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index)
-    {
-        switch (d2dEffect->GetType(index))
+        switch (valueType)
         {
-        case D2D1_PROPERTY_TYPE_BOOL:
-            {
-                BOOL value = d2dEffect->GetValue<BOOL>(index);
-                return CreateProperty(m_propertyValueFactory.Get(), static_cast<boolean>(value));
-            }
+        case EffectPropertyStorage::ValueType::Boolean:
+            m_properties.SetValue(index, static_cast<boolean>(!!d2dEffect->GetValue<BOOL>(index)));
             break;
 
-        case D2D1_PROPERTY_TYPE_INT32:
-        case D2D1_PROPERTY_TYPE_UINT32:     // Not a mistake: unsigned DImage properties are exposed in WinRT as signed.
-            {
-                INT32 value = d2dEffect->GetValue<INT32>(index);
-                return CreateProperty(m_propertyValueFactory.Get(), value);
-            }
+        case EffectPropertyStorage::ValueType::Int32:
+            m_properties.SetValue(index, d2dEffect->GetValue<INT32>(index));
             break;
 
-        case D2D1_PROPERTY_TYPE_ENUM:
-            {
-                UINT32 value = d2dEffect->GetValue<UINT32>(index);
-                return CreateProperty(m_propertyValueFactory.Get(), value);
-            }
+        case EffectPropertyStorage::ValueType::UInt32:
+            m_properties.SetValue(index, d2dEffect->GetValue<UINT32>(index));
             break;
 
-        case D2D1_PROPERTY_TYPE_FLOAT:
-            {
-                float value = d2dEffect->GetValue<float>(index);
-                return CreateProperty(m_propertyValueFactory.Get(), value);
-            }
+        case EffectPropertyStorage::ValueType::Float:
+            m_properties.SetValue(index, d2dEffect->GetValue<float>(index));
             break;
 
-        case D2D1_PROPERTY_TYPE_VECTOR2:
-        case D2D1_PROPERTY_TYPE_VECTOR3:
-        case D2D1_PROPERTY_TYPE_VECTOR4:
-        case D2D1_PROPERTY_TYPE_MATRIX_3X2:
-        case D2D1_PROPERTY_TYPE_MATRIX_4X4:
-        case D2D1_PROPERTY_TYPE_MATRIX_5X4:
-        case D2D1_PROPERTY_TYPE_BLOB:
+        case EffectPropertyStorage::ValueType::FloatArray:
             {
                 unsigned sizeInBytes = d2dEffect->GetValueSize(index);
                 unsigned sizeInFloats = sizeInBytes / sizeof(float);
 
-                std::vector<BYTE> value(sizeInBytes);
-                ThrowIfFailed(d2dEffect->GetValue(index, value.data(), sizeInBytes));
-
-                return CreateProperty(m_propertyValueFactory.Get(), sizeInFloats, reinterpret_cast<float*>(value.data()));
+                // Read directly into our storage, which is reused if the size has not changed.
+                auto value = m_properties.SetValues(index, sizeInFloats);
+                ThrowIfFailed(d2dEffect->GetValue(index, reinterpret_cast<BYTE*>(value), sizeInFloats * sizeof(float)));
             }
             break;
 
-        case D2D1_PROPERTY_TYPE_IUNKNOWN:
-        case D2D1_PROPERTY_TYPE_COLOR_CONTEXT:
+        case EffectPropertyStorage::ValueType::Inspectable:
             {
                 ComPtr<IUnknown> d2dResource;
 
@@ -1299,13 +1523,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
                 auto wrapper = d2dResource ? ResourceManager::GetOrCreate(m_realizationDevice.GetWrapper(), d2dResource.Get(), 0) : nullptr;
 
-                return CreateProperty(m_propertyValueFactory.Get(), wrapper.Get());
+                m_properties.SetValue(index, wrapper.Get());
             }
             break;
 
         default:
             ThrowHR(E_NOTIMPL);
         }
+
+        // The value now matches D2D.
+        m_properties.ClearDirty(index);
     }
 
 
@@ -1319,21 +1546,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             ThrowHR(E_INVALIDARG, Strings::EffectNoSources);
         }
 
-        // Create a new D2D effect instance.
-        auto d2dEffect = CreateD2DEffect(deviceContext, m_effectId);
+        // An identical effect that was released earlier may have left its D2D effect in the device's cache.
+        auto& cache = As<ICanvasDeviceInternal>(RealizationDevice())->GetRealizedEffectCache();
 
-        // Transfer property values from our resource independent m_properties store to the D2D effect.
-        for (unsigned i = 0; i < m_properties.size(); ++i)
+        if (CanRecycleResource() && cache.HasEffectsOfType(m_effectId))
         {
-            SetD2DProperty(d2dEffect.Get(), i, m_properties[i].Get());
+            return RealizeFromCache(cache, flags, targetDpi, deviceContext);
         }
 
-        // Also transfer the special properties that are common to all effects (CacheOutput and BufferPrecision).
-        if (m_cacheOutput)
-            ThrowIfFailed(d2dEffect->SetValue(D2D1_PROPERTY_CACHED, static_cast<BOOL>(true)));
-
-        if (m_bufferPrecision != D2D1_BUFFER_PRECISION_UNKNOWN)
-            ThrowIfFailed(d2dEffect->SetValue(D2D1_PROPERTY_PRECISION, m_bufferPrecision));
+        // Create a new D2D effect instance.
+        auto d2dEffect = CreateD2DEffectWithProperties(deviceContext);
 
         // Transfer input images across to the D2D effect.
         ThrowIfFailed(d2dEffect->SetInputCount((unsigned)m_sources.size()));
@@ -1344,16 +1566,104 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 return false;
         }
 
-        // Wipe m_properties, as the D2D effect is now the One True Source Of Authoritativeness.
-        m_properties.assign(m_properties.size(), nullptr);
+        // The D2D effect is now the One True Source Of Authoritativeness, other than for
+        // properties that are changed and marked dirty after this point.
+        m_properties.ClearAllDirty();
 
         // Store the new effect.
         SetResource(d2dEffect.Get());
 
+        m_isResourceExposed = false;
+
         return true;
     }
 
 
+    // Alternative to the main part of Realize, used when the cache might hold a D2D effect we
+    // can reuse. Cache keys identify sources by their D2D images, so unlike Realize this
+    // realizes our sources before creating (or finding) the effect that draws from them.
+    bool CanvasEffect::RealizeFromCache(RealizedEffectCache& cache, GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext)
+    {
+        auto sourceCount = static_cast<unsigned>(m_sources.size());
+
+        std::vector<ComPtr<ID2D1Image>> realizedSources(sourceCount);
+        std::vector<float> realizedDpis(sourceCount);
+
+        for (unsigned i = 0; i < sourceCount; ++i)
+        {
+            auto source = m_sources[i].GetWrapper();
+
+            if (!RealizeSource(i, source, flags, targetDpi, deviceContext, &realizedSources[i], &realizedDpis[i]))
+                return false;
+
+            m_sources[i].Set(realizedSources[i].Get(), source);
+        }
+
+        RealizedEffect cachedEffect;
+        ComPtr<ID2D1Effect> d2dEffect;
+
+        if (cache.Take(GetRealizedEffectKey(), &cachedEffect))
+        {
+            // The cached effect already has our properties and inputs, along with whatever
+            // DPI compensation they needed last time, which may not be right for this target.
+            d2dEffect = cachedEffect.Effect;
+
+            for (unsigned i = 0; i < sourceCount; ++i)
+            {
+                m_sources[i].DpiCompensator = cachedEffect.DpiCompensators[i];
+
+                if (ApplyDpiCompensation(i, realizedSources[i], realizedDpis[i], flags, targetDpi, deviceContext))
+                {
+                    SetEffectInput(d2dEffect.Get(), i, realizedSources[i].Get());
+                }
+            }
+        }
+        else
+        {
+            d2dEffect = CreateD2DEffectWithProperties(deviceContext);
+
+            ThrowIfFailed(d2dEffect->SetInputCount(sourceCount));
+
+            for (unsigned i = 0; i < sourceCount; ++i)
+            {
+                ApplyDpiCompensation(i, realizedSources[i], realizedDpis[i], flags, targetDpi, deviceContext);
+
+                SetEffectInput(d2dEffect.Get(), i, realizedSources[i].Get());
+            }
+        }
+
+        m_properties.ClearAllDirty();
+
+        SetResource(d2dEffect.Get());
+
+        m_isResourceExposed = false;
+
+        return true;
+    }
+
+
+    ComPtr<ID2D1Effect> CanvasEffect::CreateD2DEffectWithProperties(ID2D1DeviceContext* deviceContext)
+    {
+        auto d2dEffect = CreateD2DEffect(deviceContext, m_effectId);
+
+        // Transfer property values from our resource independent m_properties store to the D2D effect.
+        // This includes values that are not dirty, as the new effect starts out with D2D defaults.
+        for (unsigned i = 0; i < m_properties.GetCount(); ++i)
+        {
+            SetD2DProperty(d2dEffect.Get(), i);
+        }
+
+        // Also transfer the special properties that are common to all effects (CacheOutput and BufferPrecision).
+        if (m_cacheOutput)
+            ThrowIfFailed(d2dEffect->SetValue(D2D1_PROPERTY_CACHED, static_cast<BOOL>(true)));
+
+        if (m_bufferPrecision != D2D1_BUFFER_PRECISION_UNKNOWN)
+            ThrowIfFailed(d2dEffect->SetValue(D2D1_PROPERTY_PRECISION, m_bufferPrecision));
+
+        return d2dEffect;
+    }
+
+
     void CanvasEffect::Unrealize(unsigned int skipSourceIndex, bool skipAllSources)
     {
         auto& d2dEffect = MaybeGetResource();
@@ -1361,9 +1671,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         if (d2dEffect)
         {
             // Transfer property values from the D2D effect to our resource independent m_properties store.
-            for (unsigned i = 0; i < m_properties.size(); ++i)
+            // Dirty values have not yet been pushed to D2D, so our local copy is already the latest.
+            for (unsigned i = 0; i < m_properties.GetCount(); ++i)
             {
-                m_properties[i] = GetD2DProperty(d2dEffect.Get(), i);
+                if (!m_properties.IsDirty(i))
+                {
+                    GetD2DProperty(d2dEffect.Get(), i);
+                }
             }
 
             // Also transfer the special properties that are common to all effects (CacheOutput and BufferPrecision).
@@ -1392,10 +1706,360 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             ReleaseResource();
 
             m_workaround6146411.Reset();
+
+            ResetFoldedColorTransform();
+
+            // Parents referenced the old D2D effect, so must revalidate to pick up its replacement.
+            m_isValidated = false;
+            MarkChanged();
+        }
+    }
+
+
+    //
+    // ICanvasEffectInternal
+    //
+
+    void CanvasEffect::AddParentEffect(WeakRef const& parent)
+    {
+        std::lock_guard<std::mutex> lock(m_parentsMutex);
+
+        // WRL hands out the same weak reference object each time, so it doubles as an identity.
+        for (auto& existingParent : m_parents)
+        {
+            if (existingParent.Get() == parent.Get())
+                return;
+        }
+
+        m_parents.push_back(parent);
+    }
+
+
+    void CanvasEffect::MarkChanged()
+    {
+        // If we were already changed since the last validation, our parents have been told
+        // about it. Stopping here keeps repeated changes cheap, and terminates the recursion
+        // should the parent links ever form a cycle.
+        auto previousGeneration = m_generation++;
+
+        if (previousGeneration != m_validatedGeneration)
+            return;
+
+        MarkParentsChanged();
+    }
+
+
+    void CanvasEffect::MarkParentsChanged()
+    {
+        std::vector<ComPtr<ICanvasEffectInternal>> parents;
+
+        {
+            std::lock_guard<std::mutex> lock(m_parentsMutex);
+
+            parents.reserve(m_parents.size());
+
+            auto end = std::remove_if(m_parents.begin(), m_parents.end(), [&](WeakRef& weakParent)
+            {
+                ComPtr<ICanvasEffectInternal> parent;
+
+                if (FAILED(weakParent.As(&parent)) || !parent)
+                    return true;
+
+                parents.push_back(parent);
+                return false;
+            });
+
+            m_parents.erase(end, m_parents.end());
+        }
+
+        // Notify outside the lock, so a parent being released here can't re-enter it.
+        for (auto& parent : parents)
+        {
+            parent->MarkChanged();
+        }
+    }
+
+
+    // Is any effect that has used us as a source still alive? It may hold our D2D effect as
+    // one of its inputs, even after we are closed.
+    bool CanvasEffect::HasLiveParents()
+    {
+        std::lock_guard<std::mutex> lock(m_parentsMutex);
+
+        for (auto& weakParent : m_parents)
+        {
+            ComPtr<ICanvasEffectInternal> parent;
+
+            if (SUCCEEDED(weakParent.As(&parent)) && parent)
+                return true;
+        }
+
+        return false;
+    }
+
+
+    bool CanvasEffect::GetFoldedColorTransform(Matrix5x4* matrix, ComPtr<ID2D1Image>* input)
+    {
+        auto lock = Lock(m_mutex);
+
+        if (!m_isFolded)
+            return false;
+
+        *matrix = m_foldedMatrix;
+        *input = m_foldedInput;
+
+        return true;
+    }
+
+
+    // Called with m_mutex held.
+    bool CanvasEffect::IsValidatedFor(GetImageFlags flags, float targetDpi)
+    {
+        return m_isValidated &&
+               m_validatedFlags == flags &&
+               m_validatedDpi == targetDpi &&
+               m_generation == m_validatedGeneration &&
+               m_validatedImageCloseCount == GetCanvasImageCloseCount();
+    }
+
+
+    // Registers this effect as a parent of the source, if that is also an effect.
+    void CanvasEffect::TrackSource(IGraphicsEffectSource* source)
+    {
+        auto sourceEffect = MaybeAs<ICanvasEffectInternal>(source);
+
+        if (sourceEffect)
+        {
+            sourceEffect->AddParentEffect(AsWeak(static_cast<ICanvasEffect*>(this)));
         }
     }
 
 
+    ComPtr<ID2D1Image> CanvasEffect::GetOutputImage()
+    {
+        if (m_foldedImage)
+            return m_foldedImage;
+
+        return As<ID2D1Image>(GetResource());
+    }
+
+
+    // Called at the end of GetD2DImage when the FoldColorTransforms flag is set, after our sources
+    // have been validated. Works out whether this effect, along with a chain of foldable effects
+    // beneath it, can be drawn as a single D2D1ColorMatrix.
+    void CanvasEffect::UpdateFoldedColorTransform(Lock const& lock, ID2D1DeviceContext* deviceContext)
+    {
+        m_isFolded = false;
+        m_foldedInput.Reset();
+        m_foldedImage.Reset();
+
+        Matrix5x4 matrix;
+
+        if (!GetColorTransform(lock, &matrix))
+            return;
+
+        // If our source was folded as well, extend its transform rather than starting a new one.
+        auto sourceEffect = MaybeAs<ICanvasEffectInternal>(m_sources[0].GetWrapper());
+
+        Matrix5x4 sourceMatrix;
+        ComPtr<ID2D1Image> input;
+        bool isChain = false;
+
+        if (sourceEffect &&
+            ColorMatrixFolding::CanComposeAfter(matrix) &&
+            sourceEffect->GetFoldedColorTransform(&sourceMatrix, &input))
+        {
+            matrix = ColorMatrixFolding::Compose(sourceMatrix, matrix);
+            isChain = true;
+        }
+        else
+        {
+            // This includes any DPI compensation that was inserted for the source.
+            GetResource()->GetInput(0, &input);
+        }
+
+        // A null source (allowed by AllowNullEffectInputs) leaves nothing to fold.
+        if (!input)
+            return;
+
+        m_isFolded = true;
+        m_foldedMatrix = matrix;
+        m_foldedInput = input;
+
+        if (ColorMatrixFolding::IsIdentity(matrix))
+        {
+            // The transform has no visible result, so skip it entirely.
+            m_foldedImage = input;
+        }
+        else if (isChain)
+        {
+            if (!m_foldedEffect)
+            {
+                m_foldedEffect = CreateD2DEffect(deviceContext, CLSID_D2D1ColorMatrix);
+            }
+
+            // The D2D defaults of premultiplied alpha mode and no clamping match the way we fold.
+            ThrowIfFailed(m_foldedEffect->SetValue(D2D1_COLORMATRIX_PROP_COLOR_MATRIX, *reinterpret_cast<D2D1_MATRIX_5X4_F*>(&matrix)));
+
+            SetEffectInput(m_foldedEffect.Get(), 0, input.Get());
+
+            m_foldedImage = As<ID2D1Image>(m_foldedEffect);
+        }
+
+        // Otherwise this is a single effect, so it is drawn as itself.
+    }
+
+
+    // Describes this effect as a color matrix, if it is one of the linear color transforms that can be folded.
+    bool CanvasEffect::GetColorTransform(Lock const& lock, Matrix5x4* matrix)
+    {
+        // Effects that cache their output or change precision need a D2D effect of their own.
+        if (m_cacheOutput || m_bufferPrecision != D2D1_BUFFER_PRECISION_UNKNOWN || m_sources.size() != 1)
+            return false;
+
+        if (IsEqualGUID(m_effectId, CLSID_D2D1ColorMatrix))
+        {
+            RefreshProperty(lock, D2D1_COLORMATRIX_PROP_COLOR_MATRIX);
+            RefreshProperty(lock, D2D1_COLORMATRIX_PROP_ALPHA_MODE);
+            RefreshProperty(lock, D2D1_COLORMATRIX_PROP_CLAMP_OUTPUT);
+
+            uint32_t count;
+            uint32_t alphaMode;
+            boolean clampOutput;
+
+            auto values = m_properties.GetValues(D2D1_COLORMATRIX_PROP_COLOR_MATRIX, &count);
+            m_properties.GetValue(D2D1_COLORMATRIX_PROP_ALPHA_MODE, &alphaMode);
+            m_properties.GetValue(D2D1_COLORMATRIX_PROP_CLAMP_OUTPUT, &clampOutput);
+
+            // Straight alpha mode applies the matrix to premultiplied colors, which doesn't compose with the other effects.
+            if (count != sizeof(Matrix5x4) / sizeof(float) || alphaMode != D2D1_COLORMATRIX_ALPHA_MODE_PREMULTIPLIED || clampOutput)
+                return false;
+
+            memcpy(matrix, values, sizeof(Matrix5x4));
+        }
+        else if (IsEqualGUID(m_effectId, CLSID_D2D1Saturation))
+        {
+            float saturation;
+            RefreshProperty(lock, D2D1_SATURATION_PROP_SATURATION);
+            m_properties.GetValue(D2D1_SATURATION_PROP_SATURATION, &saturation);
+
+            *matrix = ColorMatrixFolding::Saturation(saturation);
+        }
+        else if (IsEqualGUID(m_effectId, CLSID_D2D1HueRotation))
+        {
+            float degrees;
+            RefreshProperty(lock, D2D1_HUEROTATION_PROP_ANGLE);
+            m_properties.GetValue(D2D1_HUEROTATION_PROP_ANGLE, &degrees);
+
+            *matrix = ColorMatrixFolding::HueRotation(degrees);
+        }
+        else if (IsEqualGUID(m_effectId, CLSID_D2D1Opacity))
+        {
+            float opacity;
+            RefreshProperty(lock, D2D1_OPACITY_PROP_OPACITY);
+            m_properties.GetValue(D2D1_OPACITY_PROP_OPACITY, &opacity);
+
+            *matrix = ColorMatrixFolding::Opacity(opacity);
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+
+    void CanvasEffect::ResetFoldedColorTransform()
+    {
+        m_isFolded = false;
+        m_foldedInput.Reset();
+        m_foldedImage.Reset();
+        m_foldedEffect.Reset();
+    }
+
+
+    // Can our D2D effect be fully described by a RealizedEffectKey, and so be reused by
+    // another effect after we are done with it? This is called from our destructor, so
+    // cannot be a virtual method.
+    bool CanvasEffect::CanRecycleResource()
+    {
+        // PixelShaderEffect keeps its shader and constants in shared state rather than effect properties.
+        return !IsEqualGUID(m_effectId, CLSID_PixelShaderEffect);
+    }
+
+
+    // Describes our D2D effect (or the one we would create) for RealizedEffectCache.
+    // Expects m_sources to hold the images our D2D effect draws from.
+    RealizedEffectKey CanvasEffect::GetRealizedEffectKey()
+    {
+        RealizedEffectKey key;
+
+        key.EffectId = m_effectId;
+        m_properties.GetValueKey(&key.PropertyWords, &key.PropertyInspectables);
+        key.CacheOutput = !!m_cacheOutput;
+        key.BufferPrecision = m_bufferPrecision;
+
+        for (auto& source : m_sources)
+        {
+            key.Sources.push_back(source.GetResource());
+        }
+
+        return key;
+    }
+
+
+    // Called when we are closed or destroyed. Hands our D2D effect to the device's cache, so
+    // an identical effect realized later can reuse it. This often happens when apps rebuild
+    // the same effect graph every frame.
+    //
+    // The effect that takes it over will go on to change its properties and inputs, so it is
+    // only recycled if nothing else can be using it. That is decided from what Win2D knows
+    // about, never from COM reference counts: the effect must not have been exposed (see
+    // m_isResourceExposed), and no other live effect may have it as an input. Parents that
+    // were recycled themselves are fine, as cache keys identify their inputs by identity.
+    void CanvasEffect::RecycleResource()
+    {
+        auto& d2dEffect = MaybeGetResource();
+
+        // Only effects whose state we fully know about can be described by a key. Values
+        // that are still dirty have not yet reached the D2D effect.
+        if (!d2dEffect || m_isResourceExposed || m_properties.HasDirtyValues() || !CanRecycleResource())
+            return;
+
+        if (HasLiveParents())
+            return;
+
+        // Errors have nowhere to go from here, and failing to cache an effect costs no more than
+        // creating a new one later, so they are ignored.
+        ExceptionBoundary(
+            [&]
+            {
+                auto key = GetRealizedEffectKey();
+
+                RealizedEffect realizedEffect{ d2dEffect };
+
+                for (auto& source : m_sources)
+                {
+                    realizedEffect.DpiCompensators.push_back(source.DpiCompensator);
+                }
+
+                ResetFoldedColorTransform();
+                ReleaseResource();
+
+                // The cached effect keeps its inputs alive, so we no longer need our own references
+                // to the source images. Drop them now, leaving only the wrappers.
+                for (auto& source : m_sources)
+                {
+                    source.DpiCompensator.Reset();
+                    source.Set(nullptr, source.GetWrapper());
+                }
+
+                As<ICanvasDeviceInternal>(RealizationDevice())->GetRealizedEffectCache().Add(std::move(key), std::move(realizedEffect));
+            });
+    }
+
+
     void CanvasEffect::ThrowIfClosed()
     {
         if (m_closed)
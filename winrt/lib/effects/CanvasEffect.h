@@ -29,6 +29,21 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     };
 
 
+    // Lets effects track which other effects use them as a source, so a change anywhere in
+    // an effect graph can be propagated upward to every node that will need to revalidate.
+    class __declspec(uuid("A6C17373-4A70-4DDF-BD75-4BACA30DD886"))
+    ICanvasEffectInternal : public IUnknown
+    {
+    public:
+        virtual void AddParentEffect(WeakRef const& parent) = 0;
+        virtual void MarkChanged() = 0;
+
+        // Reports the combined color transform that GetD2DImage folded this effect into,
+        // along with the input it applies to. Returns false if this effect was not folded.
+        virtual bool GetFoldedColorTransform(Matrix5x4* matrix, ComPtr<ID2D1Image>* input) = 0;
+    };
+
+
     class CanvasEffect
         : public Implements<
             RuntimeClassFlags<WinRtClassicComMix>,
@@ -38,6 +53,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             ICanvasEffect,
             ICanvasImage,
             CloakedIid<ICanvasImageInternal>,
+            CloakedIid<ICanvasEffectInternal>,
             ChainInterfaces<
                 MixIn<CanvasEffect, ResourceWrapper<ID2D1Effect, CanvasEffect, IGraphicsEffect>>,
                 IClosable,
@@ -56,12 +72,21 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         // What device are we currently realized on?
         CachedResourceReference<ID2D1Device, ICanvasDevice> m_realizationDevice;
 
-        // Effect property values (only used when the effect is not realized).
-        std::vector<ComPtr<IPropertyValue>> m_properties;
+        // Effect property values. This data is authoritative when the effect is not realized.
+        // While realized, only values that are marked dirty are authoritative: these have
+        // been changed since they were last pushed to the D2D effect, and will be pushed
+        // the next time it is requested by GetD2DImage.
+        EffectPropertyStorage m_properties;
 
         boolean m_cacheOutput;
         D2D1_BUFFER_PRECISION m_bufferPrecision;
 
+        // Set when our D2D effect is visible outside Win2D: it was handed out through
+        // GetNativeResource, we were created around an existing one, or it was realized with
+        // GetImageFlags::RetainRealization (eg. drawn into a command list). Such effects may be
+        // changed behind our back, and must never be recycled for use by other effects.
+        bool m_isResourceExposed;
+
         // Workaround Windows bug 6146411 (crash when reading back DESTINATION_COLOR_CONTEXT from a CLSID_D2D1ColorManagement effect).
         ComPtr<IUnknown> m_workaround6146411;
 
@@ -118,6 +143,43 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         ComPtr<SourcesVector> m_sourcesVector;
 
 
+        // Change tracking, which lets GetD2DImage skip recursing through parts of the effect
+        // graph that have not changed since they were last validated. m_generation is bumped
+        // whenever this effect or anything it draws from is modified. m_validatedGeneration
+        // records the generation seen at the start of the last validation pass, and the
+        // remaining fields (protected by m_mutex) what that validation was for.
+        //
+        // Bitmaps and command lists have no parents to notify, so closing one instead bumps
+        // a global count (see NotifyCanvasImageClosed). If that has moved since we validated,
+        // we walk the graph again, which fails with RO_E_CLOSED if it was one of our sources.
+        std::atomic<uint64_t> m_generation;
+        std::atomic<uint64_t> m_validatedGeneration;
+        uint64_t m_validatedImageCloseCount;
+
+        bool m_isValidated;
+        GetImageFlags m_validatedFlags;
+        float m_validatedDpi;
+
+        // Effects that use this one as a source. Held weakly, since parents own their sources.
+        // Protected by m_parentsMutex rather than m_mutex, as notifications propagate upward
+        // while child locks are held, and must not wait on the locks of the parents.
+        std::vector<WeakRef> m_parents;
+        std::mutex m_parentsMutex;
+
+
+        // Color transform folding (see GetImageFlags::FoldColorTransforms). When folded,
+        // m_foldedMatrix combines this effect with any foldable effects beneath it, and
+        // m_foldedInput is the image that transform applies to. m_foldedImage is what we
+        // draw in place of our own D2D effect: either m_foldedEffect, or the input itself
+        // if the combined transform does nothing. It is null if there is no substitution.
+        bool m_foldColorTransforms;
+        bool m_isFolded;
+        Matrix5x4 m_foldedMatrix;
+        ComPtr<ID2D1Image> m_foldedInput;
+        ComPtr<ID2D1Image> m_foldedImage;
+        ComPtr<ID2D1Effect> m_foldedEffect;
+
+
         // Generated table of effect factory functions, used by interop to create strongly
         // typed wrapper classes. m_effectMakers is terminated by a null MakeEffectFunction.
         typedef void(*MakeEffectFunction)(ICanvasDevice* device, ID2D1Effect* d2dEffect, ComPtr<IInspectable>* result);
@@ -142,7 +204,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     public:
         // Used by ResourceManager::GetOrCreate.
-        static bool TryCreateEffect(ICanvasDevice* device, IUnknown* resource, float dpi, ComPtr<IInspectable>* result);
+        static ResourceManager::TryCreateResult TryCreateEffect(ICanvasDevice* device, IUnknown* resource, float dpi, ComPtr<IInspectable>* result);
             
         //
         // ICanvasImage
@@ -157,6 +219,14 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         virtual ComPtr<ID2D1Image> GetD2DImage(ICanvasDevice* device, ID2D1DeviceContext* deviceContext, GetImageFlags flags, float targetDpi, float* realizedDpi = nullptr) override;
 
+        //
+        // ICanvasEffectInternal
+        //
+
+        virtual void AddParentEffect(WeakRef const& parent) override;
+        virtual void MarkChanged() override;
+        virtual bool GetFoldedColorTransform(Matrix5x4* matrix, ComPtr<ID2D1Image>* input) override;
+
         //
         // ICanvasResourceWrapperNative
         //
@@ -195,6 +265,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         IFACEMETHOD(put_CacheOutput)(boolean value) override;
         IFACEMETHOD(get_BufferPrecision)(IReference<CanvasBufferPrecision>** value) override;
         IFACEMETHOD(put_BufferPrecision)(IReference<CanvasBufferPrecision>* value) override;
+        IFACEMETHOD(get_FoldColorTransforms)(boolean* value) override;
+        IFACEMETHOD(put_FoldColorTransforms)(boolean value) override;
         IFACEMETHOD(InvalidateSourceRectangle)(ICanvasResourceCreatorWithDpi* resourceCreator, uint32_t sourceIndex, Rect invalidRectangle) override;
         IFACEMETHOD(GetInvalidRectangles)(ICanvasResourceCreatorWithDpi* resourceCreator, uint32_t* valueCount, Rect** valueElements) override;
         IFACEMETHOD(GetRequiredSourceRectangle)(ICanvasResourceCreatorWithDpi* resourceCreator, Rect outputRectangle, ICanvasEffect* sourceEffect, uint32_t sourceIndex, Rect sourceBounds, Rect* value) override;
@@ -208,13 +280,21 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         // enums are stored as unsigned integers, vectors and matrices as float arrays, and
         // colors as float[3] or float[4] depending on whether they include alpha.
         //
+        // Despite the name, values are held unboxed in m_properties. They are only boxed into
+        // IPropertyValue objects if requested through IGraphicsEffectD2D1Interop::GetProperty.
+        // While we are realized, set methods also write the value straight through to D2D.
+        //
 
         template<typename TBoxed, typename TPublic>
         void SetBoxedProperty(unsigned int index, TPublic const& value)
         {
-            auto boxedValue = PropertyTypeConverter<TBoxed, TPublic>::Box(m_propertyValueFactory.Get(), value);
+            auto lock = Lock(m_mutex);
+
+            PropertyTypeConverter<TBoxed, TPublic>::Store(m_properties, index, value);
+
+            WriteThroughProperty(lock, index);
 
-            SetProperty(index, boxedValue.Get());
+            MarkChanged();
         }
 
         template<typename TBoxed, typename TPublic>
@@ -222,17 +302,25 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         {
             CheckInPointer(value);
 
-            auto boxedValue = GetProperty(index);
+            auto lock = Lock(m_mutex);
 
-            PropertyTypeConverter<TBoxed, TPublic>::Unbox(boxedValue.Get(), value);
+            RefreshProperty(lock, index);
+
+            PropertyTypeConverter<TBoxed, TPublic>::Load(m_properties, index, value);
         }
 
         template<typename T>
         void SetArrayProperty(unsigned int index, uint32_t valueCount, T const* value)
         {
-            auto boxedValue = CreateProperty(m_propertyValueFactory.Get(), valueCount, value);
+            static_assert(std::is_same<T, float>::value, "Array properties must be float");
+
+            auto lock = Lock(m_mutex);
+
+            m_properties.SetValues(index, valueCount, value);
 
-            SetProperty(index, boxedValue.Get());
+            WriteThroughProperty(lock, index);
+
+            MarkChanged();
         }
 
         template<typename T>
@@ -244,12 +332,20 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         template<typename T>
         void GetArrayProperty(unsigned int index, uint32_t* valueCount, T** value)
         {
+            static_assert(std::is_same<T, float>::value, "Array properties must be float");
+
             CheckInPointer(valueCount);
             CheckAndClearOutPointer(value);
 
-            auto boxedValue = GetProperty(index);
+            auto lock = Lock(m_mutex);
+
+            RefreshProperty(lock, index);
 
-            GetValueOfProperty(boxedValue.Get(), valueCount, value);
+            uint32_t count;
+            auto data = m_properties.GetValues(index, &count);
+
+            ComArray<float> result(data, data + count);
+            result.Detach(valueCount, value);
         }
 
 
@@ -272,20 +368,37 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         // On-demand creation of the underlying D2D image effect.
         virtual bool Realize(GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext);
         virtual void Unrealize(unsigned int skipSourceIndex = UINT_MAX, bool skipAllSources = false);
-
     private:
         ComPtr<ID2D1Effect> CreateD2DEffect(ID2D1DeviceContext* deviceContext, IID const& effectId);
+        ComPtr<ID2D1Effect> CreateD2DEffectWithProperties(ID2D1DeviceContext* deviceContext);
+        bool RealizeFromCache(RealizedEffectCache& cache, GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext);
         bool ApplyDpiCompensation(unsigned int index, ComPtr<ID2D1Image>& inputImage, float inputDpi, GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext);
         void RefreshInputs(GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext);
         
         bool SetD2DInput(ID2D1Effect* d2dEffect, unsigned int index, IGraphicsEffectSource* source, GetImageFlags flags, float targetDpi = 0, ID2D1DeviceContext* deviceContext = nullptr);
+        bool RealizeSource(unsigned int index, IGraphicsEffectSource* source, GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext, ComPtr<ID2D1Image>* realizedSource, float* realizedDpi);
         ComPtr<IGraphicsEffectSource> GetD2DInput(ID2D1Effect* d2dEffect, unsigned int index);
 
-        void SetProperty(unsigned int index, IPropertyValue* propertyValue);
-        void SetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index, IPropertyValue* propertyValue);
+        void RefreshProperty(Lock const& lock, unsigned int index);
+        void WriteThroughProperty(Lock const& lock, unsigned int index);
+        void SetDirtyD2DProperties(ID2D1Effect* d2dEffect);
+
+        void SetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index);
+        void GetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index);
 
-        ComPtr<IPropertyValue> GetProperty(unsigned int index);
-        ComPtr<IPropertyValue> GetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index);
+        bool IsValidatedFor(GetImageFlags flags, float targetDpi);
+        void TrackSource(IGraphicsEffectSource* source);
+        void MarkParentsChanged();
+        bool HasLiveParents();
+
+        ComPtr<ID2D1Image> GetOutputImage();
+        void UpdateFoldedColorTransform(Lock const& lock, ID2D1DeviceContext* deviceContext);
+        bool GetColorTransform(Lock const& lock, Matrix5x4* matrix);
+        void ResetFoldedColorTransform();
+
+        bool CanRecycleResource();
+        RealizedEffectKey GetRealizedEffectKey();
+        void RecycleResource();
 
         void ThrowIfClosed();
 
@@ -310,14 +423,14 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         {
             static_assert(std::is_same<TBoxed, TPublic>::value, "Default PropertyTypeConverter should only be used when TBoxed = TPublic");
 
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, TPublic const& value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, TPublic const& value)
             {
-                return CreateProperty(factory, value);
+                storage.SetValue(index, value);
             }
 
-            static void Unbox(IPropertyValue* propertyValue, TPublic* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, TPublic* result)
             {
-                GetValueOfProperty(propertyValue, result);
+                storage.GetValue(index, result);
             }
         };
 
@@ -327,15 +440,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         struct PropertyTypeConverter<uint32_t, TPublic,
                                      typename std::enable_if<std::is_enum<TPublic>::value>::type>
         {
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, TPublic value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, TPublic value)
             {
-                return CreateProperty(factory, static_cast<uint32_t>(value));
+                storage.SetValue(index, static_cast<uint32_t>(value));
             }
 
-            static void Unbox(IPropertyValue* propertyValue, TPublic* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, TPublic* result)
             {
                 uint32_t value;
-                GetValueOfProperty(propertyValue, &value);
+                storage.GetValue(index, &value);
                 *result = static_cast<TPublic>(value);
             }
         };
@@ -355,23 +468,20 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
             static_assert(sizeof(TPublic) == sizeof(float[N]), "Wrong array size");
 
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, TPublic const& value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, TPublic const& value)
             {
-                ComPtr<IPropertyValue> propertyValue;
-                ThrowIfFailed(factory->CreateSingleArray(N, (float*)&value, &propertyValue));
-                return propertyValue;
+                storage.SetValues(index, N, reinterpret_cast<float const*>(&value));
             }
 
-            static void Unbox(IPropertyValue* propertyValue, TPublic* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, TPublic* result)
             {
-                ComArray<float> value;
+                uint32_t count;
+                auto value = storage.GetValues(index, &count);
 
-                ThrowIfFailed(propertyValue->GetSingleArray(value.GetAddressOfSize(), value.GetAddressOfData()));
-
-                if (value.GetSize() != N)
+                if (count != N)
                     ThrowHR(E_BOUNDS);
 
-                *result = *reinterpret_cast<TPublic*>(value.GetData());
+                *result = *reinterpret_cast<TPublic const*>(value);
             }
         };
 
@@ -382,15 +492,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         {
             typedef PropertyTypeConverter<float[4], Numerics::Vector4> VectorConverter;
 
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, Color const& value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, Color const& value)
             {
-                return VectorConverter::Box(factory, ToVector4(value));
+                VectorConverter::Store(storage, index, ToVector4(value));
             }
 
-            static void Unbox(IPropertyValue* propertyValue, Color* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, Color* result)
             {
                 Numerics::Vector4 value;
-                VectorConverter::Unbox(propertyValue, &value);
+                VectorConverter::Load(storage, index, &value);
                 *result = ToWindowsColor(value);
             }
         };
@@ -402,15 +512,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         {
             typedef PropertyTypeConverter<float[3], Numerics::Vector3> VectorConverter;
 
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, Color const& value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, Color const& value)
             {
-                return VectorConverter::Box(factory, ToVector3(value));
+                VectorConverter::Store(storage, index, ToVector3(value));
             }
 
-            static void Unbox(IPropertyValue* propertyValue, Color* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, Color* result)
             {
                 Numerics::Vector3 value;
-                VectorConverter::Unbox(propertyValue, &value);
+                VectorConverter::Load(storage, index, &value);
                 *result = ToWindowsColor(value);
             }
         };
@@ -422,15 +532,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         {
             typedef PropertyTypeConverter<float[3], Numerics::Vector3> VectorConverter;
 
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, Numerics::Vector4 const& value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, Numerics::Vector4 const& value)
             {
-                return VectorConverter::Box(factory, Numerics::Vector3{ value.X, value.Y, value.Z });
+                VectorConverter::Store(storage, index, Numerics::Vector3{ value.X, value.Y, value.Z });
             }
 
-            static void  Unbox(IPropertyValue* propertyValue, Numerics::Vector4* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, Numerics::Vector4* result)
             {
                 Numerics::Vector3 value;
-                VectorConverter::Unbox(propertyValue, &value);
+                VectorConverter::Load(storage, index, &value);
                 *result = Numerics::Vector4{ value.X, value.Y, value.Z, 1.0f };
             }
         };
@@ -442,16 +552,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         {
             typedef PropertyTypeConverter<float[4], Numerics::Vector4> VectorConverter;
 
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, Rect const& value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, Rect const& value)
             {
                 auto d2dRect = ToD2DRect(value);
-                return VectorConverter::Box(factory, *ReinterpretAs<Numerics::Vector4*>(&d2dRect));
+                VectorConverter::Store(storage, index, *ReinterpretAs<Numerics::Vector4*>(&d2dRect));
             }
 
-            static void Unbox(IPropertyValue* propertyValue, Rect* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, Rect* result)
             {
                 Numerics::Vector4 value;
-                VectorConverter::Unbox(propertyValue, &value);
+                VectorConverter::Load(storage, index, &value);
                 *result = FromD2DRect(*ReinterpretAs<D2D1_RECT_F*>(&value));
             }
         };
@@ -461,15 +571,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         template<>
         struct PropertyTypeConverter<ConvertRadiansToDegrees, float>
         {
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, float value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, float value)
             {
-                return CreateProperty(factory, ::DirectX::XMConvertToDegrees(value));
+                storage.SetValue(index, ::DirectX::XMConvertToDegrees(value));
             }
 
-            static void Unbox(IPropertyValue* propertyValue, float* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, float* result)
             {
                 float degrees;
-                GetValueOfProperty(propertyValue, &degrees);
+                storage.GetValue(index, &degrees);
                 *result = ::DirectX::XMConvertToRadians(degrees);
             }
         };
@@ -482,92 +592,23 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             static_assert(D2D1_COLORMATRIX_ALPHA_MODE_PREMULTIPLIED == D2D1_ALPHA_MODE_PREMULTIPLIED, "Enum values should match");
             static_assert(D2D1_COLORMATRIX_ALPHA_MODE_STRAIGHT == D2D1_ALPHA_MODE_STRAIGHT, "Enum values should match");
 
-            static ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, CanvasAlphaMode value)
+            static void Store(EffectPropertyStorage& storage, unsigned int index, CanvasAlphaMode value)
             {
                 if (value == CanvasAlphaMode::Ignore)
                     ThrowHR(E_INVALIDARG);
 
-                return CreateProperty(factory, static_cast<uint32_t>(ToD2DAlphaMode(value)));
+                storage.SetValue(index, static_cast<uint32_t>(ToD2DAlphaMode(value)));
             }
 
-            static void Unbox(IPropertyValue* propertyValue, CanvasAlphaMode* result)
+            static void Load(EffectPropertyStorage const& storage, unsigned int index, CanvasAlphaMode* result)
             {
                 uint32_t value;
-                GetValueOfProperty(propertyValue, &value);
+                storage.GetValue(index, &value);
                 *result = FromD2DAlphaMode(static_cast<D2D1_ALPHA_MODE>(value));
             }
         };
 
 
-        //
-        // Wrap the IPropertyValue accessors (which use different method names for each type) with
-        // overloaded C++ versions that can be used by generic PropertyTypeConverter implementations.
-        //
-
-#define PROPERTY_TYPE_ACCESSOR(TYPE, WINRT_NAME)                                                        \
-        static ComPtr<IPropertyValue> CreateProperty(IPropertyValueStatics* factory, TYPE const& value) \
-        {                                                                                               \
-            ComPtr<IPropertyValue> propertyValue;                                                       \
-            ThrowIfFailed(factory->Create##WINRT_NAME(value, &propertyValue));                          \
-            return propertyValue;                                                                       \
-        }                                                                                               \
-                                                                                                        \
-        static void GetValueOfProperty(IPropertyValue* propertyValue, TYPE* result)                     \
-        {                                                                                               \
-            ThrowIfFailed(propertyValue->Get##WINRT_NAME(result));                                      \
-        }
-
-#define ARRAY_PROPERTY_TYPE_ACCESSOR(TYPE, WINRT_NAME)                                                                          \
-        static ComPtr<IPropertyValue> CreateProperty(IPropertyValueStatics* factory, uint32_t valueCount, TYPE const* value)    \
-        {                                                                                                                       \
-            ComPtr<IPropertyValue> propertyValue;                                                                               \
-            ThrowIfFailed(factory->Create##WINRT_NAME##Array(valueCount, const_cast<TYPE*>(value), &propertyValue));            \
-            return propertyValue;                                                                                               \
-        }                                                                                                                       \
-                                                                                                                                \
-        static void GetValueOfProperty(IPropertyValue* propertyValue, uint32_t* valueCount, TYPE** value)                       \
-        {                                                                                                                       \
-            ThrowIfFailed(propertyValue->Get##WINRT_NAME##Array(valueCount, value));                                            \
-        }
-
-        PROPERTY_TYPE_ACCESSOR(float,    Single)
-        PROPERTY_TYPE_ACCESSOR(int32_t,  Int32)
-        PROPERTY_TYPE_ACCESSOR(uint32_t, UInt32)
-        PROPERTY_TYPE_ACCESSOR(boolean,  Boolean)
-        
-        ARRAY_PROPERTY_TYPE_ACCESSOR(float, Single)
-
-#undef PROPERTY_TYPE_ACCESSOR
-#undef ARRAY_PROPERTY_TYPE_ACCESSOR
-
-
-        // Interface types are stored as a PropertyType_InspectableArray containing a single IInspectable.
-        // This is because IPropertyValue provides CreateInspectableArray, but not CreateInspectable.
-        static ComPtr<IPropertyValue> CreateProperty(IPropertyValueStatics* factory, IInspectable* value)
-        {
-            ComPtr<IPropertyValue> propertyValue;
-            ThrowIfFailed(factory->CreateInspectableArray(1, &value, &propertyValue));
-            return propertyValue;
-        }
-
-        template<typename T>
-        static void GetValueOfProperty(IPropertyValue* propertyValue, T** result)
-        {
-            static_assert(std::is_base_of<IInspectable, T>::value, "Interface types must be IInspectable");
-            
-            ComArray<ComPtr<IInspectable>> value;
-            ThrowIfFailed(propertyValue->GetInspectableArray(value.GetAddressOfSize(), value.GetAddressOfData()));
-
-            if (value.GetSize() != 1)
-                ThrowHR(E_NOTIMPL);
-
-            if (value[0])
-                ThrowIfFailed(value[0].CopyTo(result));
-            else
-                *result = nullptr;
-        }
-
-
         //
         // Macros used by the generated strongly typed effect subclasses
         // 
@@ -0,0 +1,168 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    static_assert(sizeof(Matrix5x4) == sizeof(float[5][4]), "Matrix5x4 should be 5 rows of 4 floats");
+
+    static float (&Elements(Matrix5x4& matrix))[5][4]
+    {
+        return *reinterpret_cast<float(*)[5][4]>(&matrix);
+    }
+
+    static float const (&Elements(Matrix5x4 const& matrix))[5][4]
+    {
+        return *reinterpret_cast<float const(*)[5][4]>(&matrix);
+    }
+
+
+    Matrix5x4 ColorMatrixFolding::Identity()
+    {
+        return Matrix5x4
+        {
+            1, 0, 0, 0,
+            0, 1, 0, 0,
+            0, 0, 1, 0,
+            0, 0, 0, 1,
+            0, 0, 0, 0
+        };
+    }
+
+
+    // The luminance weights used by D2D (and SVG feColorMatrix) for saturation and hue rotation.
+    const float LuminanceR = 0.213f;
+    const float LuminanceG = 0.715f;
+    const float LuminanceB = 0.072f;
+
+
+    Matrix5x4 ColorMatrixFolding::Saturation(float saturation)
+    {
+        float s = saturation;
+
+        return Matrix5x4
+        {
+            LuminanceR + (1 - LuminanceR) * s,  LuminanceR - LuminanceR * s,        LuminanceR - LuminanceR * s,        0,
+            LuminanceG - LuminanceG * s,        LuminanceG + (1 - LuminanceG) * s,  LuminanceG - LuminanceG * s,        0,
+            LuminanceB - LuminanceB * s,        LuminanceB - LuminanceB * s,        LuminanceB + (1 - LuminanceB) * s,  0,
+            0,                                  0,                                  0,                                  1,
+            0,                                  0,                                  0,                                  0
+        };
+    }
+
+
+    Matrix5x4 ColorMatrixFolding::HueRotation(float degrees)
+    {
+        float radians = ::DirectX::XMConvertToRadians(degrees);
+
+        float c = cosf(radians);
+        float s = sinf(radians);
+
+        return Matrix5x4
+        {
+            LuminanceR + c * (1 - LuminanceR) - s * LuminanceR,  LuminanceR - c * LuminanceR + s * 0.143f,        LuminanceR - c * LuminanceR - s * (1 - LuminanceR),  0,
+            LuminanceG - c * LuminanceG - s * LuminanceG,        LuminanceG + c * (1 - LuminanceG) + s * 0.140f,  LuminanceG - c * LuminanceG + s * LuminanceG,        0,
+            LuminanceB - c * LuminanceB + s * (1 - LuminanceB),  LuminanceB - c * LuminanceB - s * 0.283f,        LuminanceB + c * (1 - LuminanceB) + s * LuminanceB,  0,
+            0,                                                   0,                                               0,                                                   1,
+            0,                                                   0,                                               0,                                                   0
+        };
+    }
+
+
+    Matrix5x4 ColorMatrixFolding::Opacity(float opacity)
+    {
+        // D2D1Opacity scales all four premultiplied channels, which for straight colors is just alpha.
+        auto matrix = Identity();
+
+        matrix.M44 = opacity;
+
+        return matrix;
+    }
+
+
+    Matrix5x4 ColorMatrixFolding::Compose(Matrix5x4 const& first, Matrix5x4 const& second)
+    {
+        auto& a = Elements(first);
+        auto& b = Elements(second);
+
+        Matrix5x4 result;
+        auto& r = Elements(result);
+
+        for (int row = 0; row < 5; row++)
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                float value = 0;
+
+                for (int i = 0; i < 4; i++)
+                {
+                    value += a[row][i] * b[i][column];
+                }
+
+                // The last row holds offsets, which are added after the multiply.
+                if (row == 4)
+                {
+                    value += b[4][column];
+                }
+
+                r[row][column] = value;
+            }
+        }
+
+        return result;
+    }
+
+
+    bool ColorMatrixFolding::CanComposeAfter(Matrix5x4 const& second)
+    {
+        return second.M14 == 0 &&
+               second.M24 == 0 &&
+               second.M34 == 0 &&
+               second.M54 == 0;
+    }
+
+
+    bool ColorMatrixFolding::IsIdentity(Matrix5x4 const& matrix)
+    {
+        // Allows for rounding error, eg. a hue rotation of 360 degrees.
+        const float tolerance = 1e-5f;
+
+        auto& m = Elements(matrix);
+
+        for (int row = 0; row < 5; row++)
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                float expected = (row == column) ? 1.0f : 0.0f;
+
+                if (fabsf(m[row][column] - expected) > tolerance)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    Numerics::Vector4 ColorMatrixFolding::Transform(Numerics::Vector4 const& color, Matrix5x4 const& matrix)
+    {
+        auto& m = Elements(matrix);
+
+        float input[5] = { color.X, color.Y, color.Z, color.W, 1 };
+        float output[4];
+
+        for (int column = 0; column < 4; column++)
+        {
+            output[column] = 0;
+
+            for (int i = 0; i < 5; i++)
+            {
+                output[column] += input[i] * m[i][column];
+            }
+        }
+
+        return Numerics::Vector4{ output[0], output[1], output[2], output[3] };
+    }
+}}}}}
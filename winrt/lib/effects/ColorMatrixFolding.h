@@ -0,0 +1,44 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    //
+    // Expresses linear color effects as 5x4 color matrices, so that chains of
+    // them can be drawn as a single D2D1ColorMatrix effect.
+    //
+    // Matrices follow the D2D convention, where output = [R G B A 1] * matrix,
+    // and are applied to straight (unpremultiplied) colors. This matches
+    // D2D1ColorMatrix with D2D1_COLORMATRIX_ALPHA_MODE_PREMULTIPLIED.
+    //
+    class ColorMatrixFolding
+    {
+    public:
+        static Matrix5x4 Identity();
+
+        // Matrices equivalent to the D2D1Saturation, D2D1HueRotation and D2D1Opacity effects.
+        static Matrix5x4 Saturation(float saturation);
+        static Matrix5x4 HueRotation(float degrees);
+        static Matrix5x4 Opacity(float opacity);
+
+        // Returns a matrix that has the same effect as applying first, then second.
+        static Matrix5x4 Compose(Matrix5x4 const& first, Matrix5x4 const& second);
+
+        // Can second be composed after another matrix without changing the result?
+        //
+        // Between two separate effects, colors are premultiplied and then
+        // unpremultiplied again, which loses the color of anything that became
+        // fully transparent. That only goes unnoticed if the second matrix keeps
+        // transparent pixels transparent, ie. output alpha depends on nothing
+        // but input alpha.
+        static bool CanComposeAfter(Matrix5x4 const& second);
+
+        static bool IsIdentity(Matrix5x4 const& matrix);
+
+        // Applies a matrix to a straight alpha color.
+        static Numerics::Vector4 Transform(Numerics::Vector4 const& color, Matrix5x4 const& matrix);
+    };
+}}}}}
@@ -0,0 +1,284 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    static_assert(sizeof(float) == sizeof(uint32_t), "Values are stored as 32 bit words");
+
+
+    EffectPropertyStorage::EffectPropertyStorage(unsigned count)
+        : m_slots(count, Slot{ ValueType::None, 0, 0, 0 })
+        , m_dirtyMask(0)
+    {
+        assert(count <= MaxProperties);
+    }
+
+
+    EffectPropertyStorage::ValueType EffectPropertyStorage::GetType(unsigned index) const
+    {
+        return GetSlot(index).Type;
+    }
+
+
+    void EffectPropertyStorage::SetValue(unsigned index, boolean value)
+    {
+        *Allocate(index, ValueType::Boolean, 1) = value ? 1 : 0;
+    }
+
+
+    void EffectPropertyStorage::SetValue(unsigned index, int32_t value)
+    {
+        *Allocate(index, ValueType::Int32, 1) = static_cast<uint32_t>(value);
+    }
+
+
+    void EffectPropertyStorage::SetValue(unsigned index, uint32_t value)
+    {
+        *Allocate(index, ValueType::UInt32, 1) = value;
+    }
+
+
+    void EffectPropertyStorage::SetValue(unsigned index, float value)
+    {
+        memcpy(Allocate(index, ValueType::Float, 1), &value, sizeof(value));
+    }
+
+
+    void EffectPropertyStorage::SetValue(unsigned index, IInspectable* value)
+    {
+        Allocate(index, ValueType::Inspectable, 0);
+
+        if (m_inspectables.empty())
+            m_inspectables.resize(m_slots.size());
+
+        m_inspectables[index] = value;
+    }
+
+
+    void EffectPropertyStorage::SetValues(unsigned index, uint32_t count, float const* values)
+    {
+        if (count > 0)
+            CheckInPointer(values);
+
+        auto storage = SetValues(index, count);
+
+        if (count > 0)
+            memcpy(storage, values, count * sizeof(float));
+    }
+
+
+    float* EffectPropertyStorage::SetValues(unsigned index, uint32_t count)
+    {
+        return reinterpret_cast<float*>(Allocate(index, ValueType::FloatArray, count));
+    }
+
+
+    void EffectPropertyStorage::GetValue(unsigned index, boolean* value) const
+    {
+        *value = GetWord(index, ValueType::Boolean) != 0;
+    }
+
+
+    void EffectPropertyStorage::GetValue(unsigned index, int32_t* value) const
+    {
+        auto& slot = GetSlot(index);
+
+        if (slot.Type == ValueType::UInt32)
+        {
+            auto unsignedValue = m_values[slot.Offset];
+
+            if (unsignedValue > static_cast<uint32_t>(INT32_MAX))
+                ThrowHR(E_BOUNDS);
+
+            *value = static_cast<int32_t>(unsignedValue);
+        }
+        else
+        {
+            *value = static_cast<int32_t>(GetWord(index, ValueType::Int32));
+        }
+    }
+
+
+    void EffectPropertyStorage::GetValue(unsigned index, uint32_t* value) const
+    {
+        auto& slot = GetSlot(index);
+
+        if (slot.Type == ValueType::Int32)
+        {
+            auto signedValue = static_cast<int32_t>(m_values[slot.Offset]);
+
+            if (signedValue < 0)
+                ThrowHR(E_BOUNDS);
+
+            *value = static_cast<uint32_t>(signedValue);
+        }
+        else
+        {
+            *value = GetWord(index, ValueType::UInt32);
+        }
+    }
+
+
+    void EffectPropertyStorage::GetValue(unsigned index, float* value) const
+    {
+        auto word = GetWord(index, ValueType::Float);
+        memcpy(value, &word, sizeof(word));
+    }
+
+
+    float const* EffectPropertyStorage::GetValues(unsigned index, uint32_t* count) const
+    {
+        auto& slot = GetSlot(index);
+
+        if (slot.Type != ValueType::FloatArray)
+            ThrowHR(TYPE_E_TYPEMISMATCH);
+
+        *count = slot.Size;
+
+        return reinterpret_cast<float const*>(m_values.data() + slot.Offset);
+    }
+
+
+    ComPtr<IInspectable> EffectPropertyStorage::GetInspectable(unsigned index) const
+    {
+        if (GetSlot(index).Type != ValueType::Inspectable)
+            ThrowHR(TYPE_E_TYPEMISMATCH);
+
+        return m_inspectables[index];
+    }
+
+
+    bool EffectPropertyStorage::IsDirty(unsigned index) const
+    {
+        assert(index < m_slots.size());
+
+        return (m_dirtyMask & (1ULL << index)) != 0;
+    }
+
+
+    void EffectPropertyStorage::ClearDirty(unsigned index)
+    {
+        assert(index < m_slots.size());
+
+        m_dirtyMask &= ~(1ULL << index);
+    }
+
+
+    ComPtr<IPropertyValue> EffectPropertyStorage::Box(IPropertyValueStatics* factory, unsigned index) const
+    {
+        auto& slot = GetSlot(index);
+        auto value = m_values.data() + slot.Offset;
+
+        ComPtr<IPropertyValue> propertyValue;
+
+        switch (slot.Type)
+        {
+        case ValueType::None:
+            return nullptr;
+
+        case ValueType::Boolean:
+            ThrowIfFailed(factory->CreateBoolean(*value != 0, &propertyValue));
+            break;
+
+        case ValueType::Int32:
+            ThrowIfFailed(factory->CreateInt32(static_cast<int32_t>(*value), &propertyValue));
+            break;
+
+        case ValueType::UInt32:
+            ThrowIfFailed(factory->CreateUInt32(*value, &propertyValue));
+            break;
+
+        case ValueType::Float:
+            ThrowIfFailed(factory->CreateSingle(*reinterpret_cast<float const*>(value), &propertyValue));
+            break;
+
+        case ValueType::FloatArray:
+            ThrowIfFailed(factory->CreateSingleArray(slot.Size, const_cast<float*>(reinterpret_cast<float const*>(value)), &propertyValue));
+            break;
+
+        case ValueType::Inspectable:
+            {
+                // IPropertyValue provides CreateInspectableArray, but not CreateInspectable.
+                auto inspectable = m_inspectables[index].Get();
+                ThrowIfFailed(factory->CreateInspectableArray(1, &inspectable, &propertyValue));
+            }
+            break;
+
+        default:
+            ThrowHR(E_NOTIMPL);
+        }
+
+        return propertyValue;
+    }
+
+
+    void EffectPropertyStorage::GetValueKey(std::vector<uint32_t>* words, std::vector<ComPtr<IInspectable>>* inspectables) const
+    {
+        words->clear();
+        inspectables->clear();
+
+        for (unsigned i = 0; i < m_slots.size(); ++i)
+        {
+            auto& slot = m_slots[i];
+
+            // The type and size are included, so eg. arrays of different lengths never run together.
+            words->push_back(static_cast<uint32_t>(slot.Type));
+            words->push_back(slot.Size);
+
+            words->insert(words->end(), m_values.begin() + slot.Offset, m_values.begin() + slot.Offset + slot.Size);
+
+            if (slot.Type == ValueType::Inspectable)
+                inspectables->push_back(m_inspectables[i]);
+        }
+    }
+
+
+    uint32_t* EffectPropertyStorage::Allocate(unsigned index, ValueType type, uint32_t size)
+    {
+        assert(index < m_slots.size());
+
+        auto& slot = m_slots[index];
+
+        if (slot.Type == ValueType::Inspectable && type != ValueType::Inspectable)
+            m_inspectables[index].Reset();
+
+        if (size > slot.Capacity)
+        {
+            // The old range (if any) is abandoned.  Only variable length
+            // arrays ever grow, so this is rare.
+            slot.Offset = static_cast<uint32_t>(m_values.size());
+            slot.Capacity = size;
+
+            m_values.resize(m_values.size() + size);
+        }
+
+        slot.Type = type;
+        slot.Size = size;
+
+        m_dirtyMask |= (1ULL << index);
+
+        return m_values.data() + slot.Offset;
+    }
+
+
+    EffectPropertyStorage::Slot const& EffectPropertyStorage::GetSlot(unsigned index) const
+    {
+        assert(index < m_slots.size());
+
+        return m_slots[index];
+    }
+
+
+    uint32_t EffectPropertyStorage::GetWord(unsigned index, ValueType type) const
+    {
+        auto& slot = GetSlot(index);
+
+        if (slot.Type != type)
+            ThrowHR(TYPE_E_TYPEMISMATCH);
+
+        return m_values[slot.Offset];
+    }
+}}}}}
@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    using namespace ::Microsoft::WRL;
+    using namespace ABI::Windows::Foundation;
+
+    //
+    // Typed storage for the property values of a CanvasEffect.
+    //
+    // Every D2D effect property is made up of bools, ints, uints or floats, so
+    // values are kept unboxed in a single flat array of 32 bit words.  Each
+    // property gets its own range of that array the first time it is set
+    // (which for generated effects is when the constructor sets the default
+    // values), and setting it again reuses the same range, so changing a
+    // property value does not allocate.  Interface-typed properties are held
+    // separately as IInspectable references.
+    //
+    // Each property also has a dirty bit, which is set whenever the property
+    // is written.  CanvasEffect uses these to track which values its D2D
+    // effect has yet to receive.
+    //
+    class EffectPropertyStorage
+    {
+    public:
+        enum class ValueType : uint8_t
+        {
+            None,
+            Boolean,
+            Int32,
+            UInt32,
+            Float,
+            FloatArray,
+            Inspectable
+        };
+
+        // The dirty bits are stored in a uint64_t.
+        static unsigned const MaxProperties = 64;
+
+    private:
+        struct Slot
+        {
+            ValueType Type;
+            uint32_t Offset;
+            uint32_t Size;
+            uint32_t Capacity;
+        };
+
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_values;
+        std::vector<ComPtr<IInspectable>> m_inspectables;
+        uint64_t m_dirtyMask;
+
+    public:
+        explicit EffectPropertyStorage(unsigned count);
+
+        unsigned GetCount() const
+        {
+            return static_cast<unsigned>(m_slots.size());
+        }
+
+        ValueType GetType(unsigned index) const;
+
+        void SetValue(unsigned index, boolean value);
+        void SetValue(unsigned index, int32_t value);
+        void SetValue(unsigned index, uint32_t value);
+        void SetValue(unsigned index, float value);
+        void SetValue(unsigned index, IInspectable* value);
+        void SetValues(unsigned index, uint32_t count, float const* values);
+
+        // Resizes a float array property and returns its storage, for the
+        // caller to fill in.
+        float* SetValues(unsigned index, uint32_t count);
+
+        // Integer values are converted between signed and unsigned if they
+        // fit, the same as IPropertyValue does.
+        void GetValue(unsigned index, boolean* value) const;
+        void GetValue(unsigned index, int32_t* value) const;
+        void GetValue(unsigned index, uint32_t* value) const;
+        void GetValue(unsigned index, float* value) const;
+        float const* GetValues(unsigned index, uint32_t* count) const;
+        ComPtr<IInspectable> GetInspectable(unsigned index) const;
+
+        template<typename T>
+        void GetValue(unsigned index, T** value) const
+        {
+            static_assert(std::is_base_of<IInspectable, T>::value, "Interface types must be IInspectable");
+
+            auto inspectable = GetInspectable(index);
+
+            if (inspectable)
+                ThrowIfFailed(inspectable.CopyTo(value));
+            else
+                *value = nullptr;
+        }
+
+        bool IsDirty(unsigned index) const;
+        bool HasDirtyValues() const { return m_dirtyMask != 0; }
+        void ClearDirty(unsigned index);
+        void ClearAllDirty() { m_dirtyMask = 0; }
+
+        // Used by IGraphicsEffectD2D1Interop::GetProperty.  Returns null for
+        // properties that have never been set.
+        ComPtr<IPropertyValue> Box(IPropertyValueStatics* factory, unsigned index) const;
+
+        // Describes every property value, for comparing whole sets of properties.
+        // Two stores holding the same values produce the same words, while
+        // interface-typed values are reported separately and compare by identity.
+        void GetValueKey(std::vector<uint32_t>* words, std::vector<ComPtr<IInspectable>>* inspectables) const;
+
+    private:
+        uint32_t* Allocate(unsigned index, ValueType type, uint32_t size);
+        Slot const& GetSlot(unsigned index) const;
+        uint32_t GetWord(unsigned index, ValueType type) const;
+    };
+}}}}}
@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "RealizedEffectCache.h"
+#include "utils/HashUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    //
+    // RealizedEffectKey implementation
+    //
+
+
+    size_t RealizedEffectKey::GetHash() const
+    {
+        size_t hash = HashValue(HashSeed, EffectId);
+
+        hash = HashBytes(hash, PropertyWords.data(), PropertyWords.size() * sizeof(uint32_t));
+        hash = HashValue(hash, CacheOutput);
+        hash = HashValue(hash, BufferPrecision);
+
+        for (auto& inspectable : PropertyInspectables)
+            hash = HashValue(hash, inspectable.Get());
+
+        for (auto source : Sources)
+            hash = HashValue(hash, source);
+
+        return hash;
+    }
+
+
+    bool RealizedEffectKey::operator==(RealizedEffectKey const& other) const
+    {
+        return IsEqualGUID(EffectId, other.EffectId) &&
+               PropertyWords == other.PropertyWords &&
+               PropertyInspectables == other.PropertyInspectables &&
+               CacheOutput == other.CacheOutput &&
+               BufferPrecision == other.BufferPrecision &&
+               Sources == other.Sources;
+    }
+
+
+    //
+    // RealizedEffectCache implementation
+    //
+
+
+    RealizedEffectCache::RealizedEffectCache()
+        : m_hitCount(0)
+        , m_missCount(0)
+    {
+    }
+
+
+    void RealizedEffectCache::Add(RealizedEffectKey&& key, RealizedEffect&& value)
+    {
+        assert(value.Effect);
+        assert(value.DpiCompensators.size() == key.Sources.size());
+
+        Lock lock(m_mutex);
+
+        auto hash = key.GetHash();
+
+        m_entries.AddToFront(hash, Entry{ std::move(key), std::move(value) });
+        m_entries.TrimToCount(MaxEntries);
+    }
+
+
+    bool RealizedEffectCache::Take(RealizedEffectKey const& key, RealizedEffect* value)
+    {
+        Lock lock(m_mutex);
+
+        auto entry = m_entries.Find(key.GetHash(), [&](Entry const& candidate) { return candidate.Key == key; });
+
+        if (entry == m_entries.end())
+        {
+            ++m_missCount;
+            return false;
+        }
+
+        ++m_hitCount;
+
+        *value = std::move(entry->Value.Effect);
+
+        m_entries.Remove(entry);
+
+        return true;
+    }
+
+
+    bool RealizedEffectCache::HasEffectsOfType(IID const& effectId)
+    {
+        Lock lock(m_mutex);
+
+        for (auto& entry : m_entries)
+        {
+            if (IsEqualGUID(entry.Value.Key.EffectId, effectId))
+                return true;
+        }
+
+        return false;
+    }
+
+
+    void RealizedEffectCache::Clear()
+    {
+        Lock lock(m_mutex);
+
+        m_entries.Clear();
+    }
+
+
+    size_t RealizedEffectCache::GetEntryCount()
+    {
+        Lock lock(m_mutex);
+        return m_entries.Size();
+    }
+
+
+    uint64_t RealizedEffectCache::GetHitCount()
+    {
+        Lock lock(m_mutex);
+        return m_hitCount;
+    }
+
+
+    uint64_t RealizedEffectCache::GetMissCount()
+    {
+        Lock lock(m_mutex);
+        return m_missCount;
+    }
+
+}}}}}
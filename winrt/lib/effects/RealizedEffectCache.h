@@ -0,0 +1,117 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+#include "utils/LruList.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    using namespace ::Microsoft::WRL;
+
+    //
+    // Everything that determines what a realized D2D effect draws: its type,
+    // property values, and the images it draws from.  Source images are
+    // compared by identity, before any DPI compensation is inserted.  An image
+    // always has the same DPI, so the same image needs the same compensation.
+    //
+    // Sources are not referenced by the key.  They are kept alive by the cached
+    // D2D effect, or by the caller while looking one up.
+    //
+    struct RealizedEffectKey
+    {
+        IID EffectId;
+        std::vector<uint32_t> PropertyWords;
+        std::vector<ComPtr<IInspectable>> PropertyInspectables;
+        bool CacheOutput;
+        D2D1_BUFFER_PRECISION BufferPrecision;
+        std::vector<IUnknown*> Sources;
+
+        size_t GetHash() const;
+
+        bool operator==(RealizedEffectKey const& other) const;
+    };
+
+
+    //
+    // A D2D effect along with the DPI compensation effects (if any) that sit
+    // between it and each of its sources.
+    //
+    struct RealizedEffect
+    {
+        ComPtr<ID2D1Effect> Effect;
+        std::vector<ComPtr<ID2D1Effect>> DpiCompensators;
+    };
+
+
+    //
+    // Each CanvasDevice owns one of these.  When a CanvasEffect is destroyed
+    // or closed, it leaves its D2D effect here, and a CanvasEffect realized
+    // later with the same key takes it back out rather than creating a new
+    // one.  This lets apps that rebuild the same effect graph every frame
+    // keep using the same D2D effects, along with any output D2D has cached
+    // for them.
+    //
+    // Unlike other caches, entries are never shared: Take removes them, as
+    // CanvasEffect goes on to change the properties and inputs of its D2D
+    // effect.  For the same reason CanvasEffect only adds effects that nothing
+    // outside Win2D could still be using (see CanvasEffect::RecycleResource).
+    //
+    // The cache holds up to MaxEntries effects, discarding the least recently
+    // added.  It is cleared when the device is trimmed, lost or closed.
+    //
+    class RealizedEffectCache
+    {
+        struct Entry
+        {
+            RealizedEffectKey Key;
+            RealizedEffect Effect;
+        };
+
+        typedef LruList<Entry> EntryList;
+
+        std::mutex m_mutex;
+
+        // Indexed by key hash; different keys may share a hash, and the same
+        // key may appear more than once.  Take does not reorder entries, so
+        // the front is the most recently added.
+        EntryList m_entries;
+
+        uint64_t m_hitCount;
+        uint64_t m_missCount;
+
+    public:
+        static uint32_t const MaxEntries = 64;
+
+        RealizedEffectCache();
+
+        RealizedEffectCache(RealizedEffectCache const&) = delete;
+        RealizedEffectCache& operator=(RealizedEffectCache const&) = delete;
+
+        //
+        // Takes ownership of an effect that its CanvasEffect has finished
+        // with.
+        //
+        void Add(RealizedEffectKey&& key, RealizedEffect&& value);
+
+        //
+        // Removes an effect matching key from the cache, passing ownership
+        // back to the caller.  Returns false if there is none.
+        //
+        bool Take(RealizedEffectKey const& key, RealizedEffect* value);
+
+        //
+        // Building a key means realizing the sources of an effect, so this
+        // cheaper check lets CanvasEffect skip that when it cannot pay off.
+        //
+        bool HasEffectsOfType(IID const& effectId);
+
+        void Clear();
+
+        size_t GetEntryCount();
+        uint64_t GetHitCount();
+        uint64_t GetMissCount();
+    };
+}}}}}
@@ -6,12 +6,18 @@
 #include "PixelShaderEffect.h"
 #include "PixelShaderEffectImpl.h"
 #include "SharedShaderState.h"
+#include "ShaderReflectionCache.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
 {
     ActivatableClassWithFactory(PixelShaderEffect, PixelShaderEffectFactory);
 
 
+    PixelShaderEffectFactory::PixelShaderEffectFactory()
+        : m_reflectionCache(ShaderReflectionCache::GetInstance())
+    { }
+
+
     IFACEMETHODIMP PixelShaderEffectFactory::Create(uint32_t shaderCodeCount, BYTE* shaderCode, IPixelShaderEffect** effect)
     {
         return ExceptionBoundary([&]
@@ -19,9 +25,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             CheckInPointer(shaderCode);
             CheckAndClearOutPointer(effect);
 
-            // Create a shared state object using the specified shader code.
-            auto sharedState = Make<SharedShaderState>(shaderCode, shaderCodeCount);
-            CheckMakeResult(sharedState);
+            // Create a shared state object using the specified shader code. This
+            // only reflects over the code the first time a given shader is seen.
+            auto sharedState = m_reflectionCache->CreateSharedState(shaderCode, shaderCodeCount);
 
             // Create the WinRT effect instance.
             auto newEffect = Make<PixelShaderEffect>(nullptr, nullptr, sharedState.Get());
@@ -310,6 +316,70 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
+    IFACEMETHODIMP PixelShaderEffect::GetPropertyIndex(HSTRING name, int32_t* index)
+    {
+        return ExceptionBoundary([&]
+        {
+            CheckInPointer(index);
+            ThrowIfPropertiesClosed();
+
+            *index = m_sharedState->GetPropertyIndex(name);
+        });
+    }
+
+
+    IFACEMETHODIMP PixelShaderEffect::SetPropertyValues(uint32_t nameCount, HSTRING* names, uint32_t valueCount, BYTE* values)
+    {
+        return ExceptionBoundary([&]
+        {
+            ThrowIfPropertiesClosed();
+
+            if (nameCount)
+                CheckInPointer(names);
+
+            if (valueCount)
+                CheckInPointer(values);
+
+            auto lock = Lock(m_mutex);
+
+            m_sharedState->SetPropertyValues(nameCount, names, valueCount, values);
+
+            // Pass the constant buffer on to Direct2D once for the whole batch.
+            SetD2DConstants();
+        });
+    }
+
+
+    IFACEMETHODIMP PixelShaderEffect::SetPropertyValuesByIndex(uint32_t indexCount, int32_t* indices, uint32_t valueCount, BYTE* values)
+    {
+        return ExceptionBoundary([&]
+        {
+            ThrowIfPropertiesClosed();
+
+            if (indexCount)
+                CheckInPointer(indices);
+
+            if (valueCount)
+                CheckInPointer(values);
+
+            auto lock = Lock(m_mutex);
+
+            m_sharedState->SetPropertyValuesByIndex(indexCount, indices, valueCount, values);
+
+            // Pass the constant buffer on to Direct2D once for the whole batch.
+            SetD2DConstants();
+        });
+    }
+
+
+    // Matches the behavior of the Properties map, which stops working when the effect is closed.
+    void PixelShaderEffect::ThrowIfPropertiesClosed()
+    {
+        if (!m_propertyMap->InternalMap())
+            ThrowHR(RO_E_CLOSED);
+    }
+
+
     HRESULT PixelShaderEffect::GetCoordinateMapping(unsigned index, SamplerCoordinateMapping* value)
     {
         assert(index < MaxShaderInputs);
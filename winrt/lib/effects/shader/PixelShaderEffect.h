@@ -7,6 +7,7 @@
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects 
 {
     class ISharedShaderState;
+    class ShaderReflectionCache;
 
     template<typename TKey, typename TValue> struct PixelShaderEffectPropertyMapTraits;
 
@@ -17,7 +18,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_Effects_PixelShaderEffect, BaseTrust);
 
+        std::shared_ptr<ShaderReflectionCache> m_reflectionCache;
+
     public:
+        PixelShaderEffectFactory();
+
         IFACEMETHOD(Create)(uint32_t shaderCodeCount, BYTE* shaderCode, IPixelShaderEffect** effect) override;
     };
 
@@ -85,6 +90,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         IFACEMETHOD(IsSupported)(ICanvasDevice* device, boolean* result) override;
 
+        IFACEMETHOD(GetPropertyIndex)(HSTRING name, int32_t* index) override;
+        IFACEMETHOD(SetPropertyValues)(uint32_t nameCount, HSTRING* names, uint32_t valueCount, BYTE* values) override;
+        IFACEMETHOD(SetPropertyValuesByIndex)(uint32_t indexCount, int32_t* indices, uint32_t valueCount, BYTE* values) override;
+
     protected:
         bool IsSupported(ICanvasDevice* device);
 
@@ -95,6 +104,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         void SetSource(unsigned int index, IGraphicsEffectSource* source);
 
         void SetProperty(HSTRING name, IInspectable* boxedValue);
+        void ThrowIfPropertiesClosed();
 
         HRESULT GetCoordinateMapping(unsigned index, SamplerCoordinateMapping* value);
         HRESULT SetCoordinateMapping(unsigned index, SamplerCoordinateMapping value);
@@ -18,7 +18,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             , Elements(type.Elements)
             , Size(desc.Size)
             , Offset(desc.StartOffset)
-        { }
+        {
+            ComputeComponentOffsets();
+        }
 
 
         WinString Name;
@@ -33,6 +35,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         unsigned Size;
         unsigned Offset;
 
+        // Constant buffer location (in 32 bit units) of each component, in the order used by the
+        // boxed property value. Worked out once here so that property accesses are a straight copy.
+        std::vector<unsigned> ComponentOffsets;
+
 
         unsigned ComponentCount() const
         {
@@ -54,6 +60,45 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                    Rows == rows &&
                    Columns == columns;
         }
+
+
+    private:
+        // Handles matrix row vs. column layout, and array element alignment.
+        void ComputeComponentOffsets()
+        {
+            const unsigned componentsPerRegister = 4;
+
+            unsigned elementSize = ((Class == D3D_SVC_MATRIX_COLUMNS) ? Columns : Rows) * componentsPerRegister;
+
+            ComponentOffsets.reserve(ComponentCount());
+
+            for (unsigned element = 0; element < std::max(Elements, 1u); element++)
+            {
+                for (unsigned row = 0; row < Rows; row++)
+                {
+                    for (unsigned column = 0; column < Columns; column++)
+                    {
+                        unsigned x = column;
+                        unsigned y = row;
+
+                        if (Class == D3D_SVC_MATRIX_COLUMNS)
+                        {
+                            std::swap(x, y);
+                        }
+
+                        unsigned constantIndex = (element * elementSize) + (y * componentsPerRegister) + x;
+
+                        // Sanity check (can only fail if the shader blob is corrupted).
+                        if (constantIndex >= Size / sizeof(uint32_t))
+                        {
+                            ThrowHR(E_UNEXPECTED);
+                        }
+
+                        ComponentOffsets.push_back(Offset / sizeof(uint32_t) + constantIndex);
+                    }
+                }
+            }
+        }
     };
 
 
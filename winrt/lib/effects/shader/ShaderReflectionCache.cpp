@@ -0,0 +1,123 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "ShaderReflectionCache.h"
+#include "utils/HashUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    ShaderReflectionCache::ShaderReflectionCache()
+        : m_hitCount(0)
+        , m_missCount(0)
+    {
+    }
+
+
+    ComPtr<ISharedShaderState> ShaderReflectionCache::CreateSharedState(BYTE const* shaderCode, uint32_t shaderCodeSize)
+    {
+        auto hash = HashBytes(HashSeed, shaderCode, shaderCodeSize);
+
+        auto prototype = Find(shaderCode, shaderCodeSize, hash);
+
+        if (!prototype)
+        {
+            auto newPrototype = Make<SharedShaderState>(shaderCode, shaderCodeSize);
+            CheckMakeResult(newPrototype);
+
+            prototype = Add(std::move(newPrototype), hash);
+        }
+
+        return prototype->Clone();
+    }
+
+
+    void ShaderReflectionCache::Clear()
+    {
+        Lock lock(m_mutex);
+
+        m_entries.Clear();
+    }
+
+
+    size_t ShaderReflectionCache::GetEntryCount()
+    {
+        Lock lock(m_mutex);
+        return m_entries.Size();
+    }
+
+
+    uint64_t ShaderReflectionCache::GetHitCount()
+    {
+        Lock lock(m_mutex);
+        return m_hitCount;
+    }
+
+
+    uint64_t ShaderReflectionCache::GetMissCount()
+    {
+        Lock lock(m_mutex);
+        return m_missCount;
+    }
+
+
+    ComPtr<SharedShaderState> ShaderReflectionCache::Find(BYTE const* shaderCode, uint32_t shaderCodeSize, size_t hash)
+    {
+        Lock lock(m_mutex);
+
+        auto entry = FindEntry(lock, shaderCode, shaderCodeSize, hash);
+
+        if (entry == m_entries.end())
+        {
+            ++m_missCount;
+            return nullptr;
+        }
+
+        ++m_hitCount;
+
+        // Move it to the front, since it has just been used
+        m_entries.MoveToFront(entry);
+
+        return entry->Value;
+    }
+
+
+    ComPtr<SharedShaderState> ShaderReflectionCache::Add(ComPtr<SharedShaderState>&& prototype, size_t hash)
+    {
+        Lock lock(m_mutex);
+
+        auto& code = prototype->Shader().Code;
+
+        // Another thread may have added the same shader while ours was being
+        // reflected
+        auto existing = FindEntry(lock, code.data(), static_cast<uint32_t>(code.size()), hash);
+        if (existing != m_entries.end())
+            return existing->Value;
+
+        m_entries.AddToFront(hash, prototype);
+        m_entries.TrimToCount(MaxEntries);
+
+        return std::move(prototype);
+    }
+
+
+    ShaderReflectionCache::EntryList::iterator ShaderReflectionCache::FindEntry(
+        Lock const& lock,
+        BYTE const* shaderCode,
+        uint32_t shaderCodeSize,
+        size_t hash)
+    {
+        MustOwnLock(lock);
+
+        return m_entries.Find(hash,
+            [=](ComPtr<SharedShaderState> const& prototype)
+            {
+                auto& code = prototype->Shader().Code;
+
+                return code.size() == shaderCodeSize &&
+                       (shaderCodeSize == 0 || memcmp(code.data(), shaderCode, shaderCodeSize) == 0);
+            });
+    }
+
+}}}}}
@@ -0,0 +1,68 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "SharedShaderState.h"
+#include "utils/LockUtilities.h"
+#include "utils/LruList.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    //
+    // Process-wide cache of reflected shaders, so that creating many
+    // PixelShaderEffect instances from the same shader code only hashes and
+    // reflects over that code once.
+    //
+    // For each distinct shader the cache keeps a SharedShaderState holding
+    // the results of reflection and the default constant buffer.  This is
+    // never handed out directly: callers get a clone, which shares the
+    // immutable ShaderDescription and copies the constants.
+    //
+    // The cache holds up to MaxEntries shaders, discarding the least recently
+    // used.  PixelShaderEffectFactory keeps the instance alive.
+    //
+    class ShaderReflectionCache : public Singleton<ShaderReflectionCache>
+    {
+        typedef LruList<ComPtr<SharedShaderState>> EntryList;
+
+        std::mutex m_mutex;
+
+        // Prototypes indexed by hash of their shader code; different code may
+        // share a hash
+        EntryList m_entries;
+
+        uint64_t m_hitCount;
+        uint64_t m_missCount;
+
+    public:
+        static uint32_t const MaxEntries = 64;
+
+        ShaderReflectionCache();
+
+        ShaderReflectionCache(ShaderReflectionCache const&) = delete;
+        ShaderReflectionCache& operator=(ShaderReflectionCache const&) = delete;
+
+        //
+        // Returns a new SharedShaderState for the specified shader code.
+        // Reflection happens without holding the lock, so if two threads race
+        // to add the same shader the second one to finish uses the first
+        // one's result.
+        //
+        ComPtr<ISharedShaderState> CreateSharedState(BYTE const* shaderCode, uint32_t shaderCodeSize);
+
+        void Clear();
+
+        size_t GetEntryCount();
+        uint64_t GetHitCount();
+        uint64_t GetMissCount();
+
+    private:
+        ComPtr<SharedShaderState> Find(BYTE const* shaderCode, uint32_t shaderCodeSize, size_t hash);
+        ComPtr<SharedShaderState> Add(ComPtr<SharedShaderState>&& prototype, size_t hash);
+
+        EntryList::iterator FindEntry(Lock const& lock, BYTE const* shaderCode, uint32_t shaderCodeSize, size_t hash);
+    };
+
+}}}}}
@@ -29,6 +29,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
 
     SharedShaderState::SharedShaderState(ShaderDescription const& shader, std::vector<BYTE> const& constants, CoordinateMappingState const& coordinateMapping, SourceInterpolationState const& sourceInterpolation)
+        : SharedShaderState(std::make_shared<ShaderDescription>(shader), constants, coordinateMapping, sourceInterpolation)
+    { }
+
+
+    SharedShaderState::SharedShaderState(std::shared_ptr<ShaderDescription const> const& shader, std::vector<BYTE> const& constants, CoordinateMappingState const& coordinateMapping, SourceInterpolationState const& sourceInterpolation)
         : m_shader(shader)
         , m_constants(constants)
         , m_coordinateMapping(coordinateMapping)
@@ -36,18 +41,22 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     { }
 
 
-    SharedShaderState::SharedShaderState(BYTE* shaderCode, uint32_t shaderCodeSize)
+    SharedShaderState::SharedShaderState(BYTE const* shaderCode, uint32_t shaderCodeSize)
     {
+        auto shader = std::make_shared<ShaderDescription>();
+
         // Store the shader program code.
-        m_shader.Code.assign(shaderCode, shaderCode + shaderCodeSize);
+        shader->Code.assign(shaderCode, shaderCode + shaderCodeSize);
 
         // Hash it to generate a unique ID.
         static const IID salt{ 0x489257f6, 0x6544, 0x4277, 0x89, 0x82, 0xea, 0xd1, 0x69, 0x39, 0x1f, 0x3d };
 
-        m_shader.Hash = GetVersion5Uuid(salt, shaderCode, shaderCodeSize);
+        shader->Hash = GetVersion5Uuid(salt, shaderCode, shaderCodeSize);
 
         // Look up shader metadata.
-        ReflectOverShader();
+        ReflectOverShader(*shader);
+
+        m_shader = shader;
     }
 
 
@@ -62,13 +71,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     unsigned SharedShaderState::GetPropertyCount()
     {
-        return static_cast<unsigned>(m_shader.Variables.size());
+        return static_cast<unsigned>(m_shader->Variables.size());
     }
 
 
     bool SharedShaderState::HasProperty(HSTRING name)
     {
-        return std::binary_search(m_shader.Variables.begin(), m_shader.Variables.end(), name, VariableNameComparison());
+        return std::binary_search(m_shader->Variables.begin(), m_shader->Variables.end(), name, VariableNameComparison());
     }
 
 
@@ -80,6 +89,30 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
+    // Scratch space for reading one property value. This lives on the stack unless the
+    // property is a large array, so reading properties does not allocate (besides boxing).
+    template<typename T>
+    class ComponentBuffer
+    {
+        static const unsigned StackSize = 16;   // Enough for a Matrix4x4.
+
+        T m_stackValues[StackSize];
+        std::vector<T> m_heapValues;
+        unsigned m_size;
+
+    public:
+        ComponentBuffer(unsigned size)
+            : m_size(size)
+        {
+            if (size > StackSize)
+                m_heapValues.resize(size);
+        }
+
+        T* data() { return (m_size > StackSize) ? m_heapValues.data() : m_stackValues; }
+        unsigned size() const { return m_size; }
+    };
+
+
     ComPtr<IInspectable> SharedShaderState::GetProperty(ShaderVariable const& variable)
     {
         ComPtr<IInspectable> result;
@@ -89,33 +122,33 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         case D3D_SVT_FLOAT:
             {
                 // It's a float, or a type comprised of floats (vector, matrix, and/or array).
-                std::vector<float> values(variable.ComponentCount());
+                ComponentBuffer<float> values(variable.ComponentCount());
 
                 CopyConstantData<CopyDirection::Read>(variable, values.data());
 
                 if (variable.IsVector(2))
                 {
-                    result = Box<Vector2>(variable, values);
+                    result = Box<Vector2>(variable, values.data(), values.size());
                 }
                 else if (variable.IsVector(3))
                 {
-                    result = Box<Vector3>(variable, values);
+                    result = Box<Vector3>(variable, values.data(), values.size());
                 }
                 else if (variable.IsVector(4))
                 {
-                    result = Box<Vector4>(variable, values);
+                    result = Box<Vector4>(variable, values.data(), values.size());
                 }
                 else if (variable.IsMatrix(3, 2))
                 {
-                    result = Box<Matrix3x2>(variable, values);
+                    result = Box<Matrix3x2>(variable, values.data(), values.size());
                 }
                 else if (variable.IsMatrix(4, 4))
                 {
-                    result = Box<Matrix4x4>(variable, values);
+                    result = Box<Matrix4x4>(variable, values.data(), values.size());
                 }
                 else
                 {
-                    result = Box<float>(variable, values);
+                    result = Box<float>(variable, values.data(), values.size());
                 }
             }
             break;
@@ -123,22 +156,22 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         case D3D_SVT_INT:
             {
                 // Integer, or vector/matrix/arrays thereof.
-                std::vector<int> values(variable.ComponentCount());
+                ComponentBuffer<int> values(variable.ComponentCount());
 
                 CopyConstantData<CopyDirection::Read>(variable, values.data());
 
-                result = Box<int>(variable, values);
+                result = Box<int>(variable, values.data(), values.size());
             }
             break;
 
         case D3D_SVT_BOOL:
             {
                 // Bool, or vector/matrix/arrays thereof.
-                std::vector<boolean> values(variable.ComponentCount());
+                ComponentBuffer<boolean> values(variable.ComponentCount());
 
                 CopyConstantData<CopyDirection::Read>(variable, values.data());
 
-                result = Box<bool>(variable, values);
+                result = Box<bool>(variable, values.data(), values.size());
             }
             break;
 
@@ -210,9 +243,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         std::vector<StringObjectPair> properties;
 
-        properties.reserve(m_shader.Variables.size());
+        properties.reserve(m_shader->Variables.size());
 
-        for (auto& variable : m_shader.Variables)
+        for (auto& variable : m_shader->Variables)
         {
             properties.emplace_back(variable.Name, GetProperty(variable));
         }
@@ -225,9 +258,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         VariableNameComparison comparison;
 
-        auto it = std::lower_bound(m_shader.Variables.begin(), m_shader.Variables.end(), name, comparison);
+        auto it = std::lower_bound(m_shader->Variables.begin(), m_shader->Variables.end(), name, comparison);
 
-        if (it == m_shader.Variables.end() || comparison(name, *it))
+        if (it == m_shader->Variables.end() || comparison(name, *it))
         {
             WinStringBuilder message;
             message.Format(Strings::CustomEffectUnknownProperty, WindowsGetStringRawBuffer(name, nullptr));
@@ -238,6 +271,74 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
+    ShaderVariable const& SharedShaderState::GetVariable(int32_t index)
+    {
+        if (index < 0 || static_cast<size_t>(index) >= m_shader->Variables.size())
+            ThrowHR(E_BOUNDS);
+
+        return m_shader->Variables[index];
+    }
+
+
+    int32_t SharedShaderState::GetPropertyIndex(HSTRING name)
+    {
+        auto& variable = FindVariable(name);
+
+        return static_cast<int32_t>(&variable - m_shader->Variables.data());
+    }
+
+
+    void SharedShaderState::SetPropertyValues(uint32_t nameCount, HSTRING const* names, uint32_t valueSize, BYTE const* values)
+    {
+        SetPackedValues(nameCount, [&](uint32_t i) -> ShaderVariable const& { return FindVariable(names[i]); }, valueSize, values);
+    }
+
+
+    void SharedShaderState::SetPropertyValuesByIndex(uint32_t indexCount, int32_t const* indices, uint32_t valueSize, BYTE const* values)
+    {
+        SetPackedValues(indexCount, [&](uint32_t i) -> ShaderVariable const& { return GetVariable(indices[i]); }, valueSize, values);
+    }
+
+
+    // Copies packed values for several properties into the constant buffer. Each property
+    // takes one 32 bit float or int per component, in the same order as its boxed value.
+    // Nothing is changed unless all the properties are valid and the size matches.
+    template<typename TLookup>
+    void SharedShaderState::SetPackedValues(uint32_t count, TLookup&& lookupVariable, uint32_t valueSize, BYTE const* values)
+    {
+        size_t expectedSize = 0;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            expectedSize += lookupVariable(i).ComponentOffsets.size() * sizeof(uint32_t);
+        }
+
+        if (valueSize != expectedSize)
+        {
+            WinStringBuilder message;
+            message.Format(Strings::CustomEffectWrongPackedValueSize, static_cast<int>(expectedSize));
+            ThrowHR(E_INVALIDARG, message.Get());
+        }
+
+        auto constantBuffer = reinterpret_cast<uint32_t*>(m_constants.data());
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto& variable = lookupVariable(i);
+            bool isBool = (variable.Type == D3D_SVT_BOOL);
+
+            for (auto offset : variable.ComponentOffsets)
+            {
+                uint32_t value;
+                memcpy(&value, values, sizeof(value));
+                values += sizeof(value);
+
+                constantBuffer[offset] = isBool ? !!value : value;
+            }
+        }
+    }
+
+
     // For formatting error message strings.
     template<typename T> wchar_t const* PropertyTypeName() { static_assert(false, "missing specialization"); }
 
@@ -267,14 +368,14 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     // Transfers a property from constant buffer format to a boxed IInspectable.
     template<typename TBoxed, typename TComponent>
-    ComPtr<IInspectable> SharedShaderState::Box(ShaderVariable const& variable, std::vector<TComponent> const& values)
+    ComPtr<IInspectable> SharedShaderState::Box(ShaderVariable const& variable, TComponent const* values, unsigned valueCount)
     {
         typedef Nullable<TBoxed>::T_abi TBoxed_abi;
 
         ComPtr<IInspectable> result;
 
-        auto boxedValueCount = values.size() * sizeof(TComponent) / sizeof(TBoxed_abi);
-        auto asBoxed = reinterpret_cast<TBoxed_abi const*>(values.data());
+        auto boxedValueCount = valueCount * sizeof(TComponent) / sizeof(TBoxed_abi);
+        auto asBoxed = reinterpret_cast<TBoxed_abi const*>(values);
 
         if (boxedValueCount == 1 && !variable.Elements)
         {
@@ -410,7 +511,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     // Generic helper used by both the property get and set implementations.
     // Transfers a property value in either direction between the constant buffer
     // and an array of individual component values, handling type conversions
-    // (boolean <-> int), matrix row vs. column layout, and array element alignment.
+    // (boolean <-> int). Matrix layout and array element alignment are already
+    // accounted for by the variable's precomputed ComponentOffsets.
     template<CopyDirection Direction, typename TComponent>
     void SharedShaderState::CopyConstantData(ShaderVariable const& variable, TComponent* values)
     {
@@ -419,53 +521,23 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         
         Transferer transferFunction;
 
-        // Look up our region of the constant buffer.
-        auto constantBuffer = reinterpret_cast<Transferer::TConstant*>(m_constants.data() + variable.Offset);
-
-        // Compute the size of a single array element.
-        const unsigned componentsPerRegister = 4;
+        auto constantBuffer = reinterpret_cast<Transferer::TConstant*>(m_constants.data());
 
-        unsigned elementSize = ((variable.Class == D3D_SVC_MATRIX_COLUMNS) ? variable.Columns : variable.Rows) * componentsPerRegister;
+        auto& offsets = variable.ComponentOffsets;
 
-        unsigned valueIndex = 0;
-
-        for (unsigned element = 0; element < std::max(variable.Elements, 1u); element++)
+        for (size_t i = 0; i < offsets.size(); i++)
         {
-            for (unsigned row = 0; row < variable.Rows; row++)
-            {
-                for (unsigned column = 0; column < variable.Columns; column++)
-                {
-                    // Where is this component located in the constant buffer?
-                    unsigned x = column;
-                    unsigned y = row;
-
-                    if (variable.Class == D3D_SVC_MATRIX_COLUMNS)
-                    {
-                        std::swap(x, y);
-                    }
-
-                    unsigned constantIndex = (element * elementSize) + (y * componentsPerRegister) + x;
-
-                    // Sanity check (can only fail if the shader blob is corrupted or my code is horribly buggy).
-                    if (constantIndex >= variable.Size / sizeof(Transferer::TConstant))
-                    {
-                        ThrowHR(E_UNEXPECTED);
-                    }
-
-                    // Read or write this component value.
-                    transferFunction(constantBuffer[constantIndex], values[valueIndex++]);
-                }
-            }
+            transferFunction(constantBuffer[offsets[i]], values[i]);
         }
     }
 
 
-    void SharedShaderState::ReflectOverShader()
+    void SharedShaderState::ReflectOverShader(ShaderDescription& shader)
     {
         // Create the shader reflection interface.
         ComPtr<ID3D11ShaderReflection> reflector;
 
-        HRESULT hr = D3DReflect(m_shader.Code.data(), m_shader.Code.size(), IID_PPV_ARGS(&reflector));
+        HRESULT hr = D3DReflect(shader.Code.data(), shader.Code.size(), IID_PPV_ARGS(&reflector));
 
         if (FAILED(hr))
             ThrowHR(E_INVALIDARG, Strings::CustomEffectBadShader);
@@ -484,25 +556,25 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         }
 
         // Examine the input bindings.
-        ReflectOverBindings(reflector.Get(), desc);
+        ReflectOverBindings(shader, reflector.Get(), desc);
 
         // Store the mapping from named constants to buffer locations.
         if (desc.ConstantBuffers)
         {
-            ReflectOverConstantBuffer(reflector->GetConstantBufferByIndex(0));
+            ReflectOverConstantBuffer(shader, reflector->GetConstantBufferByIndex(0));
         }
 
         // Grab some other metadata.
-        m_shader.InstructionCount = desc.InstructionCount;
+        shader.InstructionCount = desc.InstructionCount;
 
-        ThrowIfFailed(reflector->GetMinFeatureLevel(&m_shader.MinFeatureLevel));
+        ThrowIfFailed(reflector->GetMinFeatureLevel(&shader.MinFeatureLevel));
 
         // If this shader was compiled to support shader linking, we can also determine which inputs are simple vs. complex.
-        ReflectOverShaderLinkingFunction();
+        ReflectOverShaderLinkingFunction(shader);
     }
 
 
-    void SharedShaderState::ReflectOverBindings(ID3D11ShaderReflection* reflector, D3D11_SHADER_DESC const& desc)
+    void SharedShaderState::ReflectOverBindings(ShaderDescription& shader, ID3D11ShaderReflection* reflector, D3D11_SHADER_DESC const& desc)
     {
         for (unsigned i = 0; i < desc.BoundResources; i++)
         {
@@ -516,7 +588,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                     ThrowHR(E_INVALIDARG, Strings::CustomEffectTooManyTextures);
 
                 // Record how many input textures this shader uses.
-                m_shader.InputCount = std::max(m_shader.InputCount, inputDesc.BindPoint + 1);
+                shader.InputCount = std::max(shader.InputCount, inputDesc.BindPoint + 1);
                 break;
 
             case D3D_SIT_CBUFFER:
@@ -529,7 +601,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
-    void SharedShaderState::ReflectOverConstantBuffer(ID3D11ShaderReflectionConstantBuffer* constantBuffer)
+    void SharedShaderState::ReflectOverConstantBuffer(ShaderDescription& shader, ID3D11ShaderReflectionConstantBuffer* constantBuffer)
     {
         D3D11_SHADER_BUFFER_DESC desc;
         ThrowIfFailed(constantBuffer->GetDesc(&desc));
@@ -538,15 +610,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         m_constants.resize(desc.Size);
 
         // Look up variable metadata.
-        m_shader.Variables.reserve(desc.Variables);
+        shader.Variables.reserve(desc.Variables);
 
         for (unsigned i = 0; i < desc.Variables; i++)
         {
-            ReflectOverVariable(constantBuffer->GetVariableByIndex(i));
+            ReflectOverVariable(shader, constantBuffer->GetVariableByIndex(i));
         }
 
         // Sort the variables by name.
-        std::sort(m_shader.Variables.begin(), m_shader.Variables.end(), VariableNameComparison());
+        std::sort(shader.Variables.begin(), shader.Variables.end(), VariableNameComparison());
     }
 
 
@@ -629,7 +701,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
-    void SharedShaderState::ReflectOverVariable(ID3D11ShaderReflectionVariable* variable)
+    void SharedShaderState::ReflectOverVariable(ShaderDescription& shader, ID3D11ShaderReflectionVariable* variable)
     {
         D3D11_SHADER_VARIABLE_DESC desc;
         ThrowIfFailed(variable->GetDesc(&desc));
@@ -664,11 +736,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         }
 
         // Store metadata about this variable.
-        m_shader.Variables.emplace_back(desc, type);
+        shader.Variables.emplace_back(desc, type);
     }
 
 
-    void SharedShaderState::ReflectOverShaderLinkingFunction()
+    void SharedShaderState::ReflectOverShaderLinkingFunction(ShaderDescription const& shader)
     {
         // If this shader was compiled to support shader linking, we can get extra information
         // (telling us which inputs are simple vs. complex) from the shader linking function.
@@ -676,7 +748,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         // It's valid to use shaders that don't support linking, so we return on failure rather than throwing.
         ComPtr<ID3DBlob> privateData;
 
-        if (FAILED(D3DGetBlobPart(m_shader.Code.data(), m_shader.Code.size(), D3D_BLOB_PRIVATE_DATA, 0, &privateData)))
+        if (FAILED(D3DGetBlobPart(shader.Code.data(), shader.Code.size(), D3D_BLOB_PRIVATE_DATA, 0, &privateData)))
             return;
 
         ComPtr<ID3D11LibraryReflection> reflector;
@@ -62,24 +62,31 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         virtual ComPtr<IInspectable> GetProperty(HSTRING name) = 0;
         virtual void SetProperty(HSTRING name, IInspectable* boxedValue) = 0;
         virtual std::vector<StringObjectPair> EnumerateProperties() = 0;
+
+        // Bulk property setters, which take packed 32 bit component values.
+        virtual int32_t GetPropertyIndex(HSTRING name) = 0;
+        virtual void SetPropertyValues(uint32_t nameCount, HSTRING const* names, uint32_t valueSize, BYTE const* values) = 0;
+        virtual void SetPropertyValuesByIndex(uint32_t indexCount, int32_t const* indices, uint32_t valueSize, BYTE const* values) = 0;
     };
     
 
     class SharedShaderState : public RuntimeClass<RuntimeClassFlags<ClassicCom>, ISharedShaderState>
                             , private LifespanTracker<SharedShaderState>
     {
-        ShaderDescription m_shader;
+        // Immutable after reflection, so clones share it rather than copying.
+        std::shared_ptr<ShaderDescription const> m_shader;
         std::vector<BYTE> m_constants;
         CoordinateMappingState m_coordinateMapping;
         SourceInterpolationState m_sourceInterpolation;
 
     public:
         SharedShaderState(ShaderDescription const& shader, std::vector<BYTE> const& constants, CoordinateMappingState const& coordinateMapping, SourceInterpolationState const& sourceInterpolation);
-        SharedShaderState(BYTE* shaderCode, uint32_t shaderCodeSize);
+        SharedShaderState(std::shared_ptr<ShaderDescription const> const& shader, std::vector<BYTE> const& constants, CoordinateMappingState const& coordinateMapping, SourceInterpolationState const& sourceInterpolation);
+        SharedShaderState(BYTE const* shaderCode, uint32_t shaderCodeSize);
 
         virtual ComPtr<ISharedShaderState> Clone() override;
 
-        virtual ShaderDescription const& Shader() override { return m_shader; }
+        virtual ShaderDescription const& Shader() override { return *m_shader; }
         virtual std::vector<BYTE> const& Constants() override { return m_constants; }
         virtual CoordinateMappingState& CoordinateMapping() override { return m_coordinateMapping; }
         virtual SourceInterpolationState& SourceInterpolation() { return m_sourceInterpolation; }
@@ -91,14 +98,23 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         virtual void SetProperty(HSTRING name, IInspectable* boxedValue) override;
         virtual std::vector<StringObjectPair> EnumerateProperties() override;
 
+        // Bulk property setters.
+        virtual int32_t GetPropertyIndex(HSTRING name) override;
+        virtual void SetPropertyValues(uint32_t nameCount, HSTRING const* names, uint32_t valueSize, BYTE const* values) override;
+        virtual void SetPropertyValuesByIndex(uint32_t indexCount, int32_t const* indices, uint32_t valueSize, BYTE const* values) override;
+
     private:
         ComPtr<IInspectable> GetProperty(ShaderVariable const& variable);
         ShaderVariable const& FindVariable(HSTRING name);
+        ShaderVariable const& GetVariable(int32_t index);
+
+        template<typename TLookup>
+        void SetPackedValues(uint32_t count, TLookup&& lookupVariable, uint32_t valueSize, BYTE const* values);
 
 
         // Transfer property values between constant buffer and boxed IInspectable formats.
         template<typename TBoxed, typename TComponent>
-        static ComPtr<IInspectable> Box(ShaderVariable const& variable, std::vector<TComponent> const& values);
+        static ComPtr<IInspectable> Box(ShaderVariable const& variable, TComponent const* values, unsigned valueCount);
 
         template<typename TBoxed, typename TComponent = TBoxed>
         void Unbox(ShaderVariable const& variable, IInspectable* boxedValue);
@@ -108,11 +124,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
 
         // Shader reflection (done at init time).
-        void ReflectOverShader();
-        void ReflectOverBindings(ID3D11ShaderReflection* reflector, D3D11_SHADER_DESC const& desc);
-        void ReflectOverConstantBuffer(ID3D11ShaderReflectionConstantBuffer* constantBuffer);
-        void ReflectOverVariable(ID3D11ShaderReflectionVariable* variable);
-        void ReflectOverShaderLinkingFunction();
+        void ReflectOverShader(ShaderDescription& shader);
+        void ReflectOverBindings(ShaderDescription& shader, ID3D11ShaderReflection* reflector, D3D11_SHADER_DESC const& desc);
+        void ReflectOverConstantBuffer(ShaderDescription& shader, ID3D11ShaderReflectionConstantBuffer* constantBuffer);
+        void ReflectOverVariable(ShaderDescription& shader, ID3D11ShaderReflectionVariable* variable);
+        void ReflectOverShaderLinkingFunction(ShaderDescription const& shader);
     };
 
 }}}}}
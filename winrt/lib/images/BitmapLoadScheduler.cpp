@@ -0,0 +1,252 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "BitmapLoadScheduler.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    using namespace ABI::Windows::System::Threading;
+    using namespace ::Microsoft::WRL::Wrappers;
+
+    BitmapLoadScheduler::RunAsyncFunction const BitmapLoadScheduler::RunOnThreadPool =
+        [](std::function<void()>&& work)
+        {
+            ComPtr<IThreadPoolStatics> threadPool;
+            ThrowIfFailed(GetActivationFactory(HStringReference(RuntimeClass_Windows_System_Threading_ThreadPool).Get(), &threadPool));
+
+            auto workItem = Callback<AddFtmBase<IWorkItemHandler>::Type>(
+                [work](IAsyncAction*)
+                {
+                    work();
+                    return S_OK;
+                });
+            CheckMakeResult(workItem);
+
+            ComPtr<IAsyncAction> action;
+            ThrowIfFailed(threadPool->RunAsync(workItem.Get(), &action));
+        };
+
+
+    BitmapLoadScheduler::BitmapLoadScheduler(uint32_t workerCount, RunAsyncFunction runAsync)
+        : m_runAsync(runAsync)
+        , m_workerCount(workerCount)
+        , m_nextSequence(0)
+        , m_activeDecoderCount(0)
+        , m_uploaderIsActive(false)
+        , m_closed(false)
+    {
+        assert(workerCount > 0);
+    }
+
+
+    void BitmapLoadScheduler::Enqueue(int32_t priority, DecodeFunction&& decode, AbandonFunction&& abandon)
+    {
+        Lock lock(m_mutex);
+
+        if (m_closed)
+        {
+            lock.unlock();
+            abandon();
+            return;
+        }
+
+        auto sequence = m_nextSequence++;
+
+        m_decodeQueue.push_back(Job{ priority, sequence, std::move(decode), std::move(abandon) });
+        std::push_heap(m_decodeQueue.begin(), m_decodeQueue.end(), RunsAfter);
+
+        try
+        {
+            StartWorkers(lock);
+        }
+        catch (...)
+        {
+            //
+            // If a decoder that was already running has taken the job then
+            // it will finish normally.  Otherwise nothing may ever run it, so
+            // it is taken back out and the caller sees the failure instead.
+            //
+
+            lock.lock();
+
+            auto it = std::find_if(m_decodeQueue.begin(), m_decodeQueue.end(),
+                [=] (Job const& job)
+                {
+                    return job.Sequence == sequence;
+                });
+
+            if (it == m_decodeQueue.end())
+                return;
+
+            m_decodeQueue.erase(it);
+            std::make_heap(m_decodeQueue.begin(), m_decodeQueue.end(), RunsAfter);
+
+            throw;
+        }
+    }
+
+
+    void BitmapLoadScheduler::Close()
+    {
+        std::vector<Job> abandonedJobs;
+
+        {
+            Lock lock(m_mutex);
+
+            m_closed = true;
+            std::swap(abandonedJobs, m_decodeQueue);
+        }
+
+        for (auto& job : abandonedJobs)
+        {
+            job.Abandon();
+        }
+    }
+
+
+    size_t BitmapLoadScheduler::GetPendingCount()
+    {
+        Lock lock(m_mutex);
+        return m_decodeQueue.size();
+    }
+
+
+    bool BitmapLoadScheduler::RunsAfter(Job const& a, Job const& b)
+    {
+        if (a.Priority != b.Priority)
+            return a.Priority < b.Priority;
+
+        return a.Sequence > b.Sequence;
+    }
+
+
+    bool BitmapLoadScheduler::DecoderHasWork(Lock const& lock)
+    {
+        MustOwnLock(lock);
+
+        return !m_decodeQueue.empty() && m_uploadQueue.size() < m_workerCount;
+    }
+
+
+    void BitmapLoadScheduler::StartWorkers(Lock& lock)
+    {
+        MustOwnLock(lock);
+
+        uint32_t decodersToStart = 0;
+
+        if (DecoderHasWork(lock))
+        {
+            auto idleDecoderCount = m_workerCount - m_activeDecoderCount;
+            decodersToStart = static_cast<uint32_t>(std::min<size_t>(idleDecoderCount, m_decodeQueue.size()));
+        }
+
+        bool startUploader = !m_uploaderIsActive && !m_uploadQueue.empty();
+
+        m_activeDecoderCount += decodersToStart;
+
+        if (startUploader)
+            m_uploaderIsActive = true;
+
+        lock.unlock();
+
+        uint32_t decodersStarted = 0;
+        bool uploaderStarted = false;
+
+        try
+        {
+            auto self = shared_from_this();
+
+            for (; decodersStarted < decodersToStart; decodersStarted++)
+            {
+                m_runAsync([self] { self->RunDecoder(); });
+            }
+
+            if (startUploader)
+            {
+                m_runAsync([self] { self->RunUploader(); });
+                uploaderStarted = true;
+            }
+        }
+        catch (...)
+        {
+            // Otherwise the workers that never started would be counted as
+            // active forever, and no more would be started to replace them.
+            lock.lock();
+
+            m_activeDecoderCount -= decodersToStart - decodersStarted;
+
+            if (startUploader && !uploaderStarted)
+                m_uploaderIsActive = false;
+
+            lock.unlock();
+            throw;
+        }
+    }
+
+
+    void BitmapLoadScheduler::TryStartWorkers(Lock& lock)
+    {
+        try
+        {
+            StartWorkers(lock);
+        }
+        catch (...)
+        {
+            // The caller keeps working through the queues, and tries again
+            // each time it finishes a job.
+        }
+    }
+
+
+    void BitmapLoadScheduler::RunDecoder()
+    {
+        Lock lock(m_mutex);
+
+        while (DecoderHasWork(lock))
+        {
+            std::pop_heap(m_decodeQueue.begin(), m_decodeQueue.end(), RunsAfter);
+            auto job = std::move(m_decodeQueue.back());
+            m_decodeQueue.pop_back();
+
+            lock.unlock();
+
+            auto upload = job.Decode();
+
+            if (upload)
+            {
+                lock.lock();
+                m_uploadQueue.push(std::move(upload));
+                TryStartWorkers(lock);
+            }
+
+            lock.lock();
+        }
+
+        --m_activeDecoderCount;
+    }
+
+
+    void BitmapLoadScheduler::RunUploader()
+    {
+        Lock lock(m_mutex);
+
+        while (!m_uploadQueue.empty())
+        {
+            auto upload = std::move(m_uploadQueue.front());
+            m_uploadQueue.pop();
+
+            // That made room for another decoded image, so a decoder that
+            // stopped to wait for the uploader may need restarting.
+            TryStartWorkers(lock);
+
+            upload();
+
+            lock.lock();
+        }
+
+        m_uploaderIsActive = false;
+    }
+}}}}
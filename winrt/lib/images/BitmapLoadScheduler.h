@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Runs the two stages of CanvasBitmapLoader with bounded concurrency.
+    //
+    // Jobs are decoded by up to WorkerCount decoders, highest priority first
+    // (and in the order they were added, among equals).  Each decode returns
+    // an upload, and uploads are run one at a time by a single uploader, so
+    // they do not fight each other for the device while decoders carry on
+    // with the next jobs.  Decoders stop taking jobs while WorkerCount
+    // decoded images are waiting for the uploader.  Up to WorkerCount more
+    // may be part way through decoding when that happens, and the uploader
+    // holds one more, so at most 2 x WorkerCount + 1 decoded images are in
+    // memory at once.
+    //
+    // Decoders and the uploader are started through RunAsync, which
+    // normally queues them on the thread pool.  Each keeps going until it
+    // runs out of work.  None of the stage functions may throw.  If RunAsync
+    // throws from Enqueue, and no running decoder has already taken the new
+    // job, the job is dropped and the exception passed on to the caller.
+    //
+    class BitmapLoadScheduler : public std::enable_shared_from_this<BitmapLoadScheduler>
+    {
+    public:
+        typedef std::function<void()> UploadFunction;
+
+        // Returns null if there is nothing to upload (eg. the decode failed).
+        typedef std::function<UploadFunction()> DecodeFunction;
+
+        // Called instead of the decode function for jobs dropped by Close.
+        typedef std::function<void()> AbandonFunction;
+
+        // Must not run the work before it returns.
+        typedef std::function<void(std::function<void()>&&)> RunAsyncFunction;
+
+        static RunAsyncFunction const RunOnThreadPool;
+
+    private:
+        struct Job
+        {
+            int32_t Priority;
+            uint64_t Sequence;
+            DecodeFunction Decode;
+            AbandonFunction Abandon;
+        };
+
+        std::mutex m_mutex;
+
+        RunAsyncFunction m_runAsync;
+        uint32_t m_workerCount;
+
+        // A heap, with the next job to decode at the front
+        std::vector<Job> m_decodeQueue;
+        uint64_t m_nextSequence;
+
+        std::queue<UploadFunction> m_uploadQueue;
+
+        uint32_t m_activeDecoderCount;
+        bool m_uploaderIsActive;
+        bool m_closed;
+
+    public:
+        BitmapLoadScheduler(uint32_t workerCount, RunAsyncFunction runAsync);
+
+        BitmapLoadScheduler(BitmapLoadScheduler const&) = delete;
+        BitmapLoadScheduler& operator=(BitmapLoadScheduler const&) = delete;
+
+        void Enqueue(int32_t priority, DecodeFunction&& decode, AbandonFunction&& abandon);
+
+        //
+        // Abandons every job that has not started decoding.  Decodes that
+        // are under way, and their uploads, still run.
+        //
+        void Close();
+
+        uint32_t GetWorkerCount() const { return m_workerCount; }
+
+        // How many jobs are waiting to be decoded.
+        size_t GetPendingCount();
+
+    private:
+        static bool RunsAfter(Job const& a, Job const& b);
+
+        // Starts as many decoders, and the uploader, as there is work for.
+        // Returns, or throws, with the lock released.  If RunAsync throws,
+        // the workers that weren't started are no longer counted as active.
+        void StartWorkers(Lock& lock);
+
+        // For running workers, which can carry on even if no more start.
+        void TryStartWorkers(Lock& lock);
+
+        bool DecoderHasWork(Lock const& lock);
+
+        void RunDecoder();
+        void RunUploader();
+    };
+}}}}
@@ -5,6 +5,9 @@
 #include "pch.h"
 #include <propkey.h>
 
+#include "utils/PixelConversion.h"
+#include "CanvasBitmapPixelLock.h"
+
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
     using namespace ABI::Windows::Storage::Streams;
@@ -230,17 +233,135 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         }
     }
 
+    static ComPtr<IWICBitmapSource> ApplyExifTransform(CanvasBitmapAdapter* adapter, WicBitmapSource const& source)
+    {
+        if (source.Transform == WICBitmapTransformRotate0)
+            return source.Source;
+
+        return adapter->CreateFlipRotator(source.Source, source.Transform);        
+    }
+
     template<typename T>
     static ComPtr<IWICBitmapSource> CreateWicBitmapSourceWithExifTransform(ICanvasDevice* device, T fileNameOrStream)
     {
         auto adapter = CanvasBitmapAdapter::GetInstance();
 
-        auto source = adapter->CreateWicBitmapSource(device, fileNameOrStream);
+        return ApplyExifTransform(adapter.get(), adapter->CreateWicBitmapSource(device, fileNameOrStream));
+    }
 
-        if (source.Transform == WICBitmapTransformRotate0)
-            return source.Source;
+    static uint64_t MakeUint64(uint32_t high, uint32_t low)
+    {
+        return (static_cast<uint64_t>(high) << 32) | low;
+    }
 
-        return adapter->CreateFlipRotator(source.Source, source.Transform);        
+    //
+    // Identifies an image file for DecodedBitmapCache.  Returns false if the
+    // file cannot be identified, in which case it is loaded without the cache.
+    //
+    static bool TryGetDecodedBitmapKey(HSTRING fileName, DecodedBitmapKey* key)
+    {
+        WinString fileNameString(fileName);
+        auto name = static_cast<wchar_t const*>(fileNameString);
+
+        auto length = GetFullPathNameW(name, 0, nullptr, nullptr);
+        if (length == 0)
+            return false;
+
+        std::wstring fullPath(length, L'\0');
+
+        length = GetFullPathNameW(name, length, &fullPath[0], nullptr);
+        if (length == 0 || length >= fullPath.size())
+            return false;
+
+        fullPath.resize(length);
+
+        // File names are case insensitive.
+        std::transform(fullPath.begin(), fullPath.end(), fullPath.begin(), [](wchar_t c) { return static_cast<wchar_t>(towlower(c)); });
+
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExW(fullPath.c_str(), GetFileExInfoStandard, &attributes))
+            return false;
+
+        key->Name = std::move(fullPath);
+        key->Size = MakeUint64(attributes.nFileSizeHigh, attributes.nFileSizeLow);
+        key->LastWriteTime = MakeUint64(attributes.ftLastWriteTime.dwHighDateTime, attributes.ftLastWriteTime.dwLowDateTime);
+
+        return true;
+    }
+
+    static bool TryGetDecodedBitmapKey(IUriRuntimeClass* uri, IStream* stream, DecodedBitmapKey* key)
+    {
+        WinString canonicalUri;
+        ThrowIfFailed(uri->get_AbsoluteCanonicalUri(canonicalUri.GetAddressOf()));
+
+        // Not every stream knows when it was last written (eg. ms-appx ones
+        // may not).  Without that a rewritten file could match a stale entry,
+        // so those streams aren't cached.
+        STATSTG stat;
+        if (FAILED(stream->Stat(&stat, STATFLAG_NONAME)))
+            return false;
+
+        if (stat.mtime.dwHighDateTime == 0 && stat.mtime.dwLowDateTime == 0)
+            return false;
+
+        key->Name = static_cast<wchar_t const*>(canonicalUri);
+        key->Size = stat.cbSize.QuadPart;
+        key->LastWriteTime = MakeUint64(stat.mtime.dwHighDateTime, stat.mtime.dwLowDateTime);
+
+        return true;
+    }
+
+    //
+    // Looks the image up in DecodedBitmapCache, decoding and adding it if
+    // it is not there.  Only images that decode to 32bppPBGRA are cached.
+    // Block compressed DDS frames are copied to the GPU as they are.
+    // Extended range images are never cached, even when converted to
+    // 32bppPBGRA, since a device that supports their format would decode
+    // them differently.  Images too big for the cache are not decoded into
+    // memory, since the copy would be thrown away straight after the upload.
+    //
+    template<typename T>
+    static ComPtr<IWICBitmapSource> CreateWicBitmapSourceWithCache(
+        ICanvasDevice* device,
+        T fileNameOrStream,
+        DecodedBitmapCache* cache,
+        DecodedBitmapKey const& key)
+    {
+        if (auto cachedSource = cache->TryGet(key))
+            return cachedSource;
+
+        auto adapter = CanvasBitmapAdapter::GetInstance();
+
+        auto wicBitmapSource = adapter->CreateWicBitmapSource(device, fileNameOrStream);
+
+        auto source = ApplyExifTransform(adapter.get(), wicBitmapSource);
+
+        if (wicBitmapSource.IsDeviceDependent)
+            return source;
+
+        if (MaybeAs<IWICDdsFrameDecode>(source))
+            return source;
+
+        GUID pixelFormat;
+        ThrowIfFailed(source->GetPixelFormat(&pixelFormat));
+
+        if (pixelFormat != GUID_WICPixelFormat32bppPBGRA)
+            return source;
+
+        UINT width;
+        UINT height;
+        ThrowIfFailed(source->GetSize(&width, &height));
+
+        auto sizeInBytes = static_cast<uint64_t>(width) * height * 4;
+
+        if (sizeInBytes > cache->GetMaximumSizeInBytes())
+            return source;
+
+        auto decodedBitmap = adapter->DecodeToMemory(source);
+
+        cache->Add(key, decodedBitmap, sizeInBytes);
+
+        return decodedBitmap;
     }
 
     
@@ -297,7 +418,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 ThrowIfFailed(ddsDecoder->GetFrame(0, 0, 0, &ddsFrame));
 
                 // DDS files never need a transform and are not indexed
-                return WicBitmapSource{ ddsFrame, WICBitmapTransformRotate0, false };
+                return WicBitmapSource{ ddsFrame, WICBitmapTransformRotate0, false, false };
             }
         }
 
@@ -313,6 +434,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         ThrowIfFailed(m_wicAdapter->GetFactory()->CreateFormatConverter(&wicFormatConverter));
 
         auto targetPixelFormat = GUID_WICPixelFormat32bppPBGRA;
+        bool isDeviceDependent = false;
 
         GUID containerFormat;
         ThrowIfFailed(wicBitmapDecoder->GetContainerFormat(&containerFormat));
@@ -326,6 +448,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             GUID frameFormat;
             ThrowIfFailed(wicBitmapFrameDecode->GetPixelFormat(&frameFormat));
 
+            // Whether or not this device supports it, another device might.
+            isDeviceDependent = frameFormat == GUID_WICPixelFormat64bppRGBA ||
+                                frameFormat == GUID_WICPixelFormat64bppRGBAHalf ||
+                                frameFormat == GUID_WICPixelFormat128bppRGBAFloat;
+
             if (IsSupportedPixelFormat(device, frameFormat, GUID_WICPixelFormat64bppRGBA,       DXGI_FORMAT_R16G16B16A16_UNORM) ||
                 IsSupportedPixelFormat(device, frameFormat, GUID_WICPixelFormat64bppRGBAHalf,   DXGI_FORMAT_R16G16B16A16_FLOAT) ||
                 IsSupportedPixelFormat(device, frameFormat, GUID_WICPixelFormat128bppRGBAFloat, DXGI_FORMAT_R32G32B32A32_FLOAT))
@@ -342,7 +469,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             0,
             WICBitmapPaletteTypeMedianCut));
 
-        return WicBitmapSource{ wicFormatConverter, transformOptions, isIndexed };
+        return WicBitmapSource{ wicFormatConverter, transformOptions, isIndexed, isDeviceDependent };
     }
 
     ComPtr<IWICBitmapSource> DefaultBitmapAdapter::CreateFlipRotator(
@@ -357,6 +484,45 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         return bitmapFlipRotator;
     }
 
+    ComPtr<IWICBitmapSource> DefaultBitmapAdapter::DecodeToMemory(
+        ComPtr<IWICBitmapSource> const& source)
+    {
+        ComPtr<IWICBitmap> bitmap;
+
+        ThrowIfFailed(m_wicAdapter->GetFactory()->CreateBitmapFromSource(source.Get(), WICBitmapCacheOnLoad, &bitmap));
+
+        return bitmap;
+    }
+
+
+    ComPtr<IWICBitmapSource> CanvasBitmap::LoadWicBitmapSource(
+        ICanvasDevice* canvasDevice,
+        HSTRING fileName)
+    {
+        auto cache = DecodedBitmapCache::GetInstance();
+        DecodedBitmapKey cacheKey;
+
+        if (cache->IsEnabled() && TryGetDecodedBitmapKey(fileName, &cacheKey))
+            return CreateWicBitmapSourceWithCache(canvasDevice, fileName, cache.get(), cacheKey);
+        else
+            return CreateWicBitmapSourceWithExifTransform(canvasDevice, fileName);
+    }
+
+
+    ComPtr<IWICBitmapSource> CanvasBitmap::LoadWicBitmapSource(
+        ICanvasDevice* canvasDevice,
+        IStream* fileStream,
+        IUriRuntimeClass* sourceUri)
+    {
+        auto cache = DecodedBitmapCache::GetInstance();
+        DecodedBitmapKey cacheKey;
+
+        if (sourceUri && cache->IsEnabled() && TryGetDecodedBitmapKey(sourceUri, fileStream, &cacheKey))
+            return CreateWicBitmapSourceWithCache(canvasDevice, fileStream, cache.get(), cacheKey);
+        else
+            return CreateWicBitmapSourceWithExifTransform(canvasDevice, fileStream);
+    }
+
 
     ComPtr<CanvasBitmap> CanvasBitmap::CreateNew(
         ICanvasDevice* canvasDevice,
@@ -364,34 +530,35 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         float dpi,
         CanvasAlphaMode alpha)
     {
-        ComPtr<ICanvasDeviceInternal> canvasDeviceInternal;
-        ThrowIfFailed(canvasDevice->QueryInterface(canvasDeviceInternal.GetAddressOf()));
+        auto wicBitmapSource = LoadWicBitmapSource(canvasDevice, fileName);
+
+        return CreateNew(canvasDevice, wicBitmapSource.Get(), dpi, alpha);
+    }
 
-        auto wicBitmapSource = CreateWicBitmapSourceWithExifTransform(canvasDevice, fileName);
 
-        auto d2dBitmap = canvasDeviceInternal->CreateBitmapFromWicResource(wicBitmapSource.Get(), dpi, alpha);
+    ComPtr<CanvasBitmap> CanvasBitmap::CreateNew(
+        ICanvasDevice* canvasDevice,
+        IStream* fileStream,
+        float dpi,
+        CanvasAlphaMode alpha,
+        IUriRuntimeClass* sourceUri)
+    {
+        auto wicBitmapSource = LoadWicBitmapSource(canvasDevice, fileStream, sourceUri);
 
-        auto bitmap = Make<CanvasBitmap>(
-            canvasDevice,
-            d2dBitmap.Get());
-        CheckMakeResult(bitmap);
-        
-        return bitmap;
+        return CreateNew(canvasDevice, wicBitmapSource.Get(), dpi, alpha);
     }
 
 
     ComPtr<CanvasBitmap> CanvasBitmap::CreateNew(
         ICanvasDevice* canvasDevice,
-        IStream* fileStream,
+        IWICBitmapSource* wicBitmapSource,
         float dpi,
         CanvasAlphaMode alpha)
     {
         ComPtr<ICanvasDeviceInternal> canvasDeviceInternal;
         ThrowIfFailed(canvasDevice->QueryInterface(canvasDeviceInternal.GetAddressOf()));
 
-        auto wicBitmapSource = CreateWicBitmapSourceWithExifTransform(canvasDevice, fileStream);
-
-        auto d2dBitmap = canvasDeviceInternal->CreateBitmapFromWicResource(wicBitmapSource.Get(), dpi, alpha);
+        auto d2dBitmap = canvasDeviceInternal->CreateBitmapFromWicResource(wicBitmapSource, dpi, alpha);
 
         auto bitmap = Make<CanvasBitmap>(
             canvasDevice,
@@ -557,7 +724,17 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
 #endif
 
-    
+
+    //
+    // CanvasBitmapFactory
+    //
+
+    CanvasBitmapFactory::CanvasBitmapFactory()
+        : m_decodedBitmapCache(DecodedBitmapCache::GetInstance())
+    {
+    }
+
+
     //
     // ICanvasBitmapStatics
     //
@@ -1023,6 +1200,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 ComPtr<IAsyncOperation<IRandomAccessStreamWithContentType*>> openOperation;
                 ThrowIfFailed(streamReference->OpenReadAsync(&openOperation));
 
+                ComPtr<IUriRuntimeClass> sourceUri = uri;
+
                 // Our main async operation is constructed as a continuation of the file open,
                 // so the lambda will only start executing once the file is ready.
                 auto asyncOperation = Make<AsyncOperation<CanvasBitmap>>(openOperation, [=]
@@ -1033,7 +1212,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                     ComPtr<IStream> stream;
                     ThrowIfFailed(CreateStreamOverRandomAccessStream(randomAccessStream.Get(), IID_PPV_ARGS(&stream)));
 
-                    return CanvasBitmap::CreateNew(canvasDevice.Get(), stream.Get(), dpi, alpha);
+                    return CanvasBitmap::CreateNew(canvasDevice.Get(), stream.Get(), dpi, alpha, sourceUri.Get());
                 });
 
                 CheckMakeResult(asyncOperation);
@@ -1231,17 +1410,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
         byte* sourceRowStart = bitmapPixelAccess.GetLockedData();
 
+        auto kernel = PixelConversion::GetBestKernel();
+
         for (unsigned int y = 0; y < subRectangleHeight; y++)
         {
-            for (unsigned int x = 0; x < subRectangleWidth; x++)
-            {
-                uint32_t sourcePixel = *(reinterpret_cast<uint32_t*>(&sourceRowStart[x * 4]));
-                Color& destColor = array[y * subRectangleWidth + x];
-                destColor.B = (sourcePixel >> 0) & 0xFF;
-                destColor.G = (sourcePixel >> 8) & 0xFF;
-                destColor.R = (sourcePixel >> 16) & 0xFF;
-                destColor.A = (sourcePixel >> 24) & 0xFF;
-            }
+            PixelConversion::BgraToColors(kernel, sourceRowStart, array.GetData() + y * subRectangleWidth, subRectangleWidth);
+
             sourceRowStart += bitmapPixelAccess.GetStride();
         }
 
@@ -1423,9 +1597,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             ThrowHR(E_INVALIDARG, Strings::PixelColorsFormatRestriction);
         }
 
-        auto convertedValues = ConvertColorsToBgra(expectedArraySize, valueElements);
+        // D2D bitmaps cannot be mapped for writing, so the colors are converted into
+        // an uninitialized buffer and uploaded from there.
+        std::unique_ptr<uint8_t[]> convertedValues(new uint8_t[expectedArraySize * 4]);
+
+        PixelConversion::ColorsToBgra(valueElements, convertedValues.get(), expectedArraySize);
 
-        ThrowIfFailed(d2dBitmap->CopyFromMemory(&subRectangle, convertedValues.data(), subRectangleWidth * 4));
+        ThrowIfFailed(d2dBitmap->CopyFromMemory(&subRectangle, convertedValues.get(), subRectangleWidth * 4));
     }
 
 
@@ -1492,5 +1670,42 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         }
     }
 
+#if WINVER > _WIN32_WINNT_WINBLUE
+    void LockPixelsImpl(
+        ComPtr<ICanvasDevice> const& device,
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        CanvasBitmapLockMode mode,
+        ICanvasBitmapPixelLock** pixelLock)
+    {
+        CheckAndClearOutPointer(pixelLock);
+
+        BitmapSubRectangle r(d2dBitmap, subRectangle);
+
+        auto newLock = Make<CanvasBitmapPixelLock>(
+            device.Get(),
+            d2dBitmap.Get(),
+            subRectangle,
+            mode,
+            r.GetBytesPerRow(),
+            r.GetBlocksHigh());
+        CheckMakeResult(newLock);
+
+        ThrowIfFailed(newLock.CopyTo(pixelLock));
+    }
+
+    void GetSubRectangleRows(
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        uint32_t* bytesPerRow,
+        uint32_t* rowCount)
+    {
+        BitmapSubRectangle r(d2dBitmap, subRectangle);
+
+        *bytesPerRow = r.GetBytesPerRow();
+        *rowCount = r.GetBlocksHigh();
+    }
+#endif
+
     ActivatableClassWithFactory(CanvasBitmap, CanvasBitmapFactory);
 }}}}
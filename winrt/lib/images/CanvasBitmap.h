@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "DecodedBitmapCache.h"
 #include "ScopedBitmapMappedPixelAccess.h"
 #include "WicAdapter.h"
 
@@ -30,6 +31,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         ComPtr<IWICBitmapSource> Source;
         WICBitmapTransformOptions Transform;
         bool Indexed;
+
+        // Set when the pixel format Source decodes to depends on what the
+        // device supports, so the decoded pixels may not suit other devices.
+        bool IsDeviceDependent;
     };
 
     class DefaultBitmapAdapter;
@@ -45,6 +50,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         virtual ComPtr<IWICBitmapSource> CreateFlipRotator(
             ComPtr<IWICBitmapSource> const& source,
             WICBitmapTransformOptions transformOptions) = 0;
+
+        // WIC sources decode lazily, as they are read.  This reads the whole
+        // image into memory straight away.
+        virtual ComPtr<IWICBitmapSource> DecodeToMemory(
+            ComPtr<IWICBitmapSource> const& source) = 0;
     };
 
 
@@ -61,6 +71,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         virtual ComPtr<IWICBitmapSource> CreateFlipRotator(
             ComPtr<IWICBitmapSource> const& source,
             WICBitmapTransformOptions transformOptions) override;
+
+        virtual ComPtr<IWICBitmapSource> DecodeToMemory(
+            ComPtr<IWICBitmapSource> const& source) override;
     };
 
 
@@ -78,7 +91,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     {
         InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmap, BaseTrust);
 
+        // Keeps the cache used by LoadAsync alive between loads.
+        std::shared_ptr<DecodedBitmapCache> m_decodedBitmapCache;
+
     public:
+        CanvasBitmapFactory();
+
         //
         // ICanvasBitmapStatics
         //
@@ -315,6 +333,23 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         D2D1_POINT_2U const& destPoint,
         D2D1_RECT_U const* sourceRect);
 
+#if WINVER > _WIN32_WINNT_WINBLUE
+    void LockPixelsImpl(
+        ComPtr<ICanvasDevice> const& device,
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        CanvasBitmapLockMode mode,
+        ICanvasBitmapPixelLock** pixelLock);
+
+    // Validates a subrectangle, and returns the size of its rows and how many
+    // there are (counting rows of blocks, for block compressed formats).
+    void GetSubRectangleRows(
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        uint32_t* bytesPerRow,
+        uint32_t* rowCount);
+#endif
+
 
     struct CanvasBitmapTraits
     {
@@ -363,7 +398,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         IFACEMETHODIMP Close() override
         {
             m_device.Reset();
-            return ResourceWrapper::Close();
+
+            auto hr = ResourceWrapper::Close();
+            NotifyCanvasImageClosed();
+            return hr;
         }
 
         IFACEMETHODIMP get_SizeInPixels(_Out_ BitmapSize* size) override
@@ -879,6 +917,48 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 });
         }
 
+#if WINVER > _WIN32_WINNT_WINBLUE
+        IFACEMETHODIMP LockPixels(
+            CanvasBitmapLockMode mode,
+            ICanvasBitmapPixelLock** pixelLock) override
+        {
+            return ExceptionBoundary(
+                [&]
+                {
+                    auto& d2dBitmap = GetResource();
+
+                    LockPixelsImpl(
+                        m_device,
+                        d2dBitmap,
+                        GetResourceBitmapExtents(d2dBitmap),
+                        mode,
+                        pixelLock);
+                });
+        }
+
+        IFACEMETHODIMP LockPixelsWithSubrectangle(
+            CanvasBitmapLockMode mode,
+            int32_t left,
+            int32_t top,
+            int32_t width,
+            int32_t height,
+            ICanvasBitmapPixelLock** pixelLock) override
+        {
+            return ExceptionBoundary(
+                [&]
+                {
+                    auto& d2dBitmap = GetResource();
+
+                    LockPixelsImpl(
+                        m_device,
+                        d2dBitmap,
+                        ToD2DRectU(left, top, width, height),
+                        mode,
+                        pixelLock);
+                });
+        }
+#endif
+
     private:
         static D2D1_RECT_U GetResourceBitmapExtents(ComPtr<ID2D1Bitmap1> const& d2dBitmap)
         {
@@ -903,12 +983,32 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             float dpi,
             CanvasAlphaMode alpha);
 
+        // sourceUri, if there is one, lets the decoded image be cached.
         static ComPtr<CanvasBitmap> CreateNew(
             ICanvasDevice* canvasDevice,
             IStream* fileStream,
             float dpi,
+            CanvasAlphaMode alpha,
+            IUriRuntimeClass* sourceUri = nullptr);
+
+        static ComPtr<CanvasBitmap> CreateNew(
+            ICanvasDevice* canvasDevice,
+            IWICBitmapSource* wicBitmapSource,
+            float dpi,
             CanvasAlphaMode alpha);
 
+        // The decoding half of loading a bitmap from a file, for
+        // CanvasBitmapLoader to run separately from the upload.  WIC may
+        // still decode lazily, as the source is read.
+        static ComPtr<IWICBitmapSource> LoadWicBitmapSource(
+            ICanvasDevice* canvasDevice,
+            HSTRING fileName);
+
+        static ComPtr<IWICBitmapSource> LoadWicBitmapSource(
+            ICanvasDevice* canvasDevice,
+            IStream* fileStream,
+            IUriRuntimeClass* sourceUri);
+
         static ComPtr<CanvasBitmap> CreateNew(
             ICanvasDevice* device,
             uint32_t byteCount,
@@ -0,0 +1,98 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "CanvasBitmapCache.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    CanvasBitmapCacheStatics::CanvasBitmapCacheStatics()
+        : m_cache(DecodedBitmapCache::GetInstance())
+    {
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapCacheStatics::get_MaximumSizeInBytes(uint64_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = m_cache->GetMaximumSizeInBytes();
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapCacheStatics::put_MaximumSizeInBytes(uint64_t value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                m_cache->SetMaximumSizeInBytes(value);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapCacheStatics::get_SizeInBytes(uint64_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = m_cache->GetSizeInBytes();
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapCacheStatics::get_Count(int32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = static_cast<int32_t>(m_cache->GetEntryCount());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapCacheStatics::get_HitCount(uint64_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = m_cache->GetHitCount();
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapCacheStatics::get_MissCount(uint64_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = m_cache->GetMissCount();
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapCacheStatics::Trim(uint64_t targetSizeInBytes)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                m_cache->Trim(targetSizeInBytes);
+            });
+    }
+
+
+    ActivatableStaticOnlyFactory(CanvasBitmapCacheStatics);
+}}}}
@@ -0,0 +1,34 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "DecodedBitmapCache.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Public face of DecodedBitmapCache.  Holding the cache here keeps its
+    // settings and contents alive for as long as the app is using them.
+    //
+    class CanvasBitmapCacheStatics
+        : public AgileActivationFactory<ICanvasBitmapCacheStatics>
+        , private LifespanTracker<CanvasBitmapCacheStatics>
+    {
+        InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmapCache, BaseTrust);
+
+        std::shared_ptr<DecodedBitmapCache> m_cache;
+
+    public:
+        CanvasBitmapCacheStatics();
+
+        IFACEMETHOD(get_MaximumSizeInBytes)(uint64_t* value) override;
+        IFACEMETHOD(put_MaximumSizeInBytes)(uint64_t value) override;
+        IFACEMETHOD(get_SizeInBytes)(uint64_t* value) override;
+        IFACEMETHOD(get_Count)(int32_t* value) override;
+        IFACEMETHOD(get_HitCount)(uint64_t* value) override;
+        IFACEMETHOD(get_MissCount)(uint64_t* value) override;
+        IFACEMETHOD(Trim)(uint64_t targetSizeInBytes) override;
+    };
+}}}}
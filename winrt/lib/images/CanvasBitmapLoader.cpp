@@ -0,0 +1,346 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "CanvasBitmapLoader.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    using namespace ABI::Windows::Storage::Streams;
+    using namespace ::Microsoft::WRL::Wrappers;
+
+    //
+    // CanvasBitmapLoaderFactory implementation
+    //
+
+    IFACEMETHODIMP CanvasBitmapLoaderFactory::Create(
+        ICanvasResourceCreator* resourceCreator,
+        int32_t workerCount,
+        ICanvasBitmapLoader** loader)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(resourceCreator);
+                CheckAndClearOutPointer(loader);
+
+                if (workerCount <= 0)
+                    ThrowHR(E_INVALIDARG);
+
+                ComPtr<ICanvasDevice> device;
+                ThrowIfFailed(resourceCreator->get_Device(&device));
+
+                auto newLoader = Make<CanvasBitmapLoader>(
+                    device.Get(),
+                    static_cast<uint32_t>(workerCount));
+                CheckMakeResult(newLoader);
+
+                ThrowIfFailed(newLoader.CopyTo(loader));
+            });
+    }
+
+
+    //
+    // CanvasBitmapLoader implementation
+    //
+
+    CanvasBitmapLoader::CanvasBitmapLoader(
+        ICanvasDevice* device,
+        uint32_t workerCount,
+        BitmapLoadScheduler::RunAsyncFunction const& runAsync)
+        : m_device(device)
+        , m_scheduler(std::make_shared<BitmapLoadScheduler>(workerCount, runAsync))
+    {
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::LoadAsync(
+        HSTRING fileName,
+        LoadOperation** canvasBitmap)
+    {
+        return LoadAsyncWithPriority(fileName, 0, canvasBitmap);
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::LoadAsyncWithPriority(
+        HSTRING fileName,
+        int32_t priority,
+        LoadOperation** canvasBitmap)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(fileName);
+                CheckAndClearOutPointer(canvasBitmap);
+
+                auto operation = LoadFromFileName(fileName, priority);
+
+                ThrowIfFailed(operation.CopyTo(canvasBitmap));
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::LoadAsyncFromUri(
+        IUriRuntimeClass* uri,
+        LoadOperation** canvasBitmap)
+    {
+        return LoadAsyncFromUriWithPriority(uri, 0, canvasBitmap);
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::LoadAsyncFromUriWithPriority(
+        IUriRuntimeClass* uri,
+        int32_t priority,
+        LoadOperation** canvasBitmap)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(uri);
+                CheckAndClearOutPointer(canvasBitmap);
+
+                ComPtr<ICanvasDevice> device = m_device.EnsureNotClosed();
+
+                ComPtr<IRandomAccessStreamReferenceStatics> streamReferenceStatics;
+                ThrowIfFailed(GetActivationFactory(HStringReference(RuntimeClass_Windows_Storage_Streams_RandomAccessStreamReference).Get(), &streamReferenceStatics));
+
+                ComPtr<IRandomAccessStreamReference> streamReference;
+                ThrowIfFailed(streamReferenceStatics->CreateFromUri(uri, &streamReference));
+
+                ComPtr<IAsyncOperation<IRandomAccessStreamWithContentType*>> openOperation;
+                ThrowIfFailed(streamReference->OpenReadAsync(&openOperation));
+
+                auto operation = Make<AsyncOperation<CanvasBitmap>>();
+                CheckMakeResult(operation);
+
+                auto scheduler = m_scheduler;
+                ComPtr<IUriRuntimeClass> sourceUri = uri;
+
+                typedef AddFtmBase<IAsyncOperationCompletedHandler<IRandomAccessStreamWithContentType*>>::Type OpenedHandler;
+
+                auto onOpened = Callback<OpenedHandler>(
+                    [=](IAsyncOperation<IRandomAccessStreamWithContentType*>* completedOpen, AsyncStatus status)
+                    {
+                        HRESULT hr = ExceptionBoundary(
+                            [&]
+                            {
+                                if (status != AsyncStatus::Completed)
+                                {
+                                    HRESULT errorCode = E_ABORT;
+
+                                    if (status == AsyncStatus::Error)
+                                        ThrowIfFailed(As<IAsyncInfo>(completedOpen)->get_ErrorCode(&errorCode));
+
+                                    ThrowHR(errorCode);
+                                }
+
+                                ComPtr<IRandomAccessStreamWithContentType> randomAccessStream;
+                                ThrowIfFailed(completedOpen->GetResults(&randomAccessStream));
+
+                                ComPtr<IStream> stream;
+                                ThrowIfFailed(CreateStreamOverRandomAccessStream(randomAccessStream.Get(), IID_PPV_ARGS(&stream)));
+
+                                EnqueueLoad(scheduler, operation, priority, device,
+                                    [=]
+                                    {
+                                        return CanvasBitmap::LoadWicBitmapSource(device.Get(), stream.Get(), sourceUri.Get());
+                                    });
+                            });
+
+                        if (FAILED(hr))
+                            operation->Fail(hr);
+
+                        return S_OK;
+                    });
+                CheckMakeResult(onOpened);
+
+                ThrowIfFailed(openOperation->put_Completed(onOpened.Get()));
+
+                ThrowIfFailed(operation.CopyTo(canvasBitmap));
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::LoadManyAsync(
+        uint32_t fileNameCount,
+        HSTRING* fileNames,
+        int32_t priority,
+        uint32_t* canvasBitmapCount,
+        LoadOperation*** canvasBitmaps)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                if (fileNameCount > 0)
+                    CheckInPointer(fileNames);
+
+                CheckInPointer(canvasBitmapCount);
+                CheckAndClearOutPointer(canvasBitmaps);
+
+                for (uint32_t i = 0; i < fileNameCount; i++)
+                {
+                    CheckInPointer(fileNames[i]);
+                }
+
+                ComArray<ComPtr<LoadOperation>> operations(fileNameCount);
+
+                for (uint32_t i = 0; i < fileNameCount; i++)
+                {
+                    operations[i] = LoadFromFileName(fileNames[i], priority);
+                }
+
+                operations.Detach(canvasBitmapCount, canvasBitmaps);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::get_WorkerCount(
+        int32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                m_device.EnsureNotClosed();
+
+                *value = static_cast<int32_t>(m_scheduler->GetWorkerCount());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::get_PendingCount(
+        int32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                m_device.EnsureNotClosed();
+
+                *value = static_cast<int32_t>(m_scheduler->GetPendingCount());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::Close()
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                // Loads that have not started decoding fail with RO_E_CLOSED.
+                m_scheduler->Close();
+                m_device.Close();
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapLoader::get_Device(
+        ICanvasDevice** value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(value);
+
+                auto& device = m_device.EnsureNotClosed();
+                ThrowIfFailed(device.CopyTo(value));
+            });
+    }
+
+
+    ComPtr<CanvasBitmapLoader::LoadOperation> CanvasBitmapLoader::LoadFromFileName(
+        HSTRING fileName,
+        int32_t priority)
+    {
+        ComPtr<ICanvasDevice> device = m_device.EnsureNotClosed();
+
+        auto operation = Make<AsyncOperation<CanvasBitmap>>();
+        CheckMakeResult(operation);
+
+        WinString fileNameString(fileName);
+
+        EnqueueLoad(m_scheduler, operation, priority, device,
+            [=]
+            {
+                return CanvasBitmap::LoadWicBitmapSource(device.Get(), fileNameString);
+            });
+
+        return operation;
+    }
+
+
+    void CanvasBitmapLoader::EnqueueLoad(
+        std::shared_ptr<BitmapLoadScheduler> const& scheduler,
+        ComPtr<AsyncOperation<CanvasBitmap>> const& operation,
+        int32_t priority,
+        ComPtr<ICanvasDevice> const& device,
+        LoadSourceFunction&& loadSource)
+    {
+        auto decode = [=]() -> BitmapLoadScheduler::UploadFunction
+        {
+            // Don't bother with loads that were cancelled while queued.
+            if (!operation->ShouldContinue())
+            {
+                operation->Fail(E_ABORT);
+                return nullptr;
+            }
+
+            ComPtr<IWICBitmapSource> decodedSource;
+
+            HRESULT hr = ExceptionBoundary(
+                [&]
+                {
+                    auto source = loadSource();
+
+                    // Cached images are already in memory, and block compressed DDS
+                    // frames are copied to the GPU as they are.
+                    if (MaybeAs<IWICBitmap>(source) || MaybeAs<IWICDdsFrameDecode>(source))
+                        decodedSource = source;
+                    else
+                        decodedSource = CanvasBitmapAdapter::GetInstance()->DecodeToMemory(source);
+                });
+
+            if (FAILED(hr))
+            {
+                operation->Fail(hr);
+                return nullptr;
+            }
+
+            return [=]
+            {
+                if (!operation->ShouldContinue())
+                {
+                    operation->Fail(E_ABORT);
+                    return;
+                }
+
+                ComPtr<CanvasBitmap> bitmap;
+
+                HRESULT hr = ExceptionBoundary(
+                    [&]
+                    {
+                        bitmap = CanvasBitmap::CreateNew(device.Get(), decodedSource.Get(), DEFAULT_DPI, CanvasAlphaMode::Premultiplied);
+                    });
+
+                if (SUCCEEDED(hr))
+                    operation->Complete(bitmap);
+                else
+                    operation->Fail(hr);
+            };
+        };
+
+        auto abandon = [=]
+        {
+            operation->Fail(RO_E_CLOSED);
+        };
+
+        scheduler->Enqueue(priority, std::move(decode), std::move(abandon));
+    }
+
+
+    ActivatableClassWithFactory(CanvasBitmapLoader, CanvasBitmapLoaderFactory);
+}}}}
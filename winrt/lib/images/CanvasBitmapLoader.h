@@ -0,0 +1,122 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "BitmapLoadScheduler.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    using namespace ::Microsoft::WRL;
+    using namespace ABI::Windows::Foundation;
+
+    class CanvasBitmapLoaderFactory
+        : public AgileActivationFactory<ICanvasBitmapLoaderFactory>
+        , private LifespanTracker<CanvasBitmapLoaderFactory>
+    {
+        InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmapLoader, BaseTrust);
+
+    public:
+        IFACEMETHODIMP Create(
+            ICanvasResourceCreator* resourceCreator,
+            int32_t workerCount,
+            ICanvasBitmapLoader** loader) override;
+    };
+
+
+    //
+    // Loads many bitmaps at once without flooding the thread pool.
+    //
+    // CanvasBitmap.LoadAsync runs every load on its own thread pool work
+    // item, so a few hundred of them at once end up with decoding, format
+    // conversion and upload all competing with each other.  The loader
+    // decodes on a fixed number of workers instead, and uploads on one more,
+    // through BitmapLoadScheduler.  Each load still gets its own
+    // IAsyncOperation, which completes as soon as that bitmap is ready.
+    //
+    // URI loads open their stream first, and are only queued for decoding
+    // once it is open, so decoders never sit waiting for I/O.
+    //
+    class CanvasBitmapLoader
+        : public RuntimeClass<
+            ICanvasBitmapLoader,
+            IClosable,
+            ICanvasResourceCreator>
+        , private LifespanTracker<CanvasBitmapLoader>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmapLoader, BaseTrust);
+
+        typedef IAsyncOperation<CanvasBitmap*> LoadOperation;
+        typedef std::function<ComPtr<IWICBitmapSource>()> LoadSourceFunction;
+
+        ClosablePtr<ICanvasDevice> m_device;
+        std::shared_ptr<BitmapLoadScheduler> m_scheduler;
+
+    public:
+        CanvasBitmapLoader(
+            ICanvasDevice* device,
+            uint32_t workerCount,
+            BitmapLoadScheduler::RunAsyncFunction const& runAsync = BitmapLoadScheduler::RunOnThreadPool);
+
+        //
+        // ICanvasBitmapLoader
+        //
+
+        IFACEMETHODIMP LoadAsync(
+            HSTRING fileName,
+            LoadOperation** canvasBitmap) override;
+
+        IFACEMETHODIMP LoadAsyncWithPriority(
+            HSTRING fileName,
+            int32_t priority,
+            LoadOperation** canvasBitmap) override;
+
+        IFACEMETHODIMP LoadAsyncFromUri(
+            IUriRuntimeClass* uri,
+            LoadOperation** canvasBitmap) override;
+
+        IFACEMETHODIMP LoadAsyncFromUriWithPriority(
+            IUriRuntimeClass* uri,
+            int32_t priority,
+            LoadOperation** canvasBitmap) override;
+
+        IFACEMETHODIMP LoadManyAsync(
+            uint32_t fileNameCount,
+            HSTRING* fileNames,
+            int32_t priority,
+            uint32_t* canvasBitmapCount,
+            LoadOperation*** canvasBitmaps) override;
+
+        IFACEMETHODIMP get_WorkerCount(
+            int32_t* value) override;
+
+        IFACEMETHODIMP get_PendingCount(
+            int32_t* value) override;
+
+        //
+        // IClosable
+        //
+
+        IFACEMETHODIMP Close() override;
+
+        //
+        // ICanvasResourceCreator
+        //
+
+        IFACEMETHODIMP get_Device(
+            ICanvasDevice** value) override;
+
+    private:
+        ComPtr<LoadOperation> LoadFromFileName(
+            HSTRING fileName,
+            int32_t priority);
+
+        static void EnqueueLoad(
+            std::shared_ptr<BitmapLoadScheduler> const& scheduler,
+            ComPtr<AsyncOperation<CanvasBitmap>> const& operation,
+            int32_t priority,
+            ComPtr<ICanvasDevice> const& device,
+            LoadSourceFunction&& loadSource);
+    };
+}}}}
@@ -0,0 +1,223 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "CanvasBitmapPixelLock.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    CanvasBitmapPixelLock::CanvasBitmapPixelLock(
+        ICanvasDevice* device,
+        ID2D1Bitmap1* d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        CanvasBitmapLockMode mode,
+        uint32_t bytesPerRow,
+        uint32_t rowCount)
+        : m_d2dBitmap(d2dBitmap)
+        , m_subRectangle(subRectangle)
+        , m_mode(mode)
+        , m_data(nullptr)
+        , m_stride(0)
+        , m_capacity(0)
+    {
+        assert(bytesPerRow > 0 && rowCount > 0);
+
+        switch (mode)
+        {
+        case CanvasBitmapLockMode::Read:
+            m_mappedPixels = std::make_unique<ScopedBitmapMappedPixelAccess>(device, d2dBitmap, &subRectangle);
+            m_data = m_mappedPixels->GetLockedData();
+            m_stride = m_mappedPixels->GetStride();
+            break;
+
+        case CanvasBitmapLockMode::Write:
+        case CanvasBitmapLockMode::ReadWrite:
+            // Deliberately not value-initialized; Write locks leave the contents undefined.
+            m_writeBuffer.reset(new uint8_t[bytesPerRow * rowCount]);
+            m_data = m_writeBuffer.get();
+            m_stride = bytesPerRow;
+
+            if (mode == CanvasBitmapLockMode::ReadWrite)
+            {
+                ScopedBitmapMappedPixelAccess source(device, d2dBitmap, &subRectangle);
+
+                for (uint32_t row = 0; row < rowCount; row++)
+                {
+                    memcpy(m_data + row * m_stride, source.GetLockedData() + row * source.GetStride(), bytesPerRow);
+                }
+            }
+            break;
+
+        default:
+            ThrowHR(E_INVALIDARG);
+        }
+
+        // The last row need not be padded out to the full stride.
+        m_capacity = m_stride * (rowCount - 1) + bytesPerRow;
+    }
+
+
+    CanvasBitmapPixelLock::CanvasBitmapPixelLock(
+        ID2D1Bitmap1* stagingBitmap,
+        std::unique_ptr<ScopedBitmapMappedPixelAccess>&& mappedPixels,
+        uint32_t bytesPerRow,
+        uint32_t rowCount)
+        : m_d2dBitmap(stagingBitmap)
+        , m_mode(CanvasBitmapLockMode::Read)
+        , m_mappedPixels(std::move(mappedPixels))
+        , m_data(m_mappedPixels->GetLockedData())
+        , m_stride(m_mappedPixels->GetStride())
+        , m_capacity(m_stride * (rowCount - 1) + bytesPerRow)
+    {
+        assert(bytesPerRow > 0 && rowCount > 0);
+
+        auto size = stagingBitmap->GetPixelSize();
+        m_subRectangle = D2D1_RECT_U{ 0, 0, size.width, size.height };
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::get_Stride(uint32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+                ThrowIfClosed();
+
+                *value = m_stride;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::get_SizeInPixels(BitmapSize* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+                ThrowIfClosed();
+
+                value->Width = m_subRectangle.right - m_subRectangle.left;
+                value->Height = m_subRectangle.bottom - m_subRectangle.top;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::get_Format(DirectXPixelFormat* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+                ThrowIfClosed();
+
+                *value = static_cast<DirectXPixelFormat>(m_d2dBitmap->GetPixelFormat().format);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::get_Mode(CanvasBitmapLockMode* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+                ThrowIfClosed();
+
+                *value = m_mode;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::get_Capacity(uint32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                // IMemoryBufferReference reports a capacity of zero once closed.
+                *value = m_capacity;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::add_Closed(ClosedHandler* handler, EventRegistrationToken* token)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(handler);
+                CheckInPointer(token);
+
+                ThrowIfFailed(m_closedEventSource.Add(handler, token));
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::remove_Closed(EventRegistrationToken token)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                ThrowIfFailed(m_closedEventSource.Remove(token));
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::GetBuffer(BYTE** value, UINT32* capacity)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(value);
+                CheckInPointer(capacity);
+                ThrowIfClosed();
+
+                *value = m_data;
+                *capacity = m_capacity;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapPixelLock::Close()
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                if (!m_d2dBitmap)
+                    return;
+
+                // Handlers are told before the pointer they were given becomes invalid.
+                HRESULT closedResult = m_closedEventSource.InvokeAll(static_cast<IMemoryBufferReference*>(this), nullptr);
+
+                auto d2dBitmap = std::move(m_d2dBitmap);
+                auto writeBuffer = std::move(m_writeBuffer);
+
+                m_mappedPixels.reset();
+                m_data = nullptr;
+                m_capacity = 0;
+
+                if (writeBuffer)
+                {
+                    ThrowIfFailed(d2dBitmap->CopyFromMemory(&m_subRectangle, writeBuffer.get(), m_stride));
+                }
+
+                ThrowIfFailed(closedResult);
+            });
+    }
+
+
+    void CanvasBitmapPixelLock::ThrowIfClosed()
+    {
+        if (!m_d2dBitmap)
+            ThrowHR(RO_E_CLOSED);
+    }
+
+}}}}
+
+#endif
@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "ScopedBitmapMappedPixelAccess.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    using namespace ::Microsoft::WRL;
+    using namespace ABI::Windows::Foundation;
+
+    //
+    // Gives the caller direct access to the pixels of a CanvasBitmap
+    // subrectangle, through IMemoryBufferByteAccess, until Close is called.
+    //
+    // Read locks point straight at the mapped staging bitmap that
+    // ScopedBitmapMappedPixelAccess copies the subrectangle into.  D2D
+    // bitmaps cannot be mapped for writing, so Write and ReadWrite locks
+    // point at a tightly packed buffer instead, which Close uploads back to
+    // the bitmap with CopyFromMemory.  ReadWrite locks start out with the
+    // current contents of the bitmap; Write locks start out uninitialized.
+    //
+    // Changes are only written back by Close.  A lock that is released
+    // without being closed discards them.
+    //
+    class CanvasBitmapPixelLock : public RuntimeClass<
+                                      ICanvasBitmapPixelLock,
+                                      IMemoryBufferReference,
+                                      IClosable,
+                                      CloakedIid<::Windows::Foundation::IMemoryBufferByteAccess>>,
+                                  private LifespanTracker<CanvasBitmapPixelLock>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmapPixelLock, BaseTrust);
+
+        typedef ITypedEventHandler<IMemoryBufferReference*, IInspectable*> ClosedHandler;
+
+        ComPtr<ID2D1Bitmap1> m_d2dBitmap;   // null once closed
+        D2D1_RECT_U m_subRectangle;
+        CanvasBitmapLockMode m_mode;
+
+        std::unique_ptr<ScopedBitmapMappedPixelAccess> m_mappedPixels;
+        std::unique_ptr<uint8_t[]> m_writeBuffer;
+
+        uint8_t* m_data;
+        uint32_t m_stride;
+        uint32_t m_capacity;
+
+        EventSource<ClosedHandler, InvokeModeOptions<StopOnFirstError>> m_closedEventSource;
+
+    public:
+        //
+        // bytesPerRow and rowCount describe the subrectangle in units of
+        // blocks, so that block compressed formats work too.
+        //
+        CanvasBitmapPixelLock(
+            ICanvasDevice* device,
+            ID2D1Bitmap1* d2dBitmap,
+            D2D1_RECT_U const& subRectangle,
+            CanvasBitmapLockMode mode,
+            uint32_t bytesPerRow,
+            uint32_t rowCount);
+
+        //
+        // Read lock over a staging bitmap that the caller has already copied
+        // into and mapped, eg. by CanvasReadbackQueue.
+        //
+        CanvasBitmapPixelLock(
+            ID2D1Bitmap1* stagingBitmap,
+            std::unique_ptr<ScopedBitmapMappedPixelAccess>&& mappedPixels,
+            uint32_t bytesPerRow,
+            uint32_t rowCount);
+
+        // ICanvasBitmapPixelLock
+
+        IFACEMETHOD(get_Stride)(uint32_t* value) override;
+        IFACEMETHOD(get_SizeInPixels)(BitmapSize* value) override;
+        IFACEMETHOD(get_Format)(DirectXPixelFormat* value) override;
+        IFACEMETHOD(get_Mode)(CanvasBitmapLockMode* value) override;
+
+        // IMemoryBufferReference
+
+        IFACEMETHOD(get_Capacity)(uint32_t* value) override;
+        IFACEMETHOD(add_Closed)(ClosedHandler* handler, EventRegistrationToken* token) override;
+        IFACEMETHOD(remove_Closed)(EventRegistrationToken token) override;
+
+        // IMemoryBufferByteAccess
+
+        IFACEMETHOD(GetBuffer)(BYTE** value, UINT32* capacity) override;
+
+        // IClosable
+
+        IFACEMETHOD(Close)() override;
+
+    private:
+        void ThrowIfClosed();
+    };
+
+}}}}
+
+#endif
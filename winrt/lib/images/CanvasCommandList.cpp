@@ -105,7 +105,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     IFACEMETHODIMP CanvasCommandList::Close()
     {
         m_device.Close();
-        return __super::Close();
+
+        auto hr = __super::Close();
+        NotifyCanvasImageClosed();
+        return hr;
     }
 
 
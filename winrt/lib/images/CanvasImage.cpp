@@ -8,6 +8,19 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
     using namespace ABI::Windows::Foundation;
 
+    static std::atomic<uint64_t> s_canvasImageCloseCount(0);
+
+    void NotifyCanvasImageClosed()
+    {
+        ++s_canvasImageCloseCount;
+    }
+
+    uint64_t GetCanvasImageCloseCount()
+    {
+        return s_canvasImageCloseCount;
+    }
+
+
     DeviceContextLease GetDeviceContextForGetBounds(ICanvasDevice* device, ICanvasResourceCreator* resourceCreator)
     {
         if (auto drawingSession = MaybeAs<ICanvasDrawingSession>(resourceCreator))
@@ -198,7 +211,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 auto canvasDevice = GetCanvasDevice(resourceCreator);
                 auto d2dDevice = GetWrappedResource<ID2D1Device>(canvasDevice);
 
-                auto d2dImage = As<ICanvasImageInternal>(image)->GetD2DImage(canvasDevice.Get(), nullptr, GetImageFlags::None, dpi);
+                // The image is saved on another thread, which may still be using it after the effect is released.
+                auto d2dImage = As<ICanvasImageInternal>(image)->GetD2DImage(canvasDevice.Get(), nullptr, GetImageFlags::RetainRealization, dpi);
 
                 auto adapter = m_adapter;
                 auto istream = adapter->CreateStreamOverRandomAccessStream(stream);
@@ -219,81 +233,159 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     }
 
 
-    IFACEMETHODIMP CanvasImageFactory::ComputeHistogram(
+    //
+    // Computes a histogram for each of the specified channels, concatenating the results.
+    // The histograms share one atlas effect and are all evaluated by a single draw.
+    //
+    static void ComputeHistogramsImpl(
         ICanvasImage* image,
         Rect sourceRectangle,
         ICanvasResourceCreator* resourceCreator,
-        Effects::EffectChannelSelect channelSelect,
+        uint32_t channelCount,
+        Effects::EffectChannelSelect const* channelSelects,
         int32_t numberOfBins,
         uint32_t* valueCount,
         float** valueElements)
     {
-        return ExceptionBoundary(
-            [&]
-            {
-                CheckInPointer(image);
-                CheckInPointer(resourceCreator);
-                CheckInPointer(valueCount);
-                CheckAndClearOutPointer(valueElements);
+        CheckInPointer(image);
+        CheckInPointer(resourceCreator);
+        CheckInPointer(channelSelects);
+        CheckInPointer(valueCount);
+        CheckAndClearOutPointer(valueElements);
 
-                if (numberOfBins < 2 || numberOfBins > 1024)
-                    ThrowHR(E_INVALIDARG);
-
-                // Look up a device context.
-                ComPtr<ICanvasDevice> device;
-                ThrowIfFailed(resourceCreator->get_Device(&device));
-                
-                auto deviceInternal = As<ICanvasDeviceInternal>(device);
+        if (numberOfBins < 2 || numberOfBins > 1024)
+            ThrowHR(E_INVALIDARG);
 
-                auto deviceContext = deviceInternal->GetResourceCreationDeviceContext();
-                
-                // Look up the histogram and atlas effects.
-                auto effects = deviceInternal->LeaseHistogramEffect(deviceContext.Get());
+        // One histogram per EffectChannelSelect value (Red, Green, Blue and
+        // Alpha) is as many as could be useful.  This also keeps the result
+        // array size well away from overflowing.
+        uint32_t const maxChannelCount = 4;
 
-                auto releaseEffects = MakeScopeWarden(
-                    [&]
-                    {
-                        effects.AtlasEffect->SetInput(0, nullptr);
-                        deviceInternal->ReleaseHistogramEffect(std::move(effects));
-                    });
+        if (channelCount == 0 || channelCount > maxChannelCount)
+            ThrowHR(E_INVALIDARG);
 
-                // Configure the atlas effect to select what region of the source image we want to feed into the histogram.
-                float realizedDpi;
+        // Look up a device context.
+        ComPtr<ICanvasDevice> device;
+        ThrowIfFailed(resourceCreator->get_Device(&device));
+        
+        auto deviceInternal = As<ICanvasDeviceInternal>(device);
 
-                auto d2dImage = As<ICanvasImageInternal>(image)->GetD2DImage(device.Get(), deviceContext.Get(), GetImageFlags::None, DEFAULT_DPI, &realizedDpi);
+        auto deviceContext = deviceInternal->GetResourceCreationDeviceContext();
+        
+        // Look up a histogram and atlas effect pair for the first channel, plus
+        // an extra histogram effect for each further channel, sharing the atlas.
+        ICanvasDeviceInternal::HistogramAndAtlasEffects effects;
+        std::vector<ComPtr<ID2D1Effect>> histogramEffects;
+        histogramEffects.reserve(channelCount);
 
-                if (realizedDpi != 0 && realizedDpi != DEFAULT_DPI)
+        auto releaseEffects = MakeScopeWarden(
+            [&]
+            {
+                for (size_t i = 1; i < histogramEffects.size(); i++)
                 {
-                    ThrowIfFailed(D2D1::SetDpiCompensatedEffectInput(deviceContext.Get(), effects.AtlasEffect.Get(), 0, As<ID2D1Bitmap>(d2dImage).Get()));
+                    histogramEffects[i]->SetInput(0, nullptr);
+                    deviceInternal->ReleaseExtraHistogramEffect(std::move(histogramEffects[i]));
                 }
-                else
+
+                if (effects.AtlasEffect)
                 {
-                    effects.AtlasEffect->SetInput(0, d2dImage.Get());
+                    effects.AtlasEffect->SetInput(0, nullptr);
+                    deviceInternal->ReleaseHistogramEffect(std::move(effects));
                 }
+            });
+
+        effects = deviceInternal->LeaseHistogramEffect(deviceContext.Get());
+        histogramEffects.push_back(effects.HistogramEffect);
+
+        for (uint32_t i = 1; i < channelCount; i++)
+        {
+            histogramEffects.push_back(deviceInternal->LeaseExtraHistogramEffect(deviceContext.Get()));
+        }
+
+        auto& atlasEffect = effects.AtlasEffect;
+
+        // Configure the atlas effect to select what region of the source image we want to feed into the histogram.
+        float realizedDpi;
+
+        auto d2dImage = As<ICanvasImageInternal>(image)->GetD2DImage(device.Get(), deviceContext.Get(), GetImageFlags::None, DEFAULT_DPI, &realizedDpi);
+
+        if (realizedDpi != 0 && realizedDpi != DEFAULT_DPI)
+        {
+            ThrowIfFailed(D2D1::SetDpiCompensatedEffectInput(deviceContext.Get(), atlasEffect.Get(), 0, As<ID2D1Bitmap>(d2dImage).Get()));
+        }
+        else
+        {
+            atlasEffect->SetInput(0, d2dImage.Get());
+        }
+
+        atlasEffect->SetValue(D2D1_ATLAS_PROP_INPUT_RECT, ToD2DRect(sourceRectangle));
+
+        // Configure the histogram effects.
+        for (uint32_t i = 0; i < channelCount; i++)
+        {
+            auto& histogramEffect = histogramEffects[i];
+
+            histogramEffect->SetInputEffect(0, atlasEffect.Get());
+
+            histogramEffect->SetValue(D2D1_HISTOGRAM_PROP_CHANNEL_SELECT, channelSelects[i]);
+            histogramEffect->SetValue(D2D1_HISTOGRAM_PROP_NUM_BINS, numberOfBins);
+        }
 
-                effects.AtlasEffect->SetValue(D2D1_ATLAS_PROP_INPUT_RECT, ToD2DRect(sourceRectangle));
+        // Evaluate the histograms by drawing the effects.
+        deviceContext->BeginDraw();
 
-                // Configure the histogram effect.
-                effects.HistogramEffect->SetInputEffect(0, effects.AtlasEffect.Get());
+        for (auto& histogramEffect : histogramEffects)
+        {
+            deviceContext->DrawImage(As<ID2D1Image>(histogramEffect).Get());
+        }
+
+        ThrowIfFailed(deviceContext->EndDraw());
 
-                effects.HistogramEffect->SetValue(D2D1_HISTOGRAM_PROP_CHANNEL_SELECT, channelSelect);
-                effects.HistogramEffect->SetValue(D2D1_HISTOGRAM_PROP_NUM_BINS, numberOfBins);
+        // Read back the results.
+        ComArray<float> array(numberOfBins * channelCount);
 
-                // Evaluate the histogram by drawing the effect.
-                deviceContext->BeginDraw();
+        for (uint32_t i = 0; i < channelCount; i++)
+        {
+            ThrowIfFailed(histogramEffects[i]->GetValue(D2D1_HISTOGRAM_PROP_HISTOGRAM_OUTPUT,
+                                                        reinterpret_cast<BYTE*>(array.GetData() + i * numberOfBins),
+                                                        numberOfBins * sizeof(float)));
+        }
 
-                deviceContext->DrawImage(As<ID2D1Image>(effects.HistogramEffect).Get());
+        array.Detach(valueCount, valueElements);
+    }
 
-                ThrowIfFailed(deviceContext->EndDraw());
 
-                // Read back the results.
-                ComArray<float> array(numberOfBins);
+    IFACEMETHODIMP CanvasImageFactory::ComputeHistogram(
+        ICanvasImage* image,
+        Rect sourceRectangle,
+        ICanvasResourceCreator* resourceCreator,
+        Effects::EffectChannelSelect channelSelect,
+        int32_t numberOfBins,
+        uint32_t* valueCount,
+        float** valueElements)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                ComputeHistogramsImpl(image, sourceRectangle, resourceCreator, 1, &channelSelect, numberOfBins, valueCount, valueElements);
+            });
+    }
 
-                ThrowIfFailed(effects.HistogramEffect->GetValue(D2D1_HISTOGRAM_PROP_HISTOGRAM_OUTPUT,
-                                                                reinterpret_cast<BYTE*>(array.GetData()),
-                                                                array.GetSize() * sizeof(float)));
 
-                array.Detach(valueCount, valueElements);
+    IFACEMETHODIMP CanvasImageFactory::ComputeHistograms(
+        ICanvasImage* image,
+        Rect sourceRectangle,
+        ICanvasResourceCreator* resourceCreator,
+        uint32_t channelSelectCount,
+        Effects::EffectChannelSelect* channelSelects,
+        int32_t numberOfBins,
+        uint32_t* valueCount,
+        float** valueElements)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                ComputeHistogramsImpl(image, sourceRectangle, resourceCreator, channelSelectCount, channelSelects, numberOfBins, valueCount, valueElements);
             });
     }
 
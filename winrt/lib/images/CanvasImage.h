@@ -25,6 +25,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         MinimalRealization          = 8,    // Do the bare minimum to get back an ID2D1Image - no validation or recursive realization
         AllowNullEffectInputs       = 16,   // Allow partially configured effect graphs where some inputs are null
         UnrealizeOnFailure          = 32,   // If an input is invalid, unrealize the effect and return null rather than throwing
+        FoldColorTransforms         = 64,   // Draw chains of linear color effects as a single color matrix (see ICanvasEffect::FoldColorTransforms)
+        RetainRealization           = 128,  // The caller keeps hold of the result (eg. a command list or brush), so its D2D effects must never be recycled
     };
 
     DEFINE_ENUM_FLAG_OPERATORS(GetImageFlags)
@@ -70,6 +72,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
     DeviceContextLease GetDeviceContextForGetBounds(ICanvasDevice* device, ICanvasResourceCreator* resourceCreator);
 
+    // Bitmaps, command lists and virtual bitmaps call NotifyCanvasImageClosed when they are
+    // closed. CanvasEffect compares the count against the one it saw when it last validated
+    // its effect graph, which tells it in O(1) that none of its sources can have been closed.
+    void NotifyCanvasImageClosed();
+    uint64_t GetCanvasImageCloseCount();
+
     class DefaultCanvasImageAdapter;
     
     class CanvasImageAdapter : public Singleton<CanvasImageAdapter, DefaultCanvasImageAdapter>
@@ -163,6 +171,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             uint32_t* valueCount,
             float** valueElements) override;
 
+        IFACEMETHODIMP ComputeHistograms(
+            ICanvasImage* image,
+            Rect sourceRectangle,
+            ICanvasResourceCreator* resourceCreator,
+            uint32_t channelSelectCount,
+            Effects::EffectChannelSelect* channelSelects,
+            int32_t numberOfBins,
+            uint32_t* valueCount,
+            float** valueElements) override;
+
         IFACEMETHODIMP IsHistogramSupported(
             ICanvasDevice* device,
             boolean* result) override;
@@ -0,0 +1,242 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "CanvasReadbackQueue.h"
+#include "CanvasBitmapPixelLock.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // CanvasReadbackQueueFactory implementation
+    //
+
+    IFACEMETHODIMP CanvasReadbackQueueFactory::Create(
+        ICanvasResourceCreator* resourceCreator,
+        int32_t depth,
+        ICanvasReadbackQueue** readbackQueue)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(resourceCreator);
+                CheckAndClearOutPointer(readbackQueue);
+
+                if (depth <= 0)
+                    ThrowHR(E_INVALIDARG);
+
+                ComPtr<ICanvasDevice> device;
+                ThrowIfFailed(resourceCreator->get_Device(&device));
+
+                auto newReadbackQueue = Make<CanvasReadbackQueue>(
+                    device.Get(),
+                    static_cast<uint32_t>(depth));
+                CheckMakeResult(newReadbackQueue);
+
+                ThrowIfFailed(newReadbackQueue.CopyTo(readbackQueue));
+            });
+    }
+
+
+    //
+    // CanvasReadbackQueue implementation
+    //
+
+    CanvasReadbackQueue::CanvasReadbackQueue(
+        ICanvasDevice* device,
+        uint32_t depth)
+        : m_device(device)
+        , m_ring(device, depth)
+    {
+    }
+
+
+    IFACEMETHODIMP CanvasReadbackQueue::Enqueue(
+        ICanvasBitmap* bitmap,
+        ReadbackHandler* handler)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                EnqueueImpl(bitmap, nullptr, handler);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasReadbackQueue::EnqueueWithSubrectangle(
+        ICanvasBitmap* bitmap,
+        int32_t left,
+        int32_t top,
+        int32_t width,
+        int32_t height,
+        ReadbackHandler* handler)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                auto subRectangle = ToD2DRectU(left, top, width, height);
+
+                EnqueueImpl(bitmap, &subRectangle, handler);
+            });
+    }
+
+
+    void CanvasReadbackQueue::EnqueueImpl(
+        ICanvasBitmap* bitmap,
+        D2D1_RECT_U const* subRectangle,
+        ReadbackHandler* handler)
+    {
+        CheckInPointer(bitmap);
+        CheckInPointer(handler);
+
+        RecursiveLock lock(m_mutex);
+
+        auto& device = m_device.EnsureNotClosed();
+
+        ComPtr<ICanvasDevice> bitmapDevice;
+        ThrowIfFailed(As<ICanvasResourceCreator>(bitmap)->get_Device(&bitmapDevice));
+
+        if (!IsSameInstance(bitmapDevice.Get(), device.Get()))
+            ThrowHR(E_INVALIDARG, Strings::ReadbackQueueWrongDevice);
+
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap1>(bitmap);
+
+        D2D1_RECT_U sourceRect;
+
+        if (subRectangle)
+        {
+            sourceRect = *subRectangle;
+        }
+        else
+        {
+            auto size = d2dBitmap->GetPixelSize();
+            sourceRect = D2D1_RECT_U{ 0, 0, size.width, size.height };
+        }
+
+        uint32_t bytesPerRow;
+        uint32_t rowCount;
+        GetSubRectangleRows(d2dBitmap, sourceRect, &bytesPerRow, &rowCount);
+
+        ComPtr<ReadbackHandler> handlerPtr(handler);
+
+        m_ring.Enqueue(
+            d2dBitmap.Get(),
+            sourceRect,
+            [=] (std::unique_ptr<ScopedBitmapMappedPixelAccess>&& pixels, ID2D1Bitmap1* stagingBitmap)
+            {
+                auto pixelLock = Make<CanvasBitmapPixelLock>(
+                    stagingBitmap,
+                    std::move(pixels),
+                    bytesPerRow,
+                    rowCount);
+                CheckMakeResult(pixelLock);
+
+                // The ring reuses the staging bitmap, so the lock must not outlive the handler.
+                auto closeLock = MakeScopeWarden([&] { pixelLock->Close(); });
+
+                ThrowIfFailed(handlerPtr->Invoke(this, pixelLock.Get()));
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasReadbackQueue::Poll(
+        int32_t* completedCount)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(completedCount);
+
+                RecursiveLock lock(m_mutex);
+
+                m_device.EnsureNotClosed();
+
+                *completedCount = static_cast<int32_t>(m_ring.Poll());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasReadbackQueue::Flush(
+        int32_t* completedCount)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(completedCount);
+
+                RecursiveLock lock(m_mutex);
+
+                m_device.EnsureNotClosed();
+
+                *completedCount = static_cast<int32_t>(m_ring.Flush());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasReadbackQueue::get_Depth(
+        int32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                RecursiveLock lock(m_mutex);
+
+                m_device.EnsureNotClosed();
+
+                *value = static_cast<int32_t>(m_ring.GetDepth());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasReadbackQueue::get_PendingCount(
+        int32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                RecursiveLock lock(m_mutex);
+
+                m_device.EnsureNotClosed();
+
+                *value = static_cast<int32_t>(m_ring.GetPendingCount());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasReadbackQueue::Close()
+    {
+        RecursiveLock lock(m_mutex);
+
+        // Outstanding handlers are never called.
+        m_ring.Clear();
+        m_device.Close();
+
+        return S_OK;
+    }
+
+
+    IFACEMETHODIMP CanvasReadbackQueue::get_Device(
+        ICanvasDevice** value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(value);
+
+                auto& device = m_device.EnsureNotClosed();
+                ThrowIfFailed(device.CopyTo(value));
+            });
+    }
+
+    ActivatableClassWithFactory(CanvasReadbackQueue, CanvasReadbackQueueFactory);
+}}}}
+
+#endif
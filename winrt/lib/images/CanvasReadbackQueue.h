@@ -0,0 +1,112 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "ReadbackRing.h"
+#include "utils/LockUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    using namespace ::Microsoft::WRL;
+    using namespace ABI::Windows::Foundation;
+
+    class CanvasReadbackQueueFactory
+        : public AgileActivationFactory<ICanvasReadbackQueueFactory>
+        , private LifespanTracker<CanvasReadbackQueueFactory>
+    {
+        InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasReadbackQueue, BaseTrust);
+
+    public:
+        IFACEMETHODIMP Create(
+            ICanvasResourceCreator* resourceCreator,
+            int32_t depth,
+            ICanvasReadbackQueue** readbackQueue) override;
+    };
+
+
+    //
+    // Reads bitmaps back to the CPU without waiting for the GPU to catch up.
+    //
+    // Enqueue only starts the copy.  The handler is called from a later Poll
+    // (typically made once per frame) after the GPU has finished with it, and
+    // is given a Read mode CanvasBitmapPixelLock that points straight at the
+    // mapped staging bitmap.  The queue closes the lock when the handler
+    // returns.
+    //
+    class CanvasReadbackQueue
+        : public RuntimeClass<
+            ICanvasReadbackQueue,
+            IClosable,
+            ICanvasResourceCreator>
+        , private LifespanTracker<CanvasReadbackQueue>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_CanvasReadbackQueue, BaseTrust);
+
+        typedef ITypedEventHandler<CanvasReadbackQueue*, CanvasBitmapPixelLock*> ReadbackHandler;
+
+        // Recursive, because handlers are called with the lock held and are
+        // allowed to use the queue.
+        std::recursive_mutex m_mutex;
+
+        ClosablePtr<ICanvasDevice> m_device;
+        ReadbackRing m_ring;
+
+    public:
+        CanvasReadbackQueue(
+            ICanvasDevice* device,
+            uint32_t depth);
+
+        //
+        // ICanvasReadbackQueue
+        //
+
+        IFACEMETHODIMP Enqueue(
+            ICanvasBitmap* bitmap,
+            ReadbackHandler* handler) override;
+
+        IFACEMETHODIMP EnqueueWithSubrectangle(
+            ICanvasBitmap* bitmap,
+            int32_t left,
+            int32_t top,
+            int32_t width,
+            int32_t height,
+            ReadbackHandler* handler) override;
+
+        IFACEMETHODIMP Poll(
+            int32_t* completedCount) override;
+
+        IFACEMETHODIMP Flush(
+            int32_t* completedCount) override;
+
+        IFACEMETHODIMP get_Depth(
+            int32_t* value) override;
+
+        IFACEMETHODIMP get_PendingCount(
+            int32_t* value) override;
+
+        //
+        // IClosable
+        //
+
+        IFACEMETHODIMP Close() override;
+
+        //
+        // ICanvasResourceCreator
+        //
+
+        IFACEMETHODIMP get_Device(
+            ICanvasDevice** value) override;
+
+    private:
+        void EnqueueImpl(
+            ICanvasBitmap* bitmap,
+            D2D1_RECT_U const* subRectangle,
+            ReadbackHandler* handler);
+    };
+}}}}
+
+#endif
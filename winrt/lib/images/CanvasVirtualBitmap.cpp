@@ -363,6 +363,7 @@ CanvasVirtualBitmap::CanvasVirtualBitmap(
 IFACEMETHODIMP CanvasVirtualBitmap::Close()
 {
     HRESULT hr = ResourceWrapper::Close();
+    NotifyCanvasImageClosed();
     if (FAILED(hr))
         return hr;
 
@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "DecodedBitmapCache.h"
+#include "utils/HashUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // DecodedBitmapKey implementation
+    //
+
+
+    size_t DecodedBitmapKey::GetHash() const
+    {
+        size_t hash = HashBytes(HashSeed, Name.data(), Name.size() * sizeof(wchar_t));
+
+        hash = HashValue(hash, Size);
+        hash = HashValue(hash, LastWriteTime);
+
+        return hash;
+    }
+
+
+    bool DecodedBitmapKey::operator==(DecodedBitmapKey const& other) const
+    {
+        return Name == other.Name &&
+               Size == other.Size &&
+               LastWriteTime == other.LastWriteTime;
+    }
+
+
+    //
+    // DecodedBitmapCache implementation
+    //
+
+
+    DecodedBitmapCache::DecodedBitmapCache()
+        : m_maximumSizeInBytes(0)
+        , m_sizeInBytes(0)
+        , m_hitCount(0)
+        , m_missCount(0)
+    {
+    }
+
+
+    bool DecodedBitmapCache::IsEnabled()
+    {
+        Lock lock(m_mutex);
+        return m_maximumSizeInBytes > 0;
+    }
+
+
+    uint64_t DecodedBitmapCache::GetMaximumSizeInBytes()
+    {
+        Lock lock(m_mutex);
+        return m_maximumSizeInBytes;
+    }
+
+
+    void DecodedBitmapCache::SetMaximumSizeInBytes(uint64_t value)
+    {
+        Lock lock(m_mutex);
+
+        m_maximumSizeInBytes = value;
+
+        TrimTo(lock, value);
+    }
+
+
+    ComPtr<IWICBitmapSource> DecodedBitmapCache::TryGet(DecodedBitmapKey const& key)
+    {
+        Lock lock(m_mutex);
+
+        auto entry = Find(lock, key.GetHash(), key);
+
+        if (entry == m_entries.end())
+        {
+            ++m_missCount;
+            return nullptr;
+        }
+
+        ++m_hitCount;
+
+        m_entries.MoveToFront(entry);
+
+        return entry->Value.Bitmap;
+    }
+
+
+    void DecodedBitmapCache::Add(DecodedBitmapKey const& key, ComPtr<IWICBitmapSource> const& value, uint64_t sizeInBytes)
+    {
+        assert(value);
+
+        Lock lock(m_mutex);
+
+        auto hash = key.GetHash();
+
+        // Two loads of the same file can both miss, in which case the second
+        // one to finish replaces the first.
+        auto existing = Find(lock, hash, key);
+
+        if (existing != m_entries.end())
+            RemoveEntry(lock, existing);
+
+        if (m_maximumSizeInBytes == 0 || sizeInBytes > m_maximumSizeInBytes)
+            return;
+
+        TrimTo(lock, m_maximumSizeInBytes - sizeInBytes);
+
+        m_entries.AddToFront(hash, Entry{ key, value, sizeInBytes });
+
+        m_sizeInBytes += sizeInBytes;
+    }
+
+
+    void DecodedBitmapCache::Trim(uint64_t targetSizeInBytes)
+    {
+        Lock lock(m_mutex);
+
+        TrimTo(lock, targetSizeInBytes);
+    }
+
+
+    uint64_t DecodedBitmapCache::GetSizeInBytes()
+    {
+        Lock lock(m_mutex);
+        return m_sizeInBytes;
+    }
+
+
+    size_t DecodedBitmapCache::GetEntryCount()
+    {
+        Lock lock(m_mutex);
+        return m_entries.Size();
+    }
+
+
+    uint64_t DecodedBitmapCache::GetHitCount()
+    {
+        Lock lock(m_mutex);
+        return m_hitCount;
+    }
+
+
+    uint64_t DecodedBitmapCache::GetMissCount()
+    {
+        Lock lock(m_mutex);
+        return m_missCount;
+    }
+
+
+    DecodedBitmapCache::EntryList::iterator DecodedBitmapCache::Find(Lock const& lock, size_t hash, DecodedBitmapKey const& key)
+    {
+        MustOwnLock(lock);
+
+        return m_entries.Find(hash, [&](Entry const& entry) { return entry.Key == key; });
+    }
+
+
+    void DecodedBitmapCache::TrimTo(Lock const& lock, uint64_t targetSizeInBytes)
+    {
+        MustOwnLock(lock);
+
+        while (m_sizeInBytes > targetSizeInBytes)
+        {
+            m_sizeInBytes -= m_entries.Oldest().SizeInBytes;
+            m_entries.RemoveOldest();
+        }
+    }
+
+
+    void DecodedBitmapCache::RemoveEntry(Lock const& lock, EntryList::iterator entry)
+    {
+        MustOwnLock(lock);
+
+        m_sizeInBytes -= entry->Value.SizeInBytes;
+
+        m_entries.Remove(entry);
+    }
+}}}}
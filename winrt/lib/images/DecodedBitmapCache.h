@@ -0,0 +1,107 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+#include "utils/LruList.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    using namespace ::Microsoft::WRL;
+
+    //
+    // Identifies the contents of an image file: its normalized path or URI,
+    // plus the size and last write time of the file.  A file that is
+    // rewritten in place gets a new key, so stale pixels are never returned.
+    //
+    struct DecodedBitmapKey
+    {
+        std::wstring Name;
+        uint64_t Size;
+        uint64_t LastWriteTime;
+
+        size_t GetHash() const;
+
+        bool operator==(DecodedBitmapKey const& other) const;
+    };
+
+
+    //
+    // Process-wide cache of decoded images, used by CanvasBitmap.LoadAsync
+    // when loading from a file name or URI.  Entries are WIC bitmaps held in
+    // system memory, so they are not tied to any device; loading an image
+    // that is already here only needs to upload it.
+    //
+    // The cache is disabled until the app gives it a maximum size (through
+    // CanvasBitmapCache).  It then holds up to that many bytes of pixels,
+    // discarding the least recently used entries to make room.
+    //
+    // The instance is kept alive by the CanvasBitmap and CanvasBitmapCache
+    // activation factories, so its contents and settings outlive any one
+    // load.
+    //
+    class DecodedBitmapCache : public Singleton<DecodedBitmapCache>
+    {
+        struct Entry
+        {
+            DecodedBitmapKey Key;
+            ComPtr<IWICBitmapSource> Bitmap;
+            uint64_t SizeInBytes;
+        };
+
+        typedef LruList<Entry> EntryList;
+
+        std::mutex m_mutex;
+
+        // Indexed by key hash; different keys may share a hash
+        EntryList m_entries;
+
+        uint64_t m_maximumSizeInBytes;
+        uint64_t m_sizeInBytes;
+        uint64_t m_hitCount;
+        uint64_t m_missCount;
+
+    public:
+        DecodedBitmapCache();
+
+        DecodedBitmapCache(DecodedBitmapCache const&) = delete;
+        DecodedBitmapCache& operator=(DecodedBitmapCache const&) = delete;
+
+        bool IsEnabled();
+
+        uint64_t GetMaximumSizeInBytes();
+
+        // Lowering the maximum discards entries until the cache fits.  Zero
+        // disables the cache and empties it.
+        void SetMaximumSizeInBytes(uint64_t value);
+
+        //
+        // Returns the cached image for key, or null if there is none.
+        //
+        ComPtr<IWICBitmapSource> TryGet(DecodedBitmapKey const& key);
+
+        //
+        // Adds an image, replacing any existing entry with the same key.
+        // Images bigger than the whole cache are not added.
+        //
+        void Add(DecodedBitmapKey const& key, ComPtr<IWICBitmapSource> const& value, uint64_t sizeInBytes);
+
+        //
+        // Discards least recently used entries until no more than
+        // targetSizeInBytes remain.
+        //
+        void Trim(uint64_t targetSizeInBytes);
+
+        uint64_t GetSizeInBytes();
+        size_t GetEntryCount();
+        uint64_t GetHitCount();
+        uint64_t GetMissCount();
+
+    private:
+        EntryList::iterator Find(Lock const& lock, size_t hash, DecodedBitmapKey const& key);
+        void TrimTo(Lock const& lock, uint64_t targetSizeInBytes);
+        void RemoveEntry(Lock const& lock, EntryList::iterator entry);
+    };
+}}}}
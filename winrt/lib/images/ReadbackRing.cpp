@@ -0,0 +1,159 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "ReadbackRing.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    ReadbackRing::ReadbackRing(ICanvasDevice* device, uint32_t depth)
+        : m_device(As<ICanvasDeviceInternal>(device))
+        , m_slots(depth)
+        , m_oldest(0)
+        , m_pendingCount(0)
+        , m_clearCount(0)
+    {
+        assert(depth > 0);
+    }
+
+
+    void ReadbackRing::Enqueue(ID2D1Bitmap1* sourceBitmap, D2D1_RECT_U const& sourceRect, Callback&& callback)
+    {
+        assert(sourceRect.right > sourceRect.left);
+        assert(sourceRect.bottom > sourceRect.top);
+
+        // A callback run from here may itself enqueue, hence the loop.
+        while (m_pendingCount == m_slots.size())
+        {
+            CompleteOldest();
+        }
+
+        auto& slot = m_slots[(m_oldest + m_pendingCount) % m_slots.size()];
+
+        D2D1_SIZE_U size{ sourceRect.right - sourceRect.left, sourceRect.bottom - sourceRect.top };
+
+        EnsureStagingBitmap(slot, size, sourceBitmap->GetPixelFormat());
+
+        ThrowIfFailed(slot.StagingBitmap->CopyFromBitmap(nullptr, sourceBitmap, &sourceRect));
+
+        slot.Fence = m_device->InsertGpuFence();
+        slot.OnComplete = std::move(callback);
+
+        m_pendingCount++;
+    }
+
+
+    uint32_t ReadbackRing::Poll()
+    {
+        uint32_t completedCount = 0;
+
+        while (m_pendingCount > 0 && m_slots[m_oldest].Fence->IsComplete())
+        {
+            CompleteOldest();
+            completedCount++;
+        }
+
+        return completedCount;
+    }
+
+
+    uint32_t ReadbackRing::Flush()
+    {
+        // Requests enqueued by the callbacks are left for next time.  A
+        // callback may also flush or clear the ring itself, so stop as soon
+        // as it is empty.
+        uint32_t const requestCount = m_pendingCount;
+        uint32_t completedCount = 0;
+
+        while (completedCount < requestCount && m_pendingCount > 0)
+        {
+            CompleteOldest();
+            completedCount++;
+        }
+
+        return completedCount;
+    }
+
+
+    void ReadbackRing::Clear()
+    {
+        for (auto& slot : m_slots)
+        {
+            slot = Slot();
+        }
+
+        m_oldest = 0;
+        m_pendingCount = 0;
+        m_clearCount++;
+    }
+
+
+    void ReadbackRing::EnsureStagingBitmap(Slot& slot, D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format)
+    {
+        if (slot.StagingBitmap)
+        {
+            auto stagingSize = slot.StagingBitmap->GetPixelSize();
+            auto stagingFormat = slot.StagingBitmap->GetPixelFormat();
+
+            if (stagingSize.width == size.width &&
+                stagingSize.height == size.height &&
+                stagingFormat.format == format.format &&
+                stagingFormat.alphaMode == format.alphaMode)
+            {
+                return;
+            }
+
+            slot.StagingBitmap.Reset();
+        }
+
+        auto bitmapProperties = D2D1::BitmapProperties1(
+            D2D1_BITMAP_OPTIONS_CPU_READ | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+            format);
+
+        auto deviceContext = m_device->GetResourceCreationDeviceContext();
+
+        ThrowIfFailed(deviceContext->CreateBitmap(
+            size,
+            nullptr,
+            0,
+            &bitmapProperties,
+            &slot.StagingBitmap));
+    }
+
+
+    void ReadbackRing::CompleteOldest()
+    {
+        assert(m_pendingCount > 0);
+
+        auto& slot = m_slots[m_oldest];
+
+        // Pop the request before calling back, so that the callback sees a
+        // consistent ring.  If it enqueues into this same slot, a new
+        // staging bitmap is created rather than reusing the mapped one.
+        auto stagingBitmap = std::move(slot.StagingBitmap);
+        auto callback = std::move(slot.OnComplete);
+        slot.Fence.reset();
+
+        m_oldest = (m_oldest + 1) % m_slots.size();
+        m_pendingCount--;
+
+        auto clearCount = m_clearCount;
+
+        {
+            // Map waits for the copy, if the fence hasn't already said it's done.
+            auto pixels = std::make_unique<ScopedBitmapMappedPixelAccess>(stagingBitmap.Get());
+
+            callback(std::move(pixels), stagingBitmap.Get());
+        }
+
+        // Don't hand the staging bitmap back if the callback cleared the ring.
+        if (!slot.StagingBitmap && clearCount == m_clearCount)
+            slot.StagingBitmap = std::move(stagingBitmap);
+    }
+}}}}
+
+#endif
@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "ScopedBitmapMappedPixelAccess.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // A fixed number of CPU readable staging bitmaps, used in turn so that
+    // reading pixels back from the GPU doesn't stall it.
+    //
+    // Enqueue copies from the source bitmap into the next free staging
+    // bitmap, and inserts a GpuFence after the copy.  Poll then maps, oldest
+    // first, the staging bitmaps whose fences have completed, and hands the
+    // mapped pixels to each request's callback.  Staging bitmaps are reused
+    // for as long as the size and format of the requests stay the same.
+    //
+    // If Enqueue finds every staging bitmap still in use, it completes the
+    // oldest request first, which waits for the GPU if it has to.
+    //
+    // Callbacks may call back into the ring, including Flush and Clear, but
+    // must be done with the mapped pixels by the time they return.  The ring
+    // is not thread safe.
+    //
+    class ReadbackRing
+    {
+    public:
+        typedef std::function<void(std::unique_ptr<ScopedBitmapMappedPixelAccess>&& pixels, ID2D1Bitmap1* stagingBitmap)> Callback;
+
+        ReadbackRing(ICanvasDevice* device, uint32_t depth);
+
+        void Enqueue(ID2D1Bitmap1* sourceBitmap, D2D1_RECT_U const& sourceRect, Callback&& callback);
+
+        // Completes the requests whose copies have finished, without
+        // waiting.  Returns how many were completed.
+        uint32_t Poll();
+
+        // Completes every outstanding request, waiting for the GPU as
+        // needed.  Returns how many were completed.
+        uint32_t Flush();
+
+        // Drops outstanding requests without calling their callbacks, and
+        // releases the staging bitmaps.
+        void Clear();
+
+        uint32_t GetDepth() const { return static_cast<uint32_t>(m_slots.size()); }
+        uint32_t GetPendingCount() const { return m_pendingCount; }
+
+    private:
+        struct Slot
+        {
+            ComPtr<ID2D1Bitmap1> StagingBitmap;
+            std::unique_ptr<GpuFence> Fence;
+            Callback OnComplete;
+        };
+
+        ComPtr<ICanvasDeviceInternal> m_device;
+        std::vector<Slot> m_slots;
+        uint32_t m_oldest;
+        uint32_t m_pendingCount;
+
+        // Bumped by Clear, so CompleteOldest can tell if a callback cleared
+        // the ring.
+        uint32_t m_clearCount;
+
+        void EnsureStagingBitmap(Slot& slot, D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format);
+        void CompleteOldest();
+    };
+}}}}
+
+#endif
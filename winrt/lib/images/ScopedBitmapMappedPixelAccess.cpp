@@ -52,6 +52,17 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     }
 
 
+    ScopedBitmapMappedPixelAccess::ScopedBitmapMappedPixelAccess(ID2D1Bitmap1* stagingBitmap)
+        : m_stagingResource(stagingBitmap)
+    {
+        ThrowIfFailed(m_stagingResource->Map(
+            D2D1_MAP_OPTIONS_READ,
+            &m_mappedSubresource));
+
+        m_lockedBufferSize = m_mappedSubresource.pitch * m_stagingResource->GetPixelSize().height;
+    }
+
+
     ScopedBitmapMappedPixelAccess::~ScopedBitmapMappedPixelAccess()
     {
         ThrowIfFailed(m_stagingResource->Unmap());
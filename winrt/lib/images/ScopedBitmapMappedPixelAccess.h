@@ -16,6 +16,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
     public:
         ScopedBitmapMappedPixelAccess(ICanvasDevice* device, ID2D1Bitmap1* d2dBitmap, D2D1_RECT_U const* optionalSubRectangle = nullptr);
+
+        // Maps a CPU readable staging bitmap that the caller has already copied into.
+        explicit ScopedBitmapMappedPixelAccess(ID2D1Bitmap1* stagingBitmap);
+
         ~ScopedBitmapMappedPixelAccess();
 
         uint8_t* GetLockedData()           const { return m_mappedSubresource.bits; }
@@ -130,6 +130,9 @@
 #include "images/CanvasImage.h"
 #include "images/CanvasBitmap.h"
 #include "images/CanvasRenderTarget.h"
+#include "effects/ColorMatrixFolding.h"
+#include "effects/EffectPropertyStorage.h"
+#include "effects/RealizedEffectCache.h"
 #include "effects/CanvasEffect.h"
 #include "brushes/CanvasBrush.h"
 #include "brushes/CanvasImageBrush.h"
@@ -3,6 +3,7 @@
 // Licensed under the MIT License. See LICENSE.txt in the project root for license information.
 
 #include "pch.h"
+#include "PixelConversion.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
@@ -188,13 +189,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     {
         std::vector<uint8_t> convertedBytes(colorCount * 4);
 
-        for (uint32_t i = 0; i < colorCount; i++)
-        {
-            convertedBytes[i * 4 + 0] = colors[i].B;
-            convertedBytes[i * 4 + 1] = colors[i].G;
-            convertedBytes[i * 4 + 2] = colors[i].R;
-            convertedBytes[i * 4 + 3] = colors[i].A;
-        }
+        PixelConversion::ColorsToBgra(colors, convertedBytes.data(), colorCount);
 
         assert(convertedBytes.size() <= UINT_MAX);
 
@@ -207,13 +202,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     {
         std::vector<uint8_t> convertedBytes(colorCount * 4);
 
-        for (uint32_t i = 0; i < colorCount; i++)
-        {
-            convertedBytes[i * 4 + 0] = colors[i].R;
-            convertedBytes[i * 4 + 1] = colors[i].G;
-            convertedBytes[i * 4 + 2] = colors[i].B;
-            convertedBytes[i * 4 + 3] = colors[i].A;
-        }
+        PixelConversion::ColorsToRgba(colors, convertedBytes.data(), colorCount);
 
         assert(convertedBytes.size() <= UINT_MAX);
 
@@ -9,5 +9,27 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     ComArray<BYTE> GetSha1Hash(BYTE const* data, size_t dataSize);
 
     IID GetVersion5Uuid(IID const& namespaceId, BYTE const* name, size_t nameSize);
-    
+
+
+    // FNV-1a, for hashing cache keys.  Start from HashSeed and chain the calls.
+    size_t const HashSeed = (sizeof(size_t) == 8) ? static_cast<size_t>(14695981039346656037ULL) : 2166136261U;
+
+    inline size_t HashBytes(size_t hash, void const* data, size_t size)
+    {
+        auto bytes = static_cast<uint8_t const*>(data);
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= (sizeof(size_t) == 8) ? static_cast<size_t>(1099511628211ULL) : 16777619U;
+        }
+
+        return hash;
+    }
+
+    template<typename T>
+    size_t HashValue(size_t hash, T const& value)
+    {
+        return HashBytes(hash, &value, sizeof(value));
+    }
 }}}}
@@ -0,0 +1,124 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include <list>
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Storage shared by Win2D's caches: a list of values ordered from most to
+    // least recently used, indexed by hash.  Different values may share a
+    // hash, so lookups take a predicate to pick out the right one.
+    //
+    // This does no locking of its own; each cache holds its own lock around
+    // all calls, along with whatever else (counters, sizes) it keeps track
+    // of.
+    //
+    template<typename T>
+    class LruList
+    {
+    public:
+        struct Entry
+        {
+            size_t Hash;
+            T Value;
+        };
+
+        typedef std::list<Entry> EntryList;
+        typedef typename EntryList::iterator iterator;
+
+    private:
+        // Most recently used at the front
+        EntryList m_entries;
+
+        // Maps hashes to entries
+        std::unordered_multimap<size_t, iterator> m_index;
+
+    public:
+        LruList() = default;
+
+        LruList(LruList const&) = delete;
+        LruList& operator=(LruList const&) = delete;
+
+        iterator begin() { return m_entries.begin(); }
+        iterator end() { return m_entries.end(); }
+
+        size_t Size() const { return m_entries.size(); }
+
+        //
+        // Returns the first entry with this hash whose value satisfies
+        // isMatch, or end() if there is none.  Does not change the order.
+        //
+        template<typename PREDICATE>
+        iterator Find(size_t hash, PREDICATE&& isMatch)
+        {
+            auto range = m_index.equal_range(hash);
+
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (isMatch(it->second->Value))
+                    return it->second;
+            }
+
+            return m_entries.end();
+        }
+
+        void MoveToFront(iterator entry)
+        {
+            m_entries.splice(m_entries.begin(), m_entries, entry);
+        }
+
+        iterator AddToFront(size_t hash, T value)
+        {
+            m_entries.push_front(Entry{ hash, std::move(value) });
+            m_index.emplace(hash, m_entries.begin());
+
+            return m_entries.begin();
+        }
+
+        void Remove(iterator entry)
+        {
+            auto range = m_index.equal_range(entry->Hash);
+
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second == entry)
+                {
+                    m_index.erase(it);
+                    break;
+                }
+            }
+
+            m_entries.erase(entry);
+        }
+
+        T& Oldest()
+        {
+            assert(!m_entries.empty());
+            return m_entries.back().Value;
+        }
+
+        void RemoveOldest()
+        {
+            assert(!m_entries.empty());
+            Remove(std::prev(m_entries.end()));
+        }
+
+        // Discards least recently used entries until no more than maxEntries
+        // remain.
+        void TrimToCount(size_t maxEntries)
+        {
+            while (m_entries.size() > maxEntries)
+                RemoveOldest();
+        }
+
+        void Clear()
+        {
+            m_index.clear();
+            m_entries.clear();
+        }
+    };
+}}}}
@@ -0,0 +1,331 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "PixelConversion.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#define PIXEL_CONVERSION_X86
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(_M_ARM64)
+#define PIXEL_CONVERSION_NEON
+#include <arm64_neon.h>
+#elif defined(_M_ARM)
+#define PIXEL_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace PixelConversion
+{
+    using namespace ::ABI::Windows::UI;
+
+    static_assert(sizeof(Color) == 4 &&
+                  offsetof(Color, A) == 0 &&
+                  offsetof(Color, R) == 1 &&
+                  offsetof(Color, G) == 2 &&
+                  offsetof(Color, B) == 3,
+                  "PixelConversion relies on the layout of Windows::UI::Color");
+
+    //
+    // There are only two distinct shuffles.  Reading each pixel as a little
+    // endian uint32, Color <-> B8G8R8A8 reverses the bytes and
+    // Color -> R8G8B8A8 rotates them right by 8 bits.  Each is described by
+    // a struct that provides the operation for every kernel.
+    //
+
+    struct ReverseBytes
+    {
+        static uint32_t Scalar(uint32_t pixel)
+        {
+            return _byteswap_ulong(pixel);
+        }
+
+#ifdef PIXEL_CONVERSION_X86
+        static __m128i Sse2(__m128i pixels)
+        {
+            // Swap the 16 bit halves of each pixel, then the bytes within each half.
+            pixels = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(2, 3, 0, 1));
+            pixels = _mm_shufflehi_epi16(pixels, _MM_SHUFFLE(2, 3, 0, 1));
+
+            return _mm_or_si128(_mm_slli_epi16(pixels, 8), _mm_srli_epi16(pixels, 8));
+        }
+
+        static __m128i ShuffleMask()
+        {
+            return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        }
+#endif
+
+#ifdef PIXEL_CONVERSION_NEON
+        static uint8x16_t Neon(uint8x16_t pixels)
+        {
+            return vrev32q_u8(pixels);
+        }
+#endif
+    };
+
+    struct RotateRight8
+    {
+        static uint32_t Scalar(uint32_t pixel)
+        {
+            return _rotr(pixel, 8);
+        }
+
+#ifdef PIXEL_CONVERSION_X86
+        static __m128i Sse2(__m128i pixels)
+        {
+            return _mm_or_si128(_mm_srli_epi32(pixels, 8), _mm_slli_epi32(pixels, 24));
+        }
+
+        static __m128i ShuffleMask()
+        {
+            return _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+        }
+#endif
+
+#ifdef PIXEL_CONVERSION_NEON
+        static uint8x16_t Neon(uint8x16_t pixels)
+        {
+            auto words = vreinterpretq_u32_u8(pixels);
+            return vreinterpretq_u8_u32(vorrq_u32(vshrq_n_u32(words, 8), vshlq_n_u32(words, 24)));
+        }
+#endif
+    };
+
+
+    //
+    // Kernels.  Each one handles as many whole vectors as it can, and leaves
+    // the remaining pixels to the scalar version.  Loads and stores are
+    // unaligned, since neither the caller's arrays nor mapped bitmap rows
+    // come with any alignment guarantee.
+    //
+
+    template<typename OP>
+    static void ConvertScalar(uint8_t const* source, uint8_t* destination, size_t pixelCount)
+    {
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            uint32_t pixel;
+            memcpy(&pixel, source + i * 4, 4);
+
+            pixel = OP::Scalar(pixel);
+
+            memcpy(destination + i * 4, &pixel, 4);
+        }
+    }
+
+#ifdef PIXEL_CONVERSION_X86
+
+    template<typename OP>
+    static void ConvertSse2(uint8_t const* source, uint8_t* destination, size_t pixelCount)
+    {
+        size_t vectorCount = pixelCount / 4;
+
+        for (size_t i = 0; i < vectorCount; i++)
+        {
+            auto pixels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i * 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 16), OP::Sse2(pixels));
+        }
+
+        size_t done = vectorCount * 4;
+        ConvertScalar<OP>(source + done * 4, destination + done * 4, pixelCount - done);
+    }
+
+    template<typename OP>
+    static void ConvertSsse3(uint8_t const* source, uint8_t* destination, size_t pixelCount)
+    {
+        auto mask = OP::ShuffleMask();
+
+        size_t vectorCount = pixelCount / 4;
+
+        for (size_t i = 0; i < vectorCount; i++)
+        {
+            auto pixels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i * 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 16), _mm_shuffle_epi8(pixels, mask));
+        }
+
+        size_t done = vectorCount * 4;
+        ConvertScalar<OP>(source + done * 4, destination + done * 4, pixelCount - done);
+    }
+
+    template<typename OP>
+    static void ConvertAvx2(uint8_t const* source, uint8_t* destination, size_t pixelCount)
+    {
+        // vpshufb shuffles within each 128 bit lane, which is all a per-pixel shuffle needs.
+        auto mask = _mm256_broadcastsi128_si256(OP::ShuffleMask());
+
+        size_t vectorCount = pixelCount / 8;
+
+        for (size_t i = 0; i < vectorCount; i++)
+        {
+            auto pixels = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source + i * 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 32), _mm256_shuffle_epi8(pixels, mask));
+        }
+
+        // Avoid AVX/SSE transition penalties in whatever runs next.
+        _mm256_zeroupper();
+
+        size_t done = vectorCount * 8;
+        ConvertSsse3<OP>(source + done * 4, destination + done * 4, pixelCount - done);
+    }
+
+    struct ProcessorFeatures
+    {
+        bool Sse2;
+        bool Ssse3;
+        bool Avx2;
+
+        ProcessorFeatures()
+        {
+            int info[4];
+
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+
+            __cpuid(info, 1);
+            Sse2 = (info[3] & (1 << 26)) != 0;
+            Ssse3 = (info[2] & (1 << 9)) != 0;
+
+            // AVX2 also needs the OS to save the upper halves of the YMM registers.
+            bool osSavesYmm = (info[2] & (1 << 27)) != 0 &&
+                              (info[2] & (1 << 28)) != 0 &&
+                              (_xgetbv(0) & 6) == 6;
+
+            Avx2 = false;
+
+            if (osSavesYmm && maxLeaf >= 7)
+            {
+                __cpuidex(info, 7, 0);
+                Avx2 = (info[1] & (1 << 5)) != 0;
+            }
+        }
+    };
+
+    static ProcessorFeatures const& GetProcessorFeatures()
+    {
+        static const ProcessorFeatures features;
+        return features;
+    }
+
+#endif
+
+#ifdef PIXEL_CONVERSION_NEON
+
+    template<typename OP>
+    static void ConvertNeon(uint8_t const* source, uint8_t* destination, size_t pixelCount)
+    {
+        size_t vectorCount = pixelCount / 4;
+
+        for (size_t i = 0; i < vectorCount; i++)
+        {
+            auto pixels = vld1q_u8(source + i * 16);
+            vst1q_u8(destination + i * 16, OP::Neon(pixels));
+        }
+
+        size_t done = vectorCount * 4;
+        ConvertScalar<OP>(source + done * 4, destination + done * 4, pixelCount - done);
+    }
+
+#endif
+
+
+    bool IsKernelSupported(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::Scalar:
+            return true;
+
+#ifdef PIXEL_CONVERSION_X86
+        case Kernel::Sse2:
+            return GetProcessorFeatures().Sse2;
+
+        case Kernel::Ssse3:
+            return GetProcessorFeatures().Ssse3;
+
+        case Kernel::Avx2:
+            return GetProcessorFeatures().Avx2;
+#endif
+
+#ifdef PIXEL_CONVERSION_NEON
+        case Kernel::Neon:
+            // Windows on ARM always has NEON.
+            return true;
+#endif
+
+        default:
+            return false;
+        }
+    }
+
+
+    Kernel GetBestKernel()
+    {
+        static const Kernel best = []
+        {
+            Kernel candidates[] = { Kernel::Avx2, Kernel::Ssse3, Kernel::Sse2, Kernel::Neon };
+
+            for (auto kernel : candidates)
+            {
+                if (IsKernelSupported(kernel))
+                    return kernel;
+            }
+
+            return Kernel::Scalar;
+        }();
+
+        return best;
+    }
+
+
+    template<typename OP>
+    static void Convert(Kernel kernel, uint8_t const* source, uint8_t* destination, size_t pixelCount)
+    {
+        assert(IsKernelSupported(kernel));
+
+        switch (kernel)
+        {
+#ifdef PIXEL_CONVERSION_X86
+        case Kernel::Sse2:
+            ConvertSse2<OP>(source, destination, pixelCount);
+            break;
+
+        case Kernel::Ssse3:
+            ConvertSsse3<OP>(source, destination, pixelCount);
+            break;
+
+        case Kernel::Avx2:
+            ConvertAvx2<OP>(source, destination, pixelCount);
+            break;
+#endif
+
+#ifdef PIXEL_CONVERSION_NEON
+        case Kernel::Neon:
+            ConvertNeon<OP>(source, destination, pixelCount);
+            break;
+#endif
+
+        default:
+            ConvertScalar<OP>(source, destination, pixelCount);
+            break;
+        }
+    }
+
+
+    void BgraToColors(Kernel kernel, uint8_t const* source, Color* destination, size_t pixelCount)
+    {
+        Convert<ReverseBytes>(kernel, source, reinterpret_cast<uint8_t*>(destination), pixelCount);
+    }
+
+    void ColorsToBgra(Kernel kernel, Color const* source, uint8_t* destination, size_t pixelCount)
+    {
+        Convert<ReverseBytes>(kernel, reinterpret_cast<uint8_t const*>(source), destination, pixelCount);
+    }
+
+    void ColorsToRgba(Kernel kernel, Color const* source, uint8_t* destination, size_t pixelCount)
+    {
+        Convert<RotateRight8>(kernel, reinterpret_cast<uint8_t const*>(source), destination, pixelCount);
+    }
+}}}}}
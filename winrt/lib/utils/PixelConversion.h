@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace PixelConversion
+{
+    //
+    // Conversions between Windows::UI::Color (whose bytes are in A, R, G, B
+    // order) and 32 bit per pixel formats.  Each conversion is a fixed
+    // shuffle of the bytes within every pixel, so there are vectorized
+    // versions for whatever the processor supports, plus a portable scalar
+    // one.  GetBestKernel picks between them at runtime.
+    //
+    // The source and destination may be the same buffer, but must not
+    // otherwise overlap.
+    //
+
+    enum class Kernel
+    {
+        Scalar,
+        Sse2,
+        Ssse3,
+        Avx2,
+        Neon,
+    };
+
+    bool IsKernelSupported(Kernel kernel);
+
+    Kernel GetBestKernel();
+
+    // B8G8R8A8 -> Color.
+    void BgraToColors(Kernel kernel, uint8_t const* source, Windows::UI::Color* destination, size_t pixelCount);
+
+    // Color -> B8G8R8A8.
+    void ColorsToBgra(Kernel kernel, Windows::UI::Color const* source, uint8_t* destination, size_t pixelCount);
+
+    // Color -> R8G8B8A8.
+    void ColorsToRgba(Kernel kernel, Windows::UI::Color const* source, uint8_t* destination, size_t pixelCount);
+
+
+    inline void BgraToColors(uint8_t const* source, Windows::UI::Color* destination, size_t pixelCount)
+    {
+        BgraToColors(GetBestKernel(), source, destination, pixelCount);
+    }
+
+    inline void ColorsToBgra(Windows::UI::Color const* source, uint8_t* destination, size_t pixelCount)
+    {
+        ColorsToBgra(GetBestKernel(), source, destination, pixelCount);
+    }
+
+    inline void ColorsToRgba(Windows::UI::Color const* source, uint8_t* destination, size_t pixelCount)
+    {
+        ColorsToRgba(GetBestKernel(), source, destination, pixelCount);
+    }
+}}}}}
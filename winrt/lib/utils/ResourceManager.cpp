@@ -27,8 +27,9 @@
 #include "svg/CanvasSvgStrokeDashArrayAttribute.h"
 
 
-std::unordered_map<IUnknown*, WeakRef> ResourceManager::m_resources;
-std::recursive_mutex ResourceManager::m_mutex;
+ResourceManager::Shard ResourceManager::m_shards[ResourceManager::ShardCount];
+std::recursive_mutex ResourceManager::m_createMutex;
+std::unordered_map<void const*, size_t> ResourceManager::m_firstCandidateIndices;
 
 // When adding new types here, please also update the "Types that support interop" table in winrt\docsrc\Interop.aml.
 std::vector<ResourceManager::TryCreateFunction> ResourceManager::tryCreateFunctions =
@@ -80,14 +81,27 @@ std::vector<ResourceManager::TryCreateFunction> ResourceManager::tryCreateFuncti
 };
 
 
+// Heap pointers have their low bits clear, so they are mixed (Fibonacci
+// hashing) before picking a shard.
+size_t ResourceManager::GetShardIndex(IUnknown* resourceIdentity)
+{
+    auto value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(resourceIdentity));
+
+    return static_cast<size_t>((value * 0x9E3779B97F4A7C15ULL) >> (64 - ShardBits));
+}
+
+
 // Called by the ResourceWrapper constructor, to add itself to the interop mapping table.
 void ResourceManager::Add(IUnknown* resource, IInspectable* wrapper)
 {
     ComPtr<IUnknown> resourceIdentity = AsUnknown(resource);
+    auto weakWrapper = AsWeak(wrapper);
 
-    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    auto& shard = m_shards[GetShardIndex(resourceIdentity.Get())];
 
-    auto result = m_resources.insert(std::make_pair(resourceIdentity.Get(), AsWeak(wrapper)));
+    std::lock_guard<std::mutex> lock(shard.Mutex);
+
+    auto result = shard.Resources.insert(std::make_pair(resourceIdentity.Get(), std::move(weakWrapper)));
 
     if (!result.second)
         ThrowHR(E_UNEXPECTED);
@@ -99,45 +113,57 @@ void ResourceManager::Remove(IUnknown* resource)
 {
     ComPtr<IUnknown> resourceIdentity = AsUnknown(resource);
 
-    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    auto& shard = m_shards[GetShardIndex(resourceIdentity.Get())];
+
+    std::lock_guard<std::mutex> lock(shard.Mutex);
 
-    auto result = m_resources.erase(resourceIdentity.Get());
+    auto result = shard.Resources.erase(resourceIdentity.Get());
 
     if (result != 1)
         ThrowHR(E_UNEXPECTED);
 }
 
 
-ComPtr<IInspectable> ResourceManager::GetOrCreate(ICanvasDevice* device, IUnknown* resource, float dpi)
+ComPtr<IInspectable> ResourceManager::TryGetExistingWrapper(IUnknown* resourceIdentity)
 {
-    ComPtr<IUnknown> resourceIdentity = AsUnknown(resource);
-    ComPtr<IInspectable> wrapper;
-
-    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    auto& shard = m_shards[GetShardIndex(resourceIdentity)];
 
-    // Do we already have a wrapper around this resource?
-    auto it = m_resources.find(resourceIdentity.Get());
+    WeakRef weakWrapper;
 
-    if (it != m_resources.end())
     {
-        wrapper = LockWeakRef<IInspectable>(it->second);
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+
+        auto it = shard.Resources.find(resourceIdentity);
+
+        if (it == shard.Resources.end())
+            return nullptr;
+
+        weakWrapper = it->second;
     }
 
+    return LockWeakRef<IInspectable>(weakWrapper);
+}
+
+
+ComPtr<IInspectable> ResourceManager::GetOrCreate(ICanvasDevice* device, IUnknown* resource, float dpi)
+{
+    ComPtr<IUnknown> resourceIdentity = AsUnknown(resource);
+
+    // Do we already have a wrapper around this resource?  This is the common
+    // case, and only takes the lock for one shard.
+    auto wrapper = TryGetExistingWrapper(resourceIdentity.Get());
+
     // Create a new wrapper instance?
     if (!wrapper)
     {
-        for (auto& tryCreateFunction : tryCreateFunctions)
-        {
-            if (tryCreateFunction(device, resource, dpi, &wrapper))
-            {
-                break;
-            }
-        }
+        std::lock_guard<std::recursive_mutex> lock(m_createMutex);
+
+        // Another thread may have created one while we waited for the lock.
+        wrapper = TryGetExistingWrapper(resourceIdentity.Get());
 
-        // Fail if we did not find a way to wrap this type.
         if (!wrapper)
         {
-            ThrowHR(E_NOINTERFACE, Strings::ResourceManagerUnknownType);
+            wrapper = CreateWrapper(device, resource, resourceIdentity.Get(), dpi);
         }
     }
 
@@ -149,6 +175,77 @@ ComPtr<IInspectable> ResourceManager::GetOrCreate(ICanvasDevice* device, IUnknow
 }
 
 
+ComPtr<IInspectable> ResourceManager::CreateWrapper(ICanvasDevice* device, IUnknown* resource, IUnknown* resourceIdentity, float dpi)
+{
+    // Objects of the same class share a vtable, so this identifies the type
+    // of the resource without making any calls on it.
+    auto vtable = *reinterpret_cast<void const* const*>(resourceIdentity);
+
+    auto cachedIndex = m_firstCandidateIndices.find(vtable);
+    bool isCached = (cachedIndex != m_firstCandidateIndices.end());
+
+    size_t startIndex = isCached ? cachedIndex->second : 0;
+
+    size_t firstCandidateIndex = tryCreateFunctions.size();
+
+    ComPtr<IInspectable> wrapper;
+
+    size_t i = startIndex;
+
+    while (i < tryCreateFunctions.size())
+    {
+        auto result = tryCreateFunctions[i](device, resource, dpi, &wrapper);
+
+        //
+        // The vtable is only a hint.  If the remembered first candidate
+        // doesn't recognize the resource after all (eg. the vtable belonged
+        // to a class in a module that has since been unloaded, or the object
+        // answers QueryInterface differently to others of its class) then
+        // the earlier functions can't be skipped, so start again from the
+        // top and remember what that finds instead.
+        //
+        if (isCached && i == startIndex && result == TryCreateResult::WrongType)
+        {
+            isCached = false;
+
+            if (startIndex != 0)
+            {
+                i = 0;
+                continue;
+            }
+        }
+
+        if (result != TryCreateResult::WrongType && firstCandidateIndex == tryCreateFunctions.size())
+        {
+            firstCandidateIndex = i;
+        }
+
+        if (result == TryCreateResult::Created)
+        {
+            break;
+        }
+
+        ++i;
+    }
+
+    // Try-create functions can call back into GetOrCreate, so cachedIndex may
+    // no longer be valid here.  Types that nothing recognized aren't
+    // remembered, since there would be no candidate to check the hint with.
+    if (!isCached && firstCandidateIndex < tryCreateFunctions.size())
+    {
+        m_firstCandidateIndices[vtable] = firstCandidateIndex;
+    }
+
+    // Fail if we did not find a way to wrap this type.
+    if (!wrapper)
+    {
+        ThrowHR(E_NOINTERFACE, Strings::ResourceManagerUnknownType);
+    }
+
+    return wrapper;
+}
+
+
 // Validation rules:
 //  - If the caller specified a device or dpi, and the wrapper has device/dpi, these must match.
 //  - If the caller specified device or dpi but the wrapper has no device/dpi, we'll allow that, ignoring the parameter.
@@ -211,7 +308,12 @@ void ResourceManager::RegisterType(TryCreateFunction tryCreate)
 {
     assert(std::find(tryCreateFunctions.begin(), tryCreateFunctions.end(), tryCreate) == tryCreateFunctions.end());
 
+    std::lock_guard<std::recursive_mutex> lock(m_createMutex);
+
     tryCreateFunctions.push_back(tryCreate);
+
+    // Indices into the table have changed
+    m_firstCandidateIndices.clear();
 }
 
 
@@ -221,5 +323,9 @@ void ResourceManager::UnregisterType(TryCreateFunction tryCreate)
 
     assert(it != tryCreateFunctions.end());
 
+    std::lock_guard<std::recursive_mutex> lock(m_createMutex);
+
     tryCreateFunctions.erase(it);
+
+    m_firstCandidateIndices.clear();
 }
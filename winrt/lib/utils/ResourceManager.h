@@ -61,7 +61,21 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         // a bunch of times in a loop probing for different types, and don't want the overhead of messing
         // with refcounts for the common case of probes that early out due to wrong resource type.
 
-        typedef bool(*TryCreateFunction)(ICanvasDevice* device, IUnknown* resource, float dpi, ComPtr<IInspectable>* result);
+        //
+        // WrongType means the resource does not implement the interface this
+        // function wraps.  That depends only on the type of the resource, so
+        // GetOrCreate remembers it and skips the function for other resources
+        // of the same type.  NotCreated means the interface matched but a
+        // tester rejected this particular resource.
+        //
+        enum class TryCreateResult
+        {
+            WrongType,
+            NotCreated,
+            Created
+        };
+
+        typedef TryCreateResult(*TryCreateFunction)(ICanvasDevice* device, IUnknown* resource, float dpi, ComPtr<IInspectable>* result);
 
 
         // Allow unit tests to inject additional try-create functions.
@@ -78,7 +92,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
 
         template<typename TResource, typename TWrapper, typename TMaker, bool TTester(TResource*) = DefaultTester<TResource>>
-        static bool TryCreate(ICanvasDevice* device, IUnknown* resource, float dpi, ComPtr<IInspectable>* result)
+        static TryCreateResult TryCreate(ICanvasDevice* device, IUnknown* resource, float dpi, ComPtr<IInspectable>* result)
         {
             static_assert(std::is_base_of<ICanvasResourceWrapperNative, TWrapper>::value, "Types used with interop should implement ICanvasResourceWrapperNative");
 
@@ -86,10 +100,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             auto myTypeOfResource = MaybeAs<TResource>(resource);
 
             if (!myTypeOfResource)
-                return false;
+                return TryCreateResult::WrongType;
 
             if (!TTester(myTypeOfResource.Get()))
-                return false;
+                return TryCreateResult::NotCreated;
 
             // Create a new wrapper instance.
             auto wrapper = TMaker::Make<TResource, TWrapper>(device, myTypeOfResource.Get(), dpi);
@@ -97,7 +111,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             CheckMakeResult(wrapper);
             ThrowIfFailed(wrapper.As(result));
 
-            return true;
+            return TryCreateResult::Created;
         }
 
 
@@ -153,12 +167,48 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         };
 
 
+        // Exposed for unit tests.
+        static uint32_t const ShardBits = 4;
+        static size_t const ShardCount = 1 << ShardBits;
+
+        static size_t GetShardIndex(IUnknown* resourceIdentity);
+
+
     private:
+        //
         // Native resource -> WinRT wrapper map, shared by all active resources.
-        static std::unordered_map<IUnknown*, WeakRef> m_resources;
-        static std::recursive_mutex m_mutex;
+        // This is split into shards by resource pointer, each with its own
+        // lock, so threads working with unrelated resources don't contend.
+        //
+        struct DECLSPEC_ALIGN(64) Shard
+        {
+            std::mutex Mutex;
+            std::unordered_map<IUnknown*, WeakRef> Resources;
+        };
+
+        static Shard m_shards[ShardCount];
+
+        // Held while creating new wrappers, so two threads can't both wrap the
+        // same resource.  This is recursive because wrapper constructors may
+        // themselves call GetOrCreate.
+        static std::recursive_mutex m_createMutex;
+
+        static ComPtr<IInspectable> TryGetExistingWrapper(IUnknown* resourceIdentity);
+
+        static ComPtr<IInspectable> CreateWrapper(ICanvasDevice* device, IUnknown* resource, IUnknown* resourceIdentity, float dpi);
 
         // Table of try-create functions, one per type.
         static std::vector<TryCreateFunction> tryCreateFunctions;
+
+        //
+        // Maps the vtable of a resource's IUnknown identity to the index of the
+        // first try-create function that recognized its type.  Earlier
+        // functions all returned WrongType, so there is no need to call them
+        // again for resources of the same type.  A vtable pointer isn't a
+        // stable type identity, so this is only a hint: if the function it
+        // names doesn't recognize the resource, the whole table is searched.
+        // Guarded by m_createMutex.
+        //
+        static std::unordered_map<void const*, size_t> m_firstCandidateIndices;
     };
 }}}}
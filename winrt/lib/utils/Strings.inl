@@ -34,6 +34,7 @@ STRING(CustomEffectSourceOutOfRange, L"Source%d must be null when using this pix
 STRING(CustomEffectTooManyConstantBuffers, L"Unsupported constant buffer layout. There should be a single constant buffer bound to b0.")
 STRING(CustomEffectTooManyTextures, L"Shader has too many input textures.")
 STRING(CustomEffectUnknownProperty, L"Shader does not have a property named '%s'.")
+STRING(CustomEffectWrongPackedValueSize, L"Wrong buffer size. The specified shader properties take %d bytes of values.")
 STRING(CustomEffectWrongPropertyArraySize, L"Wrong array size. Shader property '%s' is an array of %d elements.")
 STRING(CustomEffectWrongPropertyType, L"Wrong type. Shader property '%s' is of type %s.")
 STRING(CustomEffectWrongPropertyTypeArray, L"Wrong type. Shader property '%s' is an array of %s.")
@@ -60,15 +61,21 @@ STRING(PathBuilderAddGeometryMidFigure, L"CanvasPathBuilder.AddGeometry may not
 STRING(PathBuilderClosedMidFigure, L"There was an attempt to use a CanvasPathBuilder, which was missing a call to CanvasPathBuilder.EndFigure.")
 STRING(PixelColorsFormatRestriction, L"This method only supports resources with pixel format DirectXPixelFormat.B8G8R8A8UIntNormalized.")
 STRING(PoppedWrongLayer, L"Attempting to close a CanvasActiveLayer that is not top of the stack. The most recently created layer must be closed first.")
+STRING(ReadbackQueueWrongDevice, L"This CanvasBitmap was created on a different device to the CanvasReadbackQueue it is being read back through.")
 STRING(RemoteFontUnavailable, L"The requested font is not locally available.")
 STRING(ResourceManagerNoDevice, L"To wrap this resource type, a device parameter must be passed to GetOrCreate.")
 STRING(ResourceManagerNoDpi, L"To wrap this resource type, a dpi parameter must be passed to GetOrCreate.")
 STRING(ResourceManagerUnknownType, L"Unsupported type. Win2D is not able to wrap the specified resource.")
 STRING(ResourceManagerWrongDevice, L"Existing resource wrapper is associated with a different device.")
 STRING(ResourceManagerWrongDpi, L"Existing resource wrapper has a different DPI.")
+STRING(RetainedSpriteBatchBitmapWrongDevice, L"This CanvasBitmap was created on a different device to the CanvasRetainedSpriteBatch it is being added to.")
+STRING(RetainedSpriteBatchWrongDevice, L"This CanvasRetainedSpriteBatch was created on a different device to the CanvasDrawingSession it is being drawn to.")
 STRING(SetFilledRegionDeterminationAfterBeginFigure, L"This operation is not allowed after the first call to CanvasPathBuilder.BeginFigure.")
 STRING(SetPageCountCalledBeforePreviewing, L"CanvasPrintDocument.SetPageCount or CanvasPrintDocument.SetIntermediatePageCount cannot be called until the Paginate event has been raised.")
 STRING(SharedDeviceWrongDebugLevel, L"CanvasDevice.DebugLevel has changed since this shared device was created. The debug level must be set before the first call to GetSharedDevice.")
+STRING(SpriteAtlasWrongDevice, L"This CanvasBitmap was created on a different device to the CanvasSpriteAtlas it is being added to.")
+STRING(SpriteBatchArrayLengthMismatch, L"The sprite arrays must contain either a single element or one element for each sprite. The tints and flips arrays may also be empty.")
+STRING(SpriteBatchAtlasWrongDevice, L"This CanvasSpriteAtlas was created on a different device to the CanvasSpriteBatch it is being used with.")
 STRING(SpriteBatchInvalidInterpolation, L"Invalid interpolation mode specified. Sprite batches only support CanvasImageInterpolation.NearestNeighbor or CanvasImageInterpolation.Linear.")
 STRING(SpriteBatchNotAvailable, L"Sprite batches are not supported on this device. Use CanvasSpriteBatch.IsSupported to determine if sprite batches are supported.")
 STRING(SurfaceTooBig, L"Cannot create %s sized %d x %d; MaximumBitmapSizeInPixels for this device is %d.")
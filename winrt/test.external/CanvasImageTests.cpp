@@ -4,6 +4,10 @@
 
 #include "pch.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 using namespace Microsoft::Graphics::Canvas::Effects;
 using namespace WinRTDirectX;
 
@@ -109,4 +113,121 @@ TEST_CLASS(CanvasImageTests)
             }
         }
     }
+
+    //
+    // Measures ComputeHistogram throughput when several threads share one
+    // device, and compares one ComputeHistograms call against a
+    // ComputeHistogram call per channel.  Apart from checking that the two
+    // produce the same results, this only reports timings.
+    //
+    PERF_TEST_METHOD(CanvasImage_ComputeHistogram_ConcurrentBenchmark)
+    {
+        auto device = ref new CanvasDevice();
+
+        if (!CanvasImage::IsHistogramSupported(device))
+            return;
+
+        auto bitmap = ref new CanvasRenderTarget(device, 256, 256, DEFAULT_DPI);
+        auto drawingSession = bitmap->CreateDrawingSession();
+        drawingSession->Clear(Windows::UI::Colors::CornflowerBlue);
+        drawingSession->FillCircle(128, 128, 100, Windows::UI::Colors::Orange);
+        delete drawingSession;
+
+        Rect sourceRect(0, 0, 256, 256);
+        int const numberOfBins = 256;
+        int const requestsPerThread = 20;
+        int const threadCounts[] = { 1, 2, 4, 8 };
+
+        for (int threadCount : threadCounts)
+        {
+            std::vector<std::thread> threads;
+            std::atomic<int> failures(0);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            for (int i = 0; i < threadCount; i++)
+            {
+                threads.emplace_back([=, &failures]
+                {
+                    try
+                    {
+                        for (int j = 0; j < requestsPerThread; j++)
+                        {
+                            CanvasImage::ComputeHistogram(bitmap, sourceRect, device, EffectChannelSelect::Red, numberOfBins);
+                        }
+                    }
+                    catch (Platform::Exception^)
+                    {
+                        failures++;
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            Assert::AreEqual(0, failures.load());
+
+            wchar_t message[200];
+            ThrowIfFailed(StringCchPrintf(message, _countof(message),
+                L"%d threads x %d requests: %.1f histograms per second\n",
+                threadCount,
+                requestsPerThread,
+                threadCount * requestsPerThread / elapsed.count()));
+
+            Logger::WriteMessage(message);
+        }
+
+        // Batched versus one call per channel.
+        EffectChannelSelect channels[] = { EffectChannelSelect::Red, EffectChannelSelect::Green, EffectChannelSelect::Blue, EffectChannelSelect::Alpha };
+        int const channelCount = _countof(channels);
+        int const iterations = 20;
+
+        std::chrono::duration<double, std::milli> separateTime{};
+        std::chrono::duration<double, std::milli> batchTime{};
+
+        for (int i = 0; i < iterations; i++)
+        {
+            std::vector<Platform::Array<float>^> separate;
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            for (auto channel : channels)
+            {
+                separate.push_back(CanvasImage::ComputeHistogram(bitmap, sourceRect, device, channel, numberOfBins));
+            }
+
+            separateTime += std::chrono::high_resolution_clock::now() - start;
+
+            start = std::chrono::high_resolution_clock::now();
+
+            auto batch = CanvasImage::ComputeHistograms(bitmap, sourceRect, device, ref new Platform::Array<EffectChannelSelect>(channels, channelCount), numberOfBins);
+
+            batchTime += std::chrono::high_resolution_clock::now() - start;
+
+            Assert::AreEqual<uint32_t>(channelCount * numberOfBins, batch->Length);
+
+            for (int channel = 0; channel < channelCount; channel++)
+            {
+                for (int bin = 0; bin < numberOfBins; bin++)
+                {
+                    Assert::AreEqual(separate[channel][bin], batch[channel * numberOfBins + bin]);
+                }
+            }
+        }
+
+        wchar_t message[200];
+        ThrowIfFailed(StringCchPrintf(message, _countof(message),
+            L"%d channels: ComputeHistogram x %d %.3fms, ComputeHistograms %.3fms\n",
+            channelCount,
+            channelCount,
+            separateTime.count() / iterations,
+            batchTime.count() / iterations));
+
+        Logger::WriteMessage(message);
+    }
 };
@@ -739,3 +739,15 @@ inline int GetRefCount(T^ const& hatPointer)
 {
     return GetRefCount(reinterpret_cast<IInspectable*>(hatPointer));
 }
+
+
+//
+// PERF_TEST_METHOD is TEST_METHOD for benchmarks that report timings.  These
+// are put in the "Perf" test category, so they can be left out of a test run
+// with vstest.console /TestCaseFilter:TestCategory!=Perf.
+//
+#define PERF_TEST_METHOD(METHOD_NAME)                           \
+    BEGIN_TEST_METHOD_ATTRIBUTE(METHOD_NAME)                    \
+        TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Perf")         \
+    END_TEST_METHOD_ATTRIBUTE()                                 \
+    TEST_METHOD(METHOD_NAME)
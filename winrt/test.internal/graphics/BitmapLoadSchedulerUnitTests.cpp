@@ -0,0 +1,330 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/images/BitmapLoadScheduler.h>
+
+TEST_CLASS(BitmapLoadSchedulerUnitTests)
+{
+public:
+    //
+    // Queues work items instead of running them, so tests can decide
+    // exactly when each decoder or uploader runs.
+    //
+    struct Fixture
+    {
+        std::shared_ptr<std::deque<std::function<void()>>> WorkItems;
+        std::shared_ptr<bool> RunAsyncFails;
+        std::shared_ptr<BitmapLoadScheduler> Scheduler;
+        std::vector<std::wstring> Log;
+
+        Fixture(uint32_t workerCount)
+            : WorkItems(std::make_shared<std::deque<std::function<void()>>>())
+            , RunAsyncFails(std::make_shared<bool>(false))
+        {
+            auto workItems = WorkItems;
+            auto runAsyncFails = RunAsyncFails;
+
+            Scheduler = std::make_shared<BitmapLoadScheduler>(
+                workerCount,
+                [workItems, runAsyncFails](std::function<void()>&& work)
+                {
+                    if (*runAsyncFails)
+                        ThrowHR(E_FAIL);
+
+                    workItems->push_back(std::move(work));
+                });
+        }
+
+        void Enqueue(std::wstring const& name, int32_t priority = 0)
+        {
+            Scheduler->Enqueue(
+                priority,
+                [=]
+                {
+                    Log.push_back(L"decode " + name);
+                    return [=] { Log.push_back(L"upload " + name); };
+                },
+                [=]
+                {
+                    Log.push_back(L"abandon " + name);
+                });
+        }
+
+        void RunNextWorkItem()
+        {
+            Assert::IsFalse(WorkItems->empty());
+
+            auto work = std::move(WorkItems->front());
+            WorkItems->pop_front();
+            work();
+        }
+
+        void RunAllWorkItems()
+        {
+            while (!WorkItems->empty())
+            {
+                RunNextWorkItem();
+            }
+        }
+
+        void AssertLog(std::vector<std::wstring> const& expected)
+        {
+            Assert::AreEqual(expected.size(), Log.size());
+
+            for (size_t i = 0; i < expected.size(); i++)
+            {
+                Assert::AreEqual(expected[i], Log[i]);
+            }
+        }
+    };
+
+    TEST_METHOD_EX(BitmapLoadScheduler_Enqueue_DoesNotRunAnythingImmediately)
+    {
+        Fixture f(2);
+
+        f.Enqueue(L"a");
+
+        Assert::AreEqual<size_t>(1, f.WorkItems->size());
+        Assert::AreEqual<size_t>(1, f.Scheduler->GetPendingCount());
+        Assert::IsTrue(f.Log.empty());
+
+        f.RunAllWorkItems();
+
+        f.AssertLog({ L"decode a", L"upload a" });
+        Assert::AreEqual<size_t>(0, f.Scheduler->GetPendingCount());
+    }
+
+    TEST_METHOD_EX(BitmapLoadScheduler_StartsNoMoreDecodersThanWorkerCount)
+    {
+        Fixture f(3);
+
+        for (int i = 0; i < 10; i++)
+        {
+            f.Enqueue(std::to_wstring(i));
+        }
+
+        Assert::AreEqual<size_t>(3, f.WorkItems->size());
+        Assert::AreEqual<uint32_t>(3, f.Scheduler->GetWorkerCount());
+        Assert::AreEqual<size_t>(10, f.Scheduler->GetPendingCount());
+
+        f.RunAllWorkItems();
+
+        Assert::AreEqual<size_t>(20, f.Log.size());
+        Assert::AreEqual<size_t>(0, f.Scheduler->GetPendingCount());
+    }
+
+    TEST_METHOD_EX(BitmapLoadScheduler_DecodesHigherPriorityFirst_ThenInOrderAdded)
+    {
+        Fixture f(1);
+
+        f.Enqueue(L"a", 0);
+        f.Enqueue(L"b", 1);
+        f.Enqueue(L"c", 0);
+        f.Enqueue(L"d", 1);
+        f.Enqueue(L"e", -1);
+
+        f.RunAllWorkItems();
+
+        f.AssertLog(
+        {
+            L"decode b", L"upload b",
+            L"decode d", L"upload d",
+            L"decode a", L"upload a",
+            L"decode c", L"upload c",
+            L"decode e", L"upload e",
+        });
+    }
+
+    TEST_METHOD_EX(BitmapLoadScheduler_DecoderStops_WhenWorkerCountUploadsAreWaiting)
+    {
+        Fixture f(2);
+
+        for (int i = 0; i < 4; i++)
+        {
+            f.Enqueue(std::to_wstring(i));
+        }
+
+        // The first decoder decodes two images, then stops because the
+        // uploader has not had a chance to run yet.
+        f.RunNextWorkItem();
+        f.AssertLog({ L"decode 0", L"decode 1" });
+        Assert::AreEqual<size_t>(2, f.Scheduler->GetPendingCount());
+
+        // So the second decoder has nothing to do.
+        f.RunNextWorkItem();
+        Assert::AreEqual<size_t>(2, f.Log.size());
+
+        // Running the uploader lets decoding carry on.
+        f.RunAllWorkItems();
+        Assert::AreEqual<size_t>(8, f.Log.size());
+        Assert::AreEqual<size_t>(0, f.Scheduler->GetPendingCount());
+    }
+
+    TEST_METHOD_EX(BitmapLoadScheduler_DecodeReturningNull_SkipsUpload)
+    {
+        Fixture f(1);
+
+        f.Scheduler->Enqueue(
+            0,
+            [&] () -> BitmapLoadScheduler::UploadFunction
+            {
+                f.Log.push_back(L"decode failed");
+                return nullptr;
+            },
+            [] { Assert::Fail(); });
+
+        f.Enqueue(L"a");
+
+        f.RunAllWorkItems();
+
+        f.AssertLog({ L"decode failed", L"decode a", L"upload a" });
+    }
+
+    TEST_METHOD_EX(BitmapLoadScheduler_Close_AbandonsJobsThatHaveNotStarted)
+    {
+        Fixture f(1);
+
+        f.Enqueue(L"a");
+        f.Enqueue(L"b");
+
+        f.Scheduler->Close();
+
+        f.AssertLog({ L"abandon a", L"abandon b" });
+        Assert::AreEqual<size_t>(0, f.Scheduler->GetPendingCount());
+
+        // Jobs added after closing are abandoned straight away.
+        f.Enqueue(L"c");
+        f.AssertLog({ L"abandon a", L"abandon b", L"abandon c" });
+
+        f.RunAllWorkItems();
+        Assert::AreEqual<size_t>(3, f.Log.size());
+    }
+
+    TEST_METHOD_EX(BitmapLoadScheduler_Close_LetsDecodedImagesUpload)
+    {
+        Fixture f(1);
+
+        f.Enqueue(L"a");
+        f.Enqueue(L"b");
+
+        // Decodes "a", then stops to wait for the uploader.
+        f.RunNextWorkItem();
+
+        f.Scheduler->Close();
+
+        f.RunAllWorkItems();
+
+        f.AssertLog({ L"decode a", L"abandon b", L"upload a" });
+    }
+
+    TEST_METHOD_EX(BitmapLoadScheduler_WhenRunAsyncFails_EnqueueThrows_AndLaterJobsStillRun)
+    {
+        Fixture f(1);
+
+        *f.RunAsyncFails = true;
+        ExpectHResultException(E_FAIL, [&] { f.Enqueue(L"a"); });
+
+        // Nothing would ever have run "a", so it was dropped
+        Assert::AreEqual<size_t>(0, f.Scheduler->GetPendingCount());
+
+        // The decoder that failed to start isn't still counted as active
+        *f.RunAsyncFails = false;
+        f.Enqueue(L"b");
+        Assert::AreEqual<size_t>(1, f.WorkItems->size());
+
+        f.RunAllWorkItems();
+
+        f.AssertLog({ L"decode b", L"upload b" });
+    }
+
+    TEST_METHOD_EX(BitmapLoadScheduler_WhenTheUploaderFailsToStart_ItIsStartedByTheNextEnqueue)
+    {
+        Fixture f(1);
+
+        f.Enqueue(L"a");
+
+        *f.RunAsyncFails = true;
+        f.RunNextWorkItem();
+
+        f.AssertLog({ L"decode a" });
+        Assert::IsTrue(f.WorkItems->empty());
+
+        *f.RunAsyncFails = false;
+        f.Enqueue(L"b");
+
+        f.RunAllWorkItems();
+
+        f.AssertLog({ L"decode a", L"upload a", L"decode b", L"upload b" });
+    }
+
+    //
+    // Times a batch of synthetic loads on the real thread pool, for a range
+    // of worker counts.  This only reports timings.
+    //
+    PERF_TEST_METHOD_EX(BitmapLoadScheduler_Benchmark)
+    {
+        int const jobCount = 64;
+        auto const decodeTime = std::chrono::milliseconds(4);
+        auto const uploadTime = std::chrono::milliseconds(1);
+
+        auto spin = [](std::chrono::milliseconds duration)
+        {
+            auto end = std::chrono::high_resolution_clock::now() + duration;
+
+            while (std::chrono::high_resolution_clock::now() < end)
+            {
+            }
+        };
+
+        for (uint32_t workerCount : { 1, 2, 4, 8 })
+        {
+            auto scheduler = std::make_shared<BitmapLoadScheduler>(workerCount, BitmapLoadScheduler::RunOnThreadPool);
+
+            std::mutex mutex;
+            std::condition_variable allDone;
+            int doneCount = 0;
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            for (int i = 0; i < jobCount; i++)
+            {
+                scheduler->Enqueue(
+                    0,
+                    [&]
+                    {
+                        spin(decodeTime);
+
+                        return [&]
+                        {
+                            spin(uploadTime);
+
+                            Lock lock(mutex);
+                            if (++doneCount == jobCount)
+                                allDone.notify_one();
+                        };
+                    },
+                    [] { Assert::Fail(); });
+            }
+
+            {
+                Lock lock(mutex);
+                allDone.wait(lock, [&] { return doneCount == jobCount; });
+            }
+
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            wchar_t message[200];
+            ThrowIfFailed(StringCchPrintf(message, _countof(message),
+                L"%u workers: %d loads in %.1fms (%.1f loads per second)\n",
+                workerCount,
+                jobCount,
+                elapsed.count(),
+                jobCount * 1000.0 / elapsed.count()));
+
+            Logger::WriteMessage(message);
+        }
+    }
+};
@@ -0,0 +1,249 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/images/CanvasBitmapLoader.h>
+
+TEST_CLASS(CanvasBitmapLoaderUnitTests)
+{
+public:
+    typedef IAsyncOperation<CanvasBitmap*> LoadOperation;
+
+    struct Fixture
+    {
+        std::shared_ptr<TestBitmapAdapter> Adapter;
+        ComPtr<StubCanvasDevice> Device;
+        std::shared_ptr<std::deque<std::function<void()>>> WorkItems;
+        ComPtr<CanvasBitmapLoader> Loader;
+
+        int CreateBitmapCount;
+
+        Fixture(uint32_t workerCount = 2)
+            : Adapter(std::make_shared<TestBitmapAdapter>(Make<MockWICFormatConverter>()))
+            , Device(Make<StubCanvasDevice>())
+            , WorkItems(std::make_shared<std::deque<std::function<void()>>>())
+            , CreateBitmapCount(0)
+        {
+            CanvasBitmapAdapter::SetInstance(Adapter);
+
+            Device->MockCreateBitmapFromWicResource =
+                [=](IWICBitmapSource*, CanvasAlphaMode alpha, float dpi) -> ComPtr<ID2D1Bitmap1>
+                {
+                    Assert::AreEqual(CanvasAlphaMode::Premultiplied, alpha);
+                    Assert::AreEqual(DEFAULT_DPI, dpi);
+
+                    CreateBitmapCount++;
+
+                    return Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_NONE, dpi);
+                };
+
+            auto workItems = WorkItems;
+
+            Loader = Make<CanvasBitmapLoader>(
+                Device.Get(),
+                workerCount,
+                [workItems](std::function<void()>&& work)
+                {
+                    workItems->push_back(std::move(work));
+                });
+        }
+
+        void RunAllWorkItems()
+        {
+            while (!WorkItems->empty())
+            {
+                auto work = std::move(WorkItems->front());
+                WorkItems->pop_front();
+                work();
+            }
+        }
+
+        ComPtr<LoadOperation> Load(wchar_t const* fileName, int32_t priority = 0)
+        {
+            ComPtr<LoadOperation> operation;
+            ThrowIfFailed(Loader->LoadAsyncWithPriority(WinString(fileName), priority, &operation));
+            return operation;
+        }
+    };
+
+    static AsyncStatus GetStatus(ComPtr<LoadOperation> const& operation)
+    {
+        AsyncStatus status;
+        ThrowIfFailed(As<IAsyncInfo>(operation)->get_Status(&status));
+        return status;
+    }
+
+    static HRESULT GetErrorCode(ComPtr<LoadOperation> const& operation)
+    {
+        HRESULT errorCode;
+        ThrowIfFailed(As<IAsyncInfo>(operation)->get_ErrorCode(&errorCode));
+        return errorCode;
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_Implements_Expected_Interfaces)
+    {
+        Fixture f;
+
+        ASSERT_IMPLEMENTS_INTERFACE(f.Loader, ICanvasBitmapLoader);
+        ASSERT_IMPLEMENTS_INTERFACE(f.Loader, ABI::Windows::Foundation::IClosable);
+        ASSERT_IMPLEMENTS_INTERFACE(f.Loader, ICanvasResourceCreator);
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_Create_RejectsInvalidWorkerCount)
+    {
+        Fixture f;
+
+        auto factory = Make<CanvasBitmapLoaderFactory>();
+        ComPtr<ICanvasBitmapLoader> loader;
+
+        Assert::AreEqual(E_INVALIDARG, factory->Create(f.Device.Get(), 0, &loader));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(f.Device.Get(), -1, &loader));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(nullptr, 1, &loader));
+
+        Assert::AreEqual(S_OK, factory->Create(f.Device.Get(), 4, &loader));
+
+        int32_t workerCount;
+        ThrowIfFailed(loader->get_WorkerCount(&workerCount));
+        Assert::AreEqual(4, workerCount);
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_InvalidArgs)
+    {
+        Fixture f;
+
+        ComPtr<LoadOperation> operation;
+        uint32_t count;
+        LoadOperation** operations;
+        int32_t value;
+
+        Assert::AreEqual(E_INVALIDARG, f.Loader->LoadAsync(nullptr, &operation));
+        Assert::AreEqual(E_INVALIDARG, f.Loader->LoadAsync(WinString(L"a.png"), nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.Loader->LoadAsyncFromUri(nullptr, &operation));
+        Assert::AreEqual(E_INVALIDARG, f.Loader->LoadManyAsync(1, nullptr, 0, &count, &operations));
+        Assert::AreEqual(E_INVALIDARG, f.Loader->get_WorkerCount(nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.Loader->get_PendingCount(nullptr));
+
+        Assert::AreEqual(S_OK, f.Loader->get_PendingCount(&value));
+        Assert::AreEqual(0, value);
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_Closed)
+    {
+        Fixture f;
+
+        Assert::AreEqual(S_OK, f.Loader->Close());
+
+        ComPtr<LoadOperation> operation;
+        WinString fileNameString(L"a.png");
+        HSTRING fileName = fileNameString;
+        uint32_t count;
+        LoadOperation** operations;
+        int32_t value;
+        ComPtr<ICanvasDevice> device;
+
+        Assert::AreEqual(RO_E_CLOSED, f.Loader->LoadAsync(fileName, &operation));
+        Assert::AreEqual(RO_E_CLOSED, f.Loader->LoadManyAsync(1, &fileName, 0, &count, &operations));
+        Assert::AreEqual(RO_E_CLOSED, f.Loader->get_WorkerCount(&value));
+        Assert::AreEqual(RO_E_CLOSED, f.Loader->get_PendingCount(&value));
+        Assert::AreEqual(RO_E_CLOSED, f.Loader->get_Device(&device));
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_LoadAsync_CompletesOnceDecodedAndUploaded)
+    {
+        Fixture f;
+
+        auto operation = f.Load(L"a.png");
+
+        Assert::AreEqual(AsyncStatus::Started, GetStatus(operation));
+
+        int32_t pendingCount;
+        ThrowIfFailed(f.Loader->get_PendingCount(&pendingCount));
+        Assert::AreEqual(1, pendingCount);
+
+        f.RunAllWorkItems();
+
+        Assert::AreEqual(AsyncStatus::Completed, GetStatus(operation));
+        Assert::AreEqual(1, f.CreateBitmapCount);
+
+        ComPtr<ICanvasBitmap> bitmap;
+        ThrowIfFailed(operation->GetResults(&bitmap));
+        Assert::IsNotNull(bitmap.Get());
+
+        ComPtr<ICanvasDevice> device;
+        ThrowIfFailed(As<ICanvasResourceCreator>(bitmap)->get_Device(&device));
+        Assert::IsTrue(IsSameInstance(f.Device.Get(), device.Get()));
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_LoadManyAsync_ReturnsAnOperationPerFile)
+    {
+        Fixture f;
+
+        WinString fileNames[] = { WinString(L"a.png"), WinString(L"b.png"), WinString(L"c.png") };
+        HSTRING fileNameHandles[] = { fileNames[0], fileNames[1], fileNames[2] };
+
+        ComArray<ComPtr<LoadOperation>> operations;
+        ThrowIfFailed(f.Loader->LoadManyAsync(3, fileNameHandles, 0, operations.GetAddressOfSize(), operations.GetAddressOfData()));
+
+        Assert::AreEqual<uint32_t>(3, operations.GetSize());
+
+        f.RunAllWorkItems();
+
+        for (uint32_t i = 0; i < operations.GetSize(); i++)
+        {
+            Assert::AreEqual(AsyncStatus::Completed, GetStatus(operations[i]));
+        }
+
+        Assert::AreEqual(3, f.CreateBitmapCount);
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_WhenDecodeFails_OperationReportsError)
+    {
+        Fixture f;
+
+        f.Adapter->MockCreateWicBitmapSource = [] { ThrowHR(WINCODEC_ERR_COMPONENTNOTFOUND); };
+
+        auto operation = f.Load(L"a.png");
+
+        f.RunAllWorkItems();
+
+        Assert::AreEqual(AsyncStatus::Error, GetStatus(operation));
+        Assert::AreEqual(WINCODEC_ERR_COMPONENTNOTFOUND, GetErrorCode(operation));
+        Assert::AreEqual(0, f.CreateBitmapCount);
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_WhenCanceledBeforeDecoding_FileIsNotLoaded)
+    {
+        Fixture f;
+
+        f.Adapter->MockCreateWicBitmapSource = [] { Assert::Fail(L"Unexpected decode"); };
+
+        auto operation = f.Load(L"a.png");
+
+        ThrowIfFailed(As<IAsyncInfo>(operation)->Cancel());
+
+        f.RunAllWorkItems();
+
+        Assert::AreEqual(AsyncStatus::Canceled, GetStatus(operation));
+        Assert::AreEqual(0, f.CreateBitmapCount);
+    }
+
+    TEST_METHOD_EX(CanvasBitmapLoader_Close_FailsLoadsThatHaveNotStarted)
+    {
+        Fixture f;
+
+        auto first = f.Load(L"a.png");
+        auto second = f.Load(L"b.png");
+
+        ThrowIfFailed(f.Loader->Close());
+
+        f.RunAllWorkItems();
+
+        Assert::AreEqual(AsyncStatus::Error, GetStatus(first));
+        Assert::AreEqual(RO_E_CLOSED, GetErrorCode(first));
+        Assert::AreEqual(AsyncStatus::Error, GetStatus(second));
+        Assert::AreEqual(RO_E_CLOSED, GetErrorCode(second));
+        Assert::AreEqual(0, f.CreateBitmapCount);
+    }
+};
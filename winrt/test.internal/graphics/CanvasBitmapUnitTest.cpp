@@ -372,4 +372,329 @@ TEST_CLASS(CanvasBitmapUnitTest)
         Assert::AreEqual(E_INVALIDARG, destBitmap->CopyPixelsFromBitmapWithDestPointAndSourceRect(sourceBitmap.Get(), 0, 0, 1, 1, -5, 5));
         Assert::AreEqual(E_INVALIDARG, destBitmap->CopyPixelsFromBitmapWithDestPointAndSourceRect(sourceBitmap.Get(), 0, 0, 1, 1, 5, -5));
     }
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+    struct LockPixelsFixture : public Fixture
+    {
+        uint32_t const Width;
+        uint32_t const Height;
+        uint32_t const StagingPitch;
+
+        ComPtr<StubD2DBitmap> D2DBitmap;
+        ComPtr<CanvasBitmap> Bitmap;
+        ComPtr<MockD2DDeviceContext> DeviceContext;
+
+        std::vector<uint8_t> StagingPixels;
+        bool StagingMapped;
+
+        LockPixelsFixture()
+            : Width(8)
+            , Height(6)
+            , StagingPitch(48)
+            , StagingPixels(StagingPitch * Height)
+            , StagingMapped(false)
+        {
+            for (size_t i = 0; i < StagingPixels.size(); i++)
+            {
+                StagingPixels[i] = static_cast<uint8_t>(i);
+            }
+
+            D2DBitmap = Make<StubD2DBitmap>();
+            D2DBitmap->GetPixelFormatMethod.AllowAnyCall([] { return D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED); });
+            D2DBitmap->GetPixelSizeMethod.AllowAnyCall([=] { return D2D1_SIZE_U{ Width, Height }; });
+
+            m_canvasDevice->MockCreateBitmapFromWicResource = [=](IWICBitmapSource*, CanvasAlphaMode, float) -> ComPtr<ID2D1Bitmap1> { return D2DBitmap; };
+            Bitmap = CanvasBitmap::CreateNew(m_canvasDevice.Get(), m_testFileName, DEFAULT_DPI, CanvasAlphaMode::Premultiplied);
+
+            DeviceContext = Make<MockD2DDeviceContext>();
+            m_canvasDevice->GetResourceCreationDeviceContextMethod.AllowAnyCall([=] { return DeviceContextLease(As<ID2D1DeviceContext1>(DeviceContext)); });
+        }
+
+        // The subrectangle is copied into a CPU readable staging bitmap, whose
+        // mapped rows are StagingPitch bytes apart.
+        void ExpectStagingCopy(D2D1_RECT_U const& expectedRect)
+        {
+            DeviceContext->CreateBitmapMethod.SetExpectedCalls(1,
+                [=](D2D1_SIZE_U size, void const* data, UINT32, D2D1_BITMAP_PROPERTIES1 const* properties, ID2D1Bitmap1** bitmap)
+                {
+                    Assert::AreEqual(expectedRect.right - expectedRect.left, size.width);
+                    Assert::AreEqual(expectedRect.bottom - expectedRect.top, size.height);
+                    Assert::IsNull(data);
+                    Assert::IsTrue((properties->bitmapOptions & D2D1_BITMAP_OPTIONS_CPU_READ) != 0);
+
+                    auto stagingBitmap = Make<StubD2DBitmap>(properties->bitmapOptions);
+
+                    stagingBitmap->CopyFromBitmapMethod.SetExpectedCalls(1,
+                        [=](D2D1_POINT_2U const* destinationPoint, ID2D1Bitmap* source, D2D1_RECT_U const* sourceRect)
+                        {
+                            Assert::IsNull(destinationPoint);
+                            Assert::AreEqual(static_cast<ID2D1Bitmap*>(D2DBitmap.Get()), source);
+                            Assert::AreEqual(expectedRect, *sourceRect);
+                            return S_OK;
+                        });
+
+                    stagingBitmap->MapMethod.SetExpectedCalls(1,
+                        [=](D2D1_MAP_OPTIONS options, D2D1_MAPPED_RECT* mappedRect)
+                        {
+                            Assert::IsTrue(options == D2D1_MAP_OPTIONS_READ);
+                            mappedRect->pitch = StagingPitch;
+                            mappedRect->bits = StagingPixels.data();
+                            StagingMapped = true;
+                            return S_OK;
+                        });
+
+                    stagingBitmap->UnmapMethod.SetExpectedCalls(1,
+                        [=]
+                        {
+                            StagingMapped = false;
+                            return S_OK;
+                        });
+
+                    return stagingBitmap.CopyTo(bitmap);
+                });
+        }
+
+        static std::pair<uint8_t*, uint32_t> GetBuffer(ComPtr<ICanvasBitmapPixelLock> const& pixelLock)
+        {
+            uint8_t* data;
+            uint32_t capacity;
+            ThrowIfFailed(As<::Windows::Foundation::IMemoryBufferByteAccess>(pixelLock)->GetBuffer(&data, &capacity));
+            return std::make_pair(data, capacity);
+        }
+    };
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_Implements_Expected_Interfaces)
+    {
+        LockPixelsFixture f;
+        f.ExpectStagingCopy(D2D1_RECT_U{ 0, 0, f.Width, f.Height });
+
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+        ThrowIfFailed(f.Bitmap->LockPixels(CanvasBitmapLockMode::Read, &pixelLock));
+
+        ASSERT_IMPLEMENTS_INTERFACE(pixelLock, ICanvasBitmapPixelLock);
+        ASSERT_IMPLEMENTS_INTERFACE(pixelLock, ABI::Windows::Foundation::IMemoryBufferReference);
+        ASSERT_IMPLEMENTS_INTERFACE(pixelLock, ABI::Windows::Foundation::IClosable);
+        ASSERT_IMPLEMENTS_INTERFACE(pixelLock, ::Windows::Foundation::IMemoryBufferByteAccess);
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_InvalidArgs)
+    {
+        LockPixelsFixture f;
+
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+
+        Assert::AreEqual(E_INVALIDARG, f.Bitmap->LockPixels(CanvasBitmapLockMode::Read, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.Bitmap->LockPixels(static_cast<CanvasBitmapLockMode>(3), &pixelLock));
+
+        Assert::AreEqual(E_INVALIDARG, f.Bitmap->LockPixelsWithSubrectangle(CanvasBitmapLockMode::Read, -1, 0, 1, 1, &pixelLock));
+        Assert::AreEqual(E_INVALIDARG, f.Bitmap->LockPixelsWithSubrectangle(CanvasBitmapLockMode::Read, 0, 0, 0, 1, &pixelLock));
+        Assert::AreEqual(E_INVALIDARG, f.Bitmap->LockPixelsWithSubrectangle(CanvasBitmapLockMode::Write, 0, 0, f.Width + 1, 1, &pixelLock));
+        Assert::AreEqual(E_INVALIDARG, f.Bitmap->LockPixelsWithSubrectangle(CanvasBitmapLockMode::ReadWrite, 0, f.Height, 1, 1, &pixelLock));
+
+        Assert::IsNull(pixelLock.Get());
+
+        ThrowIfFailed(f.Bitmap->Close());
+        Assert::AreEqual(RO_E_CLOSED, f.Bitmap->LockPixels(CanvasBitmapLockMode::Read, &pixelLock));
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_Read_ExposesMappedStagingBitmap)
+    {
+        LockPixelsFixture f;
+        f.ExpectStagingCopy(D2D1_RECT_U{ 2, 1, 6, 4 });
+
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+        ThrowIfFailed(f.Bitmap->LockPixelsWithSubrectangle(CanvasBitmapLockMode::Read, 2, 1, 4, 3, &pixelLock));
+
+        Assert::IsTrue(f.StagingMapped);
+
+        auto buffer = f.GetBuffer(pixelLock);
+        Assert::IsTrue(f.StagingPixels.data() == buffer.first);
+        Assert::AreEqual(f.StagingPitch * 2 + 4 * 4, buffer.second);
+
+        uint32_t stride;
+        ThrowIfFailed(pixelLock->get_Stride(&stride));
+        Assert::AreEqual(f.StagingPitch, stride);
+
+        BitmapSize size;
+        ThrowIfFailed(pixelLock->get_SizeInPixels(&size));
+        Assert::AreEqual(4u, size.Width);
+        Assert::AreEqual(3u, size.Height);
+
+        DirectXPixelFormat format;
+        ThrowIfFailed(pixelLock->get_Format(&format));
+        Assert::AreEqual(PIXEL_FORMAT(B8G8R8A8UIntNormalized), format);
+
+        CanvasBitmapLockMode mode;
+        ThrowIfFailed(pixelLock->get_Mode(&mode));
+        Assert::AreEqual(CanvasBitmapLockMode::Read, mode);
+
+        // Closing unmaps the staging bitmap without writing anything back
+        // (the mock D2D bitmap fails any CopyFromMemory call).
+        ThrowIfFailed(As<IClosable>(pixelLock)->Close());
+        Assert::IsFalse(f.StagingMapped);
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_WhenClosed_BufferIsNoLongerAccessible)
+    {
+        LockPixelsFixture f;
+        f.ExpectStagingCopy(D2D1_RECT_U{ 0, 0, f.Width, f.Height });
+
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+        ThrowIfFailed(f.Bitmap->LockPixels(CanvasBitmapLockMode::Read, &pixelLock));
+
+        ThrowIfFailed(As<IClosable>(pixelLock)->Close());
+
+        uint8_t* data;
+        uint32_t capacity;
+        Assert::AreEqual(RO_E_CLOSED, As<::Windows::Foundation::IMemoryBufferByteAccess>(pixelLock)->GetBuffer(&data, &capacity));
+        Assert::IsNull(data);
+
+        ThrowIfFailed(As<IMemoryBufferReference>(pixelLock)->get_Capacity(&capacity));
+        Assert::AreEqual(0u, capacity);
+
+        uint32_t stride;
+        BitmapSize size;
+        DirectXPixelFormat format;
+        CanvasBitmapLockMode mode;
+        Assert::AreEqual(RO_E_CLOSED, pixelLock->get_Stride(&stride));
+        Assert::AreEqual(RO_E_CLOSED, pixelLock->get_SizeInPixels(&size));
+        Assert::AreEqual(RO_E_CLOSED, pixelLock->get_Format(&format));
+        Assert::AreEqual(RO_E_CLOSED, pixelLock->get_Mode(&mode));
+
+        // Closing twice is harmless.
+        Assert::AreEqual(S_OK, As<IClosable>(pixelLock)->Close());
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_WhenReleasedWithoutClose_StagingBitmapIsUnmapped)
+    {
+        LockPixelsFixture f;
+        f.ExpectStagingCopy(D2D1_RECT_U{ 0, 0, f.Width, f.Height });
+
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+        ThrowIfFailed(f.Bitmap->LockPixels(CanvasBitmapLockMode::Read, &pixelLock));
+        Assert::IsTrue(f.StagingMapped);
+
+        pixelLock.Reset();
+        Assert::IsFalse(f.StagingMapped);
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_ReadWrite_CopiesPixelsInAndWritesThemBackOnClose)
+    {
+        LockPixelsFixture f;
+        D2D1_RECT_U expectedRect{ 1, 2, 4, 6 };
+        f.ExpectStagingCopy(expectedRect);
+
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+        ThrowIfFailed(f.Bitmap->LockPixelsWithSubrectangle(CanvasBitmapLockMode::ReadWrite, 1, 2, 3, 4, &pixelLock));
+
+        // The staging bitmap is only needed to initialize the lock.
+        Assert::IsFalse(f.StagingMapped);
+
+        const uint32_t bytesPerRow = 3 * 4;
+
+        uint32_t stride;
+        ThrowIfFailed(pixelLock->get_Stride(&stride));
+        Assert::AreEqual(bytesPerRow, stride);
+
+        auto buffer = f.GetBuffer(pixelLock);
+        Assert::AreEqual(bytesPerRow * 4, buffer.second);
+
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            Assert::AreEqual(0, memcmp(buffer.first + y * stride, f.StagingPixels.data() + y * f.StagingPitch, bytesPerRow));
+        }
+
+        for (uint32_t i = 0; i < buffer.second; i++)
+        {
+            buffer.first[i] = static_cast<uint8_t>(~buffer.first[i]);
+        }
+
+        f.D2DBitmap->CopyFromMemoryMethod.SetExpectedCalls(1,
+            [&](D2D1_RECT_U const* destinationRect, void const* sourceData, UINT32 pitch)
+            {
+                Assert::AreEqual(expectedRect, *destinationRect);
+                Assert::AreEqual(stride, pitch);
+
+                auto bytes = static_cast<uint8_t const*>(sourceData);
+
+                for (uint32_t y = 0; y < 4; y++)
+                {
+                    for (uint32_t x = 0; x < bytesPerRow; x++)
+                    {
+                        Assert::AreEqual(static_cast<uint8_t>(~f.StagingPixels[y * f.StagingPitch + x]), bytes[y * pitch + x]);
+                    }
+                }
+
+                return S_OK;
+            });
+
+        ThrowIfFailed(As<IClosable>(pixelLock)->Close());
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_Write_DoesNotReadTheBitmap)
+    {
+        LockPixelsFixture f;
+
+        // No staging bitmap: DeviceContext->CreateBitmap is not expected to be called.
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+        ThrowIfFailed(f.Bitmap->LockPixels(CanvasBitmapLockMode::Write, &pixelLock));
+
+        auto buffer = f.GetBuffer(pixelLock);
+        Assert::AreEqual(f.Width * 4 * f.Height, buffer.second);
+
+        f.D2DBitmap->CopyFromMemoryMethod.SetExpectedCalls(1,
+            [&](D2D1_RECT_U const* destinationRect, void const* sourceData, UINT32 pitch)
+            {
+                Assert::AreEqual(D2D1_RECT_U{ 0, 0, f.Width, f.Height }, *destinationRect);
+                Assert::IsTrue(buffer.first == sourceData);
+                Assert::AreEqual(f.Width * 4, pitch);
+                return S_OK;
+            });
+
+        ThrowIfFailed(As<IClosable>(pixelLock)->Close());
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_Write_WhenReleasedWithoutClose_NothingIsWrittenBack)
+    {
+        LockPixelsFixture f;
+
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+        ThrowIfFailed(f.Bitmap->LockPixels(CanvasBitmapLockMode::Write, &pixelLock));
+
+        // The mock D2D bitmap fails any CopyFromMemory call.
+        pixelLock.Reset();
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_LockPixels_Close_RaisesClosedBeforeWritingBack)
+    {
+        LockPixelsFixture f;
+
+        ComPtr<ICanvasBitmapPixelLock> pixelLock;
+        ThrowIfFailed(f.Bitmap->LockPixels(CanvasBitmapLockMode::Write, &pixelLock));
+
+        auto onClosed = MockEventHandler<ITypedEventHandler<IMemoryBufferReference*, IInspectable*>>(L"onClosed");
+        EventRegistrationToken token;
+        ThrowIfFailed(As<IMemoryBufferReference>(pixelLock)->add_Closed(onClosed.Get(), &token));
+
+        onClosed.SetExpectedCalls(1,
+            [&](IMemoryBufferReference* sender, IInspectable*)
+            {
+                Assert::IsTrue(IsSameInstance(pixelLock.Get(), sender));
+
+                // Still accessible, and not yet written back.
+                f.GetBuffer(pixelLock);
+                Assert::AreEqual(0, f.D2DBitmap->CopyFromMemoryMethod.GetCurrentCallCount());
+                return S_OK;
+            });
+
+        f.D2DBitmap->CopyFromMemoryMethod.SetExpectedCalls(1);
+
+        ThrowIfFailed(As<IClosable>(pixelLock)->Close());
+
+        // Only raised once.
+        ThrowIfFailed(As<IClosable>(pixelLock)->Close());
+    }
+
+#endif
 };
@@ -151,6 +151,12 @@ public:
         uint64_t cacheSize;
         Assert::AreEqual(RO_E_CLOSED, canvasDevice->get_MaximumCacheSize(&cacheSize));
         Assert::AreEqual(RO_E_CLOSED, canvasDevice->put_MaximumCacheSize(0));
+
+        CanvasEffectCacheStatistics statistics;
+        Assert::AreEqual(RO_E_CLOSED, canvasDevice->get_EffectCacheStatistics(&statistics));
+
+        CanvasGradientStopCacheStatistics gradientStopStatistics;
+        Assert::AreEqual(RO_E_CLOSED, canvasDevice->get_GradientStopCacheStatistics(&gradientStopStatistics));
     }
 
     ComPtr<ID2D1Device1> GetD2DDevice(ComPtr<ICanvasDevice> const& canvasDevice)
@@ -419,6 +425,42 @@ public:
         ThrowIfFailed(canvasDevice->put_MaximumCacheSize(someOtherValue));
     }
 
+    TEST_METHOD_EX(CanvasDevice_EffectCacheStatistics)
+    {
+        Fixture f;
+
+        auto canvasDevice = Make<CanvasDevice>(Make<MockD2DDevice>().Get());
+
+        Assert::AreEqual(E_INVALIDARG, canvasDevice->get_EffectCacheStatistics(nullptr));
+
+        CanvasEffectCacheStatistics statistics;
+        ThrowIfFailed(canvasDevice->get_EffectCacheStatistics(&statistics));
+        Assert::AreEqual(0, statistics.EntryCount);
+        Assert::AreEqual<int64_t>(0, statistics.HitCount);
+        Assert::AreEqual<int64_t>(0, statistics.MissCount);
+
+        auto& cache = canvasDevice->GetRealizedEffectCache();
+
+        RealizedEffectKey key{};
+        key.EffectId = CLSID_D2D1GaussianBlur;
+
+        RealizedEffect effect;
+        Assert::IsFalse(cache.Take(key, &effect));
+        cache.Add(RealizedEffectKey(key), RealizedEffect{ Make<MockD2DEffect>() });
+
+        ThrowIfFailed(canvasDevice->get_EffectCacheStatistics(&statistics));
+        Assert::AreEqual(1, statistics.EntryCount);
+        Assert::AreEqual<int64_t>(0, statistics.HitCount);
+        Assert::AreEqual<int64_t>(1, statistics.MissCount);
+
+        Assert::IsTrue(cache.Take(key, &effect));
+
+        ThrowIfFailed(canvasDevice->get_EffectCacheStatistics(&statistics));
+        Assert::AreEqual(0, statistics.EntryCount);
+        Assert::AreEqual<int64_t>(1, statistics.HitCount);
+        Assert::AreEqual<int64_t>(1, statistics.MissCount);
+    }
+
     TEST_METHOD_EX(CanvasDevice_CreateCommandList_ReturnsCommandListFromDeviceContext)
     {
         auto d2dDevice = Make<MockD2DDevice>();
@@ -445,6 +487,60 @@ public:
         Assert::IsTrue(IsSameInstance(d2dCommandList.Get(), actualD2DCommandList.Get()));
     }
 
+    TEST_METHOD_EX(CanvasDevice_CreateGradientStopCollection_IdenticalStopsShareACollection)
+    {
+        auto d2dDevice = Make<MockD2DDevice>();
+
+        auto deviceContext = Make<StubD2DDeviceContext>(d2dDevice.Get());
+        deviceContext->CreateGradientStopCollectionMethod.SetExpectedCalls(2,
+            [&](D2D1_GRADIENT_STOP const*, UINT32, D2D1_COLOR_SPACE, D2D1_COLOR_SPACE, D2D1_BUFFER_PRECISION, D2D1_EXTEND_MODE, D2D1_COLOR_INTERPOLATION_MODE, ID2D1GradientStopCollection1** value)
+            {
+                return Make<MockD2DGradientStopCollection>().CopyTo(value);
+            });
+
+        d2dDevice->MockCreateDeviceContext =
+            [&](D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** value)
+            {
+                ThrowIfFailed(deviceContext.CopyTo(value));
+            };
+
+        Fixture f;
+        auto canvasDevice = Make<CanvasDevice>(d2dDevice.Get());
+
+        auto create = [&](D2D1_EXTEND_MODE extendMode)
+        {
+            return canvasDevice->CreateGradientStopCollection(
+                std::vector<D2D1_GRADIENT_STOP>{ { 0, D2D1_COLOR_F{ 1, 0, 0, 1 } }, { 1, D2D1_COLOR_F{ 0, 0, 1, 1 } } },
+                D2D1_COLOR_SPACE_SRGB,
+                D2D1_COLOR_SPACE_SRGB,
+                D2D1_BUFFER_PRECISION_8BPC_UNORM,
+                extendMode,
+                D2D1_COLOR_INTERPOLATION_MODE_STRAIGHT);
+        };
+
+        auto first = create(D2D1_EXTEND_MODE_CLAMP);
+        auto second = create(D2D1_EXTEND_MODE_CLAMP);
+        auto third = create(D2D1_EXTEND_MODE_WRAP);
+
+        Assert::IsTrue(IsSameInstance(first.Get(), second.Get()));
+        Assert::IsFalse(IsSameInstance(first.Get(), third.Get()));
+
+        CanvasGradientStopCacheStatistics statistics;
+        ThrowIfFailed(canvasDevice->get_GradientStopCacheStatistics(&statistics));
+        Assert::AreEqual(2, statistics.EntryCount);
+        Assert::AreEqual<int64_t>(1, statistics.HitCount);
+        Assert::AreEqual<int64_t>(2, statistics.MissCount);
+    }
+
+    TEST_METHOD_EX(CanvasDevice_GradientStopCacheStatistics_NullArgument)
+    {
+        Fixture f;
+
+        auto canvasDevice = Make<CanvasDevice>(Make<MockD2DDevice>().Get());
+
+        Assert::AreEqual(E_INVALIDARG, canvasDevice->get_GradientStopCacheStatistics(nullptr));
+    }
+
     TEST_METHOD_EX(CanvasDevice_CreateRenderTarget_ReturnsBitmapCreatedWithCorrectProperties)
     {
         Fixture f;
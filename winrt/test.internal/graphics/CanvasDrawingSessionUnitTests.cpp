@@ -376,6 +376,7 @@ public:
             DeviceContext->GetUnitModeMethod.AllowAnyCall([] { return D2D1_UNIT_MODE_DIPS; });            
 
             DeviceContext->GetImageLocalBoundsMethod.AllowAnyCall();
+            DeviceContext->GetTargetMethod.AllowAnyCall();
         }
             
         virtual ~DrawImageFixture()
@@ -1427,6 +1428,77 @@ public:
     }
 
 
+    TEST_METHOD_EX(CanvasDrawingSession_DrawImage_RepeatedDrawsReuseHelperEffects)
+    {
+        DrawImageBitmapFixture f;
+
+        f.Opacity = 0.5f;
+        f.Interpolation = CanvasImageInterpolation::Cubic;
+
+        f.DeviceContext->GetTransformMethod.AllowAnyCall();
+        f.DeviceContext->SetTransformMethod.AllowAnyCall();
+
+        // The first draw creates the color matrix, border and DPI compensation
+        // effects.  Subsequent draws get the same ones back from the device.
+        f.DeviceContext->CreateEffectMethod.SetExpectedCalls(3,
+            [=](IID const& iid, ID2D1Effect** effect)
+            {
+                return Make<StubD2DEffect>(iid).CopyTo(effect);
+            });
+
+        ComPtr<ID2D1Effect> drawnEffect;
+
+        f.DeviceContext->DrawImageMethod.SetExpectedCalls(3,
+            [&](ID2D1Image* actualImage, D2D1_POINT_2F const*, D2D1_RECT_F const*, D2D1_INTERPOLATION_MODE, D2D1_COMPOSITE_MODE)
+            {
+                auto effect = As<ID2D1Effect>(actualImage);
+
+                if (drawnEffect)
+                    Assert::IsTrue(IsSameInstance(drawnEffect.Get(), effect.Get()));
+
+                drawnEffect = effect;
+            });
+
+        for (int i = 0; i < 3; ++i)
+        {
+            f.DrawImageToRectWithSourceRectAndOpacityAndInterpolation();
+        }
+
+        // Pooled effects don't hold on to the image that was drawn.
+        ComPtr<ID2D1Image> input;
+        drawnEffect->GetInput(0, &input);
+        Assert::IsNull(input.Get());
+    }
+
+    TEST_METHOD_EX(CanvasDrawingSession_DrawImage_WhenTargetIsCommandList_HelperEffectsAreNotReused)
+    {
+        DrawImageNonBitmapFixture f;
+
+        f.Opacity = 0.5f;
+
+        f.DeviceContext->GetTargetMethod.AllowAnyCall(
+            [](ID2D1Image** target)
+            {
+                Make<MockD2DCommandList>().CopyTo(target);
+            });
+
+        f.DeviceContext->CreateEffectMethod.SetExpectedCalls(3,
+            [=](IID const& iid, ID2D1Effect** effect)
+            {
+                return Make<StubD2DEffect>(iid).CopyTo(effect);
+            });
+
+        f.DeviceContext->DrawImageMethod.SetExpectedCalls(3);
+
+        f.CanvasDevice->LeaseDrawImageEffectMethod.SetExpectedCalls(0);
+        f.CanvasDevice->ReleaseDrawImageEffectMethod.SetExpectedCalls(0);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            f.DrawImageAtOffsetWithSourceRectAndOpacity();
+        }
+    }
+
     TEST_METHOD_EX(CanvasDrawingSession_DrawImage_GaussianBlurEffect)
     {
         DrawImageBitmapFixture f;
@@ -9,6 +9,9 @@
 #include "stubs/TestEffect.h"
 #include "stubs/StubD2DEffect.h"
 
+#include <lib/effects/generated/HueRotationEffect.h>
+#include <lib/effects/generated/SaturationEffect.h>
+
 #if WINVER > _WIN32_WINNT_WINBLUE
 #include <lib/effects/generated/AlphaMaskEffect.h>
 #include <lib/effects/generated/CrossFadeEffect.h>
@@ -288,6 +291,134 @@ public:
         }
     };
 
+    TEST_METHOD_EX(CanvasEffect_RealizedEffect_PropertyChangesAreWrittenThroughAtOnce)
+    {
+        Fixture f;
+
+        auto testEffect = Make<TestEffect>(m_blurGuid, 2, 1, false);
+
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        ThrowIfFailed(testEffect->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+        ThrowIfFailed(testEffect->put_BlurAmount(1));
+        testEffect->SetBoxedProperty<float>(1, 2.0f);
+
+        ComPtr<MockD2DEffectThatCountsCalls> mockEffect;
+
+        f.m_deviceContext->CreateEffectMethod.SetExpectedCalls(1,
+            [&](IID const&, ID2D1Effect** effect)
+            {
+                mockEffect = Make<MockD2DEffectThatCountsCalls>();
+                return mockEffect.CopyTo(effect);
+            });
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+
+        // Realization sets all the properties.
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+
+        Assert::AreEqual(2, mockEffect->m_setValueCalls);
+
+        // Changing a property of the realized effect sets just that property, straight away.
+        ThrowIfFailed(testEffect->put_BlurAmount(3));
+
+        Assert::AreEqual(3, mockEffect->m_setValueCalls);
+        Assert::AreEqual(3.0f, *reinterpret_cast<float*>(mockEffect->m_properties[0].data()));
+
+        ThrowIfFailed(testEffect->put_BlurAmount(4));
+
+        Assert::AreEqual(4, mockEffect->m_setValueCalls);
+        Assert::AreEqual(4.0f, *reinterpret_cast<float*>(mockEffect->m_properties[0].data()));
+
+        // So drawing again has no properties left to set.
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+
+        Assert::AreEqual(4, mockEffect->m_setValueCalls);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_PropertyChangedAfterGetNativeResource_ReachesD2DEffectImmediately)
+    {
+        Fixture f;
+
+        auto testEffect = Make<TestEffect>(m_blurGuid, 1, 1, false);
+
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+        ThrowIfFailed(testEffect->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+
+        auto mockEffect = Make<MockD2DEffectThatCountsCalls>();
+
+        f.m_deviceContext->CreateEffectMethod.SetExpectedCalls(1,
+            [&](IID const&, ID2D1Effect** effect)
+            {
+                return mockEffect.CopyTo(effect);
+            });
+
+        f.m_canvasDevice->GetResourceCreationDeviceContextMethod.AllowAnyCall(
+            [&]
+            {
+                return DeviceContextLease(As<ID2D1DeviceContext1>(f.m_deviceContext));
+            });
+
+        ComPtr<ID2D1Effect> d2dEffect;
+        ThrowIfFailed(As<ICanvasResourceWrapperNative>(testEffect)->GetNativeResource(f.m_canvasDevice.Get(), DEFAULT_DPI, IID_PPV_ARGS(&d2dEffect)));
+
+        Assert::IsTrue(IsSameInstance(mockEffect.Get(), d2dEffect.Get()));
+
+        // The app may draw d2dEffect itself, so the new value must not wait for Win2D to draw it.
+        auto setValueCalls = mockEffect->m_setValueCalls;
+
+        ThrowIfFailed(testEffect->put_BlurAmount(5));
+
+        Assert::AreEqual(setValueCalls + 1, mockEffect->m_setValueCalls);
+        Assert::AreEqual(5.0f, *reinterpret_cast<float*>(mockEffect->m_properties[0].data()));
+    }
+
+    TEST_METHOD_EX(CanvasEffect_RealizedEffect_WhenD2DRejectsPropertyValue_SetFailsAndValueIsUnchanged)
+    {
+        Fixture f;
+
+        auto testEffect = Make<TestEffect>(m_blurGuid, 1, 1, false);
+
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        ThrowIfFailed(testEffect->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+        ThrowIfFailed(testEffect->put_BlurAmount(1));
+
+        ComPtr<MockD2DEffectThatCountsCalls> mockEffect;
+
+        f.m_deviceContext->CreateEffectMethod.SetExpectedCalls(1,
+            [&](IID const&, ID2D1Effect** effect)
+            {
+                mockEffect = Make<MockD2DEffectThatCountsCalls>();
+                return mockEffect.CopyTo(effect);
+            });
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+
+        auto rawEffect = mockEffect.Get();
+
+        mockEffect->MockSetValue = [](UINT32, D2D1_PROPERTY_TYPE, CONST BYTE*, UINT32) { return E_INVALIDARG; };
+
+        mockEffect->MockGetValue =
+            [rawEffect](UINT32 index, D2D1_PROPERTY_TYPE, BYTE* data, UINT32 dataSize)
+            {
+                Assert::AreEqual<size_t>(dataSize, rawEffect->m_properties[index].size());
+                memcpy(data, rawEffect->m_properties[index].data(), dataSize);
+                return S_OK;
+            };
+
+        // The error comes from the set call, not from the next draw.
+        Assert::AreEqual(E_INVALIDARG, testEffect->put_BlurAmount(-1));
+
+        float value;
+        ThrowIfFailed(testEffect->get_BlurAmount(&value));
+        Assert::AreEqual(1.0f, value);
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+    }
+
     class InvalidEffectSourceType : public RuntimeClass<IGraphicsEffectSource>
     {
         InspectableClass(L"InvalidEffectSourceType", BaseTrust);
@@ -484,6 +615,602 @@ public:
         }
     }
 
+    TEST_METHOD_EX(CanvasEffect_UnchangedEffectGraph_IsNotRevisitedWhenDrawnAgain)
+    {
+        Fixture f;
+
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        std::vector<ComPtr<MockD2DEffectThatCountsCalls>> mockEffects;
+
+        f.m_deviceContext->CreateEffectMethod.AllowAnyCall(
+            [&](IID const&, ID2D1Effect** effect)
+            {
+                mockEffects.push_back(Make<MockD2DEffectThatCountsCalls>());
+                return mockEffects.back().CopyTo(effect);
+            });
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+
+        f.m_canvasDevice->GetResourceCreationDeviceContextMethod.AllowAnyCall(
+            [&]
+            {
+                return DeviceContextLease(As<ID2D1DeviceContext1>(f.m_deviceContext));
+            });
+
+        // Create three effects, connected as each other's sources.
+        std::vector<ComPtr<TestEffect>> testEffects;
+
+        for (int i = 0; i < 3; i++)
+        {
+            testEffects.push_back(Make<TestEffect>(m_blurGuid, 1, 1, false));
+        }
+
+        testEffects[0]->put_Source(testEffects[1].Get());
+        testEffects[1]->put_Source(testEffects[2].Get());
+        testEffects[2]->put_Source(stubBitmap.Get());
+
+        for (auto& testEffect : testEffects)
+        {
+            testEffect->put_BlurAmount(0);
+        }
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffects[0].Get()));
+        CheckCallCount(mockEffects, 3, { 1, 1, 1 }, { 1, 1, 1 });
+
+        // Walking the graph reads back D2D inputs, so make that fail for every effect.
+        std::vector<std::function<void(UINT32, ID2D1Image**)>> originalGetInputs;
+
+        for (auto& mockEffect : mockEffects)
+        {
+            originalGetInputs.push_back(mockEffect->MockGetInput);
+
+            mockEffect->MockGetInput = [](UINT32, ID2D1Image**) { Assert::Fail(L"Unexpected call to GetInput"); };
+        }
+
+        // Drawing the unchanged graph again should not visit any of its effects.
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffects[0].Get()));
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffects[0].Get()));
+        CheckCallCount(mockEffects, 3, { 1, 1, 1 }, { 1, 1, 1 });
+
+        // Changing the second level effect should revisit it and the root, but not the third level.
+        mockEffects[0]->MockGetInput = originalGetInputs[0];
+        mockEffects[1]->MockGetInput = originalGetInputs[1];
+
+        testEffects[1]->put_BlurAmount(1);
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffects[0].Get()));
+        CheckCallCount(mockEffects, 3, { 1, 1, 1 }, { 1, 2, 1 });
+
+        // After which the graph is back to being skipped entirely.
+        mockEffects[0]->MockGetInput = [](UINT32, ID2D1Image**) { Assert::Fail(L"Unexpected call to GetInput"); };
+        mockEffects[1]->MockGetInput = mockEffects[0]->MockGetInput;
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffects[0].Get()));
+        CheckCallCount(mockEffects, 3, { 1, 1, 1 }, { 1, 2, 1 });
+    }
+
+    TEST_METHOD_EX(CanvasEffect_UnchangedEffectGraph_FailsToDrawOnceSourceBitmapIsClosed)
+    {
+        Fixture f;
+
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        f.m_deviceContext->CreateEffectMethod.AllowAnyCall(
+            [](IID const&, ID2D1Effect** effect)
+            {
+                return Make<MockD2DEffectThatCountsCalls>().CopyTo(effect);
+            });
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+
+        // The bitmap is two levels down, so is only reached by walking through the child.
+        auto child = Make<TestEffect>(m_blurGuid, 1, 1, false);
+        auto root = Make<TestEffect>(m_blurGuid, 1, 1, false);
+
+        child->put_Source(stubBitmap.Get());
+        root->put_Source(child.Get());
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(root.Get()));
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(root.Get()));
+
+        ThrowIfFailed(stubBitmap->Close());
+
+        Assert::AreEqual(RO_E_CLOSED, f.m_drawingSession->DrawImageAtOrigin(child.Get()));
+        Assert::AreEqual(RO_E_CLOSED, f.m_drawingSession->DrawImageAtOrigin(root.Get()));
+    }
+
+    class VisitCountingEffect : public TestEffect
+    {
+    public:
+        int VisitCount;
+
+        VisitCountingEffect()
+            : TestEffect(CLSID_D2D1GaussianBlur, 1, 1, false)
+            , VisitCount(0)
+        {
+        }
+
+        virtual ComPtr<ID2D1Image> GetD2DImage(ICanvasDevice* device, ID2D1DeviceContext* deviceContext, GetImageFlags flags, float targetDpi, float* realizedDpi) override
+        {
+            ++VisitCount;
+            return TestEffect::GetD2DImage(device, deviceContext, flags, targetDpi, realizedDpi);
+        }
+    };
+
+    TEST_METHOD_EX(CanvasEffect_UnchangedDeepEffectGraph_OnlyRootIsVisitedWhenDrawnAgain)
+    {
+        Fixture f;
+
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        f.m_deviceContext->CreateEffectMethod.AllowAnyCall(
+            [](IID const&, ID2D1Effect** effect)
+            {
+                return Make<MockD2DEffectThatCountsCalls>().CopyTo(effect);
+            });
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+
+        int const depth = 50;
+
+        std::vector<ComPtr<VisitCountingEffect>> effects;
+
+        for (int i = 0; i < depth; i++)
+            effects.push_back(Make<VisitCountingEffect>());
+
+        for (int i = 0; i < depth - 1; i++)
+            ThrowIfFailed(effects[i]->put_Source(effects[i + 1].Get()));
+
+        ThrowIfFailed(effects.back()->put_Source(stubBitmap.Get()));
+
+        auto checkVisitsAndReset = [&](int expectedRootVisits, int expectedOtherVisits)
+        {
+            Assert::AreEqual(expectedRootVisits, effects[0]->VisitCount);
+            effects[0]->VisitCount = 0;
+
+            for (int i = 1; i < depth; i++)
+            {
+                Assert::AreEqual(expectedOtherVisits, effects[i]->VisitCount);
+                effects[i]->VisitCount = 0;
+            }
+        };
+
+        // The first draw has to walk the whole graph.
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(effects[0].Get()));
+        checkVisitsAndReset(1, 1);
+
+        // Redrawing the unchanged graph stops at the root, however deep the graph is.
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(effects[0].Get()));
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(effects[0].Get()));
+        checkVisitsAndReset(2, 0);
+
+        // Closing some unrelated bitmap costs one walk, after which redraws stop at the root again.
+        auto otherBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+        ThrowIfFailed(otherBitmap->Close());
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(effects[0].Get()));
+        checkVisitsAndReset(1, 1);
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(effects[0].Get()));
+        checkVisitsAndReset(1, 0);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_RebuiltEffectGraph_ReusesReleasedD2DEffects)
+    {
+        Fixture f;
+
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        int createCount = 0;
+
+        f.m_deviceContext->CreateEffectMethod.AllowAnyCall(
+            [&](IID const&, ID2D1Effect** effect)
+            {
+                ++createCount;
+                return Make<MockD2DEffectThatCountsCalls>().CopyTo(effect);
+            });
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+
+        auto drawGraph = [&](float rootBlurAmount)
+        {
+            auto child = Make<TestEffect>(m_blurGuid, 1, 1, false);
+            auto root = Make<TestEffect>(m_blurGuid, 1, 1, false);
+
+            child->put_Source(stubBitmap.Get());
+            child->put_BlurAmount(1);
+
+            root->put_Source(child.Get());
+            root->put_BlurAmount(rootBlurAmount);
+
+            ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(root.Get()));
+
+            // Release the root before the child, as happens when an app drops a whole graph.
+            root.Reset();
+        };
+
+        auto& cache = f.m_canvasDevice->GetRealizedEffectCache();
+
+        drawGraph(2);
+        Assert::AreEqual(2, createCount);
+        Assert::AreEqual<size_t>(2, cache.GetEntryCount());
+
+        // An identical graph takes over both D2D effects.
+        drawGraph(2);
+        Assert::AreEqual(2, createCount);
+        Assert::AreEqual<uint64_t>(2, cache.GetHitCount());
+        Assert::AreEqual<uint64_t>(0, cache.GetMissCount());
+
+        // A different root can still reuse the child.
+        drawGraph(3);
+        Assert::AreEqual(3, createCount);
+        Assert::AreEqual<uint64_t>(3, cache.GetHitCount());
+        Assert::AreEqual<uint64_t>(1, cache.GetMissCount());
+    }
+
+    struct RecyclingFixture : public Fixture
+    {
+        ComPtr<CanvasBitmap> m_bitmap;
+
+        RecyclingFixture()
+        {
+            m_bitmap = CreateStubCanvasBitmap(DEFAULT_DPI, m_canvasDevice.Get());
+
+            m_deviceContext->CreateEffectMethod.AllowAnyCall(
+                [](IID const&, ID2D1Effect** effect)
+                {
+                    return Make<MockD2DEffectThatCountsCalls>().CopyTo(effect);
+                });
+
+            m_deviceContext->DrawImageMethod.AllowAnyCall();
+
+            m_canvasDevice->GetResourceCreationDeviceContextMethod.AllowAnyCall(
+                [this]
+                {
+                    return DeviceContextLease(As<ID2D1DeviceContext1>(m_deviceContext));
+                });
+        }
+
+        void MakeGraph(ComPtr<TestEffect>* root, ComPtr<TestEffect>* child)
+        {
+            *child = Make<TestEffect>(CLSID_D2D1GaussianBlur, 1, 1, false);
+            *root = Make<TestEffect>(CLSID_D2D1GaussianBlur, 1, 1, false);
+
+            (*child)->put_Source(m_bitmap.Get());
+            (*root)->put_Source(child->Get());
+        }
+
+        size_t GetCachedEffectCount()
+        {
+            return m_canvasDevice->GetRealizedEffectCache().GetEntryCount();
+        }
+    };
+
+    TEST_METHOD_EX(CanvasEffect_EffectGraphDrawnIntoCommandList_IsNotRecycled)
+    {
+        RecyclingFixture f;
+
+        f.m_deviceContext->GetTargetMethod.AllowAnyCall(
+            [](ID2D1Image** target)
+            {
+                Make<MockD2DCommandList>().CopyTo(target);
+            });
+
+        ComPtr<TestEffect> root, child;
+        f.MakeGraph(&root, &child);
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(root.Get()));
+
+        // The command list may still draw them, whatever their reference counts say.
+        root.Reset();
+        child.Reset();
+
+        Assert::AreEqual<size_t>(0, f.GetCachedEffectCount());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_ValidatedEffectGraph_IsNotRecycledOnceRetained)
+    {
+        RecyclingFixture f;
+
+        ComPtr<TestEffect> root, child;
+        f.MakeGraph(&root, &child);
+
+        auto rootImage = As<ICanvasImageInternal>(root);
+
+        rootImage->GetD2DImage(f.m_canvasDevice.Get(), f.m_deviceContext.Get(), GetImageFlags::None, DEFAULT_DPI);
+
+        // The graph is already validated for this target, but must still be walked to mark the child.
+        rootImage->GetD2DImage(f.m_canvasDevice.Get(), f.m_deviceContext.Get(), GetImageFlags::RetainRealization, DEFAULT_DPI);
+
+        rootImage.Reset();
+        root.Reset();
+        child.Reset();
+
+        Assert::AreEqual<size_t>(0, f.GetCachedEffectCount());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_EffectGraphHandedOutThroughGetNativeResource_IsNotRecycled)
+    {
+        RecyclingFixture f;
+
+        ComPtr<TestEffect> root, child;
+        f.MakeGraph(&root, &child);
+
+        // The caller can reach the child's D2D effect through the root's inputs.
+        ComPtr<ID2D1Effect> d2dEffect;
+        ThrowIfFailed(As<ICanvasResourceWrapperNative>(root)->GetNativeResource(f.m_canvasDevice.Get(), DEFAULT_DPI, IID_PPV_ARGS(&d2dEffect)));
+        d2dEffect.Reset();
+
+        root.Reset();
+        child.Reset();
+
+        Assert::AreEqual<size_t>(0, f.GetCachedEffectCount());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_ClosedWhileStillUsedByParent_IsNotRecycled)
+    {
+        RecyclingFixture f;
+
+        ComPtr<TestEffect> root, child;
+        f.MakeGraph(&root, &child);
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(root.Get()));
+
+        // The root's D2D effect still has the child's as its input.
+        ThrowIfFailed(child->Close());
+        Assert::AreEqual<size_t>(0, f.GetCachedEffectCount());
+
+        // Once the root goes, it can be recycled.
+        root.Reset();
+        Assert::AreEqual<size_t>(1, f.GetCachedEffectCount());
+    }
+
+    struct ColorFoldingFixture : public Fixture
+    {
+        ComPtr<CanvasBitmap> m_bitmap;
+        std::vector<ComPtr<MockD2DEffectThatCountsCalls>> m_mockEffects;
+        ComPtr<ID2D1Image> m_drawnImage;
+
+        ColorFoldingFixture()
+        {
+            m_bitmap = CreateStubCanvasBitmap(DEFAULT_DPI, m_canvasDevice.Get());
+
+            m_deviceContext->CreateEffectMethod.AllowAnyCall(
+                [this](IID const& effectId, ID2D1Effect** effect)
+                {
+                    auto mockEffect = Make<MockD2DEffectThatCountsCalls>(effectId);
+
+                    // Folding reads back the property values that were previously set.
+                    auto rawEffect = mockEffect.Get();
+
+                    mockEffect->MockGetValue =
+                        [rawEffect](UINT32 index, D2D1_PROPERTY_TYPE, BYTE* data, UINT32 dataSize)
+                        {
+                            Assert::AreEqual<size_t>(dataSize, rawEffect->m_properties[index].size());
+                            memcpy(data, rawEffect->m_properties[index].data(), dataSize);
+                            return S_OK;
+                        };
+
+                    // System properties such as D2D1_PROPERTY_CACHED have indices far beyond
+                    // the effect's own, so don't try to store them.
+                    auto setEffectProperty = mockEffect->MockSetValue;
+
+                    mockEffect->MockSetValue =
+                        [setEffectProperty](UINT32 index, D2D1_PROPERTY_TYPE type, CONST BYTE* data, UINT32 dataSize)
+                        {
+                            if (index >= D2D1_PROPERTY_CLSID)
+                                return S_OK;
+
+                            return setEffectProperty(index, type, data, dataSize);
+                        };
+
+                    m_mockEffects.push_back(mockEffect);
+                    return mockEffect.CopyTo(effect);
+                });
+
+            m_deviceContext->DrawImageMethod.AllowAnyCall(
+                [this](ID2D1Image* image, D2D1_POINT_2F const*, D2D1_RECT_F const*, D2D1_INTERPOLATION_MODE, D2D1_COMPOSITE_MODE)
+                {
+                    m_drawnImage = image;
+                });
+        }
+
+        ComPtr<ID2D1Image> GetBitmapImage()
+        {
+            return As<ICanvasImageInternal>(m_bitmap)->GetD2DImage(nullptr, m_deviceContext.Get());
+        }
+    };
+
+    static void CheckColorMatrix(Matrix5x4 const& expected, std::vector<byte> const& actual)
+    {
+        Assert::AreEqual(sizeof(Matrix5x4), actual.size());
+
+        auto expectedValues = reinterpret_cast<float const*>(&expected);
+        auto actualValues = reinterpret_cast<float const*>(actual.data());
+
+        for (size_t i = 0; i < sizeof(Matrix5x4) / sizeof(float); i++)
+        {
+            Assert::AreEqual(expectedValues[i], actualValues[i], 1e-5f);
+        }
+    }
+
+    TEST_METHOD_EX(CanvasEffect_FoldColorTransforms_DefaultsToFalse)
+    {
+        auto saturationEffect = Make<SaturationEffect>();
+
+        boolean value;
+        ThrowIfFailed(saturationEffect->get_FoldColorTransforms(&value));
+        Assert::IsFalse(!!value);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_FoldColorTransforms_WhenNotSet_EffectsAreDrawnSeparately)
+    {
+        ColorFoldingFixture f;
+
+        auto saturationEffect = Make<SaturationEffect>();
+        auto hueRotationEffect = Make<HueRotationEffect>();
+
+        ThrowIfFailed(saturationEffect->put_Source(f.m_bitmap.Get()));
+        ThrowIfFailed(hueRotationEffect->put_Source(saturationEffect.Get()));
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(hueRotationEffect.Get()));
+
+        Assert::AreEqual<size_t>(2, f.m_mockEffects.size());
+        Assert::IsTrue(IsSameInstance(f.m_mockEffects[0].Get(), f.m_drawnImage.Get()));
+        CheckEffectTypeAndInput(f.m_mockEffects[0].Get(), CLSID_D2D1HueRotation, f.m_mockEffects[1].Get());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_FoldColorTransforms_ChainIsDrawnAsOneColorMatrix)
+    {
+        ColorFoldingFixture f;
+
+        auto saturationEffect = Make<SaturationEffect>();
+        auto hueRotationEffect = Make<HueRotationEffect>();
+
+        ThrowIfFailed(saturationEffect->put_Source(f.m_bitmap.Get()));
+        ThrowIfFailed(saturationEffect->put_Saturation(0.25f));
+
+        ThrowIfFailed(hueRotationEffect->put_Source(saturationEffect.Get()));
+        ThrowIfFailed(hueRotationEffect->put_Angle(DirectX::XM_PIDIV2));
+        ThrowIfFailed(hueRotationEffect->put_FoldColorTransforms(true));
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(hueRotationEffect.Get()));
+
+        // The hue rotation and saturation effects are realized as normal, plus one
+        // color matrix combining the two, which is what actually gets drawn.
+        Assert::AreEqual<size_t>(3, f.m_mockEffects.size());
+
+        auto colorMatrix = f.m_mockEffects[2];
+
+        Assert::IsTrue(IsSameInstance(colorMatrix.Get(), f.m_drawnImage.Get()));
+        CheckEffectTypeAndInput(colorMatrix.Get(), CLSID_D2D1ColorMatrix, f.GetBitmapImage().Get());
+
+        CheckColorMatrix(ColorMatrixFolding::Compose(ColorMatrixFolding::Saturation(0.25f), ColorMatrixFolding::HueRotation(90)),
+                         colorMatrix->m_properties[D2D1_COLORMATRIX_PROP_COLOR_MATRIX]);
+
+        // Changing an effect partway down the chain updates the folded matrix.
+        ThrowIfFailed(saturationEffect->put_Saturation(0.75f));
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(hueRotationEffect.Get()));
+
+        Assert::AreEqual<size_t>(3, f.m_mockEffects.size());
+        Assert::IsTrue(IsSameInstance(colorMatrix.Get(), f.m_drawnImage.Get()));
+
+        CheckColorMatrix(ColorMatrixFolding::Compose(ColorMatrixFolding::Saturation(0.75f), ColorMatrixFolding::HueRotation(90)),
+                         colorMatrix->m_properties[D2D1_COLORMATRIX_PROP_COLOR_MATRIX]);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_FoldColorTransforms_SettingCacheOutputOrBufferPrecision_RebuildsFoldedChain)
+    {
+        ColorFoldingFixture f;
+
+        auto saturationEffect = Make<SaturationEffect>();
+        auto hueRotationEffect = Make<HueRotationEffect>();
+
+        ThrowIfFailed(saturationEffect->put_Source(f.m_bitmap.Get()));
+        ThrowIfFailed(saturationEffect->put_Saturation(0.25f));
+
+        ThrowIfFailed(hueRotationEffect->put_Source(saturationEffect.Get()));
+        ThrowIfFailed(hueRotationEffect->put_Angle(DirectX::XM_PIDIV2));
+        ThrowIfFailed(hueRotationEffect->put_FoldColorTransforms(true));
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(hueRotationEffect.Get()));
+
+        Assert::AreEqual<size_t>(3, f.m_mockEffects.size());
+        Assert::IsTrue(IsSameInstance(f.m_mockEffects[2].Get(), f.m_drawnImage.Get()));
+
+        // A cached effect can't be folded, so the chain is drawn through the real effects.
+        ThrowIfFailed(saturationEffect->put_CacheOutput(true));
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(hueRotationEffect.Get()));
+
+        Assert::IsTrue(IsSameInstance(f.m_mockEffects[0].Get(), f.m_drawnImage.Get()));
+        CheckEffectTypeAndInput(f.m_mockEffects[0].Get(), CLSID_D2D1HueRotation, f.m_mockEffects[1].Get());
+
+        // Turning caching back off lets the chain fold again.
+        ThrowIfFailed(saturationEffect->put_CacheOutput(false));
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(hueRotationEffect.Get()));
+
+        Assert::IsTrue(IsSameInstance(f.m_mockEffects[2].Get(), f.m_drawnImage.Get()));
+
+        // The same goes for an explicit buffer precision.
+        auto precision = Make<Nullable<CanvasBufferPrecision>>(CanvasBufferPrecision::Precision32Float);
+        ThrowIfFailed(saturationEffect->put_BufferPrecision(precision.Get()));
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(hueRotationEffect.Get()));
+
+        Assert::IsTrue(IsSameInstance(f.m_mockEffects[0].Get(), f.m_drawnImage.Get()));
+        CheckEffectTypeAndInput(f.m_mockEffects[0].Get(), CLSID_D2D1HueRotation, f.m_mockEffects[1].Get());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_FoldColorTransforms_AppliesToSourcesOfOtherEffects)
+    {
+        ColorFoldingFixture f;
+
+        auto saturationEffect = Make<SaturationEffect>();
+        auto hueRotationEffect = Make<HueRotationEffect>();
+        auto blurEffect = Make<TestEffect>(m_blurGuid, 1, 1, false);
+
+        ThrowIfFailed(saturationEffect->put_Source(f.m_bitmap.Get()));
+        ThrowIfFailed(hueRotationEffect->put_Source(saturationEffect.Get()));
+        ThrowIfFailed(hueRotationEffect->put_Angle(1));
+        ThrowIfFailed(blurEffect->put_Source(hueRotationEffect.Get()));
+        ThrowIfFailed(blurEffect->put_BlurAmount(1));
+
+        // Setting the property on the root effect is enough to fold color transforms anywhere beneath it.
+        ThrowIfFailed(blurEffect->put_FoldColorTransforms(true));
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(blurEffect.Get()));
+
+        Assert::AreEqual<size_t>(4, f.m_mockEffects.size());
+        Assert::IsTrue(IsSameInstance(f.m_mockEffects[0].Get(), f.m_drawnImage.Get()));
+        CheckEffectTypeAndInput(f.m_mockEffects[0].Get(), m_blurGuid, f.m_mockEffects[3].Get());
+        CheckEffectTypeAndInput(f.m_mockEffects[3].Get(), CLSID_D2D1ColorMatrix, f.GetBitmapImage().Get());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_FoldColorTransforms_IdentityEffectsAreSkipped)
+    {
+        ColorFoldingFixture f;
+
+        auto saturationEffect = Make<SaturationEffect>();
+
+        ThrowIfFailed(saturationEffect->put_Source(f.m_bitmap.Get()));
+        ThrowIfFailed(saturationEffect->put_Saturation(1));
+        ThrowIfFailed(saturationEffect->put_FoldColorTransforms(true));
+
+        // Full saturation leaves colors unchanged, so the bitmap is drawn directly.
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(saturationEffect.Get()));
+
+        Assert::AreEqual<size_t>(1, f.m_mockEffects.size());
+        Assert::IsTrue(IsSameInstance(f.GetBitmapImage().Get(), f.m_drawnImage.Get()));
+
+        // A single effect that does something is drawn as itself.
+        ThrowIfFailed(saturationEffect->put_Saturation(0.5f));
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(saturationEffect.Get()));
+
+        Assert::AreEqual<size_t>(1, f.m_mockEffects.size());
+        Assert::IsTrue(IsSameInstance(f.m_mockEffects[0].Get(), f.m_drawnImage.Get()));
+    }
+
+    TEST_METHOD_EX(CanvasEffect_FoldColorTransforms_GetNativeResourceReturnsTheEffectItself)
+    {
+        ColorFoldingFixture f;
+
+        auto saturationEffect = Make<SaturationEffect>();
+
+        ThrowIfFailed(saturationEffect->put_Source(f.m_bitmap.Get()));
+        ThrowIfFailed(saturationEffect->put_Saturation(1));
+        ThrowIfFailed(saturationEffect->put_FoldColorTransforms(true));
+
+        f.m_canvasDevice->GetResourceCreationDeviceContextMethod.AllowAnyCall(
+            [&]
+            {
+                return DeviceContextLease(As<ID2D1DeviceContext1>(f.m_deviceContext));
+            });
+
+        ComPtr<ID2D1Effect> d2dEffect;
+        ThrowIfFailed(As<ICanvasResourceWrapperNative>(saturationEffect)->GetNativeResource(f.m_canvasDevice.Get(), DEFAULT_DPI, IID_PPV_ARGS(&d2dEffect)));
+
+        Assert::IsTrue(IsSameInstance(f.m_mockEffects[0].Get(), d2dEffect.Get()));
+    }
+
     TEST_METHOD_EX(CanvasEffect_DpiCompensation)
     {
         Fixture f;
@@ -582,7 +1309,7 @@ public:
             , CommandListFactory(Make<CanvasCommandListFactory>())
         {
             DeviceContext->CreateEffectMethod.AllowAnyCall(
-                [=](IID const& effectId, ID2D1Effect** effect)
+                [this](IID const& effectId, ID2D1Effect** effect)
                 {
                     MockEffects.push_back(Make<MockD2DEffectThatCountsCalls>(effectId));
                     return MockEffects.back().CopyTo(effect);
@@ -946,7 +1673,7 @@ public:
             m_testEffect->SetSource(0, m_stubBitmap.Get());
 
             m_deviceContext->CreateEffectMethod.SetExpectedCalls(expectedCreateEffectCalls,
-                [=](IID const& effectId, ID2D1Effect** effect)
+                [this](IID const& effectId, ID2D1Effect** effect)
                 {
                     m_mockEffects.push_back(Make<MockD2DEffectThatCountsCalls>(effectId));
                     return m_mockEffects.back().CopyTo(effect);
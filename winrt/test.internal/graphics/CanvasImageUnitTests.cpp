@@ -910,7 +910,7 @@ TEST_CLASS(CanvasImageHistogramUnitTests)
         Assert::AreEqual<void*>(effects2.HistogramEffect.Get(), d2dHistogram2.Get());
         Assert::AreEqual<void*>(effects2.AtlasEffect.Get(), d2dAtlas2.Get());
 
-        // Releasing the first effects should transfer their ownership back to the device.
+        // Releasing the effects should transfer their ownership back to the device.
         AssertExpectedRefCount(d2dHistogram1.Get(), 2);
         AssertExpectedRefCount(d2dHistogram2.Get(), 2);
         AssertExpectedRefCount(d2dAtlas1.Get(), 2);
@@ -926,17 +926,28 @@ TEST_CLASS(CanvasImageHistogramUnitTests)
         AssertExpectedRefCount(d2dAtlas1.Get(), 2);
         AssertExpectedRefCount(d2dAtlas2.Get(), 2);
 
-        // Releasing the second effects should swap them with the ones the device is currently holding.
+        // The device keeps more than one pair, so both remain available for concurrent callers.
         deviceInternal->ReleaseHistogramEffect(std::move(effects2));
 
         Assert::IsNull(effects2.HistogramEffect.Get());
         Assert::IsNull(effects2.AtlasEffect.Get());
 
-        AssertExpectedRefCount(d2dHistogram1.Get(), 1);
+        AssertExpectedRefCount(d2dHistogram1.Get(), 2);
         AssertExpectedRefCount(d2dHistogram2.Get(), 2);
-        AssertExpectedRefCount(d2dAtlas1.Get(), 1);
+        AssertExpectedRefCount(d2dAtlas1.Get(), 2);
         AssertExpectedRefCount(d2dAtlas2.Get(), 2);
 
+        effects = deviceInternal->LeaseHistogramEffect(d2dContext.Get());
+        effects2 = deviceInternal->LeaseHistogramEffect(d2dContext.Get());
+
+        Assert::AreEqual<void*>(effects.HistogramEffect.Get(), d2dHistogram2.Get());
+        Assert::AreEqual<void*>(effects2.HistogramEffect.Get(), d2dHistogram1.Get());
+
+        deviceInternal->ReleaseHistogramEffect(std::move(effects));
+        deviceInternal->ReleaseHistogramEffect(std::move(effects2));
+
+        Expectations::Instance()->Validate();
+
         // Closing the device should release everything.
         canvasDevice->Close();
 
@@ -946,6 +957,228 @@ TEST_CLASS(CanvasImageHistogramUnitTests)
         AssertExpectedRefCount(d2dAtlas2.Get(), 1);
     }
 
+    TEST_METHOD_EX(CanvasImage_ComputeHistogram_HistogramEffectPoolIsBounded)
+    {
+        auto deviceAdapter = std::make_shared<TestDeviceAdapter>();
+        CanvasDeviceAdapter::SetInstance(deviceAdapter);
+
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+        auto canvasDevice = Make<CanvasDevice>(d2dDevice.Get());
+        auto deviceInternal = As<ICanvasDeviceInternal>(canvasDevice);
+        auto d2dContext = Make<MockD2DDeviceContext>();
+
+        size_t const leaseCount = CanvasDevice::MaxPooledHistogramEffects + 2;
+
+        d2dContext->CreateEffectMethod.SetExpectedCalls(static_cast<int>(leaseCount * 2), [&](IID const& iid, ID2D1Effect** effect)
+        {
+            return Make<StubD2DEffect>(iid).CopyTo(effect);
+        });
+
+        std::vector<CanvasDevice::HistogramAndAtlasEffects> leased;
+
+        for (size_t i = 0; i < leaseCount; i++)
+        {
+            leased.push_back(deviceInternal->LeaseHistogramEffect(d2dContext.Get()));
+        }
+
+        std::vector<ComPtr<ID2D1Effect>> histograms;
+
+        for (auto& effects : leased)
+        {
+            histograms.push_back(effects.HistogramEffect);
+            deviceInternal->ReleaseHistogramEffect(std::move(effects));
+        }
+
+        Expectations::Instance()->Validate();
+
+        // Only the first MaxPooledHistogramEffects pairs were kept.
+        for (size_t i = 0; i < leaseCount; i++)
+        {
+            AssertExpectedRefCount(histograms[i].Get(), (i < CanvasDevice::MaxPooledHistogramEffects) ? 2 : 1);
+        }
+
+        // Closing the device empties the pool.
+        canvasDevice->Close();
+
+        for (auto& histogram : histograms)
+        {
+            AssertExpectedRefCount(histogram.Get(), 1);
+        }
+    }
+
+    TEST_METHOD_EX(CanvasImage_ComputeHistogram_ExtraHistogramEffectsAreCreatedWithoutAnAtlas)
+    {
+        auto deviceAdapter = std::make_shared<TestDeviceAdapter>();
+        CanvasDeviceAdapter::SetInstance(deviceAdapter);
+
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+        auto canvasDevice = Make<CanvasDevice>(d2dDevice.Get());
+        auto deviceInternal = As<ICanvasDeviceInternal>(canvasDevice);
+        auto d2dContext = Make<MockD2DDeviceContext>();
+
+        size_t const leaseCount = CanvasDevice::MaxPooledHistogramEffects + 2;
+
+        d2dContext->CreateEffectMethod.SetExpectedCalls(static_cast<int>(leaseCount), [&](IID const& iid, ID2D1Effect** effect)
+        {
+            Assert::AreEqual(CLSID_D2D1Histogram, iid);
+            return Make<StubD2DEffect>(iid).CopyTo(effect);
+        });
+
+        std::vector<ComPtr<ID2D1Effect>> leased;
+
+        for (size_t i = 0; i < leaseCount; i++)
+        {
+            leased.push_back(deviceInternal->LeaseExtraHistogramEffect(d2dContext.Get()));
+        }
+
+        auto histograms = leased;
+
+        for (auto& effect : leased)
+        {
+            deviceInternal->ReleaseExtraHistogramEffect(std::move(effect));
+            Assert::IsNull(effect.Get());
+        }
+
+        Expectations::Instance()->Validate();
+
+        // Only the first MaxPooledHistogramEffects effects were kept, and are handed out again.
+        for (size_t i = 0; i < leaseCount; i++)
+        {
+            AssertExpectedRefCount(histograms[i].Get(), (i < CanvasDevice::MaxPooledHistogramEffects) ? 2 : 1);
+        }
+
+        auto effect = deviceInternal->LeaseExtraHistogramEffect(d2dContext.Get());
+        Assert::IsTrue(IsSameInstance(histograms[CanvasDevice::MaxPooledHistogramEffects - 1].Get(), effect.Get()));
+        deviceInternal->ReleaseExtraHistogramEffect(std::move(effect));
+
+        // Closing the device empties the pool.
+        canvasDevice->Close();
+
+        for (auto& histogram : histograms)
+        {
+            AssertExpectedRefCount(histogram.Get(), 1);
+        }
+    }
+
+    TEST_METHOD_EX(CanvasImage_ComputeHistograms_SharesAtlasAndDraw)
+    {
+        auto factory = Make<CanvasImageFactory>();
+        auto canvasDevice = Make<StubCanvasDevice>();
+        auto d2dContext = Make<MockD2DDeviceContext>();
+        auto d2dBitmap = Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_NONE);
+        auto canvasBitmap = Make<CanvasBitmap>(nullptr, d2dBitmap.Get());
+        Rect rect{ 1, 2, 3, 4 };
+        const int numBins = 8;
+
+        EffectChannelSelect channels[] = { EffectChannelSelect::Red, EffectChannelSelect::Green, EffectChannelSelect::Alpha };
+        const uint32_t channelCount = _countof(channels);
+
+        canvasDevice->GetResourceCreationDeviceContextMethod.SetExpectedCalls(1, [&]
+        {
+            return DeviceContextLease(d2dContext);
+        });
+
+        auto atlas = Make<MockD2DEffectThatCountsCalls>();
+        auto atlasPtr = atlas.Get();
+
+        atlas->MockGetOutput = [atlasPtr](ID2D1Image** output)
+        {
+            ComPtr<ID2D1Image>(atlasPtr).CopyTo(output);
+        };
+
+        std::vector<ComPtr<MockD2DEffectThatCountsCalls>> histograms;
+
+        auto makeHistogram = [&]
+        {
+            auto histogram = Make<MockD2DEffectThatCountsCalls>();
+
+            // Each histogram fills its output with its own index.
+            float index = static_cast<float>(histograms.size());
+
+            histogram->MockGetValue = [=](UINT32 propertyIndex, D2D1_PROPERTY_TYPE, BYTE* data, UINT32 dataSize)
+            {
+                Assert::AreEqual<uint32_t>(D2D1_HISTOGRAM_PROP_HISTOGRAM_OUTPUT, propertyIndex);
+                Assert::AreEqual<size_t>(numBins * sizeof(float), dataSize);
+
+                std::fill_n(reinterpret_cast<float*>(data), numBins, index);
+                return S_OK;
+            };
+
+            histograms.push_back(histogram);
+            return histogram;
+        };
+
+        // Only one atlas effect is leased, along with the first histogram.
+        canvasDevice->LeaseHistogramEffectMethod.SetExpectedCalls(1, [&](ID2D1DeviceContext*)
+        {
+            return CanvasDevice::HistogramAndAtlasEffects{ makeHistogram(), atlas };
+        });
+
+        canvasDevice->ReleaseHistogramEffectMethod.SetExpectedCalls(1, [&](CanvasDevice::HistogramAndAtlasEffects releasing)
+        {
+            Assert::IsTrue(IsSameInstance(histograms[0].Get(), releasing.HistogramEffect.Get()));
+            Assert::IsTrue(IsSameInstance(atlas.Get(), releasing.AtlasEffect.Get()));
+        });
+
+        canvasDevice->LeaseExtraHistogramEffectMethod.SetExpectedCalls(channelCount - 1, [&](ID2D1DeviceContext*)
+        {
+            return makeHistogram();
+        });
+
+        canvasDevice->ReleaseExtraHistogramEffectMethod.SetExpectedCalls(channelCount - 1);
+
+        d2dContext->BeginDrawMethod.SetExpectedCalls(1);
+        d2dContext->EndDrawMethod.SetExpectedCalls(1);
+
+        int drawCount = 0;
+
+        d2dContext->DrawImageMethod.SetExpectedCalls(channelCount, [&](ID2D1Image* image, D2D1_POINT_2F const*, D2D1_RECT_F const*, D2D1_INTERPOLATION_MODE, D2D1_COMPOSITE_MODE)
+        {
+            Assert::IsTrue(IsSameInstance(histograms[drawCount++].Get(), image));
+        });
+
+        ComArray<float> result;
+        ThrowIfFailed(factory->ComputeHistograms(canvasBitmap.Get(), rect, canvasDevice.Get(), channelCount, channels, numBins, result.GetAddressOfSize(), result.GetAddressOfData()));
+
+        Assert::AreEqual<uint32_t>(channelCount * numBins, result.GetSize());
+
+        for (uint32_t i = 0; i < result.GetSize(); i++)
+        {
+            Assert::AreEqual(static_cast<float>(i / numBins), result[i]);
+        }
+
+        for (uint32_t i = 0; i < channelCount; i++)
+        {
+            auto& histogram = histograms[i];
+
+            // Every histogram reads from the one atlas effect, and inputs are cleared on release.
+            if (i == 0)
+                Assert::IsTrue(IsSameInstance(atlas.Get(), histogram->m_inputs[0].Get()));
+            else
+                Assert::IsNull(histogram->m_inputs[0].Get());
+
+            Assert::AreEqual(static_cast<int>(channels[i]), *reinterpret_cast<int*>(histogram->m_properties[D2D1_HISTOGRAM_PROP_CHANNEL_SELECT].data()));
+        }
+
+        Assert::IsNull(atlas->m_inputs[0].Get());
+    }
+
+    TEST_METHOD_EX(CanvasImage_ComputeHistograms_InvalidArgs)
+    {
+        auto factory = Make<CanvasImageFactory>();
+        auto canvasDevice = Make<StubCanvasDevice>();
+        auto bitmap = CreateStubCanvasBitmap();
+        Rect rect{ 1, 2, 3, 4 };
+        EffectChannelSelect channels[] = { EffectChannelSelect::Red };
+        EffectChannelSelect tooManyChannels[] = { EffectChannelSelect::Red, EffectChannelSelect::Green, EffectChannelSelect::Blue, EffectChannelSelect::Alpha, EffectChannelSelect::Red };
+        ComArray<float> result;
+
+        Assert::AreEqual(E_INVALIDARG, factory->ComputeHistograms(bitmap.Get(), rect, canvasDevice.Get(), 1, nullptr,  64, result.GetAddressOfSize(), result.GetAddressOfData()));
+        Assert::AreEqual(E_INVALIDARG, factory->ComputeHistograms(bitmap.Get(), rect, canvasDevice.Get(), 0, channels, 64, result.GetAddressOfSize(), result.GetAddressOfData()));
+        Assert::AreEqual(E_INVALIDARG, factory->ComputeHistograms(bitmap.Get(), rect, canvasDevice.Get(), 1, channels, 1,  result.GetAddressOfSize(), result.GetAddressOfData()));
+        Assert::AreEqual(E_INVALIDARG, factory->ComputeHistograms(bitmap.Get(), rect, canvasDevice.Get(), _countof(tooManyChannels), tooManyChannels, 64, result.GetAddressOfSize(), result.GetAddressOfData()));
+    }
+
     static void AssertExpectedRefCount(ID2D1Effect* ptr, unsigned long expected)
     {
         ptr->AddRef();
@@ -0,0 +1,551 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include <lib/images/CanvasReadbackQueue.h>
+
+TEST_CLASS(CanvasReadbackQueueUnitTests)
+{
+public:
+    typedef ITypedEventHandler<CanvasReadbackQueue*, CanvasBitmapPixelLock*> ReadbackHandler;
+
+    class StubGpuFence : public GpuFence
+    {
+        std::shared_ptr<bool> m_isComplete;
+
+    public:
+        StubGpuFence(std::shared_ptr<bool> const& isComplete)
+            : m_isComplete(isComplete)
+        {
+        }
+
+        virtual bool IsComplete() override
+        {
+            return *m_isComplete;
+        }
+    };
+
+    struct StagingBitmap
+    {
+        ComPtr<StubD2DBitmap> Bitmap;
+        std::vector<uint8_t> Pixels;
+        uint32_t Pitch;
+        bool Mapped;
+        int CopyCount;
+    };
+
+    struct Completion
+    {
+        ID2D1Bitmap* StagingBitmap;
+        ComPtr<ICanvasBitmapPixelLock> PixelLock;
+    };
+
+    struct Fixture
+    {
+        ComPtr<MockCanvasDevice> Device;
+        ComPtr<MockD2DDeviceContext> DeviceContext;
+        ComPtr<CanvasReadbackQueue> Queue;
+
+        // In the order they were created, or inserted.
+        std::vector<std::shared_ptr<StagingBitmap>> StagingBitmaps;
+        std::vector<std::shared_ptr<bool>> Fences;
+
+        // Each copy or fence, as it happened.
+        std::vector<std::wstring> Log;
+
+        Fixture(uint32_t depth = 2)
+            : Device(Make<MockCanvasDevice>())
+            , DeviceContext(Make<MockD2DDeviceContext>())
+            , Queue(Make<CanvasReadbackQueue>(Device.Get(), depth))
+        {
+            Device->GetResourceCreationDeviceContextMethod.AllowAnyCall(
+                [=] { return DeviceContextLease(As<ID2D1DeviceContext1>(DeviceContext)); });
+
+            Device->InsertGpuFenceMethod.AllowAnyCall(
+                [=]
+                {
+                    auto isComplete = std::make_shared<bool>(false);
+                    Fences.push_back(isComplete);
+                    Log.push_back(L"fence");
+                    return std::unique_ptr<GpuFence>(new StubGpuFence(isComplete));
+                });
+
+            DeviceContext->CreateBitmapMethod.AllowAnyCall(
+                [=] (D2D1_SIZE_U size, void const* data, UINT32, D2D1_BITMAP_PROPERTIES1 const* properties, ID2D1Bitmap1** bitmap)
+                {
+                    Assert::IsNull(data);
+                    Assert::AreEqual<uint32_t>(D2D1_BITMAP_OPTIONS_CPU_READ | D2D1_BITMAP_OPTIONS_CANNOT_DRAW, properties->bitmapOptions);
+
+                    auto staging = std::make_shared<StagingBitmap>();
+                    staging->Bitmap = Make<StubD2DBitmap>(properties->bitmapOptions);
+                    staging->Pitch = size.width * 4 + 16;
+                    staging->Pixels.resize(staging->Pitch * size.height);
+                    staging->Mapped = false;
+                    staging->CopyCount = 0;
+
+                    auto format = properties->pixelFormat;
+                    auto stagingPtr = staging.get();
+
+                    staging->Bitmap->GetPixelSizeMethod.AllowAnyCall([=] { return size; });
+                    staging->Bitmap->GetPixelFormatMethod.AllowAnyCall([=] { return format; });
+
+                    staging->Bitmap->CopyFromBitmapMethod.AllowAnyCall(
+                        [=] (D2D1_POINT_2U const* destinationPoint, ID2D1Bitmap*, D2D1_RECT_U const*)
+                        {
+                            Assert::IsNull(destinationPoint);
+                            Assert::IsFalse(stagingPtr->Mapped);
+                            stagingPtr->CopyCount++;
+                            Log.push_back(L"copy");
+                            return S_OK;
+                        });
+
+                    staging->Bitmap->MapMethod.AllowAnyCall(
+                        [=] (D2D1_MAP_OPTIONS options, D2D1_MAPPED_RECT* mappedRect)
+                        {
+                            Assert::IsTrue(options == D2D1_MAP_OPTIONS_READ);
+                            Assert::IsFalse(stagingPtr->Mapped);
+                            mappedRect->pitch = stagingPtr->Pitch;
+                            mappedRect->bits = stagingPtr->Pixels.data();
+                            stagingPtr->Mapped = true;
+                            return S_OK;
+                        });
+
+                    staging->Bitmap->UnmapMethod.AllowAnyCall(
+                        [=]
+                        {
+                            Assert::IsTrue(stagingPtr->Mapped);
+                            stagingPtr->Mapped = false;
+                            return S_OK;
+                        });
+
+                    StagingBitmaps.push_back(staging);
+                    return staging->Bitmap.CopyTo(bitmap);
+                });
+        }
+
+        ComPtr<CanvasBitmap> MakeBitmap(uint32_t width, uint32_t height)
+        {
+            auto d2dBitmap = Make<StubD2DBitmap>();
+            d2dBitmap->GetPixelSizeMethod.AllowAnyCall([=] { return D2D1_SIZE_U{ width, height }; });
+            d2dBitmap->GetPixelFormatMethod.AllowAnyCall([=] { return D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED); });
+
+            return Make<CanvasBitmap>(Device.Get(), d2dBitmap.Get());
+        }
+
+        // Records each completed readback into completions, checking that
+        // the staging bitmap is mapped for the duration of the handler.
+        ComPtr<ReadbackHandler> MakeHandler(std::vector<Completion>* completions)
+        {
+            auto handler = Callback<ReadbackHandler>(
+                [=] (ICanvasReadbackQueue* sender, ICanvasBitmapPixelLock* pixelLock)
+                {
+                    Assert::IsTrue(IsSameInstance(Queue.Get(), sender));
+
+                    uint8_t* data;
+                    uint32_t capacity;
+                    ThrowIfFailed(As<::Windows::Foundation::IMemoryBufferByteAccess>(pixelLock)->GetBuffer(&data, &capacity));
+
+                    auto it = std::find_if(StagingBitmaps.begin(), StagingBitmaps.end(),
+                        [=] (std::shared_ptr<StagingBitmap> const& staging) { return staging->Pixels.data() == data; });
+
+                    Assert::IsTrue(it != StagingBitmaps.end());
+                    Assert::IsTrue((*it)->Mapped);
+
+                    completions->push_back(Completion{ (*it)->Bitmap.Get(), pixelLock });
+                    return S_OK;
+                });
+            CheckMakeResult(handler);
+
+            return handler;
+        }
+
+        int32_t Poll()
+        {
+            int32_t completedCount;
+            ThrowIfFailed(Queue->Poll(&completedCount));
+            return completedCount;
+        }
+
+        int32_t Flush()
+        {
+            int32_t completedCount;
+            ThrowIfFailed(Queue->Flush(&completedCount));
+            return completedCount;
+        }
+
+        int32_t PendingCount()
+        {
+            int32_t value;
+            ThrowIfFailed(Queue->get_PendingCount(&value));
+            return value;
+        }
+    };
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Create_FailsWhenPassedInvalidParameters)
+    {
+        ComPtr<ICanvasReadbackQueueFactory> factory;
+        ThrowIfFailed(MakeAndInitialize<CanvasReadbackQueueFactory>(&factory));
+
+        auto device = Make<MockCanvasDevice>();
+        ComPtr<ICanvasReadbackQueue> queue;
+
+        Assert::AreEqual(E_INVALIDARG, factory->Create(nullptr, 2, &queue));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(device.Get(), 2, nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(device.Get(), 0, &queue));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(device.Get(), -1, &queue));
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Create_Succeeds)
+    {
+        ComPtr<ICanvasReadbackQueueFactory> factory;
+        ThrowIfFailed(MakeAndInitialize<CanvasReadbackQueueFactory>(&factory));
+
+        auto device = Make<MockCanvasDevice>();
+
+        ComPtr<ICanvasReadbackQueue> queue;
+        ThrowIfFailed(factory->Create(device.Get(), 3, &queue));
+
+        ComPtr<ICanvasDevice> retrievedDevice;
+        ThrowIfFailed(As<ICanvasResourceCreator>(queue)->get_Device(&retrievedDevice));
+        Assert::IsTrue(IsSameInstance(device.Get(), retrievedDevice.Get()));
+
+        int32_t depth;
+        ThrowIfFailed(queue->get_Depth(&depth));
+        Assert::AreEqual(3, depth);
+
+        int32_t pendingCount;
+        ThrowIfFailed(queue->get_PendingCount(&pendingCount));
+        Assert::AreEqual(0, pendingCount);
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Enqueue_FailsWhenPassedInvalidParameters)
+    {
+        Fixture f;
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        Assert::AreEqual(E_INVALIDARG, f.Queue->Enqueue(nullptr, handler.Get()));
+        Assert::AreEqual(E_INVALIDARG, f.Queue->Enqueue(bitmap.Get(), nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.Queue->EnqueueWithSubrectangle(bitmap.Get(), -1, 0, 1, 1, handler.Get()));
+        Assert::AreEqual(E_INVALIDARG, f.Queue->EnqueueWithSubrectangle(bitmap.Get(), 0, 0, 0, 1, handler.Get()));
+        Assert::AreEqual(E_INVALIDARG, f.Queue->EnqueueWithSubrectangle(bitmap.Get(), 0, 4, 8, 5, handler.Get()));
+
+        // Bitmaps from other devices can't be copied on the GPU.
+        Fixture otherDevice;
+        auto otherDeviceBitmap = otherDevice.MakeBitmap(8, 8);
+        Assert::AreEqual(E_INVALIDARG, f.Queue->Enqueue(otherDeviceBitmap.Get(), handler.Get()));
+        ValidateStoredErrorState(E_INVALIDARG, Strings::ReadbackQueueWrongDevice);
+
+        Assert::AreEqual(0, f.PendingCount());
+        Assert::IsTrue(f.StagingBitmaps.empty());
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Enqueue_CopiesAndInsertsFence_ButDoesNotWaitForTheGpu)
+    {
+        Fixture f;
+        std::vector<Completion> completions;
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        ThrowIfFailed(f.Queue->EnqueueWithSubrectangle(bitmap.Get(), 2, 4, 6, 3, f.MakeHandler(&completions).Get()));
+
+        Assert::AreEqual<size_t>(1, f.StagingBitmaps.size());
+        auto stagingSize = f.StagingBitmaps[0]->Bitmap->GetPixelSize();
+        Assert::AreEqual(6u, stagingSize.width);
+        Assert::AreEqual(3u, stagingSize.height);
+        Assert::IsFalse(f.StagingBitmaps[0]->Mapped);
+
+        Assert::AreEqual<size_t>(2, f.Log.size());
+        Assert::AreEqual(L"copy", f.Log[0].c_str());
+        Assert::AreEqual(L"fence", f.Log[1].c_str());
+
+        Assert::AreEqual(1, f.PendingCount());
+
+        // The GPU hasn't got to the copy yet, so Poll must not map the staging bitmap.
+        Assert::AreEqual(0, f.Poll());
+        Assert::IsTrue(completions.empty());
+
+        *f.Fences[0] = true;
+
+        Assert::AreEqual(1, f.Poll());
+        Assert::AreEqual<size_t>(1, completions.size());
+        Assert::AreEqual(0, f.PendingCount());
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Handler_IsGivenReadLockOverMappedStagingBitmap_ClosedWhenHandlerReturns)
+    {
+        Fixture f;
+        std::vector<Completion> completions;
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        ThrowIfFailed(f.Queue->EnqueueWithSubrectangle(bitmap.Get(), 2, 4, 6, 3, f.MakeHandler(&completions).Get()));
+
+        *f.Fences[0] = true;
+        Assert::AreEqual(1, f.Poll());
+
+        auto& staging = *f.StagingBitmaps[0];
+        auto const& pixelLock = completions[0].PixelLock;
+
+        Assert::IsFalse(staging.Mapped);
+
+        uint32_t stride;
+        Assert::AreEqual(RO_E_CLOSED, pixelLock->get_Stride(&stride));
+
+        uint32_t capacity;
+        ThrowIfFailed(As<ABI::Windows::Foundation::IMemoryBufferReference>(pixelLock)->get_Capacity(&capacity));
+        Assert::AreEqual(0u, capacity);
+
+        // While it was open, the lock described the subrectangle, with the last
+        // row not padded out to the full stride.
+        ThrowIfFailed(f.Queue->EnqueueWithSubrectangle(bitmap.Get(), 2, 4, 6, 3, Callback<ReadbackHandler>(
+            [&] (ICanvasReadbackQueue*, ICanvasBitmapPixelLock* lock)
+            {
+                uint32_t lockStride;
+                ThrowIfFailed(lock->get_Stride(&lockStride));
+                Assert::AreEqual(staging.Pitch, lockStride);
+
+                BitmapSize size;
+                ThrowIfFailed(lock->get_SizeInPixels(&size));
+                Assert::AreEqual(6u, size.Width);
+                Assert::AreEqual(3u, size.Height);
+
+                DirectXPixelFormat format;
+                ThrowIfFailed(lock->get_Format(&format));
+                Assert::AreEqual(PIXEL_FORMAT(B8G8R8A8UIntNormalized), format);
+
+                CanvasBitmapLockMode mode;
+                ThrowIfFailed(lock->get_Mode(&mode));
+                Assert::AreEqual(CanvasBitmapLockMode::Read, mode);
+
+                uint8_t* data;
+                uint32_t lockCapacity;
+                ThrowIfFailed(As<::Windows::Foundation::IMemoryBufferByteAccess>(lock)->GetBuffer(&data, &lockCapacity));
+                Assert::IsTrue(staging.Pixels.data() == data);
+                Assert::AreEqual(staging.Pitch * 2 + 6 * 4, lockCapacity);
+
+                return S_OK;
+            }).Get()));
+
+        Assert::AreEqual(1, f.Flush());
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Poll_CompletesInOrder_StoppingAtTheFirstUnfinishedCopy)
+    {
+        Fixture f(3);
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        for (int i = 0; i < 3; i++)
+        {
+            ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        }
+
+        Assert::AreEqual<size_t>(3, f.StagingBitmaps.size());
+
+        // The second and third copies have finished, but the first has not.
+        *f.Fences[1] = true;
+        *f.Fences[2] = true;
+
+        Assert::AreEqual(0, f.Poll());
+        Assert::IsTrue(completions.empty());
+
+        *f.Fences[0] = true;
+
+        Assert::AreEqual(3, f.Poll());
+        Assert::AreEqual<size_t>(3, completions.size());
+
+        for (int i = 0; i < 3; i++)
+        {
+            Assert::AreEqual(static_cast<ID2D1Bitmap*>(f.StagingBitmaps[i]->Bitmap.Get()), completions[i].StagingBitmap);
+        }
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Enqueue_ReusesStagingBitmaps_UnlessTheSizeChanges)
+    {
+        Fixture f(2);
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        for (int frame = 0; frame < 6; frame++)
+        {
+            ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+
+            *f.Fences.back() = true;
+            Assert::AreEqual(1, f.Poll());
+        }
+
+        Assert::AreEqual<size_t>(2, f.StagingBitmaps.size());
+        Assert::AreEqual(3, f.StagingBitmaps[0]->CopyCount);
+        Assert::AreEqual(3, f.StagingBitmaps[1]->CopyCount);
+
+        ThrowIfFailed(f.Queue->EnqueueWithSubrectangle(bitmap.Get(), 0, 0, 4, 4, handler.Get()));
+
+        Assert::AreEqual<size_t>(3, f.StagingBitmaps.size());
+        auto stagingSize = f.StagingBitmaps[2]->Bitmap->GetPixelSize();
+        Assert::AreEqual(4u, stagingSize.width);
+        Assert::AreEqual(4u, stagingSize.height);
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Enqueue_WhenFull_CompletesTheOldestReadbackFirst)
+    {
+        Fixture f(2);
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        Assert::IsTrue(completions.empty());
+
+        // Neither fence has completed, but there's nowhere else to copy to,
+        // so the oldest readback has to wait for the GPU.
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+
+        Assert::AreEqual<size_t>(1, completions.size());
+        Assert::AreEqual(static_cast<ID2D1Bitmap*>(f.StagingBitmaps[0]->Bitmap.Get()), completions[0].StagingBitmap);
+
+        Assert::AreEqual<size_t>(2, f.StagingBitmaps.size());
+        Assert::AreEqual(2, f.StagingBitmaps[0]->CopyCount);
+        Assert::AreEqual(2, f.PendingCount());
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Flush_CompletesEverything_WithoutWaitingForFences)
+    {
+        Fixture f(3);
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+
+        Assert::AreEqual(2, f.Flush());
+        Assert::AreEqual<size_t>(2, completions.size());
+        Assert::AreEqual(0, f.PendingCount());
+
+        Assert::AreEqual(0, f.Flush());
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Handler_CanEnqueueMoreReadbacks)
+    {
+        Fixture f(1);
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        int callCount = 0;
+
+        auto reenqueuingHandler = Callback<ReadbackHandler>(
+            [&] (ICanvasReadbackQueue* sender, ICanvasBitmapPixelLock*)
+            {
+                callCount++;
+                return sender->Enqueue(bitmap.Get(), handler.Get());
+            });
+
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), reenqueuingHandler.Get()));
+
+        // The staging bitmap is still mapped while the handler runs, so the
+        // readback it enqueues gets a new one.
+        Assert::AreEqual(1, f.Flush());
+        Assert::AreEqual(1, callCount);
+        Assert::AreEqual(1, f.PendingCount());
+        Assert::AreEqual<size_t>(2, f.StagingBitmaps.size());
+
+        Assert::AreEqual(1, f.Flush());
+        Assert::AreEqual<size_t>(1, completions.size());
+        Assert::AreEqual(static_cast<ID2D1Bitmap*>(f.StagingBitmaps[1]->Bitmap.Get()), completions[0].StagingBitmap);
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Handler_CanFlush)
+    {
+        Fixture f(3);
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        int flushedCount = -1;
+
+        auto flushingHandler = Callback<ReadbackHandler>(
+            [&] (ICanvasReadbackQueue* sender, ICanvasBitmapPixelLock*)
+            {
+                return sender->Flush(&flushedCount);
+            });
+
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), flushingHandler.Get()));
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+
+        // The nested flush completes the other two, leaving nothing for the
+        // outer one to do.
+        Assert::AreEqual(1, f.Flush());
+        Assert::AreEqual(2, flushedCount);
+        Assert::AreEqual<size_t>(2, completions.size());
+        Assert::AreEqual(0, f.PendingCount());
+
+        // The ring is still usable afterwards
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        Assert::AreEqual(1, f.Flush());
+        Assert::AreEqual<size_t>(3, completions.size());
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Handler_CanClose)
+    {
+        Fixture f(3);
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        auto closingHandler = Callback<ReadbackHandler>(
+            [&] (ICanvasReadbackQueue* sender, ICanvasBitmapPixelLock*)
+            {
+                return As<IClosable>(sender)->Close();
+            });
+
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), closingHandler.Get()));
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+
+        // Closing drops the other readbacks without calling their handlers
+        Assert::AreEqual(1, f.Flush());
+        Assert::IsTrue(completions.empty());
+
+        int32_t value;
+        Assert::AreEqual(RO_E_CLOSED, f.Queue->get_PendingCount(&value));
+
+        // Every staging bitmap was unmapped
+        for (auto& staging : f.StagingBitmaps)
+            Assert::IsFalse(staging->Mapped);
+    }
+
+    TEST_METHOD_EX(CanvasReadbackQueue_Close_DropsOutstandingReadbacks)
+    {
+        Fixture f;
+        std::vector<Completion> completions;
+        auto handler = f.MakeHandler(&completions);
+        auto bitmap = f.MakeBitmap(8, 8);
+
+        ThrowIfFailed(f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        *f.Fences[0] = true;
+
+        ThrowIfFailed(f.Queue->Close());
+        Assert::IsTrue(completions.empty());
+
+        int32_t value;
+        ComPtr<ICanvasDevice> device;
+
+        Assert::AreEqual(RO_E_CLOSED, f.Queue->Enqueue(bitmap.Get(), handler.Get()));
+        Assert::AreEqual(RO_E_CLOSED, f.Queue->Poll(&value));
+        Assert::AreEqual(RO_E_CLOSED, f.Queue->Flush(&value));
+        Assert::AreEqual(RO_E_CLOSED, f.Queue->get_Depth(&value));
+        Assert::AreEqual(RO_E_CLOSED, f.Queue->get_PendingCount(&value));
+        Assert::AreEqual(RO_E_CLOSED, f.Queue->get_Device(&device));
+    }
+};
+
+#endif
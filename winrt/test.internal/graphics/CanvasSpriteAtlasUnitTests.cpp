@@ -0,0 +1,484 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include <lib/drawing/CanvasSpriteAtlas.h>
+
+TEST_CLASS(CanvasSpriteAtlasUnitTests)
+{
+public:
+    struct CopiedBitmap
+    {
+        ID2D1Bitmap* AtlasBitmap;
+        ID2D1Bitmap* Source;
+        D2D1_POINT_2U Offset;
+        bool HasSourceRect;
+        D2D1_RECT_U SourceRect;
+    };
+
+    struct Fixture
+    {
+        ComPtr<MockCanvasDevice> Device;
+        ComPtr<MockD2DDeviceContext> DeviceContext;
+        ComPtr<CanvasSpriteAtlas> Atlas;
+        std::vector<ComPtr<StubD2DBitmap>> AtlasBitmaps;
+        std::vector<CopiedBitmap> Copies;
+        std::vector<ID2D1Image*> ClearedBitmaps;
+        HRESULT CopyResult;
+
+        Fixture(uint32_t width = 64, uint32_t height = 64)
+            : Device(Make<MockCanvasDevice>())
+            , DeviceContext(Make<MockD2DDeviceContext>())
+            , Atlas(Make<CanvasSpriteAtlas>(Device.Get(), width, height))
+            , CopyResult(S_OK)
+        {
+            auto target = std::make_shared<ComPtr<ID2D1Image>>();
+
+            DeviceContext->SetTargetMethod.AllowAnyCall(
+                [=] (ID2D1Image* value)
+                {
+                    *target = value;
+                });
+
+            DeviceContext->BeginDrawMethod.AllowAnyCall();
+            DeviceContext->EndDrawMethod.AllowAnyCall();
+
+            DeviceContext->ClearMethod.AllowAnyCall(
+                [=] (D2D1_COLOR_F const* color)
+                {
+                    Assert::IsNotNull(color);
+                    Assert::AreEqual(D2D1_COLOR_F{ 0, 0, 0, 0 }, *color);
+                    Assert::IsNotNull(target->Get());
+                    ClearedBitmaps.push_back(target->Get());
+                });
+
+            Device->GetResourceCreationDeviceContextMethod.AllowAnyCall(
+                [=]
+                {
+                    return DeviceContextLease(As<ID2D1DeviceContext1>(DeviceContext));
+                });
+
+            Device->CreateRenderTargetBitmapMethod.AllowAnyCall(
+                [=] (float actualWidth, float actualHeight, float dpi, DirectXPixelFormat format, CanvasAlphaMode alpha)
+                {
+                    Assert::AreEqual(static_cast<float>(width), actualWidth);
+                    Assert::AreEqual(static_cast<float>(height), actualHeight);
+                    Assert::AreEqual(DEFAULT_DPI, dpi);
+                    Assert::AreEqual(PIXEL_FORMAT(B8G8R8A8UIntNormalized), format);
+                    Assert::AreEqual(CanvasAlphaMode::Premultiplied, alpha);
+
+                    auto atlasBitmap = Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_TARGET);
+                    atlasBitmap->CopyFromBitmapMethod.AllowAnyCall(
+                        [=] (D2D1_POINT_2U const* offset, ID2D1Bitmap* source, D2D1_RECT_U const* sourceRect)
+                        {
+                            Copies.push_back(CopiedBitmap{
+                                atlasBitmap.Get(),
+                                source,
+                                *offset,
+                                sourceRect != nullptr,
+                                sourceRect ? *sourceRect : D2D1_RECT_U{} });
+                            return CopyResult;
+                        });
+
+                    AtlasBitmaps.push_back(atlasBitmap);
+                    return atlasBitmap;
+                });
+        }
+
+        ComPtr<CanvasBitmap> MakeBitmap(
+            uint32_t width,
+            uint32_t height,
+            DXGI_FORMAT format = DXGI_FORMAT_B8G8R8A8_UNORM,
+            D2D1_ALPHA_MODE alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED)
+        {
+            auto d2dBitmap = Make<StubD2DBitmap>();
+            d2dBitmap->GetPixelSizeMethod.AllowAnyCall([=] { return D2D1_SIZE_U{ width, height }; });
+            d2dBitmap->GetPixelFormatMethod.AllowAnyCall([=] { return D2D1_PIXEL_FORMAT{ format, alphaMode }; });
+
+            return Make<CanvasBitmap>(Device.Get(), d2dBitmap.Get());
+        }
+
+        bool TryAdd(ComPtr<CanvasBitmap> const& bitmap)
+        {
+            boolean added;
+            ThrowIfFailed(Atlas->TryAdd(bitmap.Get(), &added));
+            return !!added;
+        }
+
+        bool Contains(ComPtr<CanvasBitmap> const& bitmap)
+        {
+            boolean value;
+            ThrowIfFailed(Atlas->Contains(bitmap.Get(), &value));
+            return !!value;
+        }
+
+        int32_t Count()
+        {
+            int32_t value;
+            ThrowIfFailed(Atlas->get_Count(&value));
+            return value;
+        }
+
+        float Occupancy()
+        {
+            float value;
+            ThrowIfFailed(Atlas->get_Occupancy(&value));
+            return value;
+        }
+
+        void AssertCopied(size_t copyIndex, size_t atlasIndex, ComPtr<CanvasBitmap> const& bitmap, uint32_t x, uint32_t y)
+        {
+            Assert::IsTrue(copyIndex < Copies.size());
+
+            auto const& copy = Copies[copyIndex];
+            Assert::IsTrue(IsSameInstance(AtlasBitmaps[atlasIndex].Get(), copy.AtlasBitmap));
+            Assert::IsTrue(IsSameInstance(GetWrappedResource<ID2D1Bitmap1>(bitmap).Get(), copy.Source));
+            Assert::IsFalse(copy.HasSourceRect);
+            Assert::AreEqual(x, copy.Offset.x);
+            Assert::AreEqual(y, copy.Offset.y);
+        }
+
+        void AssertCopiedFromAtlas(size_t copyIndex, size_t atlasIndex, size_t sourceAtlasIndex, D2D1_RECT_U const& sourceRect, uint32_t x, uint32_t y)
+        {
+            Assert::IsTrue(copyIndex < Copies.size());
+
+            auto const& copy = Copies[copyIndex];
+            Assert::IsTrue(IsSameInstance(AtlasBitmaps[atlasIndex].Get(), copy.AtlasBitmap));
+            Assert::IsTrue(IsSameInstance(AtlasBitmaps[sourceAtlasIndex].Get(), copy.Source));
+            Assert::IsTrue(copy.HasSourceRect);
+            Assert::AreEqual(sourceRect.left, copy.SourceRect.left);
+            Assert::AreEqual(sourceRect.top, copy.SourceRect.top);
+            Assert::AreEqual(sourceRect.right, copy.SourceRect.right);
+            Assert::AreEqual(sourceRect.bottom, copy.SourceRect.bottom);
+            Assert::AreEqual(x, copy.Offset.x);
+            Assert::AreEqual(y, copy.Offset.y);
+        }
+    };
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_Create_FailsWhenPassedInvalidParameters)
+    {
+        ComPtr<ICanvasSpriteAtlasFactory> factory;
+        ThrowIfFailed(MakeAndInitialize<CanvasSpriteAtlasFactory>(&factory));
+
+        auto device = Make<MockCanvasDevice>();
+        ComPtr<ICanvasSpriteAtlas> atlas;
+
+        Assert::AreEqual(E_INVALIDARG, factory->Create(nullptr, 64, 64, &atlas));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(device.Get(), 64, 64, nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(device.Get(), 0, 64, &atlas));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(device.Get(), 64, -1, &atlas));
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_Create_Succeeds)
+    {
+        ComPtr<ICanvasSpriteAtlasFactory> factory;
+        ThrowIfFailed(MakeAndInitialize<CanvasSpriteAtlasFactory>(&factory));
+
+        auto device = Make<MockCanvasDevice>();
+        device->CreateRenderTargetBitmapMethod.SetExpectedCalls(0);
+
+        ComPtr<ICanvasSpriteAtlas> atlas;
+        ThrowIfFailed(factory->Create(device.Get(), 64, 64, &atlas));
+
+        ComPtr<ICanvasDevice> retrievedDevice;
+        ThrowIfFailed(As<ICanvasResourceCreator>(atlas)->get_Device(&retrievedDevice));
+        Assert::IsTrue(IsSameInstance(device.Get(), retrievedDevice.Get()));
+
+        int32_t count;
+        ThrowIfFailed(atlas->get_Count(&count));
+        Assert::AreEqual(0, count);
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_TryAdd_CopiesBitmapsIntoTheAtlas_InsideTheirPadding)
+    {
+        Fixture f;
+
+        auto a = f.MakeBitmap(10, 20);
+        auto b = f.MakeBitmap(10, 20);
+
+        Assert::IsTrue(f.TryAdd(a));
+        Assert::IsTrue(f.TryAdd(b));
+
+        Assert::AreEqual<size_t>(1, f.AtlasBitmaps.size());
+        Assert::AreEqual<size_t>(2, f.Copies.size());
+        f.AssertCopied(0, 0, a, 1, 1);
+        f.AssertCopied(1, 0, b, 13, 1);
+
+        Assert::IsTrue(f.Contains(a));
+        Assert::IsTrue(f.Contains(b));
+        Assert::AreEqual(2, f.Count());
+        Assert::AreEqual(2.0f * 12 * 22 / (64 * 64), f.Occupancy());
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_TryAdd_WhenBitmapIsAlreadyInTheAtlas_DoesNotCopyItAgain)
+    {
+        Fixture f;
+
+        auto a = f.MakeBitmap(10, 10);
+
+        Assert::IsTrue(f.TryAdd(a));
+        Assert::IsTrue(f.TryAdd(a));
+
+        Assert::AreEqual<size_t>(1, f.Copies.size());
+        Assert::AreEqual(1, f.Count());
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_TryAdd_ReturnsFalse_ForBitmapsThatCantBeAdded)
+    {
+        Fixture f;
+
+        Assert::IsFalse(f.TryAdd(f.MakeBitmap(10, 10, DXGI_FORMAT_R8G8B8A8_UNORM)));
+        Assert::IsFalse(f.TryAdd(f.MakeBitmap(10, 10, DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE)));
+        Assert::IsFalse(f.TryAdd(f.MakeBitmap(63, 10)));
+        Assert::IsFalse(f.TryAdd(f.MakeBitmap(10, 63)));
+
+        Assert::AreEqual<size_t>(0, f.Copies.size());
+        Assert::AreEqual(0, f.Count());
+
+        // Exactly fills the atlas, including padding
+        Assert::IsTrue(f.TryAdd(f.MakeBitmap(62, 62)));
+        Assert::AreEqual(1.0f, f.Occupancy());
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_TryAdd_FailsWhenBitmapUsesDifferentDevice)
+    {
+        Fixture f;
+
+        auto d2dBitmap = Make<StubD2DBitmap>();
+        auto bitmap = Make<CanvasBitmap>(Make<MockCanvasDevice>().Get(), d2dBitmap.Get());
+
+        boolean added;
+        Assert::AreEqual(E_INVALIDARG, f.Atlas->TryAdd(bitmap.Get(), &added));
+        ValidateStoredErrorState(E_INVALIDARG, Strings::SpriteAtlasWrongDevice);
+
+        Assert::AreEqual<size_t>(0, f.Copies.size());
+        Assert::AreEqual(0, f.Count());
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_TryAdd_WhenFull_EvictsLeastRecentlyUsedBitmapsIntoANewAtlasBitmap)
+    {
+        Fixture f(64, 32);
+
+        auto a = f.MakeBitmap(30, 30);
+        auto b = f.MakeBitmap(30, 30);
+        auto c = f.MakeBitmap(30, 30);
+
+        Assert::IsTrue(f.TryAdd(a));
+        Assert::IsTrue(f.TryAdd(b));
+
+        // Using 'a' again means 'b' is now the least recently used
+        Assert::IsTrue(f.TryAdd(a));
+
+        Assert::IsTrue(f.TryAdd(c));
+
+        Assert::IsTrue(f.Contains(a));
+        Assert::IsFalse(f.Contains(b));
+        Assert::IsTrue(f.Contains(c));
+        Assert::AreEqual(2, f.Count());
+
+        Assert::AreEqual<size_t>(2, f.AtlasBitmaps.size());
+        Assert::AreEqual<size_t>(4, f.Copies.size());
+
+        // 'c' is the most recently used, and 'a' comes across from the old
+        // atlas rather than being copied from its bitmap again.
+        f.AssertCopied(2, 1, c, 1, 1);
+        f.AssertCopiedFromAtlas(3, 1, 0, D2D1_RECT_U{ 1, 1, 31, 31 }, 33, 1);
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_TryAdd_WhenFull_EvictsAsManyBitmapsAsNeeded)
+    {
+        Fixture f(64, 32);
+
+        std::vector<ComPtr<CanvasBitmap>> narrow;
+
+        // Four of these exactly fill the width of the atlas, including padding
+        for (int i = 0; i < 4; ++i)
+        {
+            narrow.push_back(f.MakeBitmap(14, 30));
+            Assert::IsTrue(f.TryAdd(narrow.back()));
+        }
+
+        Assert::AreEqual(1.0f, f.Occupancy());
+
+        // Using these makes the other two the least recently used
+        Assert::IsTrue(f.TryAdd(narrow[0]));
+        Assert::IsTrue(f.TryAdd(narrow[2]));
+
+        // Needs half the atlas, so two of the narrow bitmaps have to go
+        auto wide = f.MakeBitmap(30, 30);
+        Assert::IsTrue(f.TryAdd(wide));
+
+        Assert::IsTrue(f.Contains(narrow[0]));
+        Assert::IsFalse(f.Contains(narrow[1]));
+        Assert::IsTrue(f.Contains(narrow[2]));
+        Assert::IsFalse(f.Contains(narrow[3]));
+        Assert::IsTrue(f.Contains(wide));
+        Assert::AreEqual(3, f.Count());
+
+        // Only the kept bitmaps are copied into the new atlas
+        Assert::AreEqual<size_t>(2, f.AtlasBitmaps.size());
+        Assert::AreEqual<size_t>(7, f.Copies.size());
+        f.AssertCopied(4, 1, wide, 1, 1);
+        f.AssertCopiedFromAtlas(5, 1, 0, D2D1_RECT_U{ 33, 1, 47, 31 }, 33, 1);
+        f.AssertCopiedFromAtlas(6, 1, 0, D2D1_RECT_U{ 1, 1, 15, 31 }, 49, 1);
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_NewAtlasBitmapsAreClearedToTransparent)
+    {
+        Fixture f(64, 32);
+
+        Assert::IsTrue(f.TryAdd(f.MakeBitmap(30, 30)));
+        Assert::IsTrue(f.TryAdd(f.MakeBitmap(30, 30)));
+        Assert::IsTrue(f.TryAdd(f.MakeBitmap(30, 30)));
+
+        Assert::AreEqual<size_t>(2, f.AtlasBitmaps.size());
+        Assert::AreEqual<size_t>(2, f.ClearedBitmaps.size());
+
+        for (size_t i = 0; i < f.AtlasBitmaps.size(); ++i)
+            Assert::IsTrue(IsSameInstance(f.AtlasBitmaps[i].Get(), f.ClearedBitmaps[i]));
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_WhenRelayoutFails_TheExistingLayoutIsKept)
+    {
+        Fixture f(64, 32);
+
+        auto a = f.MakeBitmap(30, 30);
+        auto b = f.MakeBitmap(30, 30);
+        auto c = f.MakeBitmap(30, 30);
+
+        Assert::IsTrue(f.TryAdd(a));
+        Assert::IsTrue(f.TryAdd(b));
+
+        auto atlasInternal = As<ICanvasSpriteAtlasInternal>(f.Atlas);
+        auto occupancy = f.Occupancy();
+
+        f.CopyResult = E_FAIL;
+
+        boolean added;
+        Assert::AreEqual(E_FAIL, f.Atlas->TryAdd(c.Get(), &added));
+        Assert::AreEqual(E_FAIL, f.Atlas->Repack());
+
+        Assert::IsTrue(f.Contains(a));
+        Assert::IsTrue(f.Contains(b));
+        Assert::IsFalse(f.Contains(c));
+        Assert::AreEqual(2, f.Count());
+        Assert::AreEqual(occupancy, f.Occupancy());
+
+        ComPtr<ID2D1Bitmap> atlasBitmap;
+        D2D1_POINT_2U offset;
+
+        Assert::IsTrue(atlasInternal->TryGetPlacement(GetWrappedResource<ID2D1Bitmap>(b).Get(), &atlasBitmap, &offset));
+        Assert::IsTrue(IsSameInstance(f.AtlasBitmaps[0].Get(), atlasBitmap.Get()));
+        Assert::AreEqual(33u, offset.x);
+        Assert::AreEqual(1u, offset.y);
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_Remove_SpaceIsReclaimedByRepack)
+    {
+        Fixture f;
+
+        auto a = f.MakeBitmap(30, 30);
+        auto b = f.MakeBitmap(30, 30);
+
+        Assert::IsTrue(f.TryAdd(a));
+        Assert::IsTrue(f.TryAdd(b));
+
+        auto occupancyBeforeRemove = f.Occupancy();
+
+        ThrowIfFailed(f.Atlas->Remove(a.Get()));
+
+        Assert::IsFalse(f.Contains(a));
+        Assert::AreEqual(1, f.Count());
+        Assert::AreEqual(occupancyBeforeRemove, f.Occupancy());
+
+        ThrowIfFailed(f.Atlas->Repack());
+
+        Assert::AreEqual(occupancyBeforeRemove / 2, f.Occupancy());
+        Assert::AreEqual<size_t>(2, f.AtlasBitmaps.size());
+        Assert::AreEqual<size_t>(3, f.Copies.size());
+        f.AssertCopiedFromAtlas(2, 1, 0, D2D1_RECT_U{ 33, 1, 63, 31 }, 1, 1);
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_Clear_RemovesAllBitmaps)
+    {
+        Fixture f;
+
+        auto a = f.MakeBitmap(30, 30);
+        Assert::IsTrue(f.TryAdd(a));
+
+        ThrowIfFailed(f.Atlas->Clear());
+
+        Assert::IsFalse(f.Contains(a));
+        Assert::AreEqual(0, f.Count());
+        Assert::AreEqual(0.0f, f.Occupancy());
+
+        Assert::IsTrue(f.TryAdd(a));
+        Assert::AreEqual<size_t>(2, f.AtlasBitmaps.size());
+        f.AssertCopied(1, 1, a, 1, 1);
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_get_Bitmap_ReturnsTheAtlasBitmap)
+    {
+        Fixture f;
+
+        ComPtr<ICanvasBitmap> bitmap;
+        ThrowIfFailed(f.Atlas->get_Bitmap(&bitmap));
+
+        Assert::AreEqual<size_t>(1, f.AtlasBitmaps.size());
+        Assert::IsTrue(IsSameInstance(f.AtlasBitmaps[0].Get(), GetWrappedResource<ID2D1Bitmap1>(bitmap).Get()));
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_TryGetPlacement_ReportsWhereBitmapsArePlaced)
+    {
+        Fixture f;
+
+        auto a = f.MakeBitmap(10, 10);
+        auto b = f.MakeBitmap(10, 10);
+        auto notAdded = f.MakeBitmap(10, 10);
+
+        Assert::IsTrue(f.TryAdd(a));
+        Assert::IsTrue(f.TryAdd(b));
+
+        auto atlasInternal = As<ICanvasSpriteAtlasInternal>(f.Atlas);
+
+        ComPtr<ID2D1Bitmap> atlasBitmap;
+        D2D1_POINT_2U offset;
+
+        Assert::IsTrue(atlasInternal->TryGetPlacement(GetWrappedResource<ID2D1Bitmap>(b).Get(), &atlasBitmap, &offset));
+        Assert::IsTrue(IsSameInstance(f.AtlasBitmaps[0].Get(), atlasBitmap.Get()));
+        Assert::AreEqual(13u, offset.x);
+        Assert::AreEqual(1u, offset.y);
+
+        Assert::IsFalse(atlasInternal->TryGetPlacement(GetWrappedResource<ID2D1Bitmap>(notAdded).Get(), &atlasBitmap, &offset));
+    }
+
+    TEST_METHOD_EX(CanvasSpriteAtlas_MethodsFail_AfterClosed)
+    {
+        Fixture f;
+
+        auto a = f.MakeBitmap(10, 10);
+        ThrowIfFailed(f.Atlas->Close());
+
+        boolean value;
+        int32_t count;
+        float occupancy;
+        ComPtr<ICanvasBitmap> bitmap;
+        ComPtr<ICanvasDevice> device;
+
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->TryAdd(a.Get(), &value));
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->Contains(a.Get(), &value));
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->Remove(a.Get()));
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->Repack());
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->Clear());
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->get_Count(&count));
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->get_Occupancy(&occupancy));
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->get_Bitmap(&bitmap));
+        Assert::AreEqual(RO_E_CLOSED, f.Atlas->get_Device(&device));
+    }
+};
+
+#endif
@@ -49,7 +49,8 @@ static ComPtr<CanvasDevice> MakeCanvasDeviceThatDoesNotSupportSpriteBatch()
 static CanvasSpriteSortMode gSortModes[] =
 {
     CanvasSpriteSortMode::None,
-    CanvasSpriteSortMode::Bitmap
+    CanvasSpriteSortMode::Bitmap,
+    CanvasSpriteSortMode::Layer
 };
 
 
@@ -182,8 +183,7 @@ private:
 };
 
 
-static void SetReportedVendorIdAndFeatureLevel(
-    MockD2DDeviceContext* deviceContext,
+static ComPtr<MockD2DDevice> MakeD2DDeviceThatReportsVendorIdAndFeatureLevel(
     uint32_t vendorId,
     D3D_FEATURE_LEVEL featureLevel)
 {
@@ -203,9 +203,19 @@ static void SetReportedVendorIdAndFeatureLevel(
     d3dDevice->GetFeatureLevelMethod.SetExpectedCalls(0, 1,
         [=] { return featureLevel; });
     
-    auto d2dDevice = Make<MockD2DDevice>(d3dDevice.Get());
+    return Make<MockD2DDevice>(d3dDevice.Get());
+}
+
+
+static ComPtr<MockD2DDevice> SetReportedVendorIdAndFeatureLevel(
+    MockD2DDeviceContext* deviceContext,
+    uint32_t vendorId,
+    D3D_FEATURE_LEVEL featureLevel)
+{
+    auto d2dDevice = MakeD2DDeviceThatReportsVendorIdAndFeatureLevel(vendorId, featureLevel);
     deviceContext->GetDeviceMethod.SetExpectedCalls(0, 1,
         [=] (ID2D1Device** d) { return d2dDevice.CopyTo(d); });
+    return d2dDevice;
 }
 
 
@@ -484,6 +494,17 @@ public:
     }
 
     
+    TEST_METHOD_EX(CanvasSpriteBatch_CreateSpriteBatchWithSortMode_FailsWhenPassedInvalidSortMode)
+    {
+        Fixture f;
+
+        ComPtr<ICanvasSpriteBatch> spriteBatch;
+
+        auto invalidSortMode = static_cast<CanvasSpriteSortMode>(static_cast<int>(CanvasSpriteSortMode::Layer) + 1);
+        Assert::AreEqual(E_INVALIDARG, f.DrawingSession->CreateSpriteBatchWithSortMode(invalidSortMode, &spriteBatch));
+    }
+
+    
     void TestDrawSpriteBatchOptions(
         D2D1_BITMAP_INTERPOLATION_MODE expectedInterpolationMode,
         D2D1_SPRITE_OPTIONS expectedOptions,
@@ -687,6 +708,10 @@ public:
         Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetToRectWithTintAndFlip(nullptr, destRect, sourceRect, tint, flip)); 
         Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetWithTransformAndTintAndFlip(nullptr, transform, sourceRect, tint, flip)); 
         Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetAtOffsetWithTintAndTransform(nullptr, offset, sourceRect, tint, origin, rotation, scale, flip)); 
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawAtOffsets(nullptr, 1, &offset, 1, &tint, 1, &flip));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawWithTransforms(nullptr, 1, &transform, 1, &tint, 1, &flip));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetAtOffsets(nullptr, 1, &offset, 1, &sourceRect, 1, &tint, 1, &flip));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetWithTransforms(nullptr, 1, &transform, 1, &sourceRect, 1, &tint, 1, &flip));
     }
 
 
@@ -725,6 +750,14 @@ public:
         Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->DrawFromSpriteSheetToRectWithTintAndFlip(bitmap, destRect, sourceRect, tint, flip)); 
         Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->DrawFromSpriteSheetWithTransformAndTintAndFlip(bitmap, transform, sourceRect, tint, flip)); 
         Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->DrawFromSpriteSheetAtOffsetWithTintAndTransform(bitmap, offset, sourceRect, tint, origin, rotation, scale, flip));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->DrawAtOffsets(bitmap, 1, &offset, 1, &tint, 1, &flip));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->DrawWithTransforms(bitmap, 1, &transform, 1, &tint, 1, &flip));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->DrawFromSpriteSheetAtOffsets(bitmap, 1, &offset, 1, &sourceRect, 1, &tint, 1, &flip));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->DrawFromSpriteSheetWithTransforms(bitmap, 1, &transform, 1, &sourceRect, 1, &tint, 1, &flip));
+
+        boolean isCullingEnabled{};
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->get_IsCullingEnabled(&isCullingEnabled));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->put_IsCullingEnabled(true));
 
         ComPtr<ICanvasDevice> device;
         Assert::AreEqual(RO_E_CLOSED, As<ICanvasResourceCreator>(f.SpriteBatch)->get_Device(&device));
@@ -1238,6 +1271,401 @@ public:
     }
 
 
+    //
+    // Array Draw methods
+    //
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_ArrayDrawMethods_FailWhenPassedNullArrays)
+    {
+        DrawFixture f;
+
+        auto bitmap = f.Bitmap.Get();
+        Vector2 offset{};
+        Matrix3x2 transform{};
+        Rect sourceRect{};
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawAtOffsets(bitmap, 1, nullptr, 0, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawAtOffsets(bitmap, 1, &offset, 1, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawAtOffsets(bitmap, 1, &offset, 0, nullptr, 1, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawWithTransforms(bitmap, 1, nullptr, 0, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawWithTransforms(bitmap, 1, &transform, 1, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetAtOffsets(bitmap, 1, nullptr, 1, &sourceRect, 0, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetAtOffsets(bitmap, 1, &offset, 1, nullptr, 0, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetWithTransforms(bitmap, 1, nullptr, 1, &sourceRect, 0, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetWithTransforms(bitmap, 1, &transform, 1, &sourceRect, 0, nullptr, 1, nullptr));
+
+        // Nothing was added, so closing doesn't draw anything
+        ThrowIfFailed(As<IClosable>(f.SpriteBatch)->Close());
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_ArrayDrawMethods_FailWhenArrayLengthsDoNotMatch_AndAddNoSprites)
+    {
+        DrawFixture f;
+
+        auto bitmap = f.Bitmap.Get();
+        Vector2 offsets[3]{};
+        Matrix3x2 transforms[3]{};
+        Vector4 tints[3]{};
+        CanvasSpriteFlip flips[3]{};
+        Rect sourceRects[3]{};
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawAtOffsets(bitmap, 3, offsets, 2, tints, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawAtOffsets(bitmap, 2, offsets, 0, nullptr, 3, flips));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawWithTransforms(bitmap, 3, transforms, 2, tints, 3, flips));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetAtOffsets(bitmap, 3, offsets, 0, sourceRects, 0, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetAtOffsets(bitmap, 3, offsets, 2, sourceRects, 0, nullptr, 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawFromSpriteSheetWithTransforms(bitmap, 2, transforms, 3, sourceRects, 0, nullptr, 0, nullptr));
+
+        // An invalid flip at the end of the array mustn't leave the earlier
+        // sprites behind.
+        flips[2] = static_cast<CanvasSpriteFlip>(100);
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->DrawAtOffsets(bitmap, 3, offsets, 0, nullptr, 3, flips));
+
+        ThrowIfFailed(As<IClosable>(f.SpriteBatch)->Close());
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_ArrayDrawMethods_WithNoSprites_DoNothing)
+    {
+        DrawFixture f;
+
+        auto bitmap = f.Bitmap.Get();
+
+        ThrowIfFailed(f.SpriteBatch->DrawAtOffsets(bitmap, 0, nullptr, 0, nullptr, 0, nullptr));
+        ThrowIfFailed(f.SpriteBatch->DrawWithTransforms(bitmap, 0, nullptr, 0, nullptr, 0, nullptr));
+        ThrowIfFailed(f.SpriteBatch->DrawFromSpriteSheetAtOffsets(bitmap, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr));
+        ThrowIfFailed(f.SpriteBatch->DrawFromSpriteSheetWithTransforms(bitmap, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr));
+
+        ThrowIfFailed(As<IClosable>(f.SpriteBatch)->Close());
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_DrawAtOffsets)
+    {
+        DrawFixture f;
+
+        std::vector<Vector2> offsets;
+        std::vector<Vector4> tints;
+        std::vector<CanvasSpriteFlip> flips;
+
+        uint32_t i = 0;
+        for (auto& t : GenerateFlipTestCases(f.FullBitmapSourceRect()))
+        {
+            auto offset = float2(static_cast<float>(i), static_cast<float>(i * 2));
+            auto tint = gTints[i % _countof(gTints)];
+
+            offsets.push_back(offset);
+            tints.push_back(tint);
+            flips.push_back(t.first);
+
+            f.ExpectSprite(
+                f.FullBitmapDestRect(offset),
+                t.second,
+                *ReinterpretAs<D2D1_COLOR_F*>(&tint));
+
+            ++i;
+        }
+
+        ThrowIfFailed(f.SpriteBatch->DrawAtOffsets(
+            f.Bitmap.Get(),
+            static_cast<uint32_t>(offsets.size()), offsets.data(),
+            static_cast<uint32_t>(tints.size()), tints.data(),
+            static_cast<uint32_t>(flips.size()), flips.data()));
+
+        f.Validate();
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_DrawWithTransforms_SingleTintAppliesToAllSprites)
+    {
+        DrawFixture f;
+
+        auto tint = gAnyTint;
+
+        for (auto matrix : gMatrices)
+        {
+            f.ExpectSprite(
+                f.FullBitmapDestRect(float2::zero()),
+                f.FullBitmapSourceRect(),
+                *ReinterpretAs<D2D1_COLOR_F*>(&tint),
+                *ReinterpretAs<D2D1_MATRIX_3X2_F*>(&matrix));
+        }
+
+        ThrowIfFailed(f.SpriteBatch->DrawWithTransforms(f.Bitmap.Get(), static_cast<uint32_t>(_countof(gMatrices)), gMatrices, 1, &tint, 0, nullptr));
+
+        f.Validate();
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_DrawFromSpriteSheetAtOffsets_SingleSourceRectAppliesToAllSprites)
+    {
+        DrawFixture f;
+
+        auto width = 30.0f;
+        auto height = 40.0f;
+        Rect sourceRect{ 10.0f, 20.0f, width, height };
+        D2D1_RECT_U expectedSourceRect{ 20, 40, static_cast<uint32_t>(20 + width * 2), static_cast<uint32_t>(40 + height * 2) };
+
+        for (auto offset : gOffsets)
+        {
+            f.ExpectSprite(
+                D2D1_RECT_F{ offset.x, offset.y, offset.x + width, offset.y + height },
+                expectedSourceRect);
+        }
+
+        ThrowIfFailed(f.SpriteBatch->DrawFromSpriteSheetAtOffsets(f.Bitmap.Get(), static_cast<uint32_t>(_countof(gOffsets)), ReinterpretAs<Vector2*>(gOffsets), 1, &sourceRect, 0, nullptr, 0, nullptr));
+
+        f.Validate();
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_DrawFromSpriteSheetWithTransforms)
+    {
+        DrawFixture f;
+
+        std::vector<Matrix3x2> transforms;
+        std::vector<Rect> sourceRects;
+        std::vector<CanvasSpriteFlip> flips;
+
+        uint32_t i = 0;
+        for (auto& t : GenerateFlipTestCases(D2D1_RECT_U{ 0, 0, 20, 40 }))
+        {
+            auto matrix = gMatrices[i % _countof(gMatrices)];
+            auto x = static_cast<float>(i * 10);
+            Rect sourceRect{ x, 0.0f, 10.0f, 20.0f };
+
+            transforms.push_back(matrix);
+            sourceRects.push_back(sourceRect);
+            flips.push_back(t.first);
+
+            // The expected source rect is offset by x in pixels, at 2x DPI
+            auto expectedSourceRect = t.second;
+            expectedSourceRect.left += static_cast<uint32_t>(x * 2);
+            expectedSourceRect.right += static_cast<uint32_t>(x * 2);
+
+            f.ExpectSprite(
+                D2D1_RECT_F{ 0.0f, 0.0f, 10.0f, 20.0f },
+                expectedSourceRect,
+                D2D1_COLOR_F{ 1.0f, 1.0f, 1.0f, 1.0f },
+                *ReinterpretAs<D2D1_MATRIX_3X2_F*>(&matrix));
+
+            ++i;
+        }
+
+        ThrowIfFailed(f.SpriteBatch->DrawFromSpriteSheetWithTransforms(
+            f.Bitmap.Get(),
+            static_cast<uint32_t>(transforms.size()), transforms.data(),
+            static_cast<uint32_t>(sourceRects.size()), sourceRects.data(),
+            0, nullptr,
+            static_cast<uint32_t>(flips.size()), flips.data()));
+
+        f.Validate();
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_ArrayDrawMethods_MatchSingleSpriteDrawMethods)
+    {
+        DrawFixture f;
+
+        Rect sourceRect{ 10.0f, 20.0f, 30.0f, 40.0f };
+        auto tint = gAnyTint;
+        auto flip = CanvasSpriteFlip::Both;
+
+        for (auto matrix : gMatrices)
+        {
+            ThrowIfFailed(f.SpriteBatch->DrawFromSpriteSheetWithTransformAndTintAndFlip(f.Bitmap.Get(), matrix, sourceRect, tint, flip));
+            ThrowIfFailed(f.SpriteBatch->DrawFromSpriteSheetWithTransforms(f.Bitmap.Get(), 1, &matrix, 1, &sourceRect, 1, &tint, 1, &flip));
+        }
+
+        for (Vector2 offset : gOffsets)
+        {
+            ThrowIfFailed(f.SpriteBatch->DrawFromSpriteSheetAtOffsetWithTint(f.Bitmap.Get(), offset, sourceRect, tint));
+            ThrowIfFailed(f.SpriteBatch->DrawFromSpriteSheetAtOffsets(f.Bitmap.Get(), 1, &offset, 1, &sourceRect, 1, &tint, 0, nullptr));
+        }
+
+        auto d2dSpriteBatch = f.ExpectCreateSpriteBatch();
+
+        d2dSpriteBatch->AddSpritesMethod.SetExpectedCalls(1,
+            [] (uint32_t count, const D2D1_RECT_F* dstRects, const D2D1_RECT_U* srcRects, const D2D1_COLOR_F* colors, const D2D1_MATRIX_3X2_F* transforms, uint32_t dstStride, uint32_t srcStride, uint32_t colorStride, uint32_t transformStride)
+            {
+                auto get = [] (auto base, uint32_t stride, uint32_t index)
+                {
+                    return *reinterpret_cast<decltype(base)>(reinterpret_cast<uint8_t const*>(base) + stride * index);
+                };
+
+                Assert::AreEqual(0U, count % 2);
+
+                for (uint32_t i = 0; i < count; i += 2)
+                {
+                    Assert::AreEqual(get(dstRects, dstStride, i), get(dstRects, dstStride, i + 1));
+                    Assert::AreEqual(get(srcRects, srcStride, i), get(srcRects, srcStride, i + 1));
+                    Assert::AreEqual(get(colors, colorStride, i), get(colors, colorStride, i + 1));
+                    Assert::AreEqual(get(transforms, transformStride, i), get(transforms, transformStride, i + 1));
+                }
+
+                return S_OK;
+            });
+
+        f.DeviceContext->DrawSpriteBatchMethod.SetExpectedCalls(1);
+
+        ThrowIfFailed(As<IClosable>(f.SpriteBatch)->Close());
+    }
+
+
+    //
+    // Culling
+    //
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_CullingProperties_FailWhenPassedNull)
+    {
+        DrawFixture f;
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->get_IsCullingEnabled(nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->get_CulledSpriteCount(nullptr));
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->get_SubmittedSpriteCount(nullptr));
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_WhenCullingIsDisabled_TheTargetIsNotExamined)
+    {
+        DrawFixture f;
+
+        boolean isCullingEnabled = true;
+        ThrowIfFailed(f.SpriteBatch->get_IsCullingEnabled(&isCullingEnabled));
+        Assert::IsFalse(!!isCullingEnabled);
+
+        for (auto offset : gOffsets)
+        {
+            ThrowIfFailed(f.SpriteBatch->DrawAtOffset(f.Bitmap.Get(), offset));
+            f.ExpectSprite(f.FullBitmapDestRect(offset), f.FullBitmapSourceRect());
+        }
+
+        // GetTarget isn't expected to be called
+        f.Validate();
+
+        int32_t culledCount = -1;
+        int32_t submittedCount = -1;
+        ThrowIfFailed(f.SpriteBatch->get_CulledSpriteCount(&culledCount));
+        ThrowIfFailed(f.SpriteBatch->get_SubmittedSpriteCount(&submittedCount));
+
+        Assert::AreEqual(0, culledCount);
+        Assert::AreEqual(static_cast<int32_t>(_countof(gOffsets)), submittedCount);
+    }
+
+
+    struct CullingFixture : public DrawFixture
+    {
+        // The target is 200x200 pixels, at 2x DPI, scrolled 50 DIPs to the left
+        CullingFixture(ComPtr<ID2D1Image> target = MakeTarget())
+        {
+            DeviceContext->GetTargetMethod.AllowAnyCall(
+                [=] (ID2D1Image** value)
+                {
+                    ThrowIfFailed(target.CopyTo(value));
+                });
+
+            DeviceContext->GetTransformMethod.AllowAnyCall(
+                [] (D2D1_MATRIX_3X2_F* value)
+                {
+                    *value = D2D1::Matrix3x2F::Translation(-50, 0);
+                });
+
+            DeviceContext->GetDpiMethod.AllowAnyCall(
+                [] (float* dpiX, float* dpiY)
+                {
+                    *dpiX = DEFAULT_DPI * 2;
+                    *dpiY = DEFAULT_DPI * 2;
+                });
+
+            ThrowIfFailed(SpriteBatch->put_IsCullingEnabled(true));
+        }
+
+        static ComPtr<ID2D1Image> MakeTarget()
+        {
+            auto target = Make<StubD2DBitmap>();
+            target->GetPixelSizeMethod.AllowAnyCall([] { return D2D1_SIZE_U{ 200, 200 }; });
+            return target;
+        }
+
+        void DrawAtOffsets(std::initializer_list<float2> offsets, std::initializer_list<float2> expectedOffsets)
+        {
+            for (auto offset : offsets)
+                ThrowIfFailed(SpriteBatch->DrawAtOffset(Bitmap.Get(), offset));
+
+            for (auto offset : expectedOffsets)
+                ExpectSprite(FullBitmapDestRect(offset), FullBitmapSourceRect());
+        }
+
+        void AssertCounts(int32_t expectedCulled, int32_t expectedSubmitted)
+        {
+            int32_t culledCount = -1;
+            int32_t submittedCount = -1;
+            ThrowIfFailed(SpriteBatch->get_CulledSpriteCount(&culledCount));
+            ThrowIfFailed(SpriteBatch->get_SubmittedSpriteCount(&submittedCount));
+
+            Assert::AreEqual(expectedCulled, culledCount);
+            Assert::AreEqual(expectedSubmitted, submittedCount);
+        }
+    };
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_WhenCullingIsEnabled_SpritesOutsideTheTargetAreNotSubmitted)
+    {
+        CullingFixture f;
+
+        boolean isCullingEnabled = false;
+        ThrowIfFailed(f.SpriteBatch->get_IsCullingEnabled(&isCullingEnabled));
+        Assert::IsTrue(!!isCullingEnabled);
+
+        f.DrawAtOffsets(
+            {
+                float2(0, 0),       // -100..100 pixels: visible
+                float2(150, 0),     // 200..400 pixels: off the right
+                float2(120, 0),     // 140..340 pixels: partly visible
+                float2(-50, 0),     // -200..0 pixels: off the left
+                float2(0, 100),     // 200..400 pixels: off the bottom
+            },
+            {
+                float2(0, 0),
+                float2(120, 0),
+            });
+
+        f.Validate();
+
+        f.AssertCounts(3, 2);
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_WhenCullingIsEnabled_AndAllSpritesAreOutsideTheTarget_NothingIsDrawn)
+    {
+        CullingFixture f;
+
+        f.DrawAtOffsets({ float2(150, 0), float2(0, -200) }, {});
+
+        // No D2D sprite batch is expected to be created
+        ThrowIfFailed(As<IClosable>(f.SpriteBatch)->Close());
+
+        f.AssertCounts(2, 0);
+    }
+
+
+    TEST_METHOD_EX(CanvasSpriteBatch_WhenCullingIsEnabled_AndTargetIsACommandList_NothingIsCulled)
+    {
+        CullingFixture f(Make<MockD2DCommandList>());
+
+        f.DrawAtOffsets(
+            { float2(0, 0), float2(1000, 1000) },
+            { float2(0, 0), float2(1000, 1000) });
+
+        f.Validate();
+
+        f.AssertCounts(0, 2);
+    }
+
+
     TEST_METHOD_EX(CanvasSpriteBatch_UnitModeIsSetCorrectlyWhenDrawSpriteBatchIsCalled_AndThenRestored)
     {
         DrawFixture f;
@@ -1299,32 +1727,262 @@ public:
 
 
     //
-    // Multiple bitmaps and sorting
+    // Sprite buffer pooling
     //
 
-    // ExpectedSprite where we only care about a single value that's encoded
-    // into the dest rect.  This is because these tests are about how
-    // batching/sorting works.  Earlier tests have validated that the correct
-    // values are passed in for sprites.
-    struct ExpectedOffsetSprite
+    struct PoolingFixture : public Fixture
     {
-        float Value;
-
-        explicit ExpectedOffsetSprite(float value)
-            : Value(value)
-        {}
+        ComPtr<ICanvasDeviceInternal> Device;
 
-        void Validate(D2D1_RECT_F dest, D2D1_RECT_U source, D2D1_COLOR_F color, D2D1_MATRIX_3X2_F transform)
+        PoolingFixture()
         {
-            Assert::AreEqual(Value, dest.left);
-            Assert::AreEqual(Value, dest.top);
-        }
-    };
+            auto d2dDevice = MakeD2DDeviceThatReportsVendorIdAndFeatureLevel(0, D3D_FEATURE_LEVEL_11_1);
 
-    struct MultipleBitmapFixture
-    {
-        ComPtr<MockD2DDeviceContext> DeviceContext;
-        ComPtr<MockD2DSpriteBatch> D2DSpriteBatch;
+            DeviceContext->GetDeviceMethod.AllowAnyCall(
+                [=] (ID2D1Device** d)
+                {
+                    return d2dDevice.CopyTo(d);
+                });
+
+            // Apps hold on to their device, and so its pool, between frames
+            Device = ResourceManager::GetOrCreate<ICanvasDeviceInternal>(d2dDevice.Get());
+
+            DeviceContext->CreateSpriteBatchMethod.AllowAnyCall(
+                [] (ID2D1SpriteBatch** value)
+                {
+                    auto spriteBatch = Make<MockD2DSpriteBatch>();
+                    spriteBatch->AddSpritesMethod.AllowAnyCall();
+                    return spriteBatch.CopyTo(value);
+                });
+
+            DeviceContext->DrawSpriteBatchMethod.AllowAnyCall();
+        }
+
+        void DrawFrame(uint32_t batchCount, uint32_t spritesPerBatch)
+        {
+            for (uint32_t i = 0; i < batchCount; ++i)
+            {
+                ComPtr<ICanvasSpriteBatch> spriteBatch;
+                ThrowIfFailed(DrawingSession->CreateSpriteBatch(&spriteBatch));
+
+                for (uint32_t j = 0; j < spritesPerBatch; ++j)
+                    ThrowIfFailed(spriteBatch->DrawAtOffset(Bitmap.Get(), Vector2{ static_cast<float>(j), 0 }));
+
+                ThrowIfFailed(As<IClosable>(spriteBatch)->Close());
+            }
+        }
+
+        SpriteBufferPool& Pool()
+        {
+            return Device->GetSpriteBufferPool();
+        }
+    };
+
+    TEST_METHOD_EX(CanvasSpriteBatch_SteadyStateFrames_DoNotAllocateSpriteBuffers)
+    {
+        PoolingFixture f;
+
+        f.DrawFrame(3, 100);
+
+        auto allocationCount = SpriteBufferPool::GetAllocationCount();
+
+        for (int frame = 0; frame < 10; ++frame)
+            f.DrawFrame(3, 100);
+
+        Assert::AreEqual(allocationCount, SpriteBufferPool::GetAllocationCount());
+        Assert::AreEqual<uint64_t>(33, f.Pool().GetLeaseCount());
+        Assert::AreEqual<uint64_t>(32, f.Pool().GetReuseCount());
+        Assert::AreEqual<size_t>(100, f.Pool().GetHighWaterMark());
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_SteadyStateFrames_DoNotAllocateSpriteBuffers_WhenMostSpritesAreCulled)
+    {
+        PoolingFixture f;
+
+        auto target = Make<StubD2DBitmap>();
+        target->GetPixelSizeMethod.AllowAnyCall([] { return D2D1_SIZE_U{ 200, 200 }; });
+
+        f.DeviceContext->GetTargetMethod.AllowAnyCall(
+            [=] (ID2D1Image** value)
+            {
+                ThrowIfFailed(target.CopyTo(value));
+            });
+
+        f.DeviceContext->GetTransformMethod.AllowAnyCall(
+            [] (D2D1_MATRIX_3X2_F* value)
+            {
+                *value = D2D1::Matrix3x2F::Identity();
+            });
+
+        f.DeviceContext->GetDpiMethod.AllowAnyCall(
+            [] (float* dpiX, float* dpiY)
+            {
+                *dpiX = DEFAULT_DPI;
+                *dpiY = DEFAULT_DPI;
+            });
+
+        // Four out of every five sprites are far off the right of the target
+        auto drawFrame = [&]
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                ComPtr<ICanvasSpriteBatch> spriteBatch;
+                ThrowIfFailed(f.DrawingSession->CreateSpriteBatch(&spriteBatch));
+                ThrowIfFailed(spriteBatch->put_IsCullingEnabled(true));
+
+                for (int j = 0; j < 100; ++j)
+                {
+                    auto x = (j % 5 == 0) ? 0.0f : 10000.0f;
+                    ThrowIfFailed(spriteBatch->DrawAtOffset(f.Bitmap.Get(), Vector2{ x, 0 }));
+                }
+
+                ThrowIfFailed(As<IClosable>(spriteBatch)->Close());
+            }
+        };
+
+        drawFrame();
+
+        auto allocationCount = SpriteBufferPool::GetAllocationCount();
+
+        for (int frame = 0; frame < 10; ++frame)
+            drawFrame();
+
+        Assert::AreEqual(allocationCount, SpriteBufferPool::GetAllocationCount());
+        Assert::AreEqual<uint64_t>(32, f.Pool().GetReuseCount());
+        Assert::AreEqual<size_t>(100, f.Pool().GetHighWaterMark());
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_SteadyStateFrames_DoNotAllocate_WhenSorting)
+    {
+        for (auto sortMode : { CanvasSpriteSortMode::Bitmap, CanvasSpriteSortMode::Layer })
+        {
+            PoolingFixture f;
+
+            std::vector<ComPtr<CanvasBitmap>> bitmaps;
+
+            for (int i = 0; i < 5; ++i)
+            {
+                auto d2dBitmap = Make<StubD2DBitmap>();
+                d2dBitmap->GetSizeMethod.AllowAnyCall([] { return D2D1_SIZE_F{ 100, 100 }; });
+                d2dBitmap->GetPixelSizeMethod.AllowAnyCall([] { return D2D1_SIZE_U{ 100, 100 }; });
+
+                bitmaps.push_back(Make<CanvasBitmap>(Make<MockCanvasDevice>().Get(), d2dBitmap.Get()));
+            }
+
+            // Interleave the bitmaps and layers so that the sort has to
+            // move every sprite
+            auto drawFrame = [&]
+            {
+                for (int i = 0; i < 3; ++i)
+                {
+                    ComPtr<ICanvasSpriteBatch> spriteBatch;
+                    ThrowIfFailed(f.DrawingSession->CreateSpriteBatchWithSortMode(sortMode, &spriteBatch));
+
+                    for (int j = 0; j < 100; ++j)
+                    {
+                        ThrowIfFailed(spriteBatch->put_Layer(j % 3));
+                        ThrowIfFailed(spriteBatch->DrawAtOffset(bitmaps[j % bitmaps.size()].Get(), Vector2{ static_cast<float>(j), 0 }));
+                    }
+
+                    ThrowIfFailed(As<IClosable>(spriteBatch)->Close());
+                }
+            };
+
+            drawFrame();
+
+            auto allocationCount = SpriteBufferPool::GetAllocationCount();
+
+            for (int frame = 0; frame < 10; ++frame)
+                drawFrame();
+
+            Assert::AreEqual(allocationCount, SpriteBufferPool::GetAllocationCount());
+            Assert::AreEqual<uint64_t>(32, f.Pool().GetReuseCount());
+        }
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_BatchesAreReservedUpToTheHighWaterMark)
+    {
+        PoolingFixture f;
+
+        f.DrawFrame(1, 200);
+
+        // Trimming frees the pooled buffer, but the pool still knows how big
+        // a batch is likely to be
+        f.Pool().Trim();
+        Assert::AreEqual<size_t>(0, f.Pool().GetFreeBufferCount());
+
+        auto allocationCount = SpriteBufferPool::GetAllocationCount();
+
+        f.DrawFrame(1, 150);
+
+        // One allocation for the new buffer, and no growing
+        Assert::AreEqual(allocationCount + 1, SpriteBufferPool::GetAllocationCount());
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_ManySmallArrays_GrowTheBufferGeometrically)
+    {
+        PoolingFixture f;
+
+        ComPtr<ICanvasSpriteBatch> spriteBatch;
+        ThrowIfFailed(f.DrawingSession->CreateSpriteBatch(&spriteBatch));
+
+        auto allocationCount = SpriteBufferPool::GetAllocationCount();
+
+        Vector2 offsets[2]{};
+
+        for (int i = 0; i < 1000; ++i)
+            ThrowIfFailed(spriteBatch->DrawAtOffsets(f.Bitmap.Get(), 2, offsets, 0, nullptr, 0, nullptr));
+
+        // Reserving exactly enough for each array would reallocate 1000 times
+        Assert::IsTrue(SpriteBufferPool::GetAllocationCount() - allocationCount < 20);
+
+        ThrowIfFailed(As<IClosable>(spriteBatch)->Close());
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_BufferIsReturnedToPool_WhenCloseFails)
+    {
+        PoolingFixture f;
+
+        ComPtr<ICanvasSpriteBatch> spriteBatch;
+        ThrowIfFailed(f.DrawingSession->CreateSpriteBatch(&spriteBatch));
+        ThrowIfFailed(spriteBatch->DrawAtOffset(f.Bitmap.Get(), float2::zero()));
+
+        f.DeviceContext->CreateSpriteBatchMethod.SetExpectedCalls(1, [] (auto) { return E_UNEXPECTED; });
+
+        Assert::AreEqual(E_UNEXPECTED, As<IClosable>(spriteBatch)->Close());
+        Assert::AreEqual<size_t>(1, f.Pool().GetFreeBufferCount());
+    }
+
+
+    //
+    // Multiple bitmaps and sorting
+    //
+
+    // ExpectedSprite where we only care about a single value that's encoded
+    // into the dest rect.  This is because these tests are about how
+    // batching/sorting works.  Earlier tests have validated that the correct
+    // values are passed in for sprites.
+    struct ExpectedOffsetSprite
+    {
+        float Value;
+
+        explicit ExpectedOffsetSprite(float value)
+            : Value(value)
+        {}
+
+        void Validate(D2D1_RECT_F dest, D2D1_RECT_U source, D2D1_COLOR_F color, D2D1_MATRIX_3X2_F transform)
+        {
+            Assert::AreEqual(Value, dest.left);
+            Assert::AreEqual(Value, dest.top);
+        }
+    };
+
+    struct MultipleBitmapFixture
+    {
+        ComPtr<MockD2DDeviceContext> DeviceContext;
+        ComPtr<MockD2DDevice> D2DDevice;
+        ComPtr<MockCanvasDevice> Device;
+        ComPtr<MockD2DSpriteBatch> D2DSpriteBatch;
         ComPtr<ICanvasSpriteBatch> SpriteBatch;
 
         std::array<std::pair<ComPtr<StubD2DBitmap>, ComPtr<CanvasBitmap>>, 4> Bitmaps;
@@ -1336,8 +1994,9 @@ public:
             uint32_t vendorId = 0,
             D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_1)
             : DeviceContext(Make<MockD2DDeviceContext>())
+            , Device(Make<MockCanvasDevice>())
         {
-            SetReportedVendorIdAndFeatureLevel(DeviceContext.Get(), vendorId, featureLevel);
+            D2DDevice = SetReportedVendorIdAndFeatureLevel(DeviceContext.Get(), vendorId, featureLevel);
             
             DeviceContext->GetUnitModeMethod.AllowAnyCall([] { return D2D1_UNIT_MODE_DIPS; });
             DeviceContext->GetAntialiasModeMethod.AllowAnyCall([] { return D2D1_ANTIALIAS_MODE_ALIASED; });
@@ -1354,14 +2013,13 @@ public:
             auto drawingSession = Make<CanvasDrawingSession>(DeviceContext.Get());
             ThrowIfFailed(drawingSession->CreateSpriteBatchWithSortMode(sortMode, &SpriteBatch));
 
-            auto device = Make<MockCanvasDevice>();
             for (auto& bitmap : Bitmaps)
             {
                 auto d2dBitmap = Make<StubD2DBitmap>();
                 d2dBitmap->GetSizeMethod.AllowAnyCall([] { return D2D1_SIZE_F{ 100, 100 }; });
                 d2dBitmap->GetPixelSizeMethod.AllowAnyCall([] { return D2D1_SIZE_U{ 100, 100 }; });
                 
-                bitmap = std::make_pair(d2dBitmap, Make<CanvasBitmap>(device.Get(), d2dBitmap.Get()));
+                bitmap = std::make_pair(d2dBitmap, Make<CanvasBitmap>(Device.Get(), d2dBitmap.Get()));
             }
         }
 
@@ -1522,6 +2180,207 @@ public:
         f.Validate();
     }
 
+    TEST_METHOD_EX(CanvasSpriteBatch_Layer_DefaultsToZero_AndCanBeSet)
+    {
+        DrawFixture f;
+
+        int32_t layer = -1;
+        ThrowIfFailed(f.SpriteBatch->get_Layer(&layer));
+        Assert::AreEqual(0, layer);
+
+        ThrowIfFailed(f.SpriteBatch->put_Layer(-5));
+        ThrowIfFailed(f.SpriteBatch->get_Layer(&layer));
+        Assert::AreEqual(-5, layer);
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->get_Layer(nullptr));
+
+        ThrowIfFailed(As<IClosable>(f.SpriteBatch)->Close());
+
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->get_Layer(&layer));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->put_Layer(1));
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_WhenSortedByLayer_LayersAreDrawnInOrder_AndSortedByBitmapWithinEachLayer)
+    {
+        MultipleBitmapFixture f(CanvasSpriteSortMode::Layer);
+
+        std::sort(f.Bitmaps.begin(), f.Bitmaps.end());
+
+        auto setLayer = [&] (int32_t layer) { ThrowIfFailed(f.SpriteBatch->put_Layer(layer)); };
+
+        setLayer(1);
+        f.Add(f.Bitmaps[1], 0);
+        f.Add(f.Bitmaps[0], 1);
+        setLayer(-3);
+        f.Add(f.Bitmaps[2], 2);
+        f.Add(f.Bitmaps[0], 3);
+        setLayer(1);
+        f.Add(f.Bitmaps[1], 4);
+        f.Add(f.Bitmaps[0], 5);
+        setLayer(0);
+        f.Add(f.Bitmaps[3], 6);
+        setLayer(-3);
+        f.Add(f.Bitmaps[0], 7);
+
+        // Layer -3
+        f.Expect(3); // 0: bitmap 0
+        f.Expect(7); // 1: bitmap 0
+        f.Expect(2); // 2: bitmap 2
+
+        // Layer 0
+        f.Expect(6); // 3: bitmap 3
+
+        // Layer 1
+        f.Expect(1); // 4: bitmap 0
+        f.Expect(5); // 5: bitmap 0
+        f.Expect(0); // 6: bitmap 1
+        f.Expect(4); // 7: bitmap 1
+
+        f.ExpectBatches(
+        {
+            { f.Bitmaps[0], 0, 2 },
+            { f.Bitmaps[2], 2, 1 },
+            { f.Bitmaps[3], 3, 1 },
+            { f.Bitmaps[0], 4, 2 },
+            { f.Bitmaps[1], 6, 2 }
+        });
+
+        f.Validate();
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_WhenNotSortedByLayer_LayerIsIgnored)
+    {
+        MultipleBitmapFixture f(CanvasSpriteSortMode::None);
+
+        ThrowIfFailed(f.SpriteBatch->put_Layer(2));
+        f.AddAndExpect(f.Bitmaps[0], 0);
+        ThrowIfFailed(f.SpriteBatch->put_Layer(1));
+        f.AddAndExpect(f.Bitmaps[0], 1);
+
+        f.ExpectBatches(
+        {
+            { f.Bitmaps[0], 0, 2 }
+        });
+
+        f.Validate();
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_WhenAtlasIsSet_SpritesUsingBitmapsInTheAtlasAreDrawnFromTheAtlas)
+    {
+        MultipleBitmapFixture f;
+
+        auto atlasD2DBitmap = Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_TARGET);
+        atlasD2DBitmap->CopyFromBitmapMethod.SetExpectedCalls(2);
+
+        auto device = f.Device;
+        device->MockGetD2DDevice = [&] { return f.D2DDevice; };
+        device->CreateRenderTargetBitmapMethod.SetExpectedCalls(1,
+            [=] (float, float, float, DirectXPixelFormat, CanvasAlphaMode)
+            {
+                return atlasD2DBitmap;
+            });
+
+        // New atlas bitmaps are cleared using the resource creation context
+        auto resourceContext = Make<MockD2DDeviceContext>();
+        resourceContext->SetTargetMethod.AllowAnyCall();
+        resourceContext->BeginDrawMethod.AllowAnyCall();
+        resourceContext->ClearMethod.AllowAnyCall();
+        resourceContext->EndDrawMethod.AllowAnyCall();
+
+        device->GetResourceCreationDeviceContextMethod.AllowAnyCall(
+            [=]
+            {
+                return DeviceContextLease(As<ID2D1DeviceContext1>(resourceContext));
+            });
+
+        for (auto& bitmap : f.Bitmaps)
+        {
+            bitmap.first->GetPixelFormatMethod.AllowAnyCall(
+                [] { return D2D1_PIXEL_FORMAT{ DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED }; });
+        }
+
+        // The 100x100 bitmaps are placed side by side, each with a pixel of
+        // padding around them.
+        auto atlas = Make<CanvasSpriteAtlas>(device.Get(), 256, 256);
+
+        boolean added;
+        ThrowIfFailed(atlas->TryAdd(f.Bitmaps[0].second.Get(), &added));
+        Assert::IsTrue(!!added);
+        ThrowIfFailed(atlas->TryAdd(f.Bitmaps[1].second.Get(), &added));
+        Assert::IsTrue(!!added);
+
+        ThrowIfFailed(f.SpriteBatch->put_Atlas(atlas.Get()));
+
+        f.Add(f.Bitmaps[0], 0);
+        f.Add(f.Bitmaps[1], 1);
+        f.Add(f.Bitmaps[2], 2);
+        f.Add(f.Bitmaps[0], 3);
+
+        std::vector<D2D1_RECT_U> expectedSourceRects
+        {
+            D2D1_RECT_U{   1, 1, 101, 101 },
+            D2D1_RECT_U{ 103, 1, 203, 101 },
+            D2D1_RECT_U{   0, 0, 100, 100 },
+            D2D1_RECT_U{   1, 1, 101, 101 },
+        };
+
+        f.D2DSpriteBatch->AddSpritesMethod.SetExpectedCalls(1,
+            [=] (uint32_t count, D2D1_RECT_F const*, D2D1_RECT_U const* sourceRects, D2D1_COLOR_F const*, D2D1_MATRIX_3X2_F const*, uint32_t, uint32_t sourceStride, uint32_t, uint32_t)
+            {
+                Assert::AreEqual(static_cast<uint32_t>(expectedSourceRects.size()), count);
+
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    auto sourceRect = *reinterpret_cast<D2D1_RECT_U const*>(reinterpret_cast<uint8_t const*>(sourceRects) + sourceStride * i);
+                    Assert::AreEqual(expectedSourceRects[i], sourceRect);
+                }
+
+                return S_OK;
+            });
+
+        std::pair<ComPtr<StubD2DBitmap>, ComPtr<CanvasBitmap>> atlasBitmap(atlasD2DBitmap, nullptr);
+
+        f.ExpectBatches(
+        {
+            { atlasBitmap,  0, 2 },
+            { f.Bitmaps[2], 2, 1 },
+            { atlasBitmap,  3, 1 }
+        });
+
+        f.Validate();
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_put_Atlas_FailsWhenAtlasUsesDifferentDevice)
+    {
+        MultipleBitmapFixture f;
+
+        auto otherD2DDevice = Make<MockD2DDevice>();
+
+        auto device = Make<MockCanvasDevice>();
+        device->MockGetD2DDevice = [=] { return otherD2DDevice; };
+
+        auto atlas = Make<CanvasSpriteAtlas>(device.Get(), 256, 256);
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->put_Atlas(atlas.Get()));
+        ValidateStoredErrorState(E_INVALIDARG, Strings::SpriteBatchAtlasWrongDevice);
+
+        ComPtr<ICanvasSpriteAtlas> retrievedAtlas;
+        ThrowIfFailed(f.SpriteBatch->get_Atlas(&retrievedAtlas));
+        Assert::IsNull(retrievedAtlas.Get());
+
+        // Clearing the atlas is always allowed.
+        Assert::AreEqual(S_OK, f.SpriteBatch->put_Atlas(nullptr));
+
+        f.AddAndExpect(f.Bitmaps[0], 0);
+
+        f.ExpectBatches(
+        {
+            { f.Bitmaps[0], 0, 1 }
+        });
+
+        f.Validate();
+    }
+
     TEST_METHOD_EX(CanvasSpriteBatch_When_AntialiasingIsEnabled_ItMustBeDisabledAroundCallsToDrawSpriteBatch)
     {
         MultipleBitmapFixture f;
@@ -1612,6 +2471,641 @@ public:
             f.Validate();
         }
     }
+
+
+    //
+    // Statistics
+    //
+
+
+    static CanvasSpriteBatchStatistics GetStatistics(MultipleBitmapFixture const& f)
+    {
+        CanvasSpriteBatchStatistics statistics;
+        ThrowIfFailed(f.SpriteBatch->get_Statistics(&statistics));
+        return statistics;
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_Statistics_FailsWhenPassedNull)
+    {
+        MultipleBitmapFixture f;
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->get_Statistics(nullptr));
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_Statistics_AreZeroUntilClosed)
+    {
+        MultipleBitmapFixture f;
+
+        f.AddAndExpect(f.Bitmaps[0], 0);
+
+        auto statistics = GetStatistics(f);
+        Assert::AreEqual(0, statistics.DrawCallCount);
+        Assert::AreEqual(0, statistics.QuirkDrawCallCount);
+        Assert::AreEqual(0, statistics.FlushCount);
+        Assert::AreEqual(0LL, statistics.SortTime.Duration);
+        Assert::AreEqual(0LL, statistics.AddSpritesTime.Duration);
+        Assert::AreEqual(0LL, statistics.DrawTime.Duration);
+
+        f.ExpectBatches({ { f.Bitmaps[0], 0, 1 } });
+        f.Validate();
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_Statistics_MatchTheCallsMadeToTheDeviceContext)
+    {
+        MultipleBitmapFixture f;
+
+        f.AddAndExpect(f.Bitmaps[0], 0);
+        f.AddAndExpect(f.Bitmaps[1], 1);
+        f.AddAndExpect(f.Bitmaps[1], 2);
+        f.AddAndExpect(f.Bitmaps[0], 3);
+
+        f.ExpectBatches(
+        {
+            { f.Bitmaps[0], 0, 1 },
+            { f.Bitmaps[1], 1, 2 },
+            { f.Bitmaps[0], 3, 1 }
+        });
+
+        f.Validate();
+
+        // Closing again doesn't change anything
+        f.Validate();
+
+        auto statistics = GetStatistics(f);
+        Assert::AreEqual(f.DeviceContext->DrawSpriteBatchMethod.GetCurrentCallCount(), statistics.DrawCallCount);
+        Assert::AreEqual(3, statistics.DrawCallCount);
+        Assert::AreEqual(0, statistics.QuirkDrawCallCount);
+        Assert::AreEqual(0, statistics.FlushCount);
+        Assert::IsTrue(statistics.SortTime.Duration >= 0);
+        Assert::IsTrue(statistics.AddSpritesTime.Duration >= 0);
+        Assert::IsTrue(statistics.DrawTime.Duration >= 0);
+    }
+
+    TEST_METHOD_EX(CanvasSpriteBatch_WhenQuirkRequired_Statistics_CountTheExtraDrawCallsAndFlushes)
+    {
+        MultipleBitmapFixture f(CanvasSpriteSortMode::None, QUALCOMM_VENDOR_ID, D3D_FEATURE_LEVEL_9_3);
+
+        for (int i = 0; i < 600; ++i)
+            f.AddAndExpect(f.Bitmaps[0], (float)i);
+
+        for (int i = 600; i < 900; ++i)
+            f.AddAndExpect(f.Bitmaps[1], (float)i);
+
+        f.DeviceContext->FlushMethod.SetExpectedCalls(5);
+
+        f.ExpectBatches(
+        {
+            { f.Bitmaps[0], 0, 256 },
+            { f.Bitmaps[0], 256, 256 },
+            { f.Bitmaps[0], 512, 88 },
+            { f.Bitmaps[1], 600, 256 },
+            { f.Bitmaps[1], 856, 44 }
+        });
+
+        f.Validate();
+
+        auto statistics = GetStatistics(f);
+        Assert::AreEqual(f.DeviceContext->DrawSpriteBatchMethod.GetCurrentCallCount(), statistics.DrawCallCount);
+        Assert::AreEqual(f.DeviceContext->FlushMethod.GetCurrentCallCount(), statistics.FlushCount);
+        Assert::AreEqual(5, statistics.DrawCallCount);
+        Assert::AreEqual(3, statistics.QuirkDrawCallCount);
+        Assert::AreEqual(5, statistics.FlushCount);
+    }
+};
+
+
+TEST_CLASS(CanvasRetainedSpriteBatchUnitTests)
+{
+public:
+
+    //
+    // CanvasRetainedSpriteBatch creation
+    //
+
+    static ComPtr<ICanvasRetainedSpriteBatchFactory> GetFactory()
+    {
+        ComPtr<ICanvasRetainedSpriteBatchFactory> factory;
+        ThrowIfFailed(MakeAndInitialize<CanvasRetainedSpriteBatchFactory>(&factory));
+        return factory;
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_Create_FailsWhenPassedNullParameters)
+    {
+        auto factory = GetFactory();
+        auto device = Make<CanvasDevice>(Make<MockD2DDevice>().Get());
+
+        ComPtr<ICanvasRetainedSpriteBatch> spriteBatch;
+
+        Assert::AreEqual(E_INVALIDARG, factory->Create(nullptr, &spriteBatch));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(device.Get(), nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithInterpolationAndOptions(nullptr, CanvasImageInterpolation::Linear, CanvasSpriteOptions::None, &spriteBatch));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithInterpolationAndOptions(device.Get(), CanvasImageInterpolation::Linear, CanvasSpriteOptions::None, nullptr));
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_Create_Succeeds_WhenSpriteBatchSupported)
+    {
+        auto factory = GetFactory();
+        auto device = Make<CanvasDevice>(Make<MockD2DDevice>().Get());
+
+        ComPtr<ICanvasRetainedSpriteBatch> spriteBatch;
+        ThrowIfFailed(factory->Create(device.Get(), &spriteBatch));
+
+        ComPtr<ICanvasDevice> retrievedDevice;
+        ThrowIfFailed(As<ICanvasResourceCreator>(spriteBatch)->get_Device(&retrievedDevice));
+        Assert::IsTrue(IsSameInstance(device.Get(), retrievedDevice.Get()));
+
+        uint32_t count = 1;
+        ThrowIfFailed(spriteBatch->get_Count(&count));
+        Assert::AreEqual(0u, count);
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_Create_Fails_WhenSpriteBatchNotSupported)
+    {
+        auto factory = GetFactory();
+        auto device = MakeCanvasDeviceThatDoesNotSupportSpriteBatch();
+
+        ComPtr<ICanvasRetainedSpriteBatch> spriteBatch;
+        Assert::AreEqual(E_NOTIMPL, factory->Create(device.Get(), &spriteBatch));
+        ValidateStoredErrorState(E_NOTIMPL, Strings::SpriteBatchNotAvailable);
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_Create_FailsWhenPassedInvalidInterpolationOrOptions)
+    {
+        auto factory = GetFactory();
+        auto device = Make<CanvasDevice>(Make<MockD2DDevice>().Get());
+
+        ComPtr<ICanvasRetainedSpriteBatch> spriteBatch;
+
+        for (auto interpolation : gInvalidInterpolations)
+        {
+            Assert::AreEqual(E_INVALIDARG, factory->CreateWithInterpolationAndOptions(device.Get(), interpolation, CanvasSpriteOptions::None, &spriteBatch));
+            ValidateStoredErrorState(E_INVALIDARG, Strings::SpriteBatchInvalidInterpolation);
+        }
+
+        auto invalidOptions = static_cast<CanvasSpriteOptions>(static_cast<int>(CanvasSpriteOptions::ClampToSourceRect) + 1);
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithInterpolationAndOptions(device.Get(), CanvasImageInterpolation::Linear, invalidOptions, &spriteBatch));
+    }
+
+    //
+    // Drawing
+    //
+
+    // Sprites are identified by a value encoded into the x translation of
+    // their transform.
+    static Matrix3x2 IdTransform(float id)
+    {
+        return Matrix3x2{ 1, 0, 0, 1, id, 0 };
+    }
+
+    struct Fixture
+    {
+        ComPtr<MockD2DDevice> D2DDevice;
+        ComPtr<CanvasDevice> Device;
+        ComPtr<MockD2DDeviceContext> DeviceContext;
+        ComPtr<CanvasDrawingSession> DrawingSession;
+        ComPtr<MockD2DSpriteBatch> D2DSpriteBatch;
+        ComPtr<CanvasRetainedSpriteBatch> SpriteBatch;
+
+        std::array<std::pair<ComPtr<StubD2DBitmap>, ComPtr<CanvasBitmap>>, 2> Bitmaps;
+
+        Fixture()
+            : D2DDevice(MakeD2DDeviceThatReportsVendorIdAndFeatureLevel(0, D3D_FEATURE_LEVEL_11_1))
+            , Device(Make<CanvasDevice>(D2DDevice.Get()))
+            , DeviceContext(Make<MockD2DDeviceContext>())
+            , DrawingSession(Make<CanvasDrawingSession>(DeviceContext.Get()))
+            , D2DSpriteBatch(Make<MockD2DSpriteBatch>())
+            , SpriteBatch(Make<CanvasRetainedSpriteBatch>(Device.Get(), D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, D2D1_SPRITE_OPTIONS_NONE))
+        {
+            DeviceContext->GetDeviceMethod.AllowAnyCall(
+                [=] (ID2D1Device** d)
+                {
+                    return D2DDevice.CopyTo(d);
+                });
+
+            DeviceContext->GetUnitModeMethod.AllowAnyCall([] { return D2D1_UNIT_MODE_DIPS; });
+            DeviceContext->GetAntialiasModeMethod.AllowAnyCall([] { return D2D1_ANTIALIAS_MODE_ALIASED; });
+            DeviceContext->DrawSpriteBatchMethod.AllowAnyCall();
+
+            DeviceContext->CreateSpriteBatchMethod.SetExpectedCalls(1,
+                [=] (ID2D1SpriteBatch** value)
+                {
+                    return D2DSpriteBatch.CopyTo(value);
+                });
+
+            for (auto& bitmap : Bitmaps)
+            {
+                auto d2dBitmap = Make<StubD2DBitmap>();
+                d2dBitmap->GetSizeMethod.AllowAnyCall([] { return D2D1_SIZE_F{ 100, 100 }; });
+                d2dBitmap->GetPixelSizeMethod.AllowAnyCall([] { return D2D1_SIZE_U{ 100, 100 }; });
+
+                bitmap = std::make_pair(d2dBitmap, Make<CanvasBitmap>(Device.Get(), d2dBitmap.Get()));
+            }
+        }
+
+        uint32_t Add(float id, int bitmapIndex = 0)
+        {
+            uint32_t handle;
+            ThrowIfFailed(SpriteBatch->Add(Bitmaps[bitmapIndex].second.Get(), IdTransform(id), CanvasSpriteBatch::DEFAULT_TINT, CanvasSpriteFlip::None, &handle));
+            return handle;
+        }
+
+        // Expects a single AddSprites call, starting at the end of the
+        // current D2D batch, with the sprites identified by ids.
+        void ExpectAddSprites(std::vector<float> ids)
+        {
+            D2DSpriteBatch->AddSpritesMethod.SetExpectedCalls(1,
+                [=] (uint32_t count, D2D1_RECT_F const*, D2D1_RECT_U const*, D2D1_COLOR_F const*, D2D1_MATRIX_3X2_F const* transforms, uint32_t, uint32_t, uint32_t, uint32_t transformStride)
+                {
+                    Assert::AreEqual(ids.size(), static_cast<size_t>(count));
+                    for (uint32_t i = 0; i < count; ++i)
+                        Assert::AreEqual(ids[i], Get(transforms, transformStride, i)._31);
+                    return S_OK;
+                });
+        }
+
+        struct SetSpritesEntry
+        {
+            uint32_t StartIndex;
+            std::vector<float> Ids;
+        };
+
+        // Expects one SetSprites call per entry, in order.  An id of -1
+        // indicates a removed sprite.
+        void ExpectSetSprites(std::vector<SetSpritesEntry> expected)
+        {
+            size_t call = 0;
+            D2DSpriteBatch->SetSpritesMethod.SetExpectedCalls(static_cast<int>(expected.size()),
+                [=] (uint32_t startIndex, uint32_t count, D2D1_RECT_F const* destRects, D2D1_RECT_U const*, D2D1_COLOR_F const*, D2D1_MATRIX_3X2_F const* transforms, uint32_t destStride, uint32_t, uint32_t, uint32_t transformStride) mutable
+                {
+                    Assert::IsTrue(call < expected.size());
+                    auto const& entry = expected[call++];
+
+                    Assert::AreEqual(entry.StartIndex, startIndex);
+                    Assert::AreEqual(entry.Ids.size(), static_cast<size_t>(count));
+
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        if (entry.Ids[i] < 0)
+                            Assert::AreEqual(D2D1_RECT_F{}, Get(destRects, destStride, i));
+                        else
+                            Assert::AreEqual(entry.Ids[i], Get(transforms, transformStride, i)._31);
+                    }
+                    return S_OK;
+                });
+        }
+
+        void Draw()
+        {
+            ThrowIfFailed(SpriteBatch->Draw(DrawingSession.Get()));
+        }
+
+        uint32_t Count()
+        {
+            uint32_t count;
+            ThrowIfFailed(SpriteBatch->get_Count(&count));
+            return count;
+        }
+
+    private:
+        template<typename T>
+        static T const& Get(T const* base, uint32_t stride, uint32_t index)
+        {
+            return *reinterpret_cast<T const*>(reinterpret_cast<uint8_t const*>(base) + (stride * index));
+        }
+    };
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_Draw_FailsWhenPassedNull)
+    {
+        Fixture f;
+        f.DeviceContext->CreateSpriteBatchMethod.SetExpectedCalls(0);
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->Draw(nullptr));
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_WhenEmpty_NothingIsCreatedOrDrawn)
+    {
+        Fixture f;
+        f.DeviceContext->CreateSpriteBatchMethod.SetExpectedCalls(0);
+        f.DeviceContext->DrawSpriteBatchMethod.SetExpectedCalls(0);
+
+        f.Draw();
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_FirstDraw_AddsAllSprites)
+    {
+        Fixture f;
+
+        for (int i = 0; i < 10; ++i)
+            f.Add(static_cast<float>(i));
+
+        f.ExpectAddSprites({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+        f.D2DSpriteBatch->SetSpritesMethod.SetExpectedCalls(0);
+
+        f.DeviceContext->DrawSpriteBatchMethod.SetExpectedCalls(1,
+            [=] (ID2D1SpriteBatch* spriteBatch, uint32_t startIndex, uint32_t spriteCount, ID2D1Bitmap* bitmap, D2D1_BITMAP_INTERPOLATION_MODE, D2D1_SPRITE_OPTIONS)
+            {
+                Assert::IsTrue(IsSameInstance(f.D2DSpriteBatch.Get(), spriteBatch));
+                Assert::AreEqual(0u, startIndex);
+                Assert::AreEqual(10u, spriteCount);
+                Assert::IsTrue(IsSameInstance(f.Bitmaps[0].first.Get(), bitmap));
+            });
+
+        f.Draw();
+
+        Assert::AreEqual(10u, f.Count());
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_WhenNothingChanged_NothingIsUploadedOnRedraw)
+    {
+        Fixture f;
+
+        for (int i = 0; i < 10; ++i)
+            f.Add(static_cast<float>(i));
+
+        f.ExpectAddSprites({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+        f.Draw();
+
+        f.D2DSpriteBatch->AddSpritesMethod.SetExpectedCalls(0);
+        f.D2DSpriteBatch->SetSpritesMethod.SetExpectedCalls(0);
+        f.D2DSpriteBatch->ClearMethod.SetExpectedCalls(0);
+        f.DeviceContext->DrawSpriteBatchMethod.SetExpectedCalls(3);
+
+        f.Draw();
+        f.Draw();
+        f.Draw();
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_OnlyModifiedRangesAreUploaded)
+    {
+        Fixture f;
+
+        std::vector<uint32_t> handles;
+        for (int i = 0; i < 10; ++i)
+            handles.push_back(f.Add(static_cast<float>(i)));
+
+        f.ExpectAddSprites({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+        f.Draw();
+
+        ThrowIfFailed(f.SpriteBatch->SetTransform(handles[7], IdTransform(70)));
+        ThrowIfFailed(f.SpriteBatch->SetTransform(handles[2], IdTransform(20)));
+        ThrowIfFailed(f.SpriteBatch->SetTint(handles[3], Vector4{ 1, 0, 0, 1 }));
+        ThrowIfFailed(f.SpriteBatch->SetTransform(handles[7], IdTransform(71)));
+
+        f.D2DSpriteBatch->AddSpritesMethod.SetExpectedCalls(0);
+        f.ExpectSetSprites(
+            {
+                { 2, { 20, 3 } },
+                { 7, { 71 } }
+            });
+
+        f.Draw();
+
+        // Uploads are not repeated
+        f.D2DSpriteBatch->SetSpritesMethod.SetExpectedCalls(0);
+        f.Draw();
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_SpritesAddedAfterDraw_AreAppended)
+    {
+        Fixture f;
+
+        auto handle = f.Add(0);
+        f.Add(1);
+
+        f.ExpectAddSprites({ 0, 1 });
+        f.Draw();
+
+        f.Add(2);
+        f.Add(3);
+        ThrowIfFailed(f.SpriteBatch->SetTransform(handle, IdTransform(10)));
+
+        f.ExpectAddSprites({ 2, 3 });
+        f.ExpectSetSprites({ { 0, { 10 } } });
+
+        f.Draw();
+
+        Assert::AreEqual(4u, f.Count());
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_RemovedSpritesLeaveAFreeSlotThatIsReused)
+    {
+        Fixture f;
+
+        std::vector<uint32_t> handles;
+        for (int i = 0; i < 4; ++i)
+            handles.push_back(f.Add(static_cast<float>(i)));
+
+        f.ExpectAddSprites({ 0, 1, 2, 3 });
+        f.Draw();
+
+        ThrowIfFailed(f.SpriteBatch->Remove(handles[1]));
+        Assert::AreEqual(3u, f.Count());
+
+        f.D2DSpriteBatch->AddSpritesMethod.SetExpectedCalls(0);
+        f.ExpectSetSprites({ { 1, { -1 } } });
+
+        // The free slot has the bitmap of its neighbor, so this still only
+        // needs a single draw call
+        f.DeviceContext->DrawSpriteBatchMethod.SetExpectedCalls(1,
+            [] (ID2D1SpriteBatch*, uint32_t startIndex, uint32_t spriteCount, ID2D1Bitmap*, D2D1_BITMAP_INTERPOLATION_MODE, D2D1_SPRITE_OPTIONS)
+            {
+                Assert::AreEqual(0u, startIndex);
+                Assert::AreEqual(4u, spriteCount);
+            });
+
+        f.Draw();
+
+        auto newHandle = f.Add(10);
+        Assert::AreEqual(4u, f.Count());
+
+        f.D2DSpriteBatch->AddSpritesMethod.SetExpectedCalls(0);
+        f.ExpectSetSprites({ { 1, { 10 } } });
+        f.DeviceContext->DrawSpriteBatchMethod.SetExpectedCalls(1);
+
+        f.Draw();
+
+        ThrowIfFailed(f.SpriteBatch->SetTransform(newHandle, IdTransform(11)));
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_WhenMostSpritesAreRemoved_TheBatchIsRebuilt)
+    {
+        Fixture f;
+
+        std::vector<uint32_t> handles;
+        for (int i = 0; i < 6; ++i)
+            handles.push_back(f.Add(static_cast<float>(i)));
+
+        f.ExpectAddSprites({ 0, 1, 2, 3, 4, 5 });
+        f.Draw();
+
+        ThrowIfFailed(f.SpriteBatch->Remove(handles[0]));
+        ThrowIfFailed(f.SpriteBatch->Remove(handles[2]));
+        ThrowIfFailed(f.SpriteBatch->Remove(handles[3]));
+        ThrowIfFailed(f.SpriteBatch->Remove(handles[4]));
+
+        f.D2DSpriteBatch->ClearMethod.SetExpectedCalls(1);
+        f.D2DSpriteBatch->SetSpritesMethod.SetExpectedCalls(0);
+        f.ExpectAddSprites({ 1, 5 });
+
+        f.Draw();
+
+        // The remaining handles still refer to the same sprites
+        ThrowIfFailed(f.SpriteBatch->SetTransform(handles[5], IdTransform(50)));
+
+        f.ExpectSetSprites({ { 1, { 50 } } });
+        f.Draw();
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_Clear_RemovesAllSprites)
+    {
+        Fixture f;
+
+        auto handle = f.Add(0);
+        f.Add(1);
+
+        f.ExpectAddSprites({ 0, 1 });
+        f.Draw();
+
+        ThrowIfFailed(f.SpriteBatch->Clear());
+        Assert::AreEqual(0u, f.Count());
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->SetTransform(handle, IdTransform(0)));
+
+        f.Add(2);
+
+        f.D2DSpriteBatch->ClearMethod.SetExpectedCalls(1);
+        f.ExpectAddSprites({ 2 });
+        f.Draw();
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_SpritesAddedAfterClear_AreUploadedWhenModified)
+    {
+        Fixture f;
+
+        f.Add(0);
+        f.Add(1);
+
+        f.ExpectAddSprites({ 0, 1 });
+        f.Draw();
+
+        ThrowIfFailed(f.SpriteBatch->Clear());
+
+        auto handle = f.Add(2);
+
+        f.D2DSpriteBatch->ClearMethod.SetExpectedCalls(1);
+        f.D2DSpriteBatch->SetSpritesMethod.SetExpectedCalls(0);
+        f.ExpectAddSprites({ 2 });
+        f.Draw();
+
+        ThrowIfFailed(f.SpriteBatch->SetTint(handle, Vector4{ 1, 0, 0, 1 }));
+
+        f.D2DSpriteBatch->AddSpritesMethod.SetExpectedCalls(0);
+        f.ExpectSetSprites({ { 0, { 2 } } });
+        f.Draw();
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_SpritesWithDifferentBitmaps_AreDrawnInSeparateCalls)
+    {
+        Fixture f;
+
+        f.Add(0, 0);
+        f.Add(1, 0);
+        f.Add(2, 1);
+
+        f.ExpectAddSprites({ 0, 1, 2 });
+
+        int call = 0;
+        f.DeviceContext->DrawSpriteBatchMethod.SetExpectedCalls(2,
+            [&] (ID2D1SpriteBatch*, uint32_t startIndex, uint32_t spriteCount, ID2D1Bitmap* bitmap, D2D1_BITMAP_INTERPOLATION_MODE, D2D1_SPRITE_OPTIONS)
+            {
+                Assert::AreEqual(call == 0 ? 0u : 2u, startIndex);
+                Assert::AreEqual(call == 0 ? 2u : 1u, spriteCount);
+                Assert::IsTrue(IsSameInstance(f.Bitmaps[call].first.Get(), bitmap));
+                ++call;
+            });
+
+        f.Draw();
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_MethodsFail_WhenPassedInvalidHandle)
+    {
+        Fixture f;
+        f.DeviceContext->CreateSpriteBatchMethod.SetExpectedCalls(0);
+
+        auto handle = f.Add(0);
+        auto removedHandle = f.Add(1);
+        ThrowIfFailed(f.SpriteBatch->Remove(removedHandle));
+
+        for (auto badHandle : { removedHandle, handle + 100 })
+        {
+            Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->SetTransform(badHandle, IdTransform(0)));
+            Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->SetTint(badHandle, CanvasSpriteBatch::DEFAULT_TINT));
+            Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->SetSourceRect(badHandle, gAnyRect, CanvasSpriteFlip::None));
+            Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->Remove(badHandle));
+        }
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_Add_FailsWhenBitmapIsFromDifferentDevice)
+    {
+        Fixture f;
+        f.DeviceContext->CreateSpriteBatchMethod.SetExpectedCalls(0);
+
+        auto otherBitmap = Make<CanvasBitmap>(Make<MockCanvasDevice>().Get(), f.Bitmaps[0].first.Get());
+
+        uint32_t handle;
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->Add(otherBitmap.Get(), IdTransform(0), CanvasSpriteBatch::DEFAULT_TINT, CanvasSpriteFlip::None, &handle));
+        ValidateStoredErrorState(E_INVALIDARG, Strings::RetainedSpriteBatchBitmapWrongDevice);
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->AddFromSpriteSheet(otherBitmap.Get(), IdTransform(0), gAnyRect, CanvasSpriteBatch::DEFAULT_TINT, CanvasSpriteFlip::None, &handle));
+        ValidateStoredErrorState(E_INVALIDARG, Strings::RetainedSpriteBatchBitmapWrongDevice);
+
+        uint32_t count;
+        ThrowIfFailed(f.SpriteBatch->get_Count(&count));
+        Assert::AreEqual(0u, count);
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_Draw_FailsWhenDrawingSessionUsesDifferentDevice)
+    {
+        Fixture f;
+        f.DeviceContext->CreateSpriteBatchMethod.SetExpectedCalls(0);
+
+        f.Add(0);
+
+        auto otherD2DDevice = Make<MockD2DDevice>();
+        f.DeviceContext->GetDeviceMethod.AllowAnyCall(
+            [=] (ID2D1Device** d)
+            {
+                return otherD2DDevice.CopyTo(d);
+            });
+
+        Assert::AreEqual(E_INVALIDARG, f.SpriteBatch->Draw(f.DrawingSession.Get()));
+        ValidateStoredErrorState(E_INVALIDARG, Strings::RetainedSpriteBatchWrongDevice);
+    }
+
+    TEST_METHOD_EX(CanvasRetainedSpriteBatch_MethodsFail_AfterClosed)
+    {
+        Fixture f;
+        f.DeviceContext->CreateSpriteBatchMethod.SetExpectedCalls(0);
+
+        auto handle = f.Add(0);
+
+        ThrowIfFailed(f.SpriteBatch->Close());
+
+        uint32_t newHandle;
+        uint32_t count;
+        ComPtr<ICanvasDevice> device;
+
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->Add(f.Bitmaps[0].second.Get(), IdTransform(0), CanvasSpriteBatch::DEFAULT_TINT, CanvasSpriteFlip::None, &newHandle));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->AddFromSpriteSheet(f.Bitmaps[0].second.Get(), IdTransform(0), gAnyRect, CanvasSpriteBatch::DEFAULT_TINT, CanvasSpriteFlip::None, &newHandle));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->SetTransform(handle, IdTransform(0)));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->SetTint(handle, CanvasSpriteBatch::DEFAULT_TINT));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->SetSourceRect(handle, gAnyRect, CanvasSpriteFlip::None));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->Remove(handle));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->Clear());
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->get_Count(&count));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->Draw(f.DrawingSession.Get()));
+        Assert::AreEqual(RO_E_CLOSED, f.SpriteBatch->get_Device(&device));
+    }
 };
 
 #endif
@@ -0,0 +1,198 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+static void AssertColorsEqual(Numerics::Vector4 const& expected, Numerics::Vector4 const& actual)
+{
+    const float tolerance = 1e-5f;
+
+    Assert::AreEqual(expected.X, actual.X, tolerance);
+    Assert::AreEqual(expected.Y, actual.Y, tolerance);
+    Assert::AreEqual(expected.Z, actual.Z, tolerance);
+    Assert::AreEqual(expected.W, actual.W, tolerance);
+}
+
+static void AssertMatricesEqual(Matrix5x4 const& expected, Matrix5x4 const& actual)
+{
+    auto expectedValues = reinterpret_cast<float const*>(&expected);
+    auto actualValues = reinterpret_cast<float const*>(&actual);
+
+    for (size_t i = 0; i < sizeof(Matrix5x4) / sizeof(float); i++)
+    {
+        Assert::AreEqual(expectedValues[i], actualValues[i], 1e-5f);
+    }
+}
+
+static const Numerics::Vector4 TestColors[] =
+{
+    { 0, 0, 0, 1 },
+    { 1, 1, 1, 1 },
+    { 1, 0, 0, 1 },
+    { 0.2f, 0.5f, 0.9f, 0.5f },
+    { 0.7f, 0.1f, 0.3f, 0.25f },
+};
+
+TEST_CLASS(ColorMatrixFoldingUnitTests)
+{
+public:
+    TEST_METHOD_EX(ColorMatrixFolding_Identity)
+    {
+        auto identity = ColorMatrixFolding::Identity();
+
+        Assert::IsTrue(ColorMatrixFolding::IsIdentity(identity));
+
+        for (auto& color : TestColors)
+        {
+            AssertColorsEqual(color, ColorMatrixFolding::Transform(color, identity));
+        }
+
+        auto notIdentity = identity;
+        notIdentity.M52 = 0.01f;
+
+        Assert::IsFalse(ColorMatrixFolding::IsIdentity(notIdentity));
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_Saturation_MatchesD2DFormula)
+    {
+        const float s = 0.3f;
+
+        auto matrix = ColorMatrixFolding::Saturation(s);
+
+        // Each column gives one output channel, eg. R' = M11 * R + M21 * G + M31 * B.
+        Assert::AreEqual(0.213f + 0.787f * s, matrix.M11, 1e-6f);
+        Assert::AreEqual(0.715f - 0.715f * s, matrix.M21, 1e-6f);
+        Assert::AreEqual(0.072f - 0.072f * s, matrix.M31, 1e-6f);
+
+        Assert::AreEqual(0.213f - 0.213f * s, matrix.M12, 1e-6f);
+        Assert::AreEqual(0.715f + 0.285f * s, matrix.M22, 1e-6f);
+        Assert::AreEqual(0.072f - 0.072f * s, matrix.M32, 1e-6f);
+
+        Assert::AreEqual(0.213f - 0.213f * s, matrix.M13, 1e-6f);
+        Assert::AreEqual(0.715f - 0.715f * s, matrix.M23, 1e-6f);
+        Assert::AreEqual(0.072f + 0.928f * s, matrix.M33, 1e-6f);
+
+        // Alpha is untouched.
+        Assert::AreEqual(0.4f, ColorMatrixFolding::Transform(Numerics::Vector4{ 0.1f, 0.2f, 0.3f, 0.4f }, matrix).W, 1e-6f);
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_Saturation_EndPoints)
+    {
+        Assert::IsTrue(ColorMatrixFolding::IsIdentity(ColorMatrixFolding::Saturation(1)));
+
+        // Zero saturation reduces every color to its luminance.
+        auto grayscale = ColorMatrixFolding::Saturation(0);
+
+        for (auto& color : TestColors)
+        {
+            float luminance = 0.213f * color.X + 0.715f * color.Y + 0.072f * color.Z;
+
+            AssertColorsEqual(Numerics::Vector4{ luminance, luminance, luminance, color.W }, ColorMatrixFolding::Transform(color, grayscale));
+        }
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_HueRotation_MatchesD2DFormula)
+    {
+        const float degrees = 120;
+
+        float c = cosf(DirectX::XMConvertToRadians(degrees));
+        float s = sinf(DirectX::XMConvertToRadians(degrees));
+
+        auto matrix = ColorMatrixFolding::HueRotation(degrees);
+
+        Assert::AreEqual(0.213f + c * 0.787f - s * 0.213f, matrix.M11, 1e-6f);
+        Assert::AreEqual(0.715f - c * 0.715f - s * 0.715f, matrix.M21, 1e-6f);
+        Assert::AreEqual(0.072f - c * 0.072f + s * 0.928f, matrix.M31, 1e-6f);
+
+        Assert::AreEqual(0.213f - c * 0.213f + s * 0.143f, matrix.M12, 1e-6f);
+        Assert::AreEqual(0.715f + c * 0.285f + s * 0.140f, matrix.M22, 1e-6f);
+        Assert::AreEqual(0.072f - c * 0.072f - s * 0.283f, matrix.M32, 1e-6f);
+
+        Assert::AreEqual(0.213f - c * 0.213f - s * 0.787f, matrix.M13, 1e-6f);
+        Assert::AreEqual(0.715f - c * 0.715f + s * 0.715f, matrix.M23, 1e-6f);
+        Assert::AreEqual(0.072f + c * 0.928f + s * 0.072f, matrix.M33, 1e-6f);
+
+        // Grays have no hue, so are unchanged.
+        AssertColorsEqual(Numerics::Vector4{ 0.5f, 0.5f, 0.5f, 1 }, ColorMatrixFolding::Transform(Numerics::Vector4{ 0.5f, 0.5f, 0.5f, 1 }, matrix));
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_HueRotation_FullTurnIsIdentity)
+    {
+        Assert::IsTrue(ColorMatrixFolding::IsIdentity(ColorMatrixFolding::HueRotation(0)));
+        Assert::IsTrue(ColorMatrixFolding::IsIdentity(ColorMatrixFolding::HueRotation(360)));
+        Assert::IsFalse(ColorMatrixFolding::IsIdentity(ColorMatrixFolding::HueRotation(10)));
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_Opacity_ScalesAlpha)
+    {
+        auto matrix = ColorMatrixFolding::Opacity(0.5f);
+
+        AssertColorsEqual(Numerics::Vector4{ 0.2f, 0.4f, 0.6f, 0.25f }, ColorMatrixFolding::Transform(Numerics::Vector4{ 0.2f, 0.4f, 0.6f, 0.5f }, matrix));
+
+        Assert::IsTrue(ColorMatrixFolding::IsIdentity(ColorMatrixFolding::Opacity(1)));
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_Compose_MatchesApplyingInTurn)
+    {
+        Matrix5x4 first
+        {
+            0.9f, 0.1f, 0.0f, 0.0f,
+            0.2f, 0.7f, 0.1f, 0.0f,
+            0.0f, 0.3f, 0.6f, 0.0f,
+            0.1f, 0.0f, 0.2f, 0.8f,
+            0.05f, -0.1f, 0.2f, 0.1f,
+        };
+
+        Matrix5x4 second
+        {
+            0.5f, 0.2f, 0.1f, 0.0f,
+            0.1f, 0.6f, 0.3f, 0.0f,
+            0.3f, 0.1f, 0.4f, 0.0f,
+            0.0f, 0.0f, 0.0f, 0.9f,
+            0.1f, 0.2f, -0.3f, 0.0f,
+        };
+
+        auto composed = ColorMatrixFolding::Compose(first, second);
+
+        for (auto& color : TestColors)
+        {
+            auto inTurn = ColorMatrixFolding::Transform(ColorMatrixFolding::Transform(color, first), second);
+
+            AssertColorsEqual(inTurn, ColorMatrixFolding::Transform(color, composed));
+        }
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_Compose_Saturations)
+    {
+        // Saturation matrices are L + s(I - L), where L projects onto luminance, so they compose by multiplying s.
+        auto composed = ColorMatrixFolding::Compose(ColorMatrixFolding::Saturation(0.5f), ColorMatrixFolding::Saturation(0.4f));
+
+        AssertMatricesEqual(ColorMatrixFolding::Saturation(0.2f), composed);
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_Compose_WithIdentity)
+    {
+        auto matrix = ColorMatrixFolding::Compose(ColorMatrixFolding::HueRotation(30), ColorMatrixFolding::Opacity(0.5f));
+
+        AssertMatricesEqual(matrix, ColorMatrixFolding::Compose(ColorMatrixFolding::Identity(), matrix));
+        AssertMatricesEqual(matrix, ColorMatrixFolding::Compose(matrix, ColorMatrixFolding::Identity()));
+    }
+
+    TEST_METHOD_EX(ColorMatrixFolding_CanComposeAfter)
+    {
+        Assert::IsTrue(ColorMatrixFolding::CanComposeAfter(ColorMatrixFolding::Saturation(0.5f)));
+        Assert::IsTrue(ColorMatrixFolding::CanComposeAfter(ColorMatrixFolding::HueRotation(45)));
+        Assert::IsTrue(ColorMatrixFolding::CanComposeAfter(ColorMatrixFolding::Opacity(0.5f)));
+
+        // Matrices that can make transparent pixels visible depend on the color those pixels had.
+        auto alphaFromRed = ColorMatrixFolding::Identity();
+        alphaFromRed.M14 = 1;
+
+        auto alphaOffset = ColorMatrixFolding::Identity();
+        alphaOffset.M54 = 0.5f;
+
+        Assert::IsFalse(ColorMatrixFolding::CanComposeAfter(alphaFromRed));
+        Assert::IsFalse(ColorMatrixFolding::CanComposeAfter(alphaOffset));
+    }
+};
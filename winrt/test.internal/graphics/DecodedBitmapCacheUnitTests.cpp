@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "../mocks/MockWICBitmapSource.h"
+
+TEST_CLASS(DecodedBitmapCacheUnitTests)
+{
+public:
+    static DecodedBitmapKey MakeKey(wchar_t const* name, uint64_t size = 100, uint64_t lastWriteTime = 1)
+    {
+        return DecodedBitmapKey{ name, size, lastWriteTime };
+    }
+
+    static ComPtr<IWICBitmapSource> MakeSource()
+    {
+        return Make<MockWICBitmapSource>();
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_IsDisabledByDefault)
+    {
+        DecodedBitmapCache cache;
+
+        Assert::IsFalse(cache.IsEnabled());
+        Assert::AreEqual<uint64_t>(0, cache.GetMaximumSizeInBytes());
+
+        cache.Add(MakeKey(L"a"), MakeSource(), 0);
+        cache.Add(MakeKey(L"b"), MakeSource(), 10);
+
+        Assert::AreEqual<size_t>(0, cache.GetEntryCount());
+        Assert::IsNull(cache.TryGet(MakeKey(L"a")).Get());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_TryGet_ReturnsAddedSource_AndCountsHitsAndMisses)
+    {
+        DecodedBitmapCache cache;
+        cache.SetMaximumSizeInBytes(1000);
+        Assert::IsTrue(cache.IsEnabled());
+
+        auto source = MakeSource();
+        cache.Add(MakeKey(L"a"), source, 400);
+
+        Assert::AreEqual<size_t>(1, cache.GetEntryCount());
+        Assert::AreEqual<uint64_t>(400, cache.GetSizeInBytes());
+
+        // Entries are shared, so they can be looked up again and again.
+        Assert::IsTrue(IsSameInstance(source.Get(), cache.TryGet(MakeKey(L"a")).Get()));
+        Assert::IsTrue(IsSameInstance(source.Get(), cache.TryGet(MakeKey(L"a")).Get()));
+        Assert::IsNull(cache.TryGet(MakeKey(L"b")).Get());
+
+        Assert::AreEqual<size_t>(1, cache.GetEntryCount());
+        Assert::AreEqual<uint64_t>(2, cache.GetHitCount());
+        Assert::AreEqual<uint64_t>(1, cache.GetMissCount());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_EveryPartOfTheKeyIsCompared)
+    {
+        DecodedBitmapCache cache;
+        cache.SetMaximumSizeInBytes(1000);
+
+        cache.Add(MakeKey(L"a", 100, 1), MakeSource(), 10);
+
+        Assert::IsNull(cache.TryGet(MakeKey(L"b", 100, 1)).Get());
+        Assert::IsNull(cache.TryGet(MakeKey(L"a", 101, 1)).Get());
+        Assert::IsNull(cache.TryGet(MakeKey(L"a", 100, 2)).Get());
+        Assert::IsNotNull(cache.TryGet(MakeKey(L"a", 100, 1)).Get());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Add_ReplacesEntryWithTheSameKey)
+    {
+        DecodedBitmapCache cache;
+        cache.SetMaximumSizeInBytes(1000);
+
+        auto second = MakeSource();
+
+        cache.Add(MakeKey(L"a"), MakeSource(), 100);
+        cache.Add(MakeKey(L"a"), second, 200);
+
+        Assert::AreEqual<size_t>(1, cache.GetEntryCount());
+        Assert::AreEqual<uint64_t>(200, cache.GetSizeInBytes());
+        Assert::IsTrue(IsSameInstance(second.Get(), cache.TryGet(MakeKey(L"a")).Get()));
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_WhenFull_LeastRecentlyUsedEntriesAreDiscarded)
+    {
+        DecodedBitmapCache cache;
+        cache.SetMaximumSizeInBytes(300);
+
+        cache.Add(MakeKey(L"a"), MakeSource(), 100);
+        cache.Add(MakeKey(L"b"), MakeSource(), 100);
+        cache.Add(MakeKey(L"c"), MakeSource(), 100);
+
+        // Using a makes b the least recently used.
+        cache.TryGet(MakeKey(L"a"));
+
+        cache.Add(MakeKey(L"d"), MakeSource(), 150);
+
+        Assert::AreEqual<uint64_t>(250, cache.GetSizeInBytes());
+        Assert::IsNotNull(cache.TryGet(MakeKey(L"a")).Get());
+        Assert::IsNull(cache.TryGet(MakeKey(L"b")).Get());
+        Assert::IsNull(cache.TryGet(MakeKey(L"c")).Get());
+        Assert::IsNotNull(cache.TryGet(MakeKey(L"d")).Get());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_SourcesBiggerThanTheCache_AreNotAdded)
+    {
+        DecodedBitmapCache cache;
+        cache.SetMaximumSizeInBytes(300);
+
+        cache.Add(MakeKey(L"a"), MakeSource(), 100);
+        cache.Add(MakeKey(L"b"), MakeSource(), 301);
+
+        // Existing entries are left alone.
+        Assert::AreEqual<size_t>(1, cache.GetEntryCount());
+        Assert::IsNotNull(cache.TryGet(MakeKey(L"a")).Get());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Trim_DiscardsLeastRecentlyUsedEntries)
+    {
+        DecodedBitmapCache cache;
+        cache.SetMaximumSizeInBytes(1000);
+
+        cache.Add(MakeKey(L"a"), MakeSource(), 100);
+        cache.Add(MakeKey(L"b"), MakeSource(), 100);
+        cache.Add(MakeKey(L"c"), MakeSource(), 100);
+
+        cache.Trim(250);
+
+        Assert::AreEqual<size_t>(2, cache.GetEntryCount());
+        Assert::IsNull(cache.TryGet(MakeKey(L"a")).Get());
+
+        cache.Trim(0);
+
+        Assert::AreEqual<size_t>(0, cache.GetEntryCount());
+        Assert::AreEqual<uint64_t>(0, cache.GetSizeInBytes());
+
+        // Trimming does not change the limit.
+        Assert::AreEqual<uint64_t>(1000, cache.GetMaximumSizeInBytes());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_LoweringTheMaximumSize_TrimsTheCache)
+    {
+        DecodedBitmapCache cache;
+        cache.SetMaximumSizeInBytes(1000);
+
+        cache.Add(MakeKey(L"a"), MakeSource(), 100);
+        cache.Add(MakeKey(L"b"), MakeSource(), 100);
+
+        cache.SetMaximumSizeInBytes(150);
+
+        Assert::AreEqual<size_t>(1, cache.GetEntryCount());
+        Assert::IsNotNull(cache.TryGet(MakeKey(L"b")).Get());
+
+        cache.SetMaximumSizeInBytes(0);
+
+        Assert::IsFalse(cache.IsEnabled());
+        Assert::AreEqual<size_t>(0, cache.GetEntryCount());
+    }
+};
@@ -4,13 +4,19 @@
 
 #include "pch.h"
 
+#include <chrono>
+
 class CountedD2DDeviceContext : public MockD2DDeviceContext
 {
-    int* m_counter;
+    std::atomic<int>* m_counter;
     
 public:
-    CountedD2DDeviceContext(int* counter)
+    // Set while the context is leased by the stress test
+    std::atomic<bool> IsLeased;
+
+    CountedD2DDeviceContext(std::atomic<int>* counter)
         : m_counter(counter)
+        , IsLeased(false)
     {
         (*m_counter)++;
     }
@@ -31,7 +37,7 @@ public:
         DeviceContextPool Pool;
 
         CALL_COUNTER(CreateDeviceContextMethod);
-        int NumberOfActiveDeviceContexts;
+        std::atomic<int> NumberOfActiveDeviceContexts;
 
         Fixture()
             : Device(Make<MockD2DDevice>())
@@ -48,6 +54,24 @@ public:
                 };
         }
 
+        // CreateDeviceContextMethod isn't thread safe, and nor is creating
+        // mocks (they register themselves with the test's expectations), so
+        // tests that create contexts on several threads at once use this
+        // instead.
+        void AllowCreationFromAnyThread()
+        {
+            auto mutex = std::make_shared<std::mutex>();
+
+            Device->MockCreateDeviceContext =
+                [=] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+                {
+                    Lock lock(*mutex);
+
+                    auto mockDeviceContext = Make<CountedD2DDeviceContext>(&NumberOfActiveDeviceContexts);
+                    mockDeviceContext.CopyTo(deviceContext);
+                };
+        }
+
         void PopulatePool()
         {
             // Create many concurrent leases and then release them all.
@@ -140,7 +164,7 @@ public:
         Assert::IsTrue(f.NumberOfActiveDeviceContexts > 0);
 
         f.Pool.Close();
-        Assert::AreEqual(0, f.NumberOfActiveDeviceContexts);
+        Assert::AreEqual<int>(0, f.NumberOfActiveDeviceContexts);
     }
 
     TEST_METHOD_EX(DeviceContextPool_WhenClosed_AndLeaseIsReturned_DeviceContextIsDestroyed)
@@ -153,10 +177,10 @@ public:
             
             f.Pool.Close();
 
-            Assert::AreEqual(1, f.NumberOfActiveDeviceContexts);
+            Assert::AreEqual<int>(1, f.NumberOfActiveDeviceContexts);
         }
 
-        Assert::AreEqual(0, f.NumberOfActiveDeviceContexts);
+        Assert::AreEqual<int>(0, f.NumberOfActiveDeviceContexts);
     }
 
     TEST_METHOD_EX(DeviceContextPool_WhenClosed_TakeLease_Fails)
@@ -166,4 +190,108 @@ public:
 
         ExpectHResultException(RO_E_CLOSED, [&] { f.Pool.TakeLease(); });
     }
+
+    TEST_METHOD_EX(DeviceContextPool_ContextReturnedOnOneThread_IsReusedOnAnother)
+    {
+        Fixture f;
+        f.CreateDeviceContextMethod.SetExpectedCalls(1);
+
+        ID2D1DeviceContext1* otherThreadContext = nullptr;
+
+        std::thread([&] { otherThreadContext = f.Pool.TakeLease().Get(); }).join();
+
+        auto lease = f.Pool.TakeLease();
+        Assert::AreEqual(otherThreadContext, lease.Get());
+    }
+
+    TEST_METHOD_EX(DeviceContextPool_WhenClosed_ContextsPooledByOtherThreadsAreDestroyed)
+    {
+        Fixture f;
+        f.AllowCreationFromAnyThread();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i)
+            threads.emplace_back([&] { f.Pool.TakeLease(); });
+
+        for (auto& thread : threads)
+            thread.join();
+
+        Assert::IsTrue(f.NumberOfActiveDeviceContexts > 0);
+
+        f.Pool.Close();
+        Assert::AreEqual<int>(0, f.NumberOfActiveDeviceContexts);
+    }
+
+    //
+    // Leases and returns contexts from 1 to 32 threads at once, checking that
+    // no context is ever leased to two threads at the same time, and that the
+    // pool ends up no bigger than its maximum size.  The number of leases per
+    // second is logged for each thread count.
+    //
+    PERF_TEST_METHOD_EX(DeviceContextPool_StressTest)
+    {
+        int const leasesPerThread = 20000;
+
+        for (int threadCount : { 1, 2, 4, 8, 16, 32 })
+        {
+            Fixture f;
+            f.AllowCreationFromAnyThread();
+
+            std::atomic<bool> contextLeasedTwice(false);
+
+            auto useLease = [&] (DeviceContextLease& lease)
+            {
+                auto deviceContext = static_cast<CountedD2DDeviceContext*>(lease.Get());
+
+                if (deviceContext->IsLeased.exchange(true))
+                    contextLeasedTwice = true;
+
+                deviceContext->IsLeased = false;
+            };
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            std::vector<std::thread> threads;
+            for (int i = 0; i < threadCount; ++i)
+            {
+                threads.emplace_back([&]
+                {
+                    for (int j = 0; j < leasesPerThread; ++j)
+                    {
+                        auto lease = f.Pool.TakeLease();
+                        useLease(lease);
+
+                        // Every so often hold two leases at once so that the
+                        // shared stack gets used as well as the slots.
+                        if (j % 16 == 0)
+                        {
+                            auto secondLease = f.Pool.TakeLease();
+                            useLease(secondLease);
+                        }
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            Assert::IsFalse(contextLeasedTwice.load());
+            Assert::IsTrue(f.NumberOfActiveDeviceContexts <= static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U)));
+
+            f.Pool.Close();
+            Assert::AreEqual<int>(0, f.NumberOfActiveDeviceContexts);
+
+            auto leaseCount = threadCount * (leasesPerThread + (leasesPerThread + 15) / 16);
+
+            wchar_t message[200];
+            ThrowIfFailed(StringCchPrintf(message, _countof(message),
+                L"%d threads: %.0f leases per second\n",
+                threadCount,
+                leaseCount / elapsed.count()));
+
+            Logger::WriteMessage(message);
+        }
+    }
 };
@@ -0,0 +1,199 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+typedef EffectPropertyStorage::ValueType ValueType;
+
+TEST_CLASS(EffectPropertyStorageUnitTests)
+{
+public:
+    TEST_METHOD_EX(EffectPropertyStorage_NewStorage_HasNoValues)
+    {
+        EffectPropertyStorage storage(3);
+
+        Assert::AreEqual(3u, storage.GetCount());
+        Assert::IsFalse(storage.HasDirtyValues());
+
+        for (unsigned i = 0; i < storage.GetCount(); i++)
+        {
+            Assert::IsTrue(storage.GetType(i) == ValueType::None);
+            Assert::IsFalse(storage.IsDirty(i));
+        }
+    }
+
+    TEST_METHOD_EX(EffectPropertyStorage_SetValue_RoundTripsEachType)
+    {
+        EffectPropertyStorage storage(6);
+
+        auto inspectable = Make<Nullable<float>>(1.0f);
+
+        storage.SetValue(0, static_cast<boolean>(true));
+        storage.SetValue(1, -23);
+        storage.SetValue(2, 42u);
+        storage.SetValue(3, 1.5f);
+        storage.SetValues(4, 3, std::vector<float>{ 1, 2, 3 }.data());
+        storage.SetValue(5, As<IInspectable>(inspectable).Get());
+
+        Assert::IsTrue(storage.GetType(0) == ValueType::Boolean);
+        Assert::IsTrue(storage.GetType(1) == ValueType::Int32);
+        Assert::IsTrue(storage.GetType(2) == ValueType::UInt32);
+        Assert::IsTrue(storage.GetType(3) == ValueType::Float);
+        Assert::IsTrue(storage.GetType(4) == ValueType::FloatArray);
+        Assert::IsTrue(storage.GetType(5) == ValueType::Inspectable);
+
+        boolean b;
+        int32_t i;
+        uint32_t u;
+        float f;
+        uint32_t count;
+
+        storage.GetValue(0, &b);
+        storage.GetValue(1, &i);
+        storage.GetValue(2, &u);
+        storage.GetValue(3, &f);
+        auto values = storage.GetValues(4, &count);
+
+        Assert::IsTrue(!!b);
+        Assert::AreEqual(-23, i);
+        Assert::AreEqual(42u, u);
+        Assert::AreEqual(1.5f, f);
+        Assert::AreEqual(3u, count);
+        Assert::AreEqual(1.0f, values[0]);
+        Assert::AreEqual(2.0f, values[1]);
+        Assert::AreEqual(3.0f, values[2]);
+        Assert::IsTrue(IsSameInstance(inspectable.Get(), storage.GetInspectable(5).Get()));
+    }
+
+    TEST_METHOD_EX(EffectPropertyStorage_SetValue_MarksOnlyThatValueDirty)
+    {
+        EffectPropertyStorage storage(3);
+
+        storage.SetValue(1, 1.0f);
+
+        Assert::IsTrue(storage.HasDirtyValues());
+        Assert::IsFalse(storage.IsDirty(0));
+        Assert::IsTrue(storage.IsDirty(1));
+        Assert::IsFalse(storage.IsDirty(2));
+
+        storage.ClearDirty(1);
+
+        Assert::IsFalse(storage.HasDirtyValues());
+
+        storage.SetValue(0, 1.0f);
+        storage.SetValue(2, 1.0f);
+        storage.ClearAllDirty();
+
+        Assert::IsFalse(storage.HasDirtyValues());
+        Assert::IsFalse(storage.IsDirty(0));
+        Assert::IsFalse(storage.IsDirty(2));
+    }
+
+    TEST_METHOD_EX(EffectPropertyStorage_SettingValueAgain_ReusesTheSameStorage)
+    {
+        EffectPropertyStorage storage(2);
+
+        storage.SetValues(0, 4, std::vector<float>{ 1, 2, 3, 4 }.data());
+        storage.SetValue(1, 1.0f);
+
+        uint32_t count;
+        auto originalValues = storage.GetValues(0, &count);
+
+        storage.SetValues(0, 4, std::vector<float>{ 5, 6, 7, 8 }.data());
+        storage.SetValue(1, 2.0f);
+
+        auto newValues = storage.GetValues(0, &count);
+
+        Assert::IsTrue(originalValues == newValues);
+        Assert::AreEqual(5.0f, newValues[0]);
+
+        // Shrinking an array also reuses the storage.
+        storage.SetValues(0, 2, std::vector<float>{ 9, 10 }.data());
+
+        Assert::IsTrue(originalValues == storage.GetValues(0, &count));
+        Assert::AreEqual(2u, count);
+    }
+
+    TEST_METHOD_EX(EffectPropertyStorage_GetValue_ConvertsBetweenSignedAndUnsigned)
+    {
+        EffectPropertyStorage storage(4);
+
+        storage.SetValue(0, 7);
+        storage.SetValue(1, 7u);
+        storage.SetValue(2, -1);
+        storage.SetValue(3, 0x80000000u);
+
+        int32_t i;
+        uint32_t u;
+
+        storage.GetValue(0, &u);
+        Assert::AreEqual(7u, u);
+
+        storage.GetValue(1, &i);
+        Assert::AreEqual(7, i);
+
+        ExpectHResultException(E_BOUNDS, [&] { storage.GetValue(2, &u); });
+        ExpectHResultException(E_BOUNDS, [&] { storage.GetValue(3, &i); });
+    }
+
+    TEST_METHOD_EX(EffectPropertyStorage_GetValue_WrongType_Throws)
+    {
+        EffectPropertyStorage storage(2);
+
+        storage.SetValue(0, 1.0f);
+
+        boolean b;
+        uint32_t count;
+
+        ExpectHResultException(TYPE_E_TYPEMISMATCH, [&] { storage.GetValue(0, &b); });
+        ExpectHResultException(TYPE_E_TYPEMISMATCH, [&] { storage.GetValues(0, &count); });
+        ExpectHResultException(TYPE_E_TYPEMISMATCH, [&] { storage.GetInspectable(0); });
+        ExpectHResultException(TYPE_E_TYPEMISMATCH, [&] { storage.GetValue(1, &b); });
+    }
+
+    TEST_METHOD_EX(EffectPropertyStorage_Box)
+    {
+        ComPtr<IPropertyValueStatics> factory;
+        ThrowIfFailed(GetActivationFactory(HStringReference(RuntimeClass_Windows_Foundation_PropertyValue).Get(), &factory));
+
+        EffectPropertyStorage storage(4);
+
+        storage.SetValue(1, 3u);
+        storage.SetValue(2, 2.5f);
+        storage.SetValues(3, 2, std::vector<float>{ 1, 2 }.data());
+
+        // Values that were never set box as null.
+        Assert::IsNull(storage.Box(factory.Get(), 0).Get());
+
+        PropertyType type;
+
+        auto boxedUInt = storage.Box(factory.Get(), 1);
+        ThrowIfFailed(boxedUInt->get_Type(&type));
+        Assert::AreEqual<int>(PropertyType_UInt32, type);
+
+        uint32_t u;
+        ThrowIfFailed(boxedUInt->GetUInt32(&u));
+        Assert::AreEqual(3u, u);
+
+        auto boxedFloat = storage.Box(factory.Get(), 2);
+        ThrowIfFailed(boxedFloat->get_Type(&type));
+        Assert::AreEqual<int>(PropertyType_Single, type);
+
+        float f;
+        ThrowIfFailed(boxedFloat->GetSingle(&f));
+        Assert::AreEqual(2.5f, f);
+
+        auto boxedArray = storage.Box(factory.Get(), 3);
+        ThrowIfFailed(boxedArray->get_Type(&type));
+        Assert::AreEqual<int>(PropertyType_SingleArray, type);
+
+        ComArray<float> array;
+        ThrowIfFailed(boxedArray->GetSingleArray(array.GetAddressOfSize(), array.GetAddressOfData()));
+        Assert::AreEqual(2u, array.GetSize());
+        Assert::AreEqual(2.0f, array[1]);
+
+        // Boxing does not affect the dirty state.
+        Assert::IsTrue(storage.IsDirty(1));
+    }
+};
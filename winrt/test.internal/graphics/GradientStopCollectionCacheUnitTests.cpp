@@ -0,0 +1,151 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+TEST_CLASS(GradientStopCollectionCacheUnitTests)
+{
+public:
+    static GradientStopCollectionKey MakeKey(float position = 0.5f, D2D1_EXTEND_MODE extendMode = D2D1_EXTEND_MODE_CLAMP)
+    {
+        return GradientStopCollectionKey{
+            std::vector<D2D1_GRADIENT_STOP>{ { 0, D2D1_COLOR_F{ 1, 0, 0, 1 } }, { position, D2D1_COLOR_F{ 0, 0, 1, 1 } } },
+            D2D1_COLOR_SPACE_SRGB,
+            D2D1_COLOR_SPACE_SRGB,
+            D2D1_BUFFER_PRECISION_8BPC_UNORM,
+            extendMode,
+            D2D1_COLOR_INTERPOLATION_MODE_STRAIGHT };
+    }
+
+    struct Fixture
+    {
+        GradientStopCollectionCache Cache;
+        int CreateCount;
+
+        Fixture()
+            : CreateCount(0)
+        {
+        }
+
+        ComPtr<ID2D1GradientStopCollection1> GetOrCreate(GradientStopCollectionKey&& key)
+        {
+            return Cache.GetOrCreate(std::move(key),
+                [&] (GradientStopCollectionKey const&)
+                {
+                    ++CreateCount;
+                    return ComPtr<ID2D1GradientStopCollection1>(Make<MockD2DGradientStopCollection>());
+                });
+        }
+    };
+
+    TEST_METHOD_EX(GradientStopCollectionCache_SameKey_ReturnsSameCollection)
+    {
+        Fixture f;
+
+        auto first = f.GetOrCreate(MakeKey());
+        auto second = f.GetOrCreate(MakeKey());
+
+        Assert::IsTrue(IsSameInstance(first.Get(), second.Get()));
+        Assert::AreEqual(1, f.CreateCount);
+        Assert::AreEqual<uint64_t>(1, f.Cache.GetHitCount());
+        Assert::AreEqual<uint64_t>(1, f.Cache.GetMissCount());
+    }
+
+    TEST_METHOD_EX(GradientStopCollectionCache_CreateIsPassedTheKey)
+    {
+        GradientStopCollectionCache cache;
+
+        cache.GetOrCreate(MakeKey(0.25f, D2D1_EXTEND_MODE_MIRROR),
+            [] (GradientStopCollectionKey const& key)
+            {
+                Assert::IsTrue(MakeKey(0.25f, D2D1_EXTEND_MODE_MIRROR) == key);
+                return ComPtr<ID2D1GradientStopCollection1>(Make<MockD2DGradientStopCollection>());
+            });
+    }
+
+    TEST_METHOD_EX(GradientStopCollectionCache_EveryPartOfTheKeyIsCompared)
+    {
+        auto base = MakeKey();
+
+        std::vector<GradientStopCollectionKey> variations(6, base);
+        variations[0].Stops[1].position = 0.75f;
+        variations[1].Stops.pop_back();
+        variations[2].PreInterpolationSpace = D2D1_COLOR_SPACE_SCRGB;
+        variations[3].PostInterpolationSpace = D2D1_COLOR_SPACE_SCRGB;
+        variations[4].BufferPrecision = D2D1_BUFFER_PRECISION_16BPC_FLOAT;
+        variations[5].ExtendMode = D2D1_EXTEND_MODE_WRAP;
+
+        Fixture f;
+        f.GetOrCreate(std::move(base));
+
+        for (auto& variation : variations)
+            f.GetOrCreate(std::move(variation));
+
+        auto interpolationVariation = MakeKey();
+        interpolationVariation.InterpolationMode = D2D1_COLOR_INTERPOLATION_MODE_PREMULTIPLIED;
+        f.GetOrCreate(std::move(interpolationVariation));
+
+        Assert::AreEqual(8, f.CreateCount);
+        Assert::AreEqual<uint64_t>(0, f.Cache.GetHitCount());
+    }
+
+    TEST_METHOD_EX(GradientStopCollectionCache_LeastRecentlyUsedEntryIsDiscarded)
+    {
+        Fixture f;
+
+        auto keyFor = [] (uint32_t i) { return MakeKey(static_cast<float>(i) / GradientStopCollectionCache::MaxEntries); };
+
+        for (uint32_t i = 0; i < GradientStopCollectionCache::MaxEntries; ++i)
+            f.GetOrCreate(keyFor(i));
+
+        // Using the first entry again makes the second the least recently used
+        f.GetOrCreate(keyFor(0));
+
+        f.GetOrCreate(keyFor(GradientStopCollectionCache::MaxEntries));
+        Assert::AreEqual<size_t>(GradientStopCollectionCache::MaxEntries, f.Cache.GetEntryCount());
+
+        auto createCount = f.CreateCount;
+
+        f.GetOrCreate(keyFor(0));
+        Assert::AreEqual(createCount, f.CreateCount);
+
+        f.GetOrCreate(keyFor(1));
+        Assert::AreEqual(createCount + 1, f.CreateCount);
+    }
+
+    TEST_METHOD_EX(GradientStopCollectionCache_Clear_RemovesAllEntries)
+    {
+        Fixture f;
+
+        f.GetOrCreate(MakeKey(0.1f));
+        f.GetOrCreate(MakeKey(0.2f));
+        Assert::AreEqual<size_t>(2, f.Cache.GetEntryCount());
+
+        f.Cache.Clear();
+        Assert::AreEqual<size_t>(0, f.Cache.GetEntryCount());
+
+        f.GetOrCreate(MakeKey(0.1f));
+        Assert::AreEqual(3, f.CreateCount);
+    }
+
+    TEST_METHOD_EX(GradientStopCollectionCache_WhenCreateFails_NothingIsCached)
+    {
+        Fixture f;
+
+        ExpectHResultException(E_FAIL,
+            [&]
+            {
+                f.Cache.GetOrCreate(MakeKey(),
+                    [] (GradientStopCollectionKey const&) -> ComPtr<ID2D1GradientStopCollection1>
+                    {
+                        ThrowHR(E_FAIL);
+                    });
+            });
+
+        Assert::AreEqual<size_t>(0, f.Cache.GetEntryCount());
+
+        f.GetOrCreate(MakeKey());
+        Assert::AreEqual(1, f.CreateCount);
+    }
+};
@@ -9,6 +9,7 @@
 #include <lib/effects/shader/PixelShaderTransform.h>
 #include <lib/effects/shader/ClipTransform.h>
 #include <lib/effects/shader/SharedShaderState.h>
+#include <lib/effects/shader/ShaderReflectionCache.h>
 
 #include "mocks/MockD2DDrawInfo.h"
 #include "mocks/MockD2DEffectContext.h"
@@ -267,6 +268,52 @@ TEST_CLASS(PixelShaderEffectUnitTests)
     }
 
 
+    TEST_METHOD_EX(PixelShaderEffect_SetPropertyValuesIsPassedThroughToD2D)
+    {
+        Fixture f;
+
+        // Construct a shader description containing one integer variable.
+        D3D11_SHADER_VARIABLE_DESC variableDesc = { "foo", 0, sizeof(int) };
+        D3D11_SHADER_TYPE_DESC variableType = { D3D_SVC_SCALAR, D3D_SVT_INT, 1, 1 };
+
+        ShaderDescription desc;
+        desc.Variables.emplace_back(variableDesc, variableType);
+
+        auto sharedState = MakeSharedShaderState(desc, std::vector<BYTE>(sizeof(int)));
+        auto effect = Make<PixelShaderEffect>(nullptr, nullptr, sharedState.Get());
+
+        // Realize the effect.
+        effect->GetD2DImage(f.CanvasDevice.Get(), f.DeviceContext.Get(), GetImageFlags::None, 0, nullptr);
+
+        auto& d2dConstants = f.GetEffectPropertyValue<int>(PixelShaderEffectProperty::Constants);
+
+        int32_t index;
+        ThrowIfFailed(effect->GetPropertyIndex(HStringReference(L"foo").Get(), &index));
+        Assert::AreEqual(0, index);
+
+        int value = 7;
+        HStringReference foo(L"foo");
+        HSTRING names[] = { foo.Get() };
+
+        ThrowIfFailed(effect->SetPropertyValues(1, names, sizeof(value), reinterpret_cast<BYTE*>(&value)));
+        Assert::AreEqual(7, d2dConstants);
+
+        value = 9;
+
+        ThrowIfFailed(effect->SetPropertyValuesByIndex(1, &index, sizeof(value), reinterpret_cast<BYTE*>(&value)));
+        Assert::AreEqual(9, d2dConstants);
+
+        Assert::AreEqual(E_INVALIDARG, effect->SetPropertyValuesByIndex(1, &index, 2, reinterpret_cast<BYTE*>(&value)));
+        Assert::AreEqual(E_INVALIDARG, effect->SetPropertyValues(1, nullptr, sizeof(value), reinterpret_cast<BYTE*>(&value)));
+        Assert::AreEqual(E_INVALIDARG, effect->GetPropertyIndex(HStringReference(L"foo").Get(), nullptr));
+
+        effect->Close();
+
+        Assert::AreEqual(RO_E_CLOSED, effect->SetPropertyValuesByIndex(1, &index, sizeof(value), reinterpret_cast<BYTE*>(&value)));
+        Assert::AreEqual(RO_E_CLOSED, effect->GetPropertyIndex(HStringReference(L"foo").Get(), &index));
+    }
+
+
     TEST_METHOD_EX(PixelShaderEffect_CoordinateMappingChangesArePassedThroughToD2D)
     {
         Fixture f;
@@ -1367,7 +1414,8 @@ TEST_CLASS(SharedShaderStateUnitTests)
         Assert::AreEqual(coordinateMapping.MaxOffset, clone->CoordinateMapping().MaxOffset);
         Assert::AreEqual<int>(sourceInterpolation.Filter[0], clone->SourceInterpolation().Filter[0]);
 
-        Assert::AreNotEqual<void const*>(&originalState->Shader(), &clone->Shader());
+        // The shader description is immutable, so clones share it.
+        Assert::AreEqual<void const*>(&originalState->Shader(), &clone->Shader());
         Assert::AreNotEqual<void const*>(&originalState->Constants(), &clone->Constants());
         Assert::AreNotEqual<void const*>(&originalState->CoordinateMapping(), &clone->CoordinateMapping());
         Assert::AreNotEqual<void const*>(&originalState->SourceInterpolation(), &clone->SourceInterpolation());
@@ -1564,4 +1612,177 @@ TEST_CLASS(SharedShaderStateUnitTests)
         Assert::AreEqual(4, constants->icols[12]);
         Assert::AreEqual(8, constants->icols[13]);
     };
+
+
+    template<typename T>
+    static void AppendPacked(std::vector<BYTE>& buffer, T const& value)
+    {
+        auto bytes = reinterpret_cast<BYTE const*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+
+    TEST_METHOD_EX(SharedShaderState_SetPropertyValues_MatchesSetProperty)
+    {
+        auto packedState = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+        auto boxedState = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        Matrix4x4 floatMatrix = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+        std::vector<int> intValues = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+        boxedState->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(2.5f).Get());
+        boxedState->SetProperty(HStringReference(L"b").Get(), Make<Nullable<bool>>(true).Get());
+        boxedState->SetProperty(HStringReference(L"cols").Get(), Make<Nullable<Matrix4x4>>(floatMatrix).Get());
+        boxedState->SetProperty(HStringReference(L"icols").Get(), Make<ReferenceArray<int>>(intValues).Get());
+
+        std::vector<BYTE> values;
+        AppendPacked(values, 2.5f);
+        AppendPacked(values, 7);
+        AppendPacked(values, floatMatrix);
+        for (auto value : intValues) AppendPacked(values, value);
+
+        HStringReference f(L"f"), b(L"b"), cols(L"cols"), icols(L"icols");
+        HSTRING names[] = { f.Get(), b.Get(), cols.Get(), icols.Get() };
+
+        packedState->SetPropertyValues(_countof(names), names, static_cast<uint32_t>(values.size()), values.data());
+
+        // Booleans are normalized, and matrices are laid out the same as when set through boxed values.
+        Assert::AreEqual(boxedState->Constants(), packedState->Constants());
+    }
+
+
+    TEST_METHOD_EX(SharedShaderState_SetPropertyValuesByIndex)
+    {
+        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        // Indices follow the sorted property order.
+        auto indexOfF = state->GetPropertyIndex(HStringReference(L"f").Get());
+        auto indexOfI = state->GetPropertyIndex(HStringReference(L"i").Get());
+
+        Assert::AreEqual(2, indexOfF);
+        Assert::AreEqual(3, indexOfI);
+
+        ExpectHResultException(E_INVALIDARG, [&] { state->GetPropertyIndex(HStringReference(L"nope").Get()); });
+
+        std::vector<BYTE> values;
+        AppendPacked(values, 42);
+        AppendPacked(values, 3.0f);
+
+        int32_t indices[] = { indexOfI, indexOfF };
+
+        state->SetPropertyValuesByIndex(_countof(indices), indices, static_cast<uint32_t>(values.size()), values.data());
+
+        auto constants = reinterpret_cast<float const*>(state->Constants().data());
+
+        Assert::AreEqual(3.0f, constants[0]);
+        Assert::AreEqual(42, reinterpret_cast<int const*>(constants)[1]);
+
+        int32_t badIndices[] = { indexOfF, 7 };
+
+        ExpectHResultException(E_BOUNDS, [&] { state->SetPropertyValuesByIndex(_countof(badIndices), badIndices, 8, values.data()); });
+    }
+
+
+    TEST_METHOD_EX(SharedShaderState_SetPropertyValues_ChangesNothingOnFailure)
+    {
+        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        auto originalConstants = state->Constants();
+
+        std::vector<BYTE> values;
+        AppendPacked(values, 1.0f);
+        AppendPacked(values, 2);
+
+        HStringReference f(L"f"), i(L"i"), nope(L"nope");
+        HSTRING goodNames[] = { f.Get(), i.Get() };
+        HSTRING badNames[] = { f.Get(), nope.Get() };
+
+        // Too few and too many bytes.
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetPropertyValues(_countof(goodNames), goodNames, 4, values.data()); });
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetPropertyValues(1, goodNames, 8, values.data()); });
+
+        // Unknown property.
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetPropertyValues(_countof(badNames), badNames, 8, values.data()); });
+
+        Assert::AreEqual(originalConstants, state->Constants());
+    }
+
+
+    static ComPtr<ISharedShaderState> CreateSharedState(ShaderReflectionCache& cache, std::vector<BYTE> const& shaderCode)
+    {
+        return cache.CreateSharedState(shaderCode.data(), static_cast<uint32_t>(shaderCode.size()));
+    }
+
+
+    TEST_METHOD_EX(ShaderReflectionCache_ReflectsOncePerShader)
+    {
+        ShaderReflectionCache cache;
+
+        auto state1a = CreateSharedState(cache, compiledShader1);
+        auto state1b = CreateSharedState(cache, compiledShader1);
+        auto state2a = CreateSharedState(cache, compiledShader2);
+        auto state2b = CreateSharedState(cache, compiledShader2);
+
+        Assert::AreEqual<uint64_t>(2, cache.GetMissCount());
+        Assert::AreEqual<uint64_t>(2, cache.GetHitCount());
+        Assert::AreEqual<size_t>(2, cache.GetEntryCount());
+
+        // Instances of the same shader share the reflection results.
+        Assert::AreEqual<void const*>(&state1a->Shader(), &state1b->Shader());
+        Assert::AreEqual<void const*>(&state2a->Shader(), &state2b->Shader());
+        Assert::AreNotEqual<void const*>(&state1a->Shader(), &state2a->Shader());
+
+        Assert::AreEqual(compiledShader1, state1a->Shader().Code);
+        Assert::AreEqual(compiledShader2, state2a->Shader().Code);
+        Assert::AreEqual<size_t>(7, state1a->Shader().Variables.size());
+
+        // But each has its own constants.
+        Assert::AreNotEqual<void const*>(&state1a->Constants(), &state1b->Constants());
+    };
+
+
+    TEST_METHOD_EX(ShaderReflectionCache_ConstantsStartAtTheirDefaults)
+    {
+        ShaderReflectionCache cache;
+
+        auto state1 = CreateSharedState(cache, compiledShader1);
+
+        state1->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(23.0f).Get());
+
+        auto state2 = CreateSharedState(cache, compiledShader1);
+
+        Assert::AreEqual(state1->Constants().size(), state2->Constants().size());
+        Assert::AreEqual(0.0f, *reinterpret_cast<float const*>(state2->Constants().data()));
+        Assert::AreEqual(23.0f, *reinterpret_cast<float const*>(state1->Constants().data()));
+    };
+
+
+    TEST_METHOD_EX(ShaderReflectionCache_InvalidShadersAreNotCached)
+    {
+        ShaderReflectionCache cache;
+
+        std::vector<BYTE> badCode = { 1, 2, 3 };
+
+        ExpectHResultException(E_INVALIDARG, [&] { CreateSharedState(cache, badCode); });
+        ExpectHResultException(E_INVALIDARG, [&] { CreateSharedState(cache, badCode); });
+
+        Assert::AreEqual<size_t>(0, cache.GetEntryCount());
+    };
+
+
+    TEST_METHOD_EX(ShaderReflectionCache_Clear_RemovesAllEntries)
+    {
+        ShaderReflectionCache cache;
+
+        CreateSharedState(cache, compiledShader1);
+        CreateSharedState(cache, compiledShader2);
+
+        cache.Clear();
+
+        Assert::AreEqual<size_t>(0, cache.GetEntryCount());
+
+        CreateSharedState(cache, compiledShader1);
+
+        Assert::AreEqual<uint64_t>(3, cache.GetMissCount());
+    };
 };
@@ -0,0 +1,125 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+TEST_CLASS(RealizedEffectCacheUnitTests)
+{
+public:
+    static RealizedEffectKey MakeKey(float value = 1, IUnknown* source = nullptr)
+    {
+        RealizedEffectKey key;
+
+        key.EffectId = CLSID_D2D1GaussianBlur;
+        key.PropertyWords = { static_cast<uint32_t>(EffectPropertyStorage::ValueType::Float), 1, *reinterpret_cast<uint32_t*>(&value) };
+        key.CacheOutput = false;
+        key.BufferPrecision = D2D1_BUFFER_PRECISION_UNKNOWN;
+        key.Sources = { source };
+
+        return key;
+    }
+
+    static RealizedEffect MakeEffect()
+    {
+        return RealizedEffect{ Make<MockD2DEffect>(), { nullptr } };
+    }
+
+    TEST_METHOD_EX(RealizedEffectCache_Take_ReturnsAddedEffect)
+    {
+        RealizedEffectCache cache;
+
+        auto effect = MakeEffect();
+        auto d2dEffect = effect.Effect.Get();
+
+        cache.Add(MakeKey(), std::move(effect));
+        Assert::AreEqual<size_t>(1, cache.GetEntryCount());
+        Assert::IsTrue(cache.HasEffectsOfType(CLSID_D2D1GaussianBlur));
+        Assert::IsFalse(cache.HasEffectsOfType(CLSID_D2D1Saturation));
+
+        RealizedEffect taken;
+        Assert::IsTrue(cache.Take(MakeKey(), &taken));
+        Assert::IsTrue(IsSameInstance(d2dEffect, taken.Effect.Get()));
+
+        // Entries are handed out once only.
+        Assert::AreEqual<size_t>(0, cache.GetEntryCount());
+        Assert::IsFalse(cache.Take(MakeKey(), &taken));
+
+        Assert::AreEqual<uint64_t>(1, cache.GetHitCount());
+        Assert::AreEqual<uint64_t>(1, cache.GetMissCount());
+    }
+
+    TEST_METHOD_EX(RealizedEffectCache_EveryPartOfTheKeyIsCompared)
+    {
+        auto source = Make<MockD2DEffect>();
+        auto inspectable = CreateStubCanvasBitmap();
+
+        auto base = MakeKey();
+
+        std::vector<RealizedEffectKey> variations(7, base);
+        variations[0].EffectId = CLSID_D2D1Saturation;
+        variations[1] = MakeKey(2);
+        variations[2].PropertyInspectables.push_back(As<IInspectable>(inspectable));
+        variations[3].CacheOutput = true;
+        variations[4].BufferPrecision = D2D1_BUFFER_PRECISION_32BPC_FLOAT;
+        variations[5].Sources = { As<IUnknown>(source).Get() };
+        variations[6].Sources = { nullptr, nullptr };
+
+        RealizedEffectCache cache;
+        cache.Add(std::move(base), MakeEffect());
+
+        RealizedEffect taken;
+
+        for (auto& variation : variations)
+        {
+            Assert::IsFalse(cache.Take(variation, &taken));
+        }
+
+        Assert::IsTrue(cache.Take(MakeKey(), &taken));
+    }
+
+    TEST_METHOD_EX(RealizedEffectCache_IdenticalEffectsAreAllKept)
+    {
+        RealizedEffectCache cache;
+
+        cache.Add(MakeKey(), MakeEffect());
+        cache.Add(MakeKey(), MakeEffect());
+
+        RealizedEffect first;
+        RealizedEffect second;
+
+        Assert::IsTrue(cache.Take(MakeKey(), &first));
+        Assert::IsTrue(cache.Take(MakeKey(), &second));
+        Assert::IsFalse(IsSameInstance(first.Effect.Get(), second.Effect.Get()));
+    }
+
+    TEST_METHOD_EX(RealizedEffectCache_OldestEntryIsDiscarded)
+    {
+        RealizedEffectCache cache;
+
+        for (uint32_t i = 0; i <= RealizedEffectCache::MaxEntries; ++i)
+        {
+            cache.Add(MakeKey(static_cast<float>(i)), MakeEffect());
+        }
+
+        Assert::AreEqual<size_t>(RealizedEffectCache::MaxEntries, cache.GetEntryCount());
+
+        RealizedEffect taken;
+        Assert::IsFalse(cache.Take(MakeKey(0), &taken));
+        Assert::IsTrue(cache.Take(MakeKey(1), &taken));
+        Assert::IsTrue(cache.Take(MakeKey(static_cast<float>(RealizedEffectCache::MaxEntries)), &taken));
+    }
+
+    TEST_METHOD_EX(RealizedEffectCache_Clear_RemovesAllEntries)
+    {
+        RealizedEffectCache cache;
+
+        cache.Add(MakeKey(1), MakeEffect());
+        cache.Add(MakeKey(2), MakeEffect());
+
+        cache.Clear();
+
+        Assert::AreEqual<size_t>(0, cache.GetEntryCount());
+        Assert::IsFalse(cache.HasEffectsOfType(CLSID_D2D1GaussianBlur));
+    }
+};
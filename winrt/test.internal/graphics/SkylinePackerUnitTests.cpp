@@ -0,0 +1,172 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/drawing/SkylinePacker.h>
+
+TEST_CLASS(SkylinePackerUnitTests)
+{
+public:
+    struct PackedRect
+    {
+        D2D1_POINT_2U Position;
+        uint32_t Width;
+        uint32_t Height;
+    };
+
+    // A tiny deterministic generator, so that the results don't depend on the
+    // standard library's distributions.
+    class SizeGenerator
+    {
+        uint32_t m_state;
+        uint32_t m_min;
+        uint32_t m_max;
+
+    public:
+        SizeGenerator(uint32_t seed, uint32_t min, uint32_t max)
+            : m_state(seed)
+            , m_min(min)
+            , m_max(max)
+        {
+        }
+
+        uint32_t Next()
+        {
+            m_state = m_state * 1664525u + 1013904223u;
+            return m_min + (m_state >> 8) % (m_max - m_min + 1);
+        }
+    };
+
+    static void AssertNoOverlapsAndInBounds(std::vector<PackedRect> const& rects, uint32_t width, uint32_t height)
+    {
+        for (size_t i = 0; i < rects.size(); ++i)
+        {
+            auto const& a = rects[i];
+
+            Assert::IsTrue(a.Position.x + a.Width <= width);
+            Assert::IsTrue(a.Position.y + a.Height <= height);
+
+            for (size_t j = i + 1; j < rects.size(); ++j)
+            {
+                auto const& b = rects[j];
+
+                bool overlaps =
+                    a.Position.x < b.Position.x + b.Width &&
+                    b.Position.x < a.Position.x + a.Width &&
+                    a.Position.y < b.Position.y + b.Height &&
+                    b.Position.y < a.Position.y + a.Height;
+
+                Assert::IsFalse(overlaps);
+            }
+        }
+    }
+
+    TEST_METHOD_EX(SkylinePacker_RejectsEmptyAndOversizedRectangles)
+    {
+        SkylinePacker packer(100, 50);
+        D2D1_POINT_2U position;
+
+        Assert::IsFalse(packer.TryInsert(0, 10, &position));
+        Assert::IsFalse(packer.TryInsert(10, 0, &position));
+        Assert::IsFalse(packer.TryInsert(101, 10, &position));
+        Assert::IsFalse(packer.TryInsert(10, 51, &position));
+
+        Assert::AreEqual(0ull, packer.GetUsedArea());
+    }
+
+    TEST_METHOD_EX(SkylinePacker_FirstRectangleIsPlacedAtOrigin)
+    {
+        SkylinePacker packer(100, 100);
+        D2D1_POINT_2U position{ 1, 1 };
+
+        Assert::IsTrue(packer.TryInsert(10, 20, &position));
+        Assert::AreEqual(0u, position.x);
+        Assert::AreEqual(0u, position.y);
+        Assert::AreEqual(200ull, packer.GetUsedArea());
+    }
+
+    TEST_METHOD_EX(SkylinePacker_PlacesRectanglesAsLowAsPossible)
+    {
+        SkylinePacker packer(100, 100);
+        D2D1_POINT_2U position;
+
+        Assert::IsTrue(packer.TryInsert(60, 30, &position));
+        Assert::IsTrue(packer.TryInsert(40, 10, &position));
+        Assert::AreEqual(60u, position.x);
+        Assert::AreEqual(0u, position.y);
+
+        // Fits on top of the shorter rectangle
+        Assert::IsTrue(packer.TryInsert(40, 10, &position));
+        Assert::AreEqual(60u, position.x);
+        Assert::AreEqual(10u, position.y);
+
+        // Too wide for the gap on the right, so goes on top of the tallest
+        Assert::IsTrue(packer.TryInsert(50, 10, &position));
+        Assert::AreEqual(0u, position.x);
+        Assert::AreEqual(30u, position.y);
+    }
+
+    TEST_METHOD_EX(SkylinePacker_UniformRectanglesFillTheAreaExactly)
+    {
+        SkylinePacker packer(256, 256);
+        D2D1_POINT_2U position;
+
+        std::vector<PackedRect> rects;
+        while (packer.TryInsert(16, 16, &position))
+            rects.push_back(PackedRect{ position, 16, 16 });
+
+        Assert::AreEqual<size_t>(256, rects.size());
+        Assert::AreEqual(1.0f, packer.GetOccupancy());
+        AssertNoOverlapsAndInBounds(rects, 256, 256);
+    }
+
+    TEST_METHOD_EX(SkylinePacker_RandomRectangles_AreDenselyPackedWithoutOverlapping)
+    {
+        uint32_t const size = 512;
+
+        for (uint32_t seed : { 1u, 7u, 42u })
+        {
+            SkylinePacker packer(size, size);
+            SizeGenerator generator(seed, 8, 32);
+
+            std::vector<PackedRect> rects;
+
+            for (int i = 0; i < 2000; ++i)
+            {
+                auto width = generator.Next();
+                auto height = generator.Next();
+
+                D2D1_POINT_2U position;
+                if (packer.TryInsert(width, height, &position))
+                    rects.push_back(PackedRect{ position, width, height });
+            }
+
+            AssertNoOverlapsAndInBounds(rects, size, size);
+
+            uint64_t area = 0;
+            for (auto const& rect : rects)
+                area += static_cast<uint64_t>(rect.Width) * rect.Height;
+
+            Assert::AreEqual(area, packer.GetUsedArea());
+            Assert::IsTrue(packer.GetOccupancy() > 0.85f);
+        }
+    }
+
+    TEST_METHOD_EX(SkylinePacker_Reset_MakesAllSpaceAvailableAgain)
+    {
+        SkylinePacker packer(64, 64);
+        D2D1_POINT_2U position;
+
+        Assert::IsTrue(packer.TryInsert(64, 64, &position));
+        Assert::IsFalse(packer.TryInsert(1, 1, &position));
+
+        packer.Reset();
+
+        Assert::AreEqual(0.0f, packer.GetOccupancy());
+        Assert::IsTrue(packer.TryInsert(64, 64, &position));
+        Assert::AreEqual(0u, position.x);
+        Assert::AreEqual(0u, position.y);
+    }
+};
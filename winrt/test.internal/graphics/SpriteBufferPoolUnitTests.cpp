@@ -0,0 +1,193 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+TEST_CLASS(SpriteBufferPoolUnitTests)
+{
+public:
+    static void Fill(SpriteBuffer& buffer, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            buffer.emplace_back(0, ComPtr<ID2D1Bitmap>(), D2D1_RECT_F{}, D2D1_RECT_U{}, Vector4{});
+    }
+
+    static void LeaseFillAndReturn(SpriteBufferPool& pool, size_t count)
+    {
+        auto buffer = pool.Lease();
+        Fill(buffer, count);
+        pool.Return(std::move(buffer));
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_ReturnedBuffersAreReused)
+    {
+        SpriteBufferPool pool;
+
+        auto buffer = pool.Lease();
+        Fill(buffer, 10);
+        auto data = buffer.data();
+
+        pool.Return(std::move(buffer));
+        Assert::IsTrue(buffer.empty());
+        Assert::AreEqual<size_t>(1, pool.GetFreeBufferCount());
+
+        auto reused = pool.Lease();
+        Assert::IsTrue(reused.empty());
+        Assert::IsTrue(data == reused.data());
+
+        Assert::AreEqual<uint64_t>(2, pool.GetLeaseCount());
+        Assert::AreEqual<uint64_t>(1, pool.GetReuseCount());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_UnusedBuffersAreNotPooled)
+    {
+        SpriteBufferPool pool;
+
+        pool.Return(pool.Lease());
+
+        Assert::AreEqual<size_t>(0, pool.GetFreeBufferCount());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_NewBuffersAreReservedUpToTheHighWaterMark)
+    {
+        SpriteBufferPool pool;
+
+        LeaseFillAndReturn(pool, 50);
+        Assert::AreEqual<size_t>(50, pool.GetHighWaterMark());
+
+        pool.Trim();
+
+        auto allocationCount = SpriteBufferPool::GetAllocationCount();
+
+        auto buffer = pool.Lease();
+        Assert::IsTrue(buffer.capacity() >= 50);
+        Fill(buffer, 50);
+
+        Assert::AreEqual(allocationCount + 1, SpriteBufferPool::GetAllocationCount());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_SteadyState_DoesNotAllocate)
+    {
+        SpriteBufferPool pool;
+
+        auto frame = [&]
+        {
+            for (size_t count : { 10, 100, 30 })
+                LeaseFillAndReturn(pool, count);
+        };
+
+        frame();
+
+        auto allocationCount = SpriteBufferPool::GetAllocationCount();
+
+        for (int i = 0; i < 1000; ++i)
+            frame();
+
+        Assert::AreEqual(allocationCount, SpriteBufferPool::GetAllocationCount());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_HighWaterMarkDecaysAfterTwoWindows)
+    {
+        SpriteBufferPool pool;
+
+        LeaseFillAndReturn(pool, 1000);
+
+        for (uint32_t i = 0; i < SpriteBufferPool::HighWaterMarkWindow * 2 - 1; ++i)
+        {
+            Assert::AreEqual<size_t>(1000, pool.GetHighWaterMark());
+            LeaseFillAndReturn(pool, 10);
+        }
+
+        Assert::AreEqual<size_t>(10, pool.GetHighWaterMark());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_OversizedBuffersAreNotReused_OnceTheHighWaterMarkDecays)
+    {
+        SpriteBufferPool pool;
+
+        LeaseFillAndReturn(pool, 1000);
+
+        // The big buffer is reused while the high-water mark decays
+        for (uint32_t i = 0; i < SpriteBufferPool::HighWaterMarkWindow * 2 - 1; ++i)
+            LeaseFillAndReturn(pool, 10);
+
+        auto reuseCount = pool.GetReuseCount();
+
+        auto buffer = pool.Lease();
+        Assert::IsTrue(buffer.capacity() < 1000);
+        Assert::AreEqual(reuseCount, pool.GetReuseCount());
+        Assert::AreEqual<size_t>(0, pool.GetFreeBufferCount());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_HighWaterMark_UsesPeakSpriteCountWhenLarger)
+    {
+        SpriteBufferPool pool;
+
+        auto buffer = pool.Lease();
+        Fill(buffer, 20);
+        pool.Return(std::move(buffer), 100);
+
+        Assert::AreEqual<size_t>(100, pool.GetHighWaterMark());
+
+        buffer = pool.Lease();
+        Fill(buffer, 50);
+        pool.Return(std::move(buffer), 10);
+
+        Assert::AreEqual<size_t>(100, pool.GetHighWaterMark());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_IdleBuffersAreTrimmed)
+    {
+        SpriteBufferPool pool;
+
+        // Two batches at once leave two buffers in the pool
+        auto a = pool.Lease();
+        auto b = pool.Lease();
+        Fill(a, 10);
+        Fill(b, 10);
+        pool.Return(std::move(a));
+        pool.Return(std::move(b));
+
+        Assert::AreEqual<size_t>(2, pool.GetFreeBufferCount());
+
+        // From then on only one is needed at a time, so the other goes idle
+        for (uint32_t i = 0; i < SpriteBufferPool::IdleReturnLimit; ++i)
+            LeaseFillAndReturn(pool, 10);
+
+        Assert::AreEqual<size_t>(1, pool.GetFreeBufferCount());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_NoMoreThanMaxFreeBuffersArePooled)
+    {
+        SpriteBufferPool pool;
+
+        std::vector<SpriteBuffer> buffers;
+        for (uint32_t i = 0; i < SpriteBufferPool::MaxFreeBuffers + 5; ++i)
+        {
+            buffers.push_back(pool.Lease());
+            Fill(buffers.back(), 10);
+        }
+
+        for (auto& buffer : buffers)
+            pool.Return(std::move(buffer));
+
+        Assert::AreEqual<size_t>(SpriteBufferPool::MaxFreeBuffers, pool.GetFreeBufferCount());
+    }
+
+    TEST_METHOD_EX(SpriteBufferPool_Trim_FreesAllPooledBuffers)
+    {
+        SpriteBufferPool pool;
+
+        LeaseFillAndReturn(pool, 10);
+        Assert::AreEqual<size_t>(1, pool.GetFreeBufferCount());
+
+        pool.Trim();
+
+        Assert::AreEqual<size_t>(0, pool.GetFreeBufferCount());
+    }
+};
+
+#endif
@@ -0,0 +1,145 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/drawing/SpriteCuller.h>
+
+static D2D1_RECT_F const gVisibleRect{ 0, 0, 100, 100 };
+
+TEST_CLASS(SpriteCullerUnitTests)
+{
+public:
+    struct TestSprite
+    {
+        D2D1_RECT_F DestinationRect;
+        D2D1_MATRIX_3X2_F Transform;
+        uint32_t Id;
+    };
+
+    static TestSprite MakeSprite(uint32_t id, float left, float top, float right, float bottom, D2D1_MATRIX_3X2_F transform = D2D1::IdentityMatrix())
+    {
+        return TestSprite{ D2D1_RECT_F{ left, top, right, bottom }, transform, id };
+    }
+
+    static std::vector<uint32_t> GetIds(std::vector<TestSprite> const& sprites)
+    {
+        std::vector<uint32_t> ids;
+        for (auto const& sprite : sprites)
+            ids.push_back(sprite.Id);
+        return ids;
+    }
+
+    static void AssertIds(std::vector<uint32_t> const& expected, std::vector<TestSprite> const& sprites)
+    {
+        auto actual = GetIds(sprites);
+
+        Assert::AreEqual<size_t>(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+            Assert::AreEqual(expected[i], actual[i]);
+    }
+
+    TEST_METHOD_EX(SpriteCuller_EmptyVector_CullsNothing)
+    {
+        std::vector<TestSprite> sprites;
+
+        Assert::AreEqual(0u, SpriteCuller::Cull(sprites, D2D1::IdentityMatrix(), gVisibleRect));
+        Assert::IsTrue(sprites.empty());
+    }
+
+    TEST_METHOD_EX(SpriteCuller_SpritesInsideOrOverlapping_AreKept)
+    {
+        std::vector<TestSprite> sprites
+        {
+            MakeSprite(0,   10,  10,  20,  20),     // inside
+            MakeSprite(1,  -10, -10,   1,   1),     // overlaps top-left
+            MakeSprite(2,   99,  99, 110, 110),     // overlaps bottom-right
+            MakeSprite(3, -100,  50, 200,  60),     // spans the whole width
+            MakeSprite(4,  -10, -10, 110, 110),     // covers everything
+        };
+
+        Assert::AreEqual(0u, SpriteCuller::Cull(sprites, D2D1::IdentityMatrix(), gVisibleRect));
+        AssertIds({ 0, 1, 2, 3, 4 }, sprites);
+    }
+
+    TEST_METHOD_EX(SpriteCuller_SpritesBeyondAnyEdge_AreCulled_AndOrderIsPreserved)
+    {
+        std::vector<TestSprite> sprites
+        {
+            MakeSprite(0,   10,   10,   20,   20),
+            MakeSprite(1,  -20,   10,  -10,   20),  // left
+            MakeSprite(2,   10,  -20,   20,  -10),  // above
+            MakeSprite(3,   30,   30,   40,   40),
+            MakeSprite(4,  110,   10,  120,   20),  // right
+            MakeSprite(5,   10,  110,   20,  120),  // below
+            MakeSprite(6,  -10,   10,    0,   20),  // touching the left edge
+            MakeSprite(7,  100,   10,  110,   20),  // touching the right edge
+            MakeSprite(8,   50,   50,   60,   60),
+        };
+
+        Assert::AreEqual(6u, SpriteCuller::Cull(sprites, D2D1::IdentityMatrix(), gVisibleRect));
+        AssertIds({ 0, 3, 8 }, sprites);
+    }
+
+    TEST_METHOD_EX(SpriteCuller_SpriteTransformIsApplied)
+    {
+        std::vector<TestSprite> sprites
+        {
+            MakeSprite(0, 0, 0, 10, 10, D2D1::Matrix3x2F::Translation(200, 0)),
+            MakeSprite(1, 200, 0, 210, 10, D2D1::Matrix3x2F::Translation(-150, 0)),
+            MakeSprite(2, 0, 0, 10, 10, D2D1::Matrix3x2F::Scale(-1, 1)),
+            MakeSprite(3, 0, 0, 10, 10, D2D1::Matrix3x2F::Scale(20, 20) * D2D1::Matrix3x2F::Translation(-100, -100)),
+        };
+
+        Assert::AreEqual(2u, SpriteCuller::Cull(sprites, D2D1::IdentityMatrix(), gVisibleRect));
+        AssertIds({ 1, 3 }, sprites);
+    }
+
+    TEST_METHOD_EX(SpriteCuller_TargetTransformIsAppliedAfterSpriteTransform)
+    {
+        std::vector<TestSprite> sprites
+        {
+            MakeSprite(0, 0, 0, 10, 10, D2D1::Matrix3x2F::Translation(60, 0)),
+            MakeSprite(1, 0, 0, 10, 10, D2D1::Matrix3x2F::Translation(5, 0)),
+            MakeSprite(2, 0, 0, 10, 10, D2D1::Matrix3x2F::Translation(80, 50)),
+        };
+
+        // Scrolled left by 50 and then scaled up by 2 (eg. for DPI)
+        auto targetTransform = D2D1::Matrix3x2F::Translation(-50, 0) * D2D1::Matrix3x2F::Scale(2, 2);
+
+        Assert::AreEqual(2u, SpriteCuller::Cull(sprites, targetTransform, gVisibleRect));
+        AssertIds({ 0 }, sprites);
+    }
+
+    TEST_METHOD_EX(SpriteCuller_RotatedSprites_AreOnlyCulledWhenAllCornersAreOutside)
+    {
+        auto rotateAroundCenter = D2D1::Matrix3x2F::Rotation(45, D2D1::Point2F(5, 5));
+
+        std::vector<TestSprite> sprites
+        {
+            // Axis aligned this would be outside, but rotated a corner pokes in
+            MakeSprite(0, 0, 0, 10, 10, rotateAroundCenter * D2D1::Matrix3x2F::Translation(-11, 40)),
+
+            // Far enough away that even the rotated corner is outside
+            MakeSprite(1, 0, 0, 10, 10, rotateAroundCenter * D2D1::Matrix3x2F::Translation(-14, 40)),
+        };
+
+        Assert::AreEqual(1u, SpriteCuller::Cull(sprites, D2D1::IdentityMatrix(), gVisibleRect));
+        AssertIds({ 0 }, sprites);
+    }
+
+    TEST_METHOD_EX(SpriteCuller_SpritesWithNaNCoordinates_AreNotCulled)
+    {
+        auto nan = std::numeric_limits<float>::quiet_NaN();
+
+        std::vector<TestSprite> sprites
+        {
+            MakeSprite(0, nan, nan, nan, nan),
+            MakeSprite(1, 0, 0, 10, 10, D2D1::Matrix3x2F(nan, 0, 0, nan, 0, 0)),
+        };
+
+        Assert::AreEqual(0u, SpriteCuller::Cull(sprites, D2D1::IdentityMatrix(), gVisibleRect));
+        AssertIds({ 0, 1 }, sprites);
+    }
+};
@@ -0,0 +1,274 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <chrono>
+#include <random>
+
+#include <lib/drawing/SpriteSorter.h>
+
+TEST_CLASS(SpriteSorterUnitTests)
+{
+public:
+    // Roughly the same shape as CanvasSpriteBatch's sprites
+    struct TestSprite
+    {
+        ComPtr<ID2D1Bitmap> Bitmap;
+        D2D1_RECT_F DestinationRect;
+        D2D1_RECT_U SourceRect;
+        D2D1_COLOR_F Color;
+        D2D1_MATRIX_3X2_F Transform;
+        int32_t Layer;
+        uint32_t Id;
+
+        TestSprite(ComPtr<ID2D1Bitmap> const& bitmap, uint32_t id, int32_t layer = 0)
+            : Bitmap(bitmap)
+            , DestinationRect{}
+            , SourceRect{}
+            , Color{}
+            , Transform{}
+            , Layer(layer)
+            , Id(id)
+        {
+        }
+    };
+
+    static std::vector<ComPtr<ID2D1Bitmap>> MakeBitmaps(size_t count)
+    {
+        std::vector<ComPtr<ID2D1Bitmap>> bitmaps;
+        for (size_t i = 0; i < count; ++i)
+            bitmaps.push_back(Make<StubD2DBitmap>());
+        return bitmaps;
+    }
+
+    // A stream of sprites that mostly comes in short runs that share a
+    // bitmap, as is typical of sprite sheet based drawing.
+    static std::vector<TestSprite> MakeSpriteStream(std::vector<ComPtr<ID2D1Bitmap>> const& bitmaps, uint32_t count)
+    {
+        std::mt19937 random(42);
+        std::uniform_int_distribution<size_t> bitmapIndex(0, bitmaps.size() - 1);
+        std::uniform_int_distribution<uint32_t> runLength(1, 16);
+
+        std::vector<TestSprite> sprites;
+        sprites.reserve(count);
+
+        while (sprites.size() < count)
+        {
+            auto const& bitmap = bitmaps[bitmapIndex(random)];
+            for (auto run = runLength(random); run > 0 && sprites.size() < count; --run)
+                sprites.emplace_back(bitmap, static_cast<uint32_t>(sprites.size()));
+        }
+
+        return sprites;
+    }
+
+    static void ReferenceSort(std::vector<TestSprite>& sprites)
+    {
+        std::stable_sort(sprites.begin(), sprites.end(),
+            [] (auto const& a, auto const& b)
+            {
+                return a.Bitmap.Get() < b.Bitmap.Get();
+            });
+    }
+
+    static void ReferenceSortByLayer(std::vector<TestSprite>& sprites)
+    {
+        std::stable_sort(sprites.begin(), sprites.end(),
+            [] (auto const& a, auto const& b)
+            {
+                if (a.Layer != b.Layer)
+                    return a.Layer < b.Layer;
+
+                return a.Bitmap.Get() < b.Bitmap.Get();
+            });
+    }
+
+    static void AssertSameOrder(std::vector<TestSprite> const& expected, std::vector<TestSprite> const& actual)
+    {
+        Assert::AreEqual(expected.size(), actual.size());
+
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            Assert::AreEqual(expected[i].Id, actual[i].Id);
+            Assert::IsTrue(expected[i].Bitmap == actual[i].Bitmap);
+        }
+    }
+
+    static void ValidateAgainstReferenceSort(size_t bitmapCount, uint32_t spriteCount)
+    {
+        auto bitmaps = MakeBitmaps(bitmapCount);
+        auto sprites = MakeSpriteStream(bitmaps, spriteCount);
+        auto expected = sprites;
+
+        ReferenceSort(expected);
+        SpriteSorter::SortByBitmap(sprites);
+
+        AssertSameOrder(expected, sprites);
+    }
+
+    TEST_METHOD_EX(SpriteSorter_EmptyAndSingleSpriteAreUnchanged)
+    {
+        std::vector<TestSprite> sprites;
+        SpriteSorter::SortByBitmap(sprites);
+        Assert::AreEqual<size_t>(0, sprites.size());
+
+        auto bitmaps = MakeBitmaps(1);
+        sprites.emplace_back(bitmaps[0], 0);
+        SpriteSorter::SortByBitmap(sprites);
+        Assert::AreEqual<size_t>(1, sprites.size());
+        Assert::AreEqual(0u, sprites[0].Id);
+    }
+
+    TEST_METHOD_EX(SpriteSorter_SpritesWithOneBitmapAreUnchanged)
+    {
+        ValidateAgainstReferenceSort(1, 100);
+    }
+
+    TEST_METHOD_EX(SpriteSorter_SortsByBitmapPointer_AndIsStable)
+    {
+        auto bitmaps = MakeBitmaps(3);
+        std::sort(bitmaps.begin(), bitmaps.end(),
+            [] (auto const& a, auto const& b)
+            {
+                return a.Get() < b.Get();
+            });
+
+        std::vector<TestSprite> sprites;
+        sprites.emplace_back(bitmaps[2], 0);
+        sprites.emplace_back(bitmaps[0], 1);
+        sprites.emplace_back(bitmaps[1], 2);
+        sprites.emplace_back(bitmaps[2], 3);
+        sprites.emplace_back(bitmaps[0], 4);
+        sprites.emplace_back(bitmaps[0], 5);
+        sprites.emplace_back(bitmaps[1], 6);
+
+        SpriteSorter::SortByBitmap(sprites);
+
+        uint32_t expectedIds[] = { 1, 4, 5, 2, 6, 0, 3 };
+        Assert::AreEqual(_countof(expectedIds), sprites.size());
+
+        for (size_t i = 0; i < sprites.size(); ++i)
+            Assert::AreEqual(expectedIds[i], sprites[i].Id);
+    }
+
+    TEST_METHOD_EX(SpriteSorter_MatchesStableSort)
+    {
+        ValidateAgainstReferenceSort(2, 1000);
+        ValidateAgainstReferenceSort(40, 5000);
+    }
+
+    TEST_METHOD_EX(SpriteSorter_MatchesStableSort_WhenThereAreMoreBitmapsThanFitInOneRadixDigit)
+    {
+        ValidateAgainstReferenceSort(300, 5000);
+    }
+
+    TEST_METHOD_EX(SpriteSorter_SortByLayerAndBitmap_SortsByLayerThenBitmap_AndIsStable)
+    {
+        auto bitmaps = MakeBitmaps(2);
+        std::sort(bitmaps.begin(), bitmaps.end(),
+            [] (auto const& a, auto const& b)
+            {
+                return a.Get() < b.Get();
+            });
+
+        std::vector<TestSprite> sprites;
+        sprites.emplace_back(bitmaps[1], 0, 5);
+        sprites.emplace_back(bitmaps[0], 1, 5);
+        sprites.emplace_back(bitmaps[1], 2, -2);
+        sprites.emplace_back(bitmaps[1], 3, 5);
+        sprites.emplace_back(bitmaps[0], 4, -2);
+        sprites.emplace_back(bitmaps[0], 5, 0);
+        sprites.emplace_back(bitmaps[0], 6, 5);
+
+        SpriteSorter::SortByLayerAndBitmap(sprites);
+
+        uint32_t expectedIds[] = { 4, 2, 5, 1, 6, 0, 3 };
+        Assert::AreEqual(_countof(expectedIds), sprites.size());
+
+        for (size_t i = 0; i < sprites.size(); ++i)
+            Assert::AreEqual(expectedIds[i], sprites[i].Id);
+    }
+
+    TEST_METHOD_EX(SpriteSorter_SortByLayerAndBitmap_MatchesStableSort)
+    {
+        // From a handful of layers up to ones that span the whole int32 range
+        int32_t const layerRanges[] = { 1, 3, 1000, std::numeric_limits<int32_t>::max() };
+
+        for (auto layerRange : layerRanges)
+        {
+            std::mt19937 random(layerRange);
+            std::uniform_int_distribution<int32_t> layer(-layerRange, layerRange);
+
+            auto bitmaps = MakeBitmaps(40);
+            auto sprites = MakeSpriteStream(bitmaps, 5000);
+            for (auto& sprite : sprites)
+                sprite.Layer = layer(random);
+
+            auto expected = sprites;
+
+            ReferenceSortByLayer(expected);
+            SpriteSorter::SortByLayerAndBitmap(sprites);
+
+            AssertSameOrder(expected, sprites);
+        }
+    }
+
+    //
+    // Compares the radix sort with the stable_sort it replaced.  This only
+    // reports timings; the pass / fail result just checks that the two sorts
+    // agree.
+    //
+    PERF_TEST_METHOD_EX(SpriteSorter_Benchmark)
+    {
+        struct Scenario
+        {
+            size_t BitmapCount;
+            uint32_t SpriteCount;
+        };
+
+        Scenario scenarios[] =
+        {
+            {  4,  1000 },
+            { 40, 50000 },
+            { 500, 50000 },
+        };
+
+        int const iterations = 5;
+
+        for (auto const& scenario : scenarios)
+        {
+            auto bitmaps = MakeBitmaps(scenario.BitmapCount);
+            auto const original = MakeSpriteStream(bitmaps, scenario.SpriteCount);
+
+            std::chrono::duration<double, std::milli> referenceTime{};
+            std::chrono::duration<double, std::milli> radixTime{};
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                auto expected = original;
+                auto start = std::chrono::high_resolution_clock::now();
+                ReferenceSort(expected);
+                referenceTime += std::chrono::high_resolution_clock::now() - start;
+
+                auto actual = original;
+                start = std::chrono::high_resolution_clock::now();
+                SpriteSorter::SortByBitmap(actual);
+                radixTime += std::chrono::high_resolution_clock::now() - start;
+
+                AssertSameOrder(expected, actual);
+            }
+
+            wchar_t message[200];
+            ThrowIfFailed(StringCchPrintf(message, _countof(message),
+                L"%u sprites, %u bitmaps: stable_sort %.3fms, SpriteSorter %.3fms\n",
+                scenario.SpriteCount,
+                static_cast<uint32_t>(scenario.BitmapCount),
+                referenceTime.count() / iterations,
+                radixTime.count() / iterations));
+
+            Logger::WriteMessage(message);
+        }
+    }
+};
@@ -57,6 +57,11 @@ namespace canvas
 
         CALL_COUNTER_WITH_MOCK(LeaseHistogramEffectMethod, HistogramAndAtlasEffects(ID2D1DeviceContext*));
         CALL_COUNTER_WITH_MOCK(ReleaseHistogramEffectMethod, void(HistogramAndAtlasEffects));
+        CALL_COUNTER_WITH_MOCK(LeaseExtraHistogramEffectMethod, ComPtr<ID2D1Effect>(ID2D1DeviceContext*));
+        CALL_COUNTER_WITH_MOCK(ReleaseExtraHistogramEffectMethod, void(ComPtr<ID2D1Effect>));
+
+        CALL_COUNTER_WITH_MOCK(LeaseDrawImageEffectMethod, ComPtr<ID2D1Effect>(ID2D1DeviceContext*, IID const&));
+        CALL_COUNTER_WITH_MOCK(ReleaseDrawImageEffectMethod, void(IID const&, ComPtr<ID2D1Effect>));
 
         CALL_COUNTER_WITH_MOCK(IsBufferPrecisionSupportedMethod, HRESULT(CanvasBufferPrecision, boolean*));
 
@@ -71,11 +76,19 @@ namespace canvas
 
         CALL_COUNTER_WITH_MOCK(IsDeviceLostMethod, HRESULT(int, boolean*));
 
+        // The cache has no interesting behavior to mock, so a real one is used
+        Effects::RealizedEffectCache m_realizedEffectCache;
+
 #if WINVER > _WIN32_WINNT_WINBLUE
         CALL_COUNTER_WITH_MOCK(CreateGradientMeshMethod, ComPtr<ID2D1GradientMesh>(D2D1_GRADIENT_MESH_PATCH const*, UINT32));
         CALL_COUNTER_WITH_MOCK(IsSpriteBatchQuirkRequiredMethod, bool());
 
         CALL_COUNTER_WITH_MOCK(CreateSvgDocumentMethod, ComPtr<ID2D1SvgDocument>(IStream*));
+
+        CALL_COUNTER_WITH_MOCK(InsertGpuFenceMethod, std::unique_ptr<GpuFence>());
+
+        // The pool has no interesting behavior to mock, so a real one is used
+        SpriteBufferPool m_spriteBufferPool;
 #endif
 
         //
@@ -129,6 +142,18 @@ namespace canvas
             return E_NOTIMPL;
         }
 
+        IFACEMETHODIMP get_EffectCacheStatistics(CanvasEffectCacheStatistics* value) override
+        {
+            Assert::Fail(L"Unexpected call to get_EffectCacheStatistics");
+            return E_NOTIMPL;
+        }
+
+        IFACEMETHODIMP get_GradientStopCacheStatistics(CanvasGradientStopCacheStatistics* value) override
+        {
+            Assert::Fail(L"Unexpected call to get_GradientStopCacheStatistics");
+            return E_NOTIMPL;
+        }
+
         IFACEMETHODIMP add_DeviceLost(
             DeviceLostHandlerType* value,
             EventRegistrationToken* token)
@@ -405,6 +430,31 @@ namespace canvas
             return ReleaseHistogramEffectMethod.WasCalled(effects);
         }
 
+        virtual ComPtr<ID2D1Effect> LeaseExtraHistogramEffect(ID2D1DeviceContext* d2dContext) override
+        {
+            return LeaseExtraHistogramEffectMethod.WasCalled(d2dContext);
+        }
+
+        virtual void ReleaseExtraHistogramEffect(ComPtr<ID2D1Effect>&& effect) override
+        {
+            return ReleaseExtraHistogramEffectMethod.WasCalled(effect);
+        }
+
+        virtual ComPtr<ID2D1Effect> LeaseDrawImageEffect(ID2D1DeviceContext* d2dContext, IID const& effectId) override
+        {
+            return LeaseDrawImageEffectMethod.WasCalled(d2dContext, effectId);
+        }
+
+        virtual void ReleaseDrawImageEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect) override
+        {
+            return ReleaseDrawImageEffectMethod.WasCalled(effectId, effect);
+        }
+
+        virtual Effects::RealizedEffectCache& GetRealizedEffectCache() override
+        {
+            return m_realizedEffectCache;
+        }
+
 #if WINVER > _WIN32_WINNT_WINBLUE
         virtual ComPtr<ID2D1GradientMesh> CreateGradientMesh(
             D2D1_GRADIENT_MESH_PATCH const* patches,
@@ -418,10 +468,20 @@ namespace canvas
             return IsSpriteBatchQuirkRequiredMethod.WasCalled();
         }
 
+        virtual SpriteBufferPool& GetSpriteBufferPool() override
+        {
+            return m_spriteBufferPool;
+        }
+
         ComPtr<ID2D1SvgDocument> CreateSvgDocument(IStream* inputXmlStream)
         {
             return CreateSvgDocumentMethod.WasCalled(inputXmlStream);
         }
+
+        std::unique_ptr<GpuFence> InsertGpuFence()
+        {
+            return InsertGpuFenceMethod.WasCalled();
+        }
 #endif
     };
 }
@@ -32,6 +32,18 @@
     }                                                                           \
     void METHOD_NAME##_()
 
+//
+// PERF_TEST_METHOD_EX is TEST_METHOD_EX for benchmarks that report timings.
+// These are put in the "Perf" test category, which the automated test run
+// (see Win2D.proj) leaves out.  Run them from Test Explorer, or with
+// vstest.console /TestCaseFilter:TestCategory=Perf.
+//
+#define PERF_TEST_METHOD_EX(METHOD_NAME)                                        \
+    BEGIN_TEST_METHOD_ATTRIBUTE(METHOD_NAME)                                    \
+        TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Perf")                         \
+    END_TEST_METHOD_ATTRIBUTE()                                                 \
+    TEST_METHOD_EX(METHOD_NAME)
+
 //
 // CALL_COUNTER defines a member variable that can be used to count how many
 // times a method is called. eg:
@@ -24,6 +24,7 @@ namespace canvas
         ComPtr<MockD3D11Device> m_d3dDevice;
         ComPtr<MockEventSource<DeviceLostHandlerType>> m_deviceLostEventSource;
         DeviceContextPool m_deviceContextPool;
+        std::vector<std::pair<IID, ComPtr<ID2D1Effect>>> m_drawImageEffects;
         
     public:
         StubCanvasDevice(ComPtr<ID2D1Device1> device = Make<StubD2DDevice>(), ComPtr<MockD3D11Device> d3dDevice = nullptr)
@@ -93,6 +94,33 @@ namespace canvas
                     return S_OK;
                 });
 
+            LeaseDrawImageEffectMethod.AllowAnyCall(
+                [=](ID2D1DeviceContext* d2dContext, IID const& effectId)
+                {
+                    ComPtr<ID2D1Effect> effect;
+
+                    auto it = std::find_if(m_drawImageEffects.begin(), m_drawImageEffects.end(),
+                        [&](std::pair<IID, ComPtr<ID2D1Effect>> const& entry) { return entry.first == effectId; });
+
+                    if (it != m_drawImageEffects.end())
+                    {
+                        effect = it->second;
+                        m_drawImageEffects.erase(it);
+                    }
+                    else
+                    {
+                        ThrowIfFailed(d2dContext->CreateEffect(effectId, &effect));
+                    }
+
+                    return effect;
+                });
+
+            ReleaseDrawImageEffectMethod.AllowAnyCall(
+                [=](IID const& effectId, ComPtr<ID2D1Effect> effect)
+                {
+                    m_drawImageEffects.emplace_back(effectId, effect);
+                });
+
 #if WINVER > _WIN32_WINNT_WINBLUE
             CreateGradientMeshMethod.AllowAnyCall(
                 [=](D2D1_GRADIENT_MESH_PATCH const*, UINT32)
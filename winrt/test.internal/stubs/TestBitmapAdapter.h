@@ -35,6 +35,12 @@ public:
     {
         return source;
     }
+
+    virtual ComPtr<IWICBitmapSource> DecodeToMemory(
+            ComPtr<IWICBitmapSource> const& source) override
+    {
+        return source;
+    }
 };
 
 
@@ -325,6 +325,103 @@ TEST_CLASS(AsyncOperationTests)
     }
 
 
+    TEST_METHOD_EX(AsyncCompletedByOwnerTest)
+    {
+        MockAsyncResult expectedResult;
+
+        auto async = Make<AsyncOperation<MockAsyncResult>>();
+
+        bool hasCallbackFired = false;
+
+        auto completedCallback = Callback<IAsyncOperationCompletedHandler<MockAsyncResult*>>([&](IAsyncOperation<MockAsyncResult*>*, AsyncStatus status)
+        {
+            Assert::IsFalse(hasCallbackFired);
+            hasCallbackFired = true;
+
+            Assert::AreEqual(AsyncStatus::Completed, status);
+            return S_OK;
+        });
+
+        ThrowIfFailed(async->put_Completed(completedCallback.Get()));
+
+        // Nothing happens until the owner says so.
+        AsyncStatus status = (AsyncStatus)-1;
+        ThrowIfFailed(async->get_Status(&status));
+        Assert::AreEqual(AsyncStatus::Started, status);
+        Assert::IsTrue(async->ShouldContinue());
+        Assert::IsFalse(hasCallbackFired);
+
+        async->Complete(&expectedResult);
+
+        Assert::IsTrue(hasCallbackFired);
+        Assert::IsFalse(async->ShouldContinue());
+
+        ComPtr<MockAsyncResult> result;
+        ThrowIfFailed(async->GetResults(&result));
+        Assert::AreEqual<void*>(&expectedResult, result.Get());
+    }
+
+
+    TEST_METHOD_EX(AsyncFailedByOwnerTest)
+    {
+        auto async = Make<AsyncOperation<MockAsyncResult>>();
+
+        bool hasCallbackFired = false;
+
+        auto completedCallback = Callback<IAsyncOperationCompletedHandler<MockAsyncResult*>>([&](IAsyncOperation<MockAsyncResult*>*, AsyncStatus status)
+        {
+            hasCallbackFired = true;
+
+            Assert::AreEqual(AsyncStatus::Error, status);
+            return S_OK;
+        });
+
+        ThrowIfFailed(async->put_Completed(completedCallback.Get()));
+
+        async->Fail(E_NOTIMPL);
+
+        Assert::IsTrue(hasCallbackFired);
+
+        HRESULT errorCode = S_OK;
+        ThrowIfFailed(async->get_ErrorCode(&errorCode));
+        Assert::AreEqual(E_NOTIMPL, errorCode);
+    }
+
+
+    TEST_METHOD_EX(AsyncCanceledBeforeOwnerCompletesTest)
+    {
+        MockAsyncResult expectedResult;
+
+        auto async = Make<AsyncOperation<MockAsyncResult>>();
+
+        bool hasCallbackFired = false;
+
+        auto completedCallback = Callback<IAsyncOperationCompletedHandler<MockAsyncResult*>>([&](IAsyncOperation<MockAsyncResult*>*, AsyncStatus status)
+        {
+            hasCallbackFired = true;
+
+            Assert::AreEqual(AsyncStatus::Canceled, status);
+            return S_OK;
+        });
+
+        ThrowIfFailed(async->put_Completed(completedCallback.Get()));
+
+        async->Cancel();
+
+        // The owner can see that there is no point doing the work.
+        Assert::IsFalse(async->ShouldContinue());
+        Assert::IsFalse(hasCallbackFired);
+
+        async->Complete(&expectedResult);
+
+        Assert::IsTrue(hasCallbackFired);
+
+        AsyncStatus status = (AsyncStatus)-1;
+        ThrowIfFailed(async->get_Status(&status));
+        Assert::AreEqual(AsyncStatus::Canceled, status);
+    }
+
+
     TEST_METHOD_EX(AsyncContinuationTest)
     {
         MockAsyncResult result1, result2;
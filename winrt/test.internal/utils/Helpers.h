@@ -975,6 +975,16 @@ namespace Microsoft
                 END_ENUM(CanvasAlphaMode);
             }
 
+#if WINVER > _WIN32_WINNT_WINBLUE
+            ENUM_TO_STRING(CanvasBitmapLockMode)
+            {
+                ENUM_VALUE(CanvasBitmapLockMode::Read);
+                ENUM_VALUE(CanvasBitmapLockMode::Write);
+                ENUM_VALUE(CanvasBitmapLockMode::ReadWrite);
+                END_ENUM(CanvasBitmapLockMode);
+            }
+#endif
+
             ENUM_TO_STRING(CanvasColorSpace)
             {
                 ENUM_VALUE(CanvasColorSpace::Custom);
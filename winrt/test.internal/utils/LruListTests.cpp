@@ -0,0 +1,111 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "../lib/utils/LruList.h"
+
+using namespace ABI::Microsoft::Graphics::Canvas;
+
+TEST_CLASS(LruListTests)
+{
+    typedef LruList<int> IntList;
+
+    static IntList::iterator Find(IntList& list, size_t hash, int value)
+    {
+        return list.Find(hash, [=](int candidate) { return candidate == value; });
+    }
+
+    static std::vector<int> GetValues(IntList& list)
+    {
+        std::vector<int> values;
+
+        for (auto& entry : list)
+            values.push_back(entry.Value);
+
+        return values;
+    }
+
+    TEST_METHOD_EX(LruList_Find_MatchesOnHashAndPredicate)
+    {
+        IntList list;
+
+        // 1 and 2 share a hash, so only the predicate tells them apart
+        list.AddToFront(10, 1);
+        list.AddToFront(10, 2);
+        list.AddToFront(20, 3);
+
+        Assert::AreEqual(1, Find(list, 10, 1)->Value);
+        Assert::AreEqual(2, Find(list, 10, 2)->Value);
+        Assert::AreEqual(3, Find(list, 20, 3)->Value);
+
+        Assert::IsTrue(Find(list, 20, 1) == list.end());
+        Assert::IsTrue(Find(list, 30, 3) == list.end());
+    }
+
+    TEST_METHOD_EX(LruList_MoveToFront_ChangesWhichEntryIsOldest)
+    {
+        IntList list;
+
+        list.AddToFront(1, 1);
+        list.AddToFront(2, 2);
+        list.AddToFront(3, 3);
+
+        Assert::AreEqual(1, list.Oldest());
+
+        list.MoveToFront(Find(list, 1, 1));
+
+        Assert::AreEqual(2, list.Oldest());
+        Assert::IsTrue(std::vector<int>{ 1, 3, 2 } == GetValues(list));
+    }
+
+    TEST_METHOD_EX(LruList_Remove_OnlyUnindexesThatEntry)
+    {
+        IntList list;
+
+        // Two entries with the same hash and value
+        list.AddToFront(1, 7);
+        auto second = list.AddToFront(1, 7);
+
+        list.Remove(second);
+
+        Assert::AreEqual(size_t(1), list.Size());
+
+        auto remaining = Find(list, 1, 7);
+        Assert::IsTrue(remaining != list.end());
+
+        list.Remove(remaining);
+
+        Assert::AreEqual(size_t(0), list.Size());
+        Assert::IsTrue(Find(list, 1, 7) == list.end());
+    }
+
+    TEST_METHOD_EX(LruList_TrimToCount_DiscardsOldestEntries)
+    {
+        IntList list;
+
+        for (int i = 0; i < 5; ++i)
+            list.AddToFront(i % 2, i);
+
+        list.TrimToCount(2);
+
+        Assert::IsTrue(std::vector<int>{ 4, 3 } == GetValues(list));
+
+        for (int i = 0; i < 3; ++i)
+            Assert::IsTrue(Find(list, i % 2, i) == list.end());
+
+        Assert::AreEqual(4, Find(list, 0, 4)->Value);
+        Assert::AreEqual(3, Find(list, 1, 3)->Value);
+    }
+
+    TEST_METHOD_EX(LruList_Clear_EmptiesListAndIndex)
+    {
+        IntList list;
+
+        list.AddToFront(1, 1);
+        list.Clear();
+
+        Assert::AreEqual(size_t(0), list.Size());
+        Assert::IsTrue(Find(list, 1, 1) == list.end());
+    }
+};
@@ -0,0 +1,236 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <chrono>
+
+#include <lib/utils/PixelConversion.h>
+
+using namespace PixelConversion;
+
+TEST_CLASS(PixelConversionUnitTests)
+{
+public:
+    static std::vector<Kernel> GetSupportedKernels()
+    {
+        std::vector<Kernel> kernels;
+
+        for (auto kernel : { Kernel::Scalar, Kernel::Sse2, Kernel::Ssse3, Kernel::Avx2, Kernel::Neon })
+        {
+            if (IsKernelSupported(kernel))
+                kernels.push_back(kernel);
+        }
+
+        return kernels;
+    }
+
+    static wchar_t const* GetKernelName(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::Scalar: return L"Scalar";
+        case Kernel::Sse2:   return L"SSE2";
+        case Kernel::Ssse3:  return L"SSSE3";
+        case Kernel::Avx2:   return L"AVX2";
+        case Kernel::Neon:   return L"NEON";
+        default:             return L"?";
+        }
+    }
+
+    //
+    // Every conversion moves each byte to a position that depends only on
+    // where it is within its pixel, so giving every byte position every
+    // possible value covers all inputs.  Pixel i holds i, i+1, i+2 and i+3.
+    //
+    static std::vector<uint8_t> MakeTestPixels(size_t pixelCount)
+    {
+        std::vector<uint8_t> bytes(pixelCount * 4);
+
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            for (size_t j = 0; j < 4; j++)
+            {
+                bytes[i * 4 + j] = static_cast<uint8_t>(i + j);
+            }
+        }
+
+        return bytes;
+    }
+
+    // Enough pixels for every value at every position, and then some, so
+    // that every kernel runs both its vector loop and its tail.
+    static size_t const TestPixelCount = 256 + 13;
+
+    TEST_METHOD_EX(PixelConversion_GetBestKernel_IsSupported)
+    {
+        Assert::IsTrue(IsKernelSupported(Kernel::Scalar));
+        Assert::IsTrue(IsKernelSupported(GetBestKernel()));
+    }
+
+    TEST_METHOD_EX(PixelConversion_BgraToColors)
+    {
+        auto source = MakeTestPixels(TestPixelCount);
+
+        for (auto kernel : GetSupportedKernels())
+        {
+            std::vector<Color> colors(TestPixelCount);
+
+            BgraToColors(kernel, source.data(), colors.data(), TestPixelCount);
+
+            for (size_t i = 0; i < TestPixelCount; i++)
+            {
+                Assert::AreEqual(source[i * 4 + 0], colors[i].B, GetKernelName(kernel));
+                Assert::AreEqual(source[i * 4 + 1], colors[i].G, GetKernelName(kernel));
+                Assert::AreEqual(source[i * 4 + 2], colors[i].R, GetKernelName(kernel));
+                Assert::AreEqual(source[i * 4 + 3], colors[i].A, GetKernelName(kernel));
+            }
+        }
+    }
+
+    TEST_METHOD_EX(PixelConversion_ColorsToBgra)
+    {
+        auto source = MakeTestPixels(TestPixelCount);
+        auto colors = reinterpret_cast<Color const*>(source.data());
+
+        for (auto kernel : GetSupportedKernels())
+        {
+            std::vector<uint8_t> bytes(TestPixelCount * 4);
+
+            ColorsToBgra(kernel, colors, bytes.data(), TestPixelCount);
+
+            for (size_t i = 0; i < TestPixelCount; i++)
+            {
+                Assert::AreEqual(colors[i].B, bytes[i * 4 + 0], GetKernelName(kernel));
+                Assert::AreEqual(colors[i].G, bytes[i * 4 + 1], GetKernelName(kernel));
+                Assert::AreEqual(colors[i].R, bytes[i * 4 + 2], GetKernelName(kernel));
+                Assert::AreEqual(colors[i].A, bytes[i * 4 + 3], GetKernelName(kernel));
+            }
+        }
+    }
+
+    TEST_METHOD_EX(PixelConversion_ColorsToRgba)
+    {
+        auto source = MakeTestPixels(TestPixelCount);
+        auto colors = reinterpret_cast<Color const*>(source.data());
+
+        for (auto kernel : GetSupportedKernels())
+        {
+            std::vector<uint8_t> bytes(TestPixelCount * 4);
+
+            ColorsToRgba(kernel, colors, bytes.data(), TestPixelCount);
+
+            for (size_t i = 0; i < TestPixelCount; i++)
+            {
+                Assert::AreEqual(colors[i].R, bytes[i * 4 + 0], GetKernelName(kernel));
+                Assert::AreEqual(colors[i].G, bytes[i * 4 + 1], GetKernelName(kernel));
+                Assert::AreEqual(colors[i].B, bytes[i * 4 + 2], GetKernelName(kernel));
+                Assert::AreEqual(colors[i].A, bytes[i * 4 + 3], GetKernelName(kernel));
+            }
+        }
+    }
+
+    //
+    // The vector kernels must match the scalar one for every length (so
+    // every split between vector loop and tail) and every alignment, and
+    // must not write past the end of the destination.
+    //
+    TEST_METHOD_EX(PixelConversion_AllKernelsMatchScalar_ForAllLengthsAndAlignments)
+    {
+        size_t const maxPixelCount = 70;
+        uint8_t const guard = 0xCD;
+
+        auto source = MakeTestPixels(maxPixelCount + 1);
+
+        for (auto kernel : GetSupportedKernels())
+        {
+            for (size_t offset = 0; offset < 4; offset++)
+            {
+                for (size_t pixelCount = 0; pixelCount <= maxPixelCount; pixelCount++)
+                {
+                    auto sourceBytes = source.data() + offset;
+                    auto sourceColors = reinterpret_cast<Color const*>(sourceBytes);
+
+                    std::vector<uint8_t> expected(pixelCount * 4 + offset + 4, guard);
+                    std::vector<uint8_t> actual(pixelCount * 4 + offset + 4, guard);
+
+                    auto expectedBytes = expected.data() + offset;
+                    auto actualBytes = actual.data() + offset;
+
+                    BgraToColors(Kernel::Scalar, sourceBytes, reinterpret_cast<Color*>(expectedBytes), pixelCount);
+                    BgraToColors(kernel, sourceBytes, reinterpret_cast<Color*>(actualBytes), pixelCount);
+                    Assert::IsTrue(expected == actual, GetKernelName(kernel));
+
+                    ColorsToBgra(Kernel::Scalar, sourceColors, expectedBytes, pixelCount);
+                    ColorsToBgra(kernel, sourceColors, actualBytes, pixelCount);
+                    Assert::IsTrue(expected == actual, GetKernelName(kernel));
+
+                    ColorsToRgba(Kernel::Scalar, sourceColors, expectedBytes, pixelCount);
+                    ColorsToRgba(kernel, sourceColors, actualBytes, pixelCount);
+                    Assert::IsTrue(expected == actual, GetKernelName(kernel));
+
+                    Assert::AreEqual(guard, actual.back(), GetKernelName(kernel));
+                }
+            }
+        }
+    }
+
+    TEST_METHOD_EX(PixelConversion_InPlaceConversionMatchesScalar)
+    {
+        auto source = MakeTestPixels(TestPixelCount);
+
+        std::vector<uint8_t> expected(TestPixelCount * 4);
+        ColorsToRgba(Kernel::Scalar, reinterpret_cast<Color const*>(source.data()), expected.data(), TestPixelCount);
+
+        for (auto kernel : GetSupportedKernels())
+        {
+            auto buffer = source;
+
+            ColorsToRgba(kernel, reinterpret_cast<Color const*>(buffer.data()), buffer.data(), TestPixelCount);
+
+            Assert::IsTrue(expected == buffer, GetKernelName(kernel));
+        }
+    }
+
+    //
+    // Times each kernel converting a 4K frame.  This only reports timings.
+    //
+    PERF_TEST_METHOD_EX(PixelConversion_Benchmark)
+    {
+        size_t const pixelCount = 3840 * 2160;
+        int const iterations = 10;
+
+        auto source = MakeTestPixels(pixelCount);
+        std::vector<Color> colors(pixelCount);
+        std::vector<uint8_t> bytes(pixelCount * 4);
+
+        for (auto kernel : GetSupportedKernels())
+        {
+            std::chrono::duration<double, std::milli> getTime{};
+            std::chrono::duration<double, std::milli> setTime{};
+
+            for (int i = 0; i < iterations; i++)
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                BgraToColors(kernel, source.data(), colors.data(), pixelCount);
+                getTime += std::chrono::high_resolution_clock::now() - start;
+
+                start = std::chrono::high_resolution_clock::now();
+                ColorsToBgra(kernel, colors.data(), bytes.data(), pixelCount);
+                setTime += std::chrono::high_resolution_clock::now() - start;
+            }
+
+            Assert::IsTrue(source == bytes);
+
+            wchar_t message[200];
+            ThrowIfFailed(StringCchPrintf(message, _countof(message),
+                L"%s: BgraToColors %.3fms, ColorsToBgra %.3fms per 3840x2160 frame\n",
+                GetKernelName(kernel),
+                getTime.count() / iterations,
+                setTime.count() / iterations));
+
+            Logger::WriteMessage(message);
+        }
+    }
+};
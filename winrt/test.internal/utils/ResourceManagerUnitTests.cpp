@@ -4,6 +4,8 @@
 
 #include "pch.h"
 
+#include <chrono>
+
 namespace
 {
     class __declspec(uuid("92378CDA-713F-416D-99EE-EC0DFF5D238E"))
@@ -17,6 +19,68 @@ namespace
     };
 
 
+    class CountingDummyResource : public DummyResource
+    {
+    public:
+        static int QueryCount;
+
+        STDMETHOD(QueryInterface)(REFIID riid, void** ppvObject) override
+        {
+            ++QueryCount;
+            return DummyResource::QueryInterface(riid, ppvObject);
+        }
+    };
+
+    int CountingDummyResource::QueryCount;
+
+
+    class ChoosyDummyResource : public RuntimeClass<RuntimeClassFlags<ClassicCom>, IDummyResource>
+    {
+    public:
+        bool IsWrappable;
+
+        ChoosyDummyResource(bool isWrappable)
+            : IsWrappable(isWrappable)
+        { }
+    };
+
+
+    bool IsWrappableChoosyResource(IDummyResource* resource)
+    {
+        return static_cast<ChoosyDummyResource*>(resource)->IsWrappable;
+    }
+
+    class __declspec(uuid("5C0B9E2A-3F47-4D6B-9A18-7E2D4C61B0F3"))
+    IOtherDummyResource : public IDummyResource
+    {
+    };
+
+    // Every instance shares a vtable, but each answers QueryInterface for
+    // only one of the two interfaces.
+    class ShapeShiftingDummyResource : public RuntimeClass<RuntimeClassFlags<ClassicCom>, ChainInterfaces<IOtherDummyResource, IDummyResource>>
+    {
+        bool m_isOther;
+
+    public:
+        ShapeShiftingDummyResource(bool isOther)
+            : m_isOther(isOther)
+        { }
+
+        STDMETHOD(QueryInterface)(REFIID riid, void** ppvObject) override
+        {
+            auto hiddenIid = m_isOther ? __uuidof(IDummyResource) : __uuidof(IOtherDummyResource);
+
+            if (riid == hiddenIid)
+            {
+                *ppvObject = nullptr;
+                return E_NOINTERFACE;
+            }
+
+            return RuntimeClass::QueryInterface(riid, ppvObject);
+        }
+    };
+
+
     class __declspec(uuid("B7E157E0-99C7-463B-8DDC-F72B10221FEC"))
     IDummyWrapper : public IInspectable
     {
@@ -38,7 +102,7 @@ namespace
         DummyWrapper(IDummyResource* resource)
             : ResourceWrapper(resource)
         {
-            static int nextId = 1;
+            static std::atomic<int> nextId(1);
             m_id = nextId++;
         }
 
@@ -391,6 +455,212 @@ TEST_CLASS(ResourceManagerUnitTests)
 
         ValidateStoredErrorState(E_NOINTERFACE, Strings::ResourceManagerUnknownType);
     }
+
+    TEST_METHOD_EX(ResourceManager_GetOrCreate_SecondResourceOfAType_SkipsTryCreateFunctionsThatDidNotMatch)
+    {
+        // This goes on the end of the table, after all the built in types.
+        auto tryCreateDummyResource = ResourceManager::TryCreate<IDummyResource, DummyWrapper, ResourceManager::MakeWrapper>;
+        ResourceManager::RegisterType(tryCreateDummyResource);
+        auto restoreTypeTable = MakeScopeWarden([&] { ResourceManager::UnregisterType(tryCreateDummyResource); });
+
+        auto countQueriesToWrap = [&]
+        {
+            auto resource = Make<CountingDummyResource>();
+
+            CountingDummyResource::QueryCount = 0;
+            auto wrapper = ResourceManager::GetOrCreate<IDummyWrapper>(resource.Get());
+            Assert::IsNotNull(wrapper.Get());
+
+            return CountingDummyResource::QueryCount;
+        };
+
+        auto firstQueryCount = countQueriesToWrap();
+        auto secondQueryCount = countQueriesToWrap();
+        auto thirdQueryCount = countQueriesToWrap();
+
+        wchar_t message[200];
+        ThrowIfFailed(StringCchPrintf(message, _countof(message),
+            L"QueryInterface calls to wrap a resource: %d the first time, %d after that\n",
+            firstQueryCount,
+            secondQueryCount));
+
+        Logger::WriteMessage(message);
+
+        Assert::IsTrue(secondQueryCount < firstQueryCount);
+        Assert::AreEqual(secondQueryCount, thirdQueryCount);
+    }
+
+    TEST_METHOD_EX(ResourceManager_GetOrCreate_TesterRejection_IsNotRememberedForOtherResourcesOfTheSameType)
+    {
+        auto tryCreateChoosyResource = ResourceManager::TryCreate<IDummyResource, DummyWrapper, ResourceManager::MakeWrapper, IsWrappableChoosyResource>;
+        ResourceManager::RegisterType(tryCreateChoosyResource);
+        auto restoreTypeTable = MakeScopeWarden([&] { ResourceManager::UnregisterType(tryCreateChoosyResource); });
+
+        auto unwrappableResource = Make<ChoosyDummyResource>(false);
+        auto wrappableResource = Make<ChoosyDummyResource>(true);
+
+        ExpectHResultException(E_NOINTERFACE, [&]
+        {
+            ResourceManager::GetOrCreate(nullptr, unwrappableResource.Get(), 0);
+        });
+
+        auto wrapper = ResourceManager::GetOrCreate<IDummyWrapper>(wrappableResource.Get());
+        Assert::IsNotNull(wrapper.Get());
+
+        ExpectHResultException(E_NOINTERFACE, [&]
+        {
+            ResourceManager::GetOrCreate(nullptr, Make<ChoosyDummyResource>(false).Get(), 0);
+        });
+    }
+
+    TEST_METHOD_EX(ResourceManager_GetOrCreate_WhenTheRememberedCandidateDoesNotMatch_SearchesTheWholeTable)
+    {
+        auto tryCreateDummyResource = ResourceManager::TryCreate<IDummyResource, DummyWrapper, ResourceManager::MakeWrapper>;
+        auto tryCreateOtherResource = ResourceManager::TryCreate<IOtherDummyResource, DummyWrapper, ResourceManager::MakeWrapper>;
+
+        ResourceManager::RegisterType(tryCreateDummyResource);
+        auto restoreDummyType = MakeScopeWarden([&] { ResourceManager::UnregisterType(tryCreateDummyResource); });
+
+        ResourceManager::RegisterType(tryCreateOtherResource);
+        auto restoreOtherType = MakeScopeWarden([&] { ResourceManager::UnregisterType(tryCreateOtherResource); });
+
+        // Remembers tryCreateOtherResource as the first candidate for this vtable
+        auto otherResource = Make<ShapeShiftingDummyResource>(true);
+        Assert::IsNotNull(ResourceManager::GetOrCreate<IDummyWrapper>(otherResource.Get()).Get());
+
+        // Only the earlier tryCreateDummyResource recognizes this one
+        auto dummyResource = Make<ShapeShiftingDummyResource>(false);
+        Assert::IsNotNull(ResourceManager::GetOrCreate<IDummyWrapper>(dummyResource.Get()).Get());
+
+        // And both kinds still work afterwards
+        Assert::IsNotNull(ResourceManager::GetOrCreate<IDummyWrapper>(Make<ShapeShiftingDummyResource>(true).Get()).Get());
+        Assert::IsNotNull(ResourceManager::GetOrCreate<IDummyWrapper>(Make<ShapeShiftingDummyResource>(false).Get()).Get());
+    }
+
+    TEST_METHOD_EX(ResourceManager_RegisterType_IsSeenByTypesThatWereAlreadyLookedUp)
+    {
+        auto resource = Make<DummyResource>();
+
+        ExpectHResultException(E_NOINTERFACE, [&]
+        {
+            ResourceManager::GetOrCreate(nullptr, resource.Get(), 0);
+        });
+
+        auto tryCreateDummyResource = ResourceManager::TryCreate<IDummyResource, DummyWrapper, ResourceManager::MakeWrapper>;
+        ResourceManager::RegisterType(tryCreateDummyResource);
+        auto restoreTypeTable = MakeScopeWarden([&] { ResourceManager::UnregisterType(tryCreateDummyResource); });
+
+        auto wrapper = ResourceManager::GetOrCreate<IDummyWrapper>(resource.Get());
+        Assert::IsNotNull(wrapper.Get());
+    }
+
+    TEST_METHOD_EX(ResourceManager_ResourcesAreSpreadAcrossShards)
+    {
+        std::vector<ComPtr<DummyResource>> resources;
+        std::vector<int> resourcesPerShard(ResourceManager::ShardCount);
+
+        for (size_t i = 0; i < ResourceManager::ShardCount * 16; ++i)
+        {
+            resources.push_back(Make<DummyResource>());
+
+            auto shardIndex = ResourceManager::GetShardIndex(As<IUnknown>(resources.back()).Get());
+            Assert::IsTrue(shardIndex < ResourceManager::ShardCount);
+
+            ++resourcesPerShard[shardIndex];
+        }
+
+        for (auto count : resourcesPerShard)
+        {
+            Assert::AreNotEqual(0, count);
+        }
+    }
+
+    TEST_METHOD_EX(ResourceManager_GetOrCreate_FromManyThreads_AllGetTheSameWrapper)
+    {
+        auto tryCreateDummyResource = ResourceManager::TryCreate<IDummyResource, DummyWrapper, ResourceManager::MakeWrapper>;
+        ResourceManager::RegisterType(tryCreateDummyResource);
+        auto restoreTypeTable = MakeScopeWarden([&] { ResourceManager::UnregisterType(tryCreateDummyResource); });
+
+        int const threadCount = 8;
+
+        for (int i = 0; i < 100; ++i)
+        {
+            auto resource = Make<DummyResource>();
+
+            std::vector<ComPtr<IDummyWrapper>> wrappers(threadCount);
+            std::vector<std::thread> threads;
+
+            for (int j = 0; j < threadCount; ++j)
+            {
+                threads.emplace_back([&, j]
+                {
+                    wrappers[j] = ResourceManager::GetOrCreate<IDummyWrapper>(resource.Get());
+                });
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+
+            for (auto& wrapper : wrappers)
+            {
+                Assert::AreEqual(wrappers[0].Get(), wrapper.Get());
+            }
+        }
+    }
+
+    PERF_TEST_METHOD_EX(ResourceManager_StressTest)
+    {
+        auto tryCreateDummyResource = ResourceManager::TryCreate<IDummyResource, DummyWrapper, ResourceManager::MakeWrapper>;
+        ResourceManager::RegisterType(tryCreateDummyResource);
+        auto restoreTypeTable = MakeScopeWarden([&] { ResourceManager::UnregisterType(tryCreateDummyResource); });
+
+        int const wrappersPerThread = 5000;
+        int const lookupsPerWrapper = 4;
+
+        for (int threadCount : { 1, 2, 4, 8, 16 })
+        {
+            std::atomic<bool> lookupFailed(false);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            std::vector<std::thread> threads;
+            for (int i = 0; i < threadCount; ++i)
+            {
+                threads.emplace_back([&]
+                {
+                    for (int j = 0; j < wrappersPerThread; ++j)
+                    {
+                        // Creating and releasing the wrapper exercises Add and Remove
+                        auto resource = Make<DummyResource>();
+                        auto wrapper = ResourceManager::GetOrCreate<IDummyWrapper>(resource.Get());
+
+                        for (int k = 0; k < lookupsPerWrapper; ++k)
+                        {
+                            if (ResourceManager::GetOrCreate<IDummyWrapper>(resource.Get()) != wrapper)
+                                lookupFailed = true;
+                        }
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            Assert::IsFalse(lookupFailed.load());
+
+            auto operationCount = threadCount * wrappersPerThread * (lookupsPerWrapper + 1);
+
+            wchar_t message[200];
+            ThrowIfFailed(StringCchPrintf(message, _countof(message),
+                L"%d threads: %.0f GetOrCreate calls per second\n",
+                threadCount,
+                operationCount / elapsed.count()));
+
+            Logger::WriteMessage(message);
+        }
+    }
 };
 
 